@@ -0,0 +1,41 @@
+// AQI math: what aqi::Update() does once per snapshot, instead of every
+// page render and display refresh doing it.
+
+#include <aqi.h>
+#include <bench.h>
+
+namespace {
+
+void BM_Pm2_5Aqi(bench::State& state) {
+  // Sweeps the breakpoint table rather than hitting one branch.
+  float pm2_5 = 0;
+  for (auto _ : state) {
+    bench::DoNotOptimize(aqi::Pm2_5Aqi(pm2_5));
+    pm2_5 = pm2_5 < 300 ? pm2_5 + 7.3f : 0;
+  }
+}
+BENCHMARK(BM_Pm2_5Aqi);
+
+void BM_GetLevel(bench::State& state) {
+  int value = 0;
+  for (auto _ : state) {
+    bench::DoNotOptimize(aqi::GetLevel(value));
+    value = value < 500 ? value + 13 : 0;
+  }
+}
+BENCHMARK(BM_GetLevel);
+
+void BM_Derive(bench::State& state) {
+  pmsx003::Data pms = {};
+  dsco220::Data dsco220 = {};
+  for (auto _ : state) {
+    bench::DoNotOptimize(aqi::Derive(pms, dsco220));
+    pms.pm_1_0 = pms.pm_1_0 < 200 ? pms.pm_1_0 + 3.1f : 0;
+    pms.pm_2_5 = pms.pm_2_5 < 300 ? pms.pm_2_5 + 7.3f : 0;
+    pms.pm_10_0 = pms.pm_10_0 < 500 ? pms.pm_10_0 + 11.7f : 0;
+    dsco220.co2_ppm = dsco220.co2_ppm < 5000 ? dsco220.co2_ppm + 97 : 400;
+  }
+}
+BENCHMARK(BM_Derive);
+
+}  // namespace
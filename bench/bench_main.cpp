@@ -0,0 +1,45 @@
+// Runs every benchmark and prints one JSON line per result.
+//
+// On the ESP32:  pio run -e bench -t upload -t monitor
+// On the host:   pneumatic_bench [--filter=<substring>] [--min-time-ms=<n>]
+//                                [--stack-size=<bytes>]
+
+#include <Arduino.h>
+#include <bench.h>
+#include <string.h>
+
+#ifdef ARDUINO
+void setup() {
+  Serial.begin(115200);
+  // Give the monitor a moment to attach.
+  delay(2000);
+  bench::RunAll(bench::Options(), &Serial);
+  Serial.println("{\"done\":true}");
+}
+
+void loop() { delay(1000); }
+#else
+int main(int argc, char** argv) {
+  bench::Options options;
+  // x86-64 frames and glibc's stdio are far larger than on the device; this
+  // keeps deep benchmarks from pinning the measurement at the stack size.
+  options.stack_size = 64 * 1024;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strncmp(arg, "--filter=", 9) == 0) {
+      options.filter = arg + 9;
+    } else if (strncmp(arg, "--min-time-ms=", 14) == 0) {
+      options.min_time_ms = atoi(arg + 14);
+    } else if (strncmp(arg, "--stack-size=", 13) == 0) {
+      options.stack_size = atoi(arg + 13);
+    } else {
+      fprintf(stderr,
+              "usage: %s [--filter=<substring>] [--min-time-ms=<n>] "
+              "[--stack-size=<bytes>]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  return bench::RunAll(options, &Serial) > 0 ? 0 : 1;
+}
+#endif
@@ -0,0 +1,50 @@
+#ifndef _BENCH_UTIL_H_
+#define _BENCH_UTIL_H_
+
+// Inputs shared by the benchmarks.
+
+#include <Print.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fills frame with a valid Plantower frame around big-endian payload words;
+// frame must hold 6 + 2 * word_count bytes.
+inline void MakePlantowerFrame(const uint16_t* words, size_t word_count,
+                               uint8_t* frame) {
+  const size_t length = word_count * 2 + 2;
+  frame[0] = 0x42;
+  frame[1] = 0x4d;
+  frame[2] = length >> 8;
+  frame[3] = length & 0xff;
+  for (size_t i = 0; i < word_count; ++i) {
+    frame[4 + 2 * i] = words[i] >> 8;
+    frame[5 + 2 * i] = words[i] & 0xff;
+  }
+  uint16_t checksum = 0;
+  for (size_t i = 0; i < 4 + 2 * word_count; ++i) {
+    checksum += frame[i];
+  }
+  frame[4 + 2 * word_count] = checksum >> 8;
+  frame[5 + 2 * word_count] = checksum & 0xff;
+}
+
+// Discards everything printed to it, so rendering is measured without any
+// network or serial I/O.
+class NullPrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    ++bytes_;
+    return 1;
+  }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    bytes_ += size;
+    return size;
+  }
+
+  size_t bytes() const { return bytes_; }
+
+ private:
+  size_t bytes_ = 0;
+};
+
+#endif  // _BENCH_UTIL_H_
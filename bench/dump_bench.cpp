@@ -0,0 +1,18 @@
+// Duration formatting, used in every log line and on the status page.
+
+#include <bench.h>
+#include <dump.h>
+
+namespace {
+
+void BM_MillisHumanReadable(bench::State& state) {
+  // A bit over 3 days, so every unit is printed.
+  unsigned long ms = 3 * 24 * 3600 * 1000ul + 4 * 3600 * 1000ul + 123456;
+  for (auto _ : state) {
+    bench::DoNotOptimize(dump::MillisHumanReadable(ms));
+    ++ms;
+  }
+}
+BENCHMARK(BM_MillisHumanReadable);
+
+}  // namespace
@@ -0,0 +1,39 @@
+// Compressing responses on the fly.
+
+#include <bench.h>
+#include <gzip.h>
+#include <metrics.h>
+#include <string.h>
+
+#include "bench_util.h"
+
+namespace {
+
+gzip::GzipPrint gz;
+
+// 300 lines of history CSV, as /api/v1/history sends by default.
+void BM_GzipHistoryCsv(bench::State& state) {
+  static char csv[300 * 40];
+  static size_t size = 0;
+  if (size == 0) {
+    for (int i = 0; i < 300; ++i) {
+      size += metrics::FormatInt(1697000000 + 120 * i, csv + size);
+      for (int v : {610 + i % 7, 640 + i % 13, 625 + i % 5}) {
+        csv[size++] = ',';
+        size += metrics::FormatInt(v, csv + size);
+      }
+      memcpy(csv + size, ",120\n", 5);
+      size += 5;
+    }
+  }
+  NullPrint out;
+  for (auto _ : state) {
+    gz.Begin(&out);
+    gz.write(reinterpret_cast<const uint8_t*>(csv), size);
+    gz.Finish();
+  }
+  bench::DoNotOptimize(out.bytes());
+}
+BENCHMARK(BM_GzipHistoryCsv);
+
+}  // namespace
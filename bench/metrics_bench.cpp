@@ -0,0 +1,54 @@
+// The pieces of a /varz scrape: number formatting on every line, and label
+// rendering, which the label cache only pays for when the network changes.
+
+#include <bench.h>
+#include <metrics.h>
+#include <string.h>
+
+namespace {
+
+metrics::Identity MakeIdentity() {
+  metrics::Identity identity = {};
+  const uint8_t mac[6] = {0x24, 0x0a, 0xc4, 0x00, 0x51, 0x3e};
+  memcpy(identity.mac, mac, sizeof(mac));
+  identity.ip = 192 | 168 << 8 | 1 << 16 | 23u << 24;
+  strcpy(identity.hostname, "pneumatic");
+  strcpy(identity.ssid, "home");
+  const uint8_t bssid[6] = {0xaa, 0xbb, 0xcc, 0x01, 0x02, 0x03};
+  memcpy(identity.bssid, bssid, sizeof(bssid));
+  identity.channel = 11;
+  return identity;
+}
+
+void BM_FormatFixed(bench::State& state) {
+  char buf[metrics::kMaxNumberSize];
+  double value = 101325.37;
+  for (auto _ : state) {
+    bench::DoNotOptimize(metrics::FormatFixed(value, 2, buf));
+    value += 0.01;
+  }
+}
+BENCHMARK(BM_FormatFixed);
+
+void BM_RenderLabels(bench::State& state) {
+  const metrics::Identity identity = MakeIdentity();
+  metrics::Labels labels;
+  for (auto _ : state) {
+    metrics::RenderLabels(identity, &labels);
+    bench::ClobberMemory();
+  }
+}
+BENCHMARK(BM_RenderLabels);
+
+void BM_LabelCacheHit(bench::State& state) {
+  const metrics::Identity identity = MakeIdentity();
+  metrics::LabelCache cache;
+  metrics::Labels labels;
+  for (auto _ : state) {
+    cache.Get(identity, &labels);
+    bench::ClobberMemory();
+  }
+}
+BENCHMARK(BM_LabelCacheHit);
+
+}  // namespace
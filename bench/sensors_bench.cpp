@@ -0,0 +1,71 @@
+// Frame verification and decoding for the Plantower sensors.
+
+#include <bench.h>
+#include <dsco220.h>
+#include <plantower.h>
+#include <pmsx003.h>
+#include <string.h>
+
+#include "bench_util.h"
+
+namespace {
+
+struct Frames {
+  Frames() {
+    const uint16_t pms[] = {5, 12, 15, 5, 12, 15, 2160, 660, 108, 10, 3, 1, 0x9700};
+    MakePlantowerFrame(pms, sizeof(pms) / sizeof(pms[0]), pmsx003);
+    const uint16_t ds[] = {612, 0, 0};
+    MakePlantowerFrame(ds, sizeof(ds) / sizeof(ds[0]), dsco220);
+  }
+  uint8_t pmsx003[32];
+  uint8_t dsco220[12];
+};
+
+const Frames& frames() {
+  static const Frames frames;
+  return frames;
+}
+
+void BM_Pmsx003VerifyPacket(bench::State& state) {
+  uint8_t frame[32];
+  memcpy(frame, frames().pmsx003, sizeof(frame));
+  for (auto _ : state) {
+    bench::DoNotOptimize(pmsx003::VerifyPacket(frame, sizeof(frame)));
+  }
+}
+BENCHMARK(BM_Pmsx003VerifyPacket);
+
+void BM_Pmsx003Decode(bench::State& state) {
+  pmsx003::Data data = {};
+  for (auto _ : state) {
+    bench::DoNotOptimize(
+        pmsx003::Decode(frames().pmsx003, sizeof(frames().pmsx003), &data));
+  }
+  bench::DoNotOptimize(data);
+}
+BENCHMARK(BM_Pmsx003Decode);
+
+// The whole receive path: bytes into the frame parser, then decoded.
+void BM_Pmsx003ParseAndDecode(bench::State& state) {
+  plantower::FrameParser parser;
+  pmsx003::Data data = {};
+  for (auto _ : state) {
+    parser.Feed(frames().pmsx003, sizeof(frames().pmsx003));
+    bench::DoNotOptimize(
+        pmsx003::Decode(parser.frame(), parser.frame_size(), &data));
+  }
+  bench::DoNotOptimize(data);
+}
+BENCHMARK(BM_Pmsx003ParseAndDecode);
+
+void BM_Dsco220Decode(bench::State& state) {
+  dsco220::Data data = {};
+  for (auto _ : state) {
+    bench::DoNotOptimize(
+        dsco220::Decode(frames().dsco220, sizeof(frames().dsco220), &data));
+  }
+  bench::DoNotOptimize(data);
+}
+BENCHMARK(BM_Dsco220Decode);
+
+}  // namespace
@@ -0,0 +1,55 @@
+// Rolling samples up into the history tiers, and reading them back.
+
+#include <bench.h>
+#include <timeseries.h>
+
+namespace {
+
+timeseries::Series series(/*resolution=*/0.1);
+timeseries::Point points[720];
+timeseries::Bucket buckets[720];
+uint32_t starts_s[720];
+
+// A sample a second, so most land in open buckets and one in ten closes
+// the finest tier's.
+void BM_SeriesAdd(bench::State& state) {
+  series.Clear();
+  unsigned long timestamp_ms = 0;
+  float value = 0;
+  for (auto _ : state) {
+    series.Add(value, timestamp_ms);
+    timestamp_ms += 1000;
+    value = value < 500 ? value + 1.7f : 0;
+  }
+  bench::DoNotOptimize(series.samples());
+}
+BENCHMARK(BM_SeriesAdd);
+
+// A full day of the 2 minute tier, as a history graph wants it.
+void BM_SeriesReadDay(bench::State& state) {
+  series.Clear();
+  for (unsigned long s = 0; s < 24 * 60 * 60; s += 5) {
+    series.Add(s % 1000 / 10.0f, s * 1000);
+  }
+  for (auto _ : state) {
+    bench::DoNotOptimize(series.Read(1, 0, points, 720));
+  }
+}
+BENCHMARK(BM_SeriesReadDay);
+
+// A day of the 2 minute tier down to what /api/v1/history sends by default.
+void BM_Downsample(bench::State& state) {
+  series.Clear();
+  for (unsigned long s = 0; s < 24 * 60 * 60; s += 5) {
+    series.Add(s % 1000 / 10.0f, s * 1000);
+  }
+  for (auto _ : state) {
+    const size_t count =
+        series.Read(1, 0, UINT32_MAX, buckets, starts_s, 720);
+    bench::DoNotOptimize(
+        timeseries::Downsample(buckets, starts_s, count, /*threshold=*/300));
+  }
+}
+BENCHMARK(BM_Downsample);
+
+}  // namespace
@@ -0,0 +1,83 @@
+// Packing samples into flash log pages, and scanning them back. The flash is
+// RAM, so this is the encoding and decoding alone; programming and erasing
+// real flash comes on top.
+
+#include <bench.h>
+#include <string.h>
+#include <tslog.h>
+
+namespace {
+
+class RamFlash : public tslog::Flash {
+ public:
+  size_t size() const override { return sizeof(data_); }
+  bool Read(size_t offset, void* data, size_t size) override {
+    memcpy(data, data_ + offset, size);
+    return true;
+  }
+  bool Write(size_t offset, const void* data, size_t size) override {
+    for (size_t i = 0; i < size; ++i) {
+      data_[offset + i] &= static_cast<const uint8_t*>(data)[i];
+    }
+    return true;
+  }
+  bool Erase(size_t offset, size_t size) override {
+    memset(data_ + offset, 0xff, size);
+    return true;
+  }
+
+ private:
+  uint8_t data_[8 * tslog::kSectorSize];
+};
+
+RamFlash flash;
+tslog::Log log(&flash);
+// Runs keep going from where the last left off, samples having to come in
+// time order.
+uint32_t time_s = 1700000000;
+
+void Mount() {
+  static const bool mounted = log.Mount();
+  (void)mounted;
+}
+
+// Six streams a second apart, as history::Record() logs the sensors, and
+// the pages they fill written out, as history::TaskWriteLog() does.
+void BM_LogAppend(bench::State& state) {
+  Mount();
+  int16_t value = 0;
+  for (auto _ : state) {
+    for (int stream = 0; stream < 6; ++stream) {
+      log.Append(stream, time_s, value + stream);
+    }
+    log.WriteOut();
+    ++time_s;
+    value += (time_s * 7919) % 5 - 2;
+  }
+  bench::DoNotOptimize(log.stats().samples);
+}
+BENCHMARK(BM_LogAppend);
+
+bool Count(const tslog::Sample& sample, void* count) {
+  ++*reinterpret_cast<size_t*>(count);
+  return true;
+}
+
+// An hour of one of six streams, out of what fits.
+void BM_LogScanHour(bench::State& state) {
+  Mount();
+  for (int i = 0; i < 3 * 60 * 60; ++i, ++time_s) {
+    for (int stream = 0; stream < 6; ++stream) {
+      log.Append(stream, time_s, (i * 7919) % 5);
+    }
+    log.WriteOut();
+  }
+  for (auto _ : state) {
+    size_t count = 0;
+    log.Scan(0, time_s - 60 * 60, time_s, Count, &count);
+    bench::DoNotOptimize(count);
+  }
+}
+BENCHMARK(BM_LogScanHour);
+
+}  // namespace
@@ -0,0 +1,91 @@
+// Rendering of the web pages.
+
+#include <bench.h>
+#include <sensor_bus.h>
+#include <ui.h>
+
+#include "bench_util.h"
+
+namespace {
+
+// Topics holding one plausible reading each, like a device that has been up
+// for a while.
+struct Readings {
+  Readings()
+      : pmsx003(sensor_bus::kPmsx003),
+        mhz19(sensor_bus::kMhz19),
+        dsco220(sensor_bus::kDsco220),
+        bme(sensor_bus::kBme),
+        aqi(sensor_bus::kAqi) {
+    pmsx003::Data pms = {};
+    pms.pm_1_0 = 5.2;
+    pms.pm_2_5 = 12.4;
+    pms.pm_10_0 = 15.1;
+    pms.particles_gt_0_3 = 2160;
+    pms.particles_gt_0_5 = 660;
+    pms.particles_gt_1_0 = 108;
+    pms.particles_gt_2_5 = 10;
+    pms.particles_gt_5_0 = 3;
+    pms.particles_gt_10_0 = 1;
+    pmsx003.Publish(pms, 0);
+    mhz19.Publish({/*co2_ppm=*/615, /*temp_c=*/22}, 0);
+    dsco220.Publish({/*co2_ppm=*/612, 0, 0}, 0);
+    bme.Publish({"BME280", /*temp_c=*/21.6, /*pressure_pa=*/101325,
+                 /*humidity_pct=*/44.7},
+                0);
+    aqi_data.pmsx003 = &pmsx003;
+    aqi_data.dsco220 = &dsco220;
+    aqi_data.topic = &aqi;
+    aqi::Update(&aqi_data, 0);
+    task_data.pmsx003 = &pmsx003;
+    task_data.mhz19 = &mhz19;
+    task_data.dsco220 = &dsco220;
+    task_data.bme = &bme;
+    task_data.aqi = &aqi;
+  }
+
+  sensor_bus::Topic<pmsx003::Data> pmsx003;
+  sensor_bus::Topic<mhz19::Data> mhz19;
+  sensor_bus::Topic<dsco220::Data> dsco220;
+  sensor_bus::Topic<bme::Data> bme;
+  sensor_bus::Topic<aqi::Data> aqi;
+  aqi::TaskData aqi_data = {};
+  ui::TaskData task_data = {};
+};
+
+const Readings& readings() {
+  static const Readings readings;
+  return readings;
+}
+
+// Past the first minute, so the sensor metrics are rendered too.
+const unsigned long kUptimeMs = 10 * 60 * 1000;
+
+void BM_DoVarz(bench::State& state) {
+  NullPrint out;
+  for (auto _ : state) {
+    ui::DoVarz(&out, &readings().task_data, kUptimeMs);
+  }
+  bench::DoNotOptimize(out.bytes());
+}
+BENCHMARK(BM_DoVarz);
+
+void BM_DoStatusz(bench::State& state) {
+  NullPrint out;
+  for (auto _ : state) {
+    ui::DoStatusz(&out, &readings().task_data, kUptimeMs);
+  }
+  bench::DoNotOptimize(out.bytes());
+}
+BENCHMARK(BM_DoStatusz);
+
+void BM_DoReadings(bench::State& state) {
+  NullPrint out;
+  for (auto _ : state) {
+    ui::DoReadings(&out, &readings().task_data, kUptimeMs);
+  }
+  bench::DoNotOptimize(out.bytes());
+}
+BENCHMARK(BM_DoReadings);
+
+}  // namespace
@@ -0,0 +1,84 @@
+#ifndef _HOST_ADAFRUIT_NEOPIXEL_H_
+#define _HOST_ADAFRUIT_NEOPIXEL_H_
+
+// Keeps the pixel colors so they can be inspected, and drives nothing.
+
+#include <stdint.h>
+
+#include <vector>
+
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+
+class Adafruit_NeoPixel {
+ public:
+  Adafruit_NeoPixel(uint16_t num_pixels, int16_t pin, uint16_t type)
+      : pixels_(num_pixels) {}
+
+  void begin() {}
+  void show() {}
+  void setBrightness(uint8_t brightness) { brightness_ = brightness; }
+  uint8_t getBrightness() const { return brightness_; }
+  void setPixelColor(uint16_t n, uint32_t color) {
+    if (n < pixels_.size()) {
+      pixels_[n] = color;
+    }
+  }
+  uint32_t getPixelColor(uint16_t n) const {
+    return n < pixels_.size() ? pixels_[n] : 0;
+  }
+  uint16_t numPixels() const { return pixels_.size(); }
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+    return static_cast<uint32_t>(r) << 16 | static_cast<uint32_t>(g) << 8 | b;
+  }
+  // Same mapping as the library: hue 0-65535 around the wheel.
+  static uint32_t ColorHSV(uint16_t hue, uint8_t sat = 255,
+                           uint8_t val = 255) {
+    uint8_t r, g, b;
+    hue = (hue * 1530L + 32768) / 65536;
+    if (hue < 510) {
+      b = 0;
+      if (hue < 255) {
+        r = 255;
+        g = hue;
+      } else {
+        r = 510 - hue;
+        g = 255;
+      }
+    } else if (hue < 1020) {
+      r = 0;
+      if (hue < 765) {
+        g = 255;
+        b = hue - 510;
+      } else {
+        g = 1020 - hue;
+        b = 255;
+      }
+    } else if (hue < 1530) {
+      g = 0;
+      if (hue < 1275) {
+        r = hue - 1020;
+        b = 255;
+      } else {
+        r = 255;
+        b = 1530 - hue;
+      }
+    } else {
+      r = 255;
+      g = b = 0;
+    }
+    uint32_t v1 = 1 + val;
+    uint16_t s1 = 1 + sat;
+    uint8_t s2 = 255 - sat;
+    return ((((((r * s1) >> 8) + s2) * v1) & 0xff00) << 8) |
+           (((((g * s1) >> 8) + s2) * v1) & 0xff00) |
+           (((((b * s1) >> 8) + s2) * v1) >> 8);
+  }
+
+ private:
+  std::vector<uint32_t> pixels_;
+  uint8_t brightness_ = 0;
+};
+
+#endif  // _HOST_ADAFRUIT_NEOPIXEL_H_
@@ -0,0 +1,124 @@
+// Arduino core timing, GPIO and the console.
+
+#include "Arduino.h"
+
+#include <sched.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <random>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "host.h"
+
+HardwareSerial Serial(0);
+EspClass ESP;
+
+unsigned long millis() { return host::SimMicros() / 1000; }
+
+unsigned long micros() { return host::SimMicros(); }
+
+void delay(uint32_t ms) { vTaskDelay(ms / portTICK_PERIOD_MS); }
+
+void delayMicroseconds(uint32_t us) { host::SleepSimMicros(us); }
+
+void yield() { sched_yield(); }
+
+// No GPIO is driven from outside, so every input reads the pull-up: idle I2C
+// lines and unpressed buttons.
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t value) {}
+int digitalRead(uint8_t pin) { return HIGH; }
+
+void ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits) {}
+void ledcAttachPin(uint8_t pin, uint8_t channel) {}
+void ledcWrite(uint8_t channel, uint32_t duty) {}
+
+namespace {
+std::mt19937& Rng() {
+  static std::mt19937 rng(1);
+  return rng;
+}
+}  // namespace
+
+long random(long max) { return max <= 0 ? 0 : Rng()() % max; }
+
+long random(long min, long max) {
+  return max <= min ? min : min + random(max - min);
+}
+
+uint64_t EspClass::getEfuseMac() {
+  // 24:0a:c4:00:51:3e, stored the way the eFuse reads it.
+  return 0x3e5100c40a24ull;
+}
+
+uint32_t EspClass::getFreeHeap() { return esp_get_free_heap_size(); }
+
+void EspClass::restart() { esp_restart(); }
+
+uint32_t EspClass::getCycleCount() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+uint32_t EspClass::getCpuFreqMHz() {
+  static const uint32_t mhz = [this] {
+    auto start = std::chrono::steady_clock::now();
+    uint32_t start_cycles = getCycleCount();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint32_t cycles = getCycleCount() - start_cycles;
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<uint32_t>(
+        cycles / std::chrono::duration<double, std::micro>(elapsed).count() +
+        0.5);
+  }();
+  return mhz;
+}
+
+int HardwareSerial::available() {
+  return uart_nr_ == 0 ? 0 : host::UartAvailable(uart_nr_);
+}
+
+int HardwareSerial::read() {
+  uint8_t c;
+  if (uart_nr_ == 0 || host::UartRead(uart_nr_, &c, 1) != 1) {
+    return -1;
+  }
+  return c;
+}
+
+int HardwareSerial::peek() {
+  return uart_nr_ == 0 ? -1 : host::UartPeek(uart_nr_);
+}
+
+size_t HardwareSerial::readBytes(uint8_t* buffer, size_t length) {
+  if (uart_nr_ == 0) {
+    return 0;
+  }
+  return Stream::readBytes(buffer, length);
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  if (uart_nr_ == 0) {
+    return fwrite(buffer, 1, size, stdout);
+  }
+  host::UartWrite(uart_nr_, buffer, size);
+  return size;
+}
+
+void HardwareSerial::flush() {
+  if (uart_nr_ == 0) {
+    fflush(stdout);
+  }
+}
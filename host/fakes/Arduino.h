@@ -0,0 +1,68 @@
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+// Host stand-in for the Arduino core: timing, GPIO no-ops and Serial.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "HardwareSerial.h"
+#include "Print.h"
+#include "Stream.h"
+#include "WString.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+#define OPEN_DRAIN 0x10
+#define OUTPUT_OPEN_DRAIN 0x12
+
+// Simulated time since boot. Runs faster than wall time when the simulation
+// speed is above 1 (see host::SetSpeed()).
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+void ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+long random(long max);
+long random(long min, long max);
+
+class EspClass {
+ public:
+  uint64_t getEfuseMac();
+  uint32_t getFreeHeap();
+  void restart();
+  // The host's time stamp counter where there is one, else nanoseconds; like
+  // the device's, it wraps at 32 bits.
+  uint32_t getCycleCount();
+  // Rate of getCycleCount(), measured once.
+  uint32_t getCpuFreqMHz();
+};
+extern EspClass ESP;
+
+#endif  // _HOST_ARDUINO_H_
@@ -0,0 +1,19 @@
+#ifndef _HOST_DNS_SERVER_H_
+#define _HOST_DNS_SERVER_H_
+
+// Answers nothing: the simulated soft AP has no clients to ask.
+
+#include "IPAddress.h"
+#include "WString.h"
+
+class DNSServer {
+ public:
+  bool start(const uint16_t& port, const String& domain_name,
+             const IPAddress& resolved_ip) {
+    return true;
+  }
+  void processNextRequest() {}
+  void stop() {}
+};
+
+#endif  // _HOST_DNS_SERVER_H_
@@ -0,0 +1,34 @@
+#ifndef _HOST_HTTP_CLIENT_H_
+#define _HOST_HTTP_CLIENT_H_
+
+// No outbound network in the simulation: every request is refused.
+
+#include "WiFiClient.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+typedef enum {
+  HTTP_CODE_OK = 200,
+  HTTP_CODE_ALREADY_REPORTED = 208,
+} t_http_codes;
+
+class HTTPClient {
+ public:
+  bool begin(WiFiClient& client, const char* host, uint16_t port,
+             const char* uri = "/", bool https = false) {
+    return true;
+  }
+  bool begin(const char* url) { return true; }
+  void end() {}
+  void setReuse(bool reuse) {}
+  void setConnectTimeout(int32_t timeout_ms) {}
+  void setTimeout(uint16_t timeout_ms) {}
+  void setUserAgent(const String& user_agent) {}
+  void addHeader(const String& name, const String& value) {}
+  int GET() { return HTTPC_ERROR_CONNECTION_REFUSED; }
+  int POST(const String& payload) { return HTTPC_ERROR_CONNECTION_REFUSED; }
+  String getString() { return String(); }
+  static String errorToString(int error) { return "connection refused"; }
+};
+
+#endif  // _HOST_HTTP_CLIENT_H_
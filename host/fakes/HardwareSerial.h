@@ -0,0 +1,34 @@
+#ifndef _HOST_HARDWARE_SERIAL_H_
+#define _HOST_HARDWARE_SERIAL_H_
+
+#include "Stream.h"
+
+#define SERIAL_8N1 0x800001c
+
+// The console (Serial) writes to stdout. Other ports are the fake UART ports
+// that simulated devices attach to with host::UartAttach().
+class HardwareSerial : public Stream {
+ public:
+  explicit HardwareSerial(int uart_nr) : uart_nr_(uart_nr) {}
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rx_pin = -1,
+             int8_t tx_pin = -1) {}
+  void end() {}
+  operator bool() const { return true; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(uint8_t* buffer, size_t length) override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  void flush() override;
+
+ private:
+  int uart_nr_;
+};
+
+extern HardwareSerial Serial;
+
+#endif  // _HOST_HARDWARE_SERIAL_H_
@@ -0,0 +1,38 @@
+#ifndef _HOST_IP_ADDRESS_H_
+#define _HOST_IP_ADDRESS_H_
+
+#include <stdint.h>
+
+#include "WString.h"
+
+class IPAddress {
+ public:
+  IPAddress() = default;
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+      : bytes_{a, b, c, d} {}
+  // As stored by lwIP: the first octet in the lowest byte.
+  explicit IPAddress(uint32_t address) {
+    for (int i = 0; i < 4; ++i) {
+      bytes_[i] = address >> (8 * i);
+    }
+  }
+
+  operator uint32_t() const {
+    return bytes_[0] | bytes_[1] << 8 | bytes_[2] << 16 |
+           static_cast<uint32_t>(bytes_[3]) << 24;
+  }
+  uint8_t operator[](int i) const { return bytes_[i]; }
+  bool operator==(const IPAddress& other) const {
+    return uint32_t(*this) == uint32_t(other);
+  }
+
+  String toString() const {
+    return String(int(bytes_[0])) + "." + String(int(bytes_[1])) + "." +
+           String(int(bytes_[2])) + "." + String(int(bytes_[3]));
+  }
+
+ private:
+  uint8_t bytes_[4] = {0, 0, 0, 0};
+};
+
+#endif  // _HOST_IP_ADDRESS_H_
@@ -0,0 +1,93 @@
+#include "Print.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Arduino.h"
+#include "Stream.h"
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (n < size && write(buffer[n])) {
+    ++n;
+  }
+  return n;
+}
+
+size_t Print::write(const char* str) {
+  return str == nullptr ? 0 : write(str, strlen(str));
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (len < 0) {
+    return 0;
+  }
+  if (static_cast<size_t>(len) < sizeof(buffer)) {
+    return write(buffer, len);
+  }
+  std::string big(len + 1, '\0');
+  va_start(args, format);
+  vsnprintf(&big[0], big.size(), format, args);
+  va_end(args);
+  return write(big.data(), len);
+}
+
+size_t Print::print(unsigned char value, int base) {
+  return print(static_cast<unsigned long>(value), base);
+}
+
+size_t Print::print(int value, int base) {
+  return print(static_cast<long>(value), base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+  return print(static_cast<unsigned long>(value), base);
+}
+
+// Unlike String, Print spells hex digits in upper case.
+size_t Print::print(long value, int base) {
+  String s(value, static_cast<unsigned char>(base));
+  s.toUpperCase();
+  return print(s);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  String s(value, static_cast<unsigned char>(base));
+  s.toUpperCase();
+  return print(s);
+}
+
+size_t Print::print(double value, int digits) {
+  return print(String(value, static_cast<unsigned int>(digits)));
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+  size_t n = 0;
+  unsigned long start_ms = millis();
+  while (n < length) {
+    int c = read();
+    if (c < 0) {
+      if (millis() - start_ms >= timeout_ms_) {
+        break;
+      }
+      delay(1);
+      continue;
+    }
+    buffer[n++] = c;
+  }
+  return n;
+}
+
+String Stream::readString() {
+  String s;
+  for (int c = read(); c >= 0; c = read()) {
+    s += static_cast<char>(c);
+  }
+  return s;
+}
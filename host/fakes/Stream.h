@@ -0,0 +1,25 @@
+#ifndef _HOST_STREAM_H_
+#define _HOST_STREAM_H_
+
+#include "Print.h"
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout_ms) { timeout_ms_ = timeout_ms; }
+
+  // Reads up to length bytes, waiting up to the stream timeout for each.
+  virtual size_t readBytes(uint8_t* buffer, size_t length);
+  size_t readBytes(char* buffer, size_t length) {
+    return readBytes(reinterpret_cast<uint8_t*>(buffer), length);
+  }
+  String readString();
+
+ protected:
+  unsigned long timeout_ms_ = 1000;
+};
+
+#endif  // _HOST_STREAM_H_
@@ -0,0 +1,72 @@
+#ifndef _HOST_TFT_ESPI_H_
+#define _HOST_TFT_ESPI_H_
+
+// The display draws nothing on the host; only the calls the firmware makes
+// exist, so the UI task runs and is measured like any other.
+
+#include <stdint.h>
+
+#include "Print.h"
+#include "WString.h"
+
+#ifndef TFT_BL
+#define TFT_BL 4
+#endif
+
+#define TFT_BLACK 0x0000
+#define TFT_BLUE 0x001F
+#define TFT_RED 0xF800
+#define TFT_GREEN 0x07E0
+#define TFT_WHITE 0xFFFF
+
+#define TL_DATUM 0
+#define TR_DATUM 2
+#define BL_DATUM 6
+#define BR_DATUM 8
+
+struct GFXfont {};
+
+class TFT_eSPI : public Print {
+ public:
+  void init() {}
+  void setRotation(uint8_t rotation) {}
+  void invertDisplay(bool invert) {}
+  void fillScreen(uint32_t color) {}
+  void setCursor(int16_t x, int16_t y, uint8_t font = 1) {}
+  void setTextColor(uint16_t color) {}
+  void setTextColor(uint16_t fg, uint16_t bg) {}
+  size_t write(uint8_t c) override { return 1; }
+  using Print::write;
+
+  uint16_t color24to16(uint32_t color888) {
+    return (color888 >> 8 & 0xF800) | (color888 >> 5 & 0x07E0) |
+           (color888 >> 3 & 0x001F);
+  }
+  uint16_t alphaBlend(uint8_t alpha, uint16_t fgc, uint16_t bgc) {
+    auto blend = [alpha](uint16_t fg, uint16_t bg) {
+      return (fg * alpha + bg * (255 - alpha)) / 255;
+    };
+    return (blend(fgc >> 11, bgc >> 11) << 11) |
+           (blend(fgc >> 5 & 0x3F, bgc >> 5 & 0x3F) << 5) |
+           blend(fgc & 0x1F, bgc & 0x1F);
+  }
+};
+
+class TFT_eSprite : public TFT_eSPI {
+ public:
+  explicit TFT_eSprite(TFT_eSPI* tft) {}
+
+  void* createSprite(int16_t width, int16_t height) { return this; }
+  void pushSprite(int32_t x, int32_t y) {}
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {}
+  void setTextDatum(uint8_t datum) {}
+  void setFreeFont(const GFXfont* font) {}
+  int16_t drawString(const char* string, int32_t x, int32_t y) { return 0; }
+  int16_t drawString(const String& string, int32_t x, int32_t y) { return 0; }
+  int16_t drawNumber(long number, int32_t x, int32_t y) { return 0; }
+};
+
+inline const GFXfont FreeMonoBold9pt7b = {};
+inline const GFXfont FreeMonoBold24pt7b = {};
+
+#endif  // _HOST_TFT_ESPI_H_
@@ -0,0 +1,121 @@
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+namespace {
+
+std::string ToBase(unsigned long value, unsigned char base) {
+  if (base < 2 || base > 36) {
+    base = 10;
+  }
+  if (value == 0) {
+    return "0";
+  }
+  std::string s;
+  while (value > 0) {
+    int digit = value % base;
+    s += static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10);
+    value /= base;
+  }
+  std::reverse(s.begin(), s.end());
+  return s;
+}
+
+std::string SignedToBase(long value, unsigned char base) {
+  if (base == DEC && value < 0) {
+    return "-" + ToBase(-static_cast<unsigned long>(value), base);
+  }
+  return ToBase(static_cast<unsigned long>(value), base);
+}
+
+std::string Fixed(double value, unsigned int decimal_places) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimal_places, value);
+  return buffer;
+}
+
+}  // namespace
+
+String::String(unsigned char value, unsigned char base)
+    : s_(ToBase(value, base)) {}
+String::String(int value, unsigned char base) : s_(SignedToBase(value, base)) {}
+String::String(unsigned int value, unsigned char base)
+    : s_(ToBase(value, base)) {}
+String::String(long value, unsigned char base)
+    : s_(SignedToBase(value, base)) {}
+String::String(unsigned long value, unsigned char base)
+    : s_(ToBase(value, base)) {}
+String::String(float value, unsigned int decimal_places)
+    : s_(Fixed(value, decimal_places)) {}
+String::String(double value, unsigned int decimal_places)
+    : s_(Fixed(value, decimal_places)) {}
+
+void String::replace(const String& find, const String& replace) {
+  if (find.s_.empty()) {
+    return;
+  }
+  for (size_t pos = s_.find(find.s_); pos != std::string::npos;
+       pos = s_.find(find.s_, pos + replace.s_.size())) {
+    s_.replace(pos, find.s_.size(), replace.s_);
+  }
+}
+
+void String::replace(char find, char replace) {
+  std::replace(s_.begin(), s_.end(), find, replace);
+}
+
+void String::toLowerCase() {
+  for (char& c : s_) {
+    c = tolower(static_cast<unsigned char>(c));
+  }
+}
+
+void String::toUpperCase() {
+  for (char& c : s_) {
+    c = toupper(static_cast<unsigned char>(c));
+  }
+}
+
+void String::trim() {
+  size_t begin = s_.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) {
+    s_.clear();
+    return;
+  }
+  size_t end = s_.find_last_not_of(" \t\r\n");
+  s_ = s_.substr(begin, end - begin + 1);
+}
+
+int String::indexOf(const String& s, unsigned int from) const {
+  size_t pos = s_.find(s.s_, from);
+  return pos == std::string::npos ? -1 : pos;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t pos = s_.find(c, from);
+  return pos == std::string::npos ? -1 : pos;
+}
+
+bool String::endsWith(const String& suffix) const {
+  return s_.size() >= suffix.s_.size() &&
+         s_.compare(s_.size() - suffix.s_.size(), suffix.s_.size(),
+                    suffix.s_) == 0;
+}
+
+long String::toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+
+float String::toFloat() const { return strtof(s_.c_str(), nullptr); }
+
+String operator+(const String& a, const String& b) {
+  return String(a.str() + b.str());
+}
+
+String operator+(const String& a, const char* b) { return String(a.str() + b); }
+
+String operator+(const char* a, const String& b) { return String(a + b.str()); }
+
+String operator+(const String& a, char b) { return String(a.str() + b); }
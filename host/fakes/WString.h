@@ -0,0 +1,88 @@
+#ifndef _HOST_WSTRING_H_
+#define _HOST_WSTRING_H_
+
+// Host stand-in for the Arduino String class, backed by std::string.
+
+#include <stdint.h>
+
+#include <string>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class String {
+ public:
+  String() = default;
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  String(char c) : s_(1, c) {}
+  String(unsigned char value, unsigned char base = DEC);
+  String(int value, unsigned char base = DEC);
+  String(unsigned int value, unsigned char base = DEC);
+  String(long value, unsigned char base = DEC);
+  String(unsigned long value, unsigned char base = DEC);
+  String(float value, unsigned int decimal_places = 2);
+  String(double value, unsigned int decimal_places = 2);
+
+  const char* c_str() const { return s_.c_str(); }
+  unsigned int length() const { return s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+  char operator[](unsigned int i) const { return s_[i]; }
+  char& operator[](unsigned int i) { return s_[i]; }
+  char charAt(unsigned int i) const { return s_[i]; }
+
+  String& operator+=(const String& other) {
+    s_ += other.s_;
+    return *this;
+  }
+  String& operator+=(const char* other) {
+    s_ += other;
+    return *this;
+  }
+  String& operator+=(char c) {
+    s_ += c;
+    return *this;
+  }
+  bool concat(const String& other) {
+    s_ += other.s_;
+    return true;
+  }
+
+  bool operator==(const String& other) const { return s_ == other.s_; }
+  bool operator==(const char* other) const { return s_ == other; }
+  bool operator!=(const String& other) const { return s_ != other.s_; }
+  bool operator!=(const char* other) const { return s_ != other; }
+  bool operator<(const String& other) const { return s_ < other.s_; }
+  bool equals(const String& other) const { return s_ == other.s_; }
+
+  void replace(const String& find, const String& replace);
+  void replace(char find, char replace);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+  int indexOf(const String& s, unsigned int from = 0) const;
+  int indexOf(char c, unsigned int from = 0) const;
+  bool startsWith(const String& prefix) const { return s_.rfind(prefix.s_, 0) == 0; }
+  bool endsWith(const String& suffix) const;
+  String substring(unsigned int begin) const { return String(s_.substr(begin)); }
+  String substring(unsigned int begin, unsigned int end) const {
+    return String(s_.substr(begin, end - begin));
+  }
+  long toInt() const;
+  float toFloat() const;
+  void reserve(unsigned int size) { s_.reserve(size); }
+
+  const std::string& str() const { return s_; }
+
+ private:
+  std::string s_;
+};
+
+String operator+(const String& a, const String& b);
+String operator+(const String& a, const char* b);
+String operator+(const char* a, const String& b);
+String operator+(const String& a, char b);
+
+#endif  // _HOST_WSTRING_H_
@@ -0,0 +1,496 @@
+// The simulated station, and WiFiClient/WiFiServer over localhost sockets.
+
+#include "WiFi.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "host.h"
+
+WiFiClass WiFi;
+
+namespace {
+
+const char kSsid[] = "pneumatic-sim";
+const char kPassword[] = "simulated";
+const char kBssid[] = "02:00:00:00:00:01";
+const uint8_t kBssidBytes[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+const int kChannel = 6;
+const int kRssi = -55;
+// 127.0.0.1 in lwIP order.
+const uint32_t kLocalIp = 0x0100007f;
+// How long connecting takes with a scan of every channel; connecting to a
+// given BSSID on its channel skips it.
+const uint32_t kScanMs = 2000;
+// WIFI_REASON_NO_AP_FOUND and WIFI_REASON_AUTH_FAIL
+const uint8_t kNoApFound = 201;
+const uint8_t kAuthFail = 202;
+
+std::mutex wifi_mutex;
+wifi_mode_t wifi_mode = WIFI_MODE_NULL;
+bool connected = false;
+// Taken, but the station stays on 127.0.0.1.
+uint32_t static_ip = 0;
+std::string hostname = "pneumatic-sim";
+wifi_config_t sta_config = {};
+wifi_config_t ap_config = {};
+std::vector<std::pair<arduino_event_id_t, WiFiEventFuncCb>> callbacks;
+wifi_ap_record_t scan_record = {};
+bool provisioned = true;
+
+// Saves the simulated network on first use, unless unprovisioned.
+void InitConfig() {
+  if (provisioned && sta_config.sta.ssid[0] == '\0') {
+    memcpy(sta_config.sta.ssid, kSsid, sizeof(kSsid));
+    memcpy(sta_config.sta.password, kPassword, sizeof(kPassword));
+  }
+}
+
+}  // namespace
+
+void host::SetWifiProvisioned(bool saved) {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  provisioned = saved;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  wifi_mode = mode;
+  return true;
+}
+
+wifi_mode_t WiFiClass::getMode() {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  return wifi_mode;
+}
+
+bool WiFiClass::setHostname(const char* name) {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  hostname = name;
+  return true;
+}
+
+const char* WiFiClass::getHostname() {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  return hostname.c_str();
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb callback,
+                                   arduino_event_id_t event) {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  callbacks.emplace_back(event, callback);
+  return callbacks.size();
+}
+
+void WiFiClass::Raise(arduino_event_id_t event, const WiFiEventInfo_t& info) {
+  std::vector<WiFiEventFuncCb> matching;
+  {
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    for (const auto& entry : callbacks) {
+      if (entry.first == event || entry.first == ARDUINO_EVENT_MAX) {
+        matching.push_back(entry.second);
+      }
+    }
+  }
+  for (const auto& callback : matching) {
+    callback(event, info);
+  }
+}
+
+wl_status_t WiFiClass::begin() {
+  bool scan = true;
+  bool found = true;
+  bool auth = true;
+  {
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    if (wifi_mode == WIFI_MODE_NULL) {
+      wifi_mode = WIFI_MODE_STA;
+    }
+    InitConfig();
+    const wifi_sta_config_t& sta = sta_config.sta;
+    found = strncmp(reinterpret_cast<const char*>(sta.ssid), kSsid,
+                    sizeof(sta.ssid)) == 0;
+    auth = strncmp(reinterpret_cast<const char*>(sta.password), kPassword,
+                   sizeof(sta.password)) == 0;
+    if (found && sta.bssid_set) {
+      scan = false;
+      found = memcmp(sta.bssid, kBssidBytes, sizeof(kBssidBytes)) == 0 &&
+              (sta.channel == 0 || sta.channel == kChannel);
+    }
+  }
+  WiFiEventInfo_t info = {};
+  if (scan) {
+    delay(kScanMs);
+  }
+  if (!found || !auth) {
+    info.wifi_sta_disconnected.reason = found ? kAuthFail : kNoApFound;
+    Raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+    return WL_DISCONNECTED;
+  }
+  {
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    connected = true;
+  }
+  Raise(ARDUINO_EVENT_WIFI_STA_CONNECTED, info);
+  info.got_ip.ip_info.ip.addr = kLocalIp;
+  info.got_ip.ip_info.netmask.addr = 0x000000ff;
+  info.got_ip.ip_info.gw.addr = kLocalIp;
+  Raise(ARDUINO_EVENT_WIFI_STA_GOT_IP, info);
+  return WL_CONNECTED;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* password) {
+  {
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    memset(&sta_config, 0, sizeof(sta_config));
+    // Like the IDF, a 32 character SSID fills the field unterminated.
+    memcpy(sta_config.sta.ssid, ssid,
+           std::min(strlen(ssid), sizeof(sta_config.sta.ssid)));
+    if (password != nullptr) {
+      memcpy(sta_config.sta.password, password,
+             std::min(strlen(password), sizeof(sta_config.sta.password)));
+    }
+    if (strcmp(ssid, kSsid) != 0) {
+      return WL_NO_SSID_AVAIL;
+    }
+  }
+  return begin();
+}
+
+bool WiFiClass::config(IPAddress local_ip, IPAddress gateway,
+                       IPAddress subnet, IPAddress dns1) {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  static_ip = local_ip;
+  return true;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+  {
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    if (!connected) {
+      return true;
+    }
+    connected = false;
+    if (wifioff) {
+      wifi_mode = WIFI_MODE_NULL;
+    }
+  }
+  WiFiEventInfo_t info = {};
+  // WIFI_REASON_ASSOC_LEAVE
+  info.wifi_sta_disconnected.reason = 8;
+  Raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+  return true;
+}
+
+bool WiFiClass::enableSTA(bool enable) {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  if (enable) {
+    wifi_mode = wifi_mode == WIFI_MODE_AP || wifi_mode == WIFI_MODE_APSTA
+                    ? WIFI_MODE_APSTA
+                    : WIFI_MODE_STA;
+  } else if (wifi_mode == WIFI_MODE_APSTA) {
+    wifi_mode = WIFI_MODE_AP;
+  } else if (wifi_mode == WIFI_MODE_STA) {
+    wifi_mode = WIFI_MODE_NULL;
+  }
+  return true;
+}
+
+wl_status_t WiFiClass::status() {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  return connected ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+int16_t WiFiClass::scanNetworks(bool async, bool show_hidden, bool passive,
+                                uint32_t max_ms_per_chan) {
+  memset(&scan_record, 0, sizeof(scan_record));
+  memcpy(scan_record.ssid, kSsid, sizeof(kSsid));
+  sscanf(kBssid, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &scan_record.bssid[0],
+         &scan_record.bssid[1], &scan_record.bssid[2], &scan_record.bssid[3],
+         &scan_record.bssid[4], &scan_record.bssid[5]);
+  scan_record.primary = kChannel;
+  scan_record.rssi = kRssi;
+  scan_record.authmode = WIFI_AUTH_WPA2_PSK;
+  return 1;
+}
+
+String WiFiClass::SSID(uint8_t i) { return i == 0 ? kSsid : ""; }
+int32_t WiFiClass::RSSI(uint8_t i) { return i == 0 ? kRssi : 0; }
+wifi_auth_mode_t WiFiClass::encryptionType(uint8_t i) {
+  return WIFI_AUTH_WPA2_PSK;
+}
+int32_t WiFiClass::channel(uint8_t i) { return i == 0 ? kChannel : 0; }
+String WiFiClass::BSSIDstr(uint8_t i) { return i == 0 ? kBssid : ""; }
+void* WiFiClass::getScanInfoByIndex(int i) {
+  return i == 0 ? &scan_record : nullptr;
+}
+
+String WiFiClass::SSID() { return isConnected() ? kSsid : ""; }
+String WiFiClass::BSSIDstr() { return isConnected() ? kBssid : ""; }
+uint8_t* WiFiClass::BSSID() {
+  static wifi_ap_record_t info;
+  return esp_wifi_sta_get_ap_info(&info) == ESP_OK ? info.bssid : nullptr;
+}
+int32_t WiFiClass::channel() { return kChannel; }
+int8_t WiFiClass::RSSI() { return isConnected() ? kRssi : 0; }
+
+String WiFiClass::macAddress() {
+  uint8_t b[6];
+  macAddress(b);
+  char buffer[18];
+  snprintf(buffer, sizeof(buffer), "%02X:%02X:%02X:%02X:%02X:%02X", b[0], b[1],
+           b[2], b[3], b[4], b[5]);
+  return buffer;
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+  uint64_t efuse_mac = ESP.getEfuseMac();
+  memcpy(mac, &efuse_mac, 6);
+  return mac;
+}
+
+IPAddress WiFiClass::localIP() {
+  return isConnected() ? IPAddress(kLocalIp) : IPAddress();
+}
+IPAddress WiFiClass::gatewayIP() { return localIP(); }
+IPAddress WiFiClass::subnetMask() { return IPAddress(255, 0, 0, 0); }
+IPAddress WiFiClass::networkID() { return IPAddress(127, 0, 0, 0); }
+IPAddress WiFiClass::broadcastIP() { return IPAddress(127, 255, 255, 255); }
+
+bool WiFiClass::softAP(const char* ssid, const char* password, int channel,
+                       int ssid_hidden, int max_connection) {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  memset(&ap_config, 0, sizeof(ap_config));
+  memcpy(ap_config.ap.ssid, ssid,
+         std::min(strlen(ssid), sizeof(ap_config.ap.ssid)));
+  ap_config.ap.ssid_len = std::min(strlen(ssid), sizeof(ap_config.ap.ssid));
+  ap_config.ap.channel = channel;
+  ap_config.ap.max_connection = max_connection;
+  if (wifi_mode == WIFI_MODE_NULL || wifi_mode == WIFI_MODE_AP) {
+    wifi_mode = WIFI_MODE_AP;
+  } else {
+    wifi_mode = WIFI_MODE_APSTA;
+  }
+  return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool wifioff) {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  memset(&ap_config, 0, sizeof(ap_config));
+  if (wifioff) {
+    wifi_mode = wifi_mode == WIFI_MODE_APSTA ? WIFI_MODE_STA : WIFI_MODE_NULL;
+  }
+  return true;
+}
+
+// Servers are kept on localhost, so the station and the AP share it, and
+// the setup page takes posts from the sim.
+IPAddress WiFiClass::softAPIP() { return IPAddress(kLocalIp); }
+
+void WiFiClass::printDiag(Print& out) {
+  out.print("Mode: STA\nChannel: ");
+  out.println(kChannel);
+  out.print("SSID: ");
+  out.println(kSsid);
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t* conf) {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  InitConfig();
+  *conf = interface == WIFI_IF_STA ? sta_config : ap_config;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t* conf) {
+  std::lock_guard<std::mutex> lock(wifi_mutex);
+  (interface == WIFI_IF_STA ? sta_config : ap_config) = *conf;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect() {
+  WiFi.begin();
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_disconnect() {
+  WiFi.disconnect();
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* ap_info) {
+  if (!WiFi.isConnected()) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  WiFi.scanNetworks();
+  *ap_info = scan_record;
+  return ESP_OK;
+}
+
+// WiFiClient
+
+struct WiFiClient::Socket {
+  explicit Socket(int fd) : fd(fd) {}
+  ~Socket() { Close(); }
+  void Close() {
+    if (fd >= 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  int fd;
+};
+
+WiFiClient::WiFiClient(int fd) : socket_(std::make_shared<Socket>(fd)) {}
+
+int WiFiClient::fd() const { return socket_ ? socket_->fd : -1; }
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* result = nullptr;
+  char port_str[8];
+  snprintf(port_str, sizeof(port_str), "%u", host::MapPort(port));
+  if (getaddrinfo(host, port_str, &hints, &result) != 0) {
+    return 0;
+  }
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  int err = fd < 0 ? -1 : ::connect(fd, result->ai_addr, result->ai_addrlen);
+  freeaddrinfo(result);
+  if (err != 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    return 0;
+  }
+  socket_ = std::make_shared<Socket>(fd);
+  return 1;
+}
+
+uint8_t WiFiClient::connected() {
+  if (fd() < 0) {
+    return 0;
+  }
+  uint8_t c;
+  ssize_t n = recv(fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (n > 0) {
+    return 1;
+  }
+  return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+void WiFiClient::stop() {
+  if (socket_) {
+    socket_->Close();
+  }
+}
+
+int WiFiClient::available() {
+  int n = 0;
+  if (fd() < 0 || ioctl(fd(), FIONREAD, &n) != 0) {
+    return 0;
+  }
+  return n;
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+  if (fd() < 0) {
+    return -1;
+  }
+  ssize_t n = recv(fd(), buffer, size, MSG_DONTWAIT);
+  return n > 0 ? n : -1;
+}
+
+int WiFiClient::peek() {
+  uint8_t c;
+  if (fd() < 0 || recv(fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT) != 1) {
+    return -1;
+  }
+  return c;
+}
+
+size_t WiFiClient::write(uint8_t c) { return write(&c, 1); }
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+  size_t sent = 0;
+  while (fd() >= 0 && sent < size) {
+    ssize_t n = send(fd(), buffer + sent, size - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      break;
+    }
+    sent += n;
+  }
+  return sent;
+}
+
+IPAddress WiFiClient::remoteIP() const {
+  struct sockaddr_in addr = {};
+  socklen_t len = sizeof(addr);
+  if (fd() < 0 ||
+      getpeername(fd(), reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+    return IPAddress();
+  }
+  return IPAddress(static_cast<uint32_t>(addr.sin_addr.s_addr));
+}
+
+// WiFiServer
+
+void WiFiServer::begin(uint16_t port) {
+  if (port != 0) {
+    port_ = port;
+  }
+  end();
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(host::MapPort(port_));
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(fd, 16) != 0) {
+    fprintf(stderr, "WiFiServer: can't listen on port %u: %s\n",
+            host::MapPort(port_), strerror(errno));
+    close(fd);
+    return;
+  }
+  socklen_t len = sizeof(addr);
+  getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+  if (port_ == 80) {
+    host::SetBoundHttpPort(ntohs(addr.sin_port));
+  }
+  fd_ = fd;
+}
+
+void WiFiServer::end() {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+WiFiClient WiFiServer::accept() {
+  if (fd_ < 0) {
+    return WiFiClient();
+  }
+  int fd = accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+  return fd < 0 ? WiFiClient() : WiFiClient(fd);
+}
@@ -0,0 +1,126 @@
+#ifndef _HOST_WIFI_H_
+#define _HOST_WIFI_H_
+
+// The simulated station: one network that is always in range, saved unless
+// host::SetWifiProvisioned(false). begin() "connects" to 127.0.0.1 and
+// raises the usual events: after a simulated all-channel scan, or at once
+// when given the BSSID and channel. The soft AP only keeps its settings.
+
+#include <functional>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+#include "esp_wifi.h"
+
+#define WIFI_OFF WIFI_MODE_NULL
+#define WIFI_STA WIFI_MODE_STA
+#define WIFI_AP WIFI_MODE_AP
+#define WIFI_AP_STA WIFI_MODE_APSTA
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6,
+  WL_NO_SHIELD = 255,
+} wl_status_t;
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_READY = 0,
+  ARDUINO_EVENT_WIFI_SCAN_DONE,
+  ARDUINO_EVENT_WIFI_STA_START,
+  ARDUINO_EVENT_WIFI_STA_STOP,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_STA_LOST_IP,
+  ARDUINO_EVENT_MAX,
+} arduino_event_id_t;
+typedef arduino_event_id_t WiFiEvent_t;
+
+typedef union {
+  struct {
+    uint8_t ssid[32];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t reason;
+  } wifi_sta_disconnected;
+  struct {
+    struct {
+      struct {
+        uint32_t addr;
+      } ip, netmask, gw;
+    } ip_info;
+  } got_ip;
+} WiFiEventInfo_t;
+
+typedef std::function<void(WiFiEvent_t event, WiFiEventInfo_t info)>
+    WiFiEventFuncCb;
+typedef int wifi_event_id_t;
+
+class WiFiClass {
+ public:
+  bool mode(wifi_mode_t mode);
+  wifi_mode_t getMode();
+  bool persistent(bool persistent) { return true; }
+  bool setSleep(bool enabled) { return true; }
+  bool setAutoReconnect(bool enabled) { return true; }
+  bool setHostname(const char* hostname);
+  const char* getHostname();
+
+  wifi_event_id_t onEvent(WiFiEventFuncCb callback,
+                          arduino_event_id_t event = ARDUINO_EVENT_MAX);
+
+  wl_status_t begin();
+  wl_status_t begin(const char* ssid, const char* password = nullptr);
+  bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet,
+              IPAddress dns1 = IPAddress());
+  bool disconnect(bool wifioff = false, bool eraseap = false);
+  bool enableSTA(bool enable);
+  wl_status_t status();
+  bool isConnected() { return status() == WL_CONNECTED; }
+
+  int16_t scanNetworks(bool async = false, bool show_hidden = false,
+                       bool passive = false, uint32_t max_ms_per_chan = 300);
+  void scanDelete() {}
+  String SSID(uint8_t i);
+  int32_t RSSI(uint8_t i);
+  wifi_auth_mode_t encryptionType(uint8_t i);
+  int32_t channel(uint8_t i);
+  String BSSIDstr(uint8_t i);
+  void* getScanInfoByIndex(int i);
+
+  String SSID();
+  String BSSIDstr();
+  uint8_t* BSSID();
+  int32_t channel();
+  int8_t RSSI();
+  int getTxPower() { return 78; }
+  String macAddress();
+  uint8_t* macAddress(uint8_t* mac);
+  IPAddress localIP();
+  IPAddress gatewayIP();
+  IPAddress subnetMask();
+  IPAddress networkID();
+  IPAddress broadcastIP();
+  uint8_t subnetCIDR() { return 8; }
+
+  bool softAP(const char* ssid, const char* password = nullptr,
+              int channel = 1, int ssid_hidden = 0, int max_connection = 4);
+  bool softAPdisconnect(bool wifioff = false);
+  IPAddress softAPIP();
+  void printDiag(Print& out);
+
+ private:
+  void Raise(arduino_event_id_t event, const WiFiEventInfo_t& info);
+};
+
+extern WiFiClass WiFi;
+
+#endif  // _HOST_WIFI_H_
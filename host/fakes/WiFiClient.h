@@ -0,0 +1,40 @@
+#ifndef _HOST_WIFI_CLIENT_H_
+#define _HOST_WIFI_CLIENT_H_
+
+// A TCP connection over a real localhost socket.
+
+#include <memory>
+
+#include "IPAddress.h"
+#include "Stream.h"
+
+class WiFiClient : public Stream {
+ public:
+  WiFiClient() = default;
+  // Takes ownership of a connected socket.
+  explicit WiFiClient(int fd);
+
+  int connect(const char* host, uint16_t port);
+  uint8_t connected();
+  operator bool() { return connected(); }
+  void stop();
+
+  int available() override;
+  int read() override;
+  int read(uint8_t* buffer, size_t size);
+  int peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  void flush() override {}
+
+  IPAddress remoteIP() const;
+  int fd() const;
+
+ private:
+  // Copies share the socket, like the ESP32 WiFiClient.
+  struct Socket;
+  std::shared_ptr<Socket> socket_;
+};
+
+#endif  // _HOST_WIFI_CLIENT_H_
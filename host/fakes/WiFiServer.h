@@ -0,0 +1,26 @@
+#ifndef _HOST_WIFI_SERVER_H_
+#define _HOST_WIFI_SERVER_H_
+
+// Listens on localhost; port 80 is remapped with host::SetHttpPort().
+
+#include "WiFiClient.h"
+
+class WiFiServer {
+ public:
+  explicit WiFiServer(uint16_t port = 80) : port_(port) {}
+  ~WiFiServer() { end(); }
+
+  void begin(uint16_t port = 0);
+  void end();
+  operator bool() const { return fd_ >= 0; }
+
+  // Non-blocking; an empty client if nobody is waiting.
+  WiFiClient accept();
+  WiFiClient available() { return accept(); }
+
+ private:
+  uint16_t port_;
+  int fd_ = -1;
+};
+
+#endif  // _HOST_WIFI_SERVER_H_
@@ -0,0 +1,110 @@
+// TwoWire on top of the simulated I2C bus.
+
+#include "Wire.h"
+
+#include <string.h>
+
+#include "host.h"
+
+TwoWire Wire(0);
+TwoWire Wire1(1);
+
+namespace host {
+namespace {
+
+// Start, address byte and a stop, plus 9 clocks per data byte.
+void WaitForWire(size_t bytes, uint32_t clock_hz) {
+  if (clock_hz == 0) {
+    return;
+  }
+  SleepSimMicros((bytes + 1) * 9 * 1000000ull / clock_hz + 1);
+}
+
+}  // namespace
+
+bool I2cWrite(uint8_t address, const uint8_t* data, size_t size,
+              uint32_t clock_hz) {
+  bool acked;
+  {
+    std::lock_guard<std::mutex> lock(DeviceMutex());
+    I2cDevice* device = FindI2cDevice(address);
+    acked = device != nullptr && device->Write(data, size);
+  }
+  // A NACKed address still costs the address byte.
+  WaitForWire(acked ? size : 0, clock_hz);
+  return acked;
+}
+
+bool I2cRead(uint8_t address, uint8_t* data, size_t size, uint32_t clock_hz) {
+  bool acked;
+  {
+    std::lock_guard<std::mutex> lock(DeviceMutex());
+    I2cDevice* device = FindI2cDevice(address);
+    acked = device != nullptr && device->Read(data, size);
+  }
+  WaitForWire(acked ? size : 0, clock_hz);
+  return acked;
+}
+
+}  // namespace host
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+  if (frequency != 0) {
+    clock_hz_ = frequency;
+  }
+  return true;
+}
+
+bool TwoWire::end() { return true; }
+
+bool TwoWire::setClock(uint32_t frequency) {
+  clock_hz_ = frequency;
+  return true;
+}
+
+void TwoWire::beginTransmission(uint16_t address) {
+  tx_address_ = address;
+  tx_size_ = 0;
+}
+
+uint8_t TwoWire::endTransmission(bool send_stop) {
+  bool acked = host::I2cWrite(tx_address_, tx_buffer_, tx_size_, clock_hz_);
+  tx_size_ = 0;
+  // 2: NACK on the address.
+  return acked ? 0 : 2;
+}
+
+uint8_t TwoWire::requestFrom(uint16_t address, uint8_t size, bool send_stop) {
+  rx_pos_ = 0;
+  rx_size_ = 0;
+  if (size > sizeof(rx_buffer_)) {
+    size = sizeof(rx_buffer_);
+  }
+  if (!host::I2cRead(address, rx_buffer_, size, clock_hz_)) {
+    return 0;
+  }
+  rx_size_ = size;
+  return size;
+}
+
+size_t TwoWire::write(uint8_t c) {
+  if (tx_size_ >= sizeof(tx_buffer_)) {
+    return 0;
+  }
+  tx_buffer_[tx_size_++] = c;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t size) {
+  size_t n = 0;
+  while (n < size && write(data[n])) {
+    ++n;
+  }
+  return n;
+}
+
+int TwoWire::available() { return rx_size_ - rx_pos_; }
+
+int TwoWire::read() { return rx_pos_ < rx_size_ ? rx_buffer_[rx_pos_++] : -1; }
+
+int TwoWire::peek() { return rx_pos_ < rx_size_ ? rx_buffer_[rx_pos_] : -1; }
@@ -0,0 +1,61 @@
+#ifndef _HOST_WIRE_H_
+#define _HOST_WIRE_H_
+
+// Host stand-in for the Arduino TwoWire API. Transfers are routed to
+// simulated devices registered with host::I2cAttach().
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Stream.h"
+
+#define I2C_BUFFER_LENGTH 128
+
+class TwoWire : public Stream {
+ public:
+  explicit TwoWire(uint8_t bus_num) : bus_num_(bus_num) {}
+
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  bool end();
+  bool setClock(uint32_t frequency);
+  uint32_t getClock() { return clock_hz_; }
+  void setTimeOut(uint16_t timeout_ms) {}
+
+  void beginTransmission(uint16_t address);
+  void beginTransmission(uint8_t address) {
+    beginTransmission(static_cast<uint16_t>(address));
+  }
+  void beginTransmission(int address) {
+    beginTransmission(static_cast<uint16_t>(address));
+  }
+  uint8_t endTransmission(bool send_stop = true);
+
+  uint8_t requestFrom(uint16_t address, uint8_t size, bool send_stop = true);
+  uint8_t requestFrom(int address, int size) {
+    return requestFrom(static_cast<uint16_t>(address),
+                       static_cast<uint8_t>(size));
+  }
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* data, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() override {}
+
+ private:
+  uint8_t bus_num_;
+  uint32_t clock_hz_ = 100000;
+  uint16_t tx_address_ = 0;
+  uint8_t tx_buffer_[I2C_BUFFER_LENGTH];
+  size_t tx_size_ = 0;
+  uint8_t rx_buffer_[I2C_BUFFER_LENGTH];
+  size_t rx_size_ = 0;
+  size_t rx_pos_ = 0;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif  // _HOST_WIRE_H_
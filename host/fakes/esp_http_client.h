@@ -0,0 +1,73 @@
+#ifndef _HOST_ESP_HTTP_CLIENT_H_
+#define _HOST_ESP_HTTP_CLIENT_H_
+
+// The simulation has no outbound network: every request fails to connect.
+
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+#define ESP_ERR_HTTP_BASE 0x7000
+#define ESP_ERR_HTTP_CONNECT (ESP_ERR_HTTP_BASE + 2)
+
+typedef struct esp_http_client* esp_http_client_handle_t;
+
+typedef enum {
+  HTTP_EVENT_ERROR = 0,
+  HTTP_EVENT_ON_CONNECTED,
+  HTTP_EVENT_HEADER_SENT,
+  HTTP_EVENT_ON_HEADER,
+  HTTP_EVENT_ON_DATA,
+  HTTP_EVENT_ON_FINISH,
+  HTTP_EVENT_DISCONNECTED,
+} esp_http_client_event_id_t;
+
+typedef struct esp_http_client_event {
+  esp_http_client_event_id_t event_id;
+  esp_http_client_handle_t client;
+  void* data;
+  int data_len;
+  void* user_data;
+  char* header_key;
+  char* header_value;
+} esp_http_client_event_t;
+
+typedef esp_err_t (*http_event_handle_cb)(esp_http_client_event_t* evt);
+
+// Same field order as IDF 4.x, so designated initializers carry over.
+typedef struct {
+  const char* url;
+  const char* host;
+  int port;
+  const char* username;
+  const char* password;
+  int auth_type;
+  const char* path;
+  const char* query;
+  const char* cert_pem;
+  const char* client_cert_pem;
+  const char* client_key_pem;
+  int method;
+  int timeout_ms;
+  bool disable_auto_redirect;
+  int max_redirection_count;
+  int max_authorization_retries;
+  http_event_handle_cb event_handler;
+  int transport_type;
+  int buffer_size;
+  int buffer_size_tx;
+  void* user_data;
+  bool is_async;
+  bool use_global_ca_store;
+  bool skip_cert_common_name_check;
+  bool keep_alive_enable;
+} esp_http_client_config_t;
+
+esp_http_client_handle_t esp_http_client_init(
+    const esp_http_client_config_t* config);
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client);
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client);
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+
+#endif  // _HOST_ESP_HTTP_CLIENT_H_
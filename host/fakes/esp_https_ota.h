@@ -0,0 +1,8 @@
+#ifndef _HOST_ESP_HTTPS_OTA_H_
+#define _HOST_ESP_HTTPS_OTA_H_
+
+#include "esp_http_client.h"
+
+esp_err_t esp_https_ota(const esp_http_client_config_t* config);
+
+#endif  // _HOST_ESP_HTTPS_OTA_H_
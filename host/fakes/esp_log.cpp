@@ -0,0 +1,101 @@
+// ESP-IDF style logging to stdout, plus esp_err_to_name().
+
+#include "esp_log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "esp_err.h"
+#include "host.h"
+
+namespace {
+
+std::mutex& LevelsMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+// Keyed by tag; "*" is the default.
+std::map<std::string, esp_log_level_t>& Levels() {
+  static std::map<std::string, esp_log_level_t> levels = {
+      {"*", ESP_LOG_INFO}};
+  return levels;
+}
+
+esp_log_level_t LevelFor(const char* tag) {
+  std::lock_guard<std::mutex> lock(LevelsMutex());
+  auto& levels = Levels();
+  auto it = levels.find(tag);
+  return it != levels.end() ? it->second : levels["*"];
+}
+
+const char kLevelLetters[] = "NEWIDV";
+
+}  // namespace
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {
+  std::lock_guard<std::mutex> lock(LevelsMutex());
+  Levels()[tag] = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format,
+                   ...) {
+  if (level > LevelFor(tag)) {
+    return;
+  }
+  char message[512];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  // One printf so lines from different tasks don't interleave.
+  printf("%c (%llu) %s: %s\n", kLevelLetters[level],
+         static_cast<unsigned long long>(host::SimMicros() / 1000), tag,
+         message);
+}
+
+void esp_log_buffer_hex_internal(const char* tag, const void* buffer,
+                                 uint16_t size, esp_log_level_t level) {
+  const auto* bytes = static_cast<const uint8_t*>(buffer);
+  for (uint16_t line = 0; line < size; line += 16) {
+    char hex[16 * 3 + 1] = {0};
+    for (uint16_t i = line; i < size && i < line + 16; ++i) {
+      snprintf(hex + (i - line) * 3, 4, "%02x ", bytes[i]);
+    }
+    esp_log_write(level, tag, "%s", hex);
+  }
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+  switch (code) {
+    case ESP_OK:
+      return "ESP_OK";
+    case ESP_FAIL:
+      return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+      return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+      return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+      return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+      return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+      return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+      return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE:
+      return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:
+      return "ESP_ERR_INVALID_CRC";
+    case 0x7002:
+      return "ESP_ERR_HTTP_CONNECT";
+  }
+  return "UNKNOWN ERROR";
+}
@@ -0,0 +1,8 @@
+#ifndef _HOST_ESP_OTA_OPS_H_
+#define _HOST_ESP_OTA_OPS_H_
+
+#include "esp_err.h"
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback();
+
+#endif  // _HOST_ESP_OTA_OPS_H_
@@ -0,0 +1,85 @@
+#include "esp_partition.h"
+
+#include <string.h>
+
+#include <mutex>
+#include <vector>
+
+namespace {
+
+const size_t kSectorSize = 4096;
+
+const esp_partition_t kPartitions[] = {
+    {ESP_PARTITION_TYPE_DATA, static_cast<esp_partition_subtype_t>(0x40),
+     0x310000, 0xf0000, "tslog", false},
+};
+const size_t kNumPartitions = sizeof(kPartitions) / sizeof(kPartitions[0]);
+
+std::mutex mutex;
+
+// Contents of kPartitions[i], erased on first use.
+std::vector<uint8_t>& Contents(const esp_partition_t* partition) {
+  static std::vector<uint8_t> contents[kNumPartitions];
+  std::vector<uint8_t>& data = contents[partition - kPartitions];
+  if (data.empty()) {
+    data.assign(partition->size, 0xff);
+  }
+  return data;
+}
+
+bool InRange(const esp_partition_t* partition, size_t offset, size_t size) {
+  return partition >= kPartitions &&
+         partition < kPartitions + kNumPartitions &&
+         offset <= partition->size && size <= partition->size - offset;
+}
+
+}  // namespace
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char* label) {
+  for (const esp_partition_t& partition : kPartitions) {
+    if (partition.type == type &&
+        (subtype == ESP_PARTITION_SUBTYPE_ANY ||
+         partition.subtype == subtype) &&
+        (label == nullptr || strcmp(label, partition.label) == 0)) {
+      return &partition;
+    }
+  }
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition,
+                             size_t src_offset, void* dst, size_t size) {
+  if (!InRange(partition, src_offset, size)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  memcpy(dst, Contents(partition).data() + src_offset, size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition,
+                              size_t dst_offset, const void* src,
+                              size_t size) {
+  if (!InRange(partition, dst_offset, size)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  uint8_t* data = Contents(partition).data() + dst_offset;
+  for (size_t i = 0; i < size; ++i) {
+    data[i] &= static_cast<const uint8_t*>(src)[i];
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition,
+                                    size_t offset, size_t size) {
+  if (!InRange(partition, offset, size) || offset % kSectorSize != 0 ||
+      size % kSectorSize != 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  memset(Contents(partition).data() + offset, 0xff, size);
+  return ESP_OK;
+}
@@ -0,0 +1,24 @@
+#ifndef _HOST_ESP_SNTP_H_
+#define _HOST_ESP_SNTP_H_
+
+// The host clock is already right, so SNTP only reports itself synced.
+
+#include <stdint.h>
+
+#define SNTP_OPMODE_POLL 0
+#define SNTP_OPMODE_LISTENONLY 1
+
+typedef enum {
+  SNTP_SYNC_STATUS_RESET,
+  SNTP_SYNC_STATUS_COMPLETED,
+  SNTP_SYNC_STATUS_IN_PROGRESS,
+} sntp_sync_status_t;
+
+void sntp_setoperatingmode(uint8_t operating_mode);
+void sntp_servermode_dhcp(int set_servers_from_dhcp);
+void sntp_setservername(uint8_t idx, const char* server);
+void sntp_init();
+void sntp_stop();
+sntp_sync_status_t sntp_get_sync_status();
+
+#endif  // _HOST_ESP_SNTP_H_
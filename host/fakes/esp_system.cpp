@@ -0,0 +1,151 @@
+// System, heap, SNTP and OTA stand-ins.
+
+#include "esp_system.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <random>
+
+#include "esp_heap_caps.h"
+#include "esp_http_client.h"
+#include "esp_https_ota.h"
+#include "esp_ota_ops.h"
+#include "esp_sntp.h"
+#include "host.h"
+
+namespace {
+
+// Roughly what an ESP32 running WiFi has left for the application.
+const size_t kDeviceHeapSize = 280 * 1024;
+
+std::atomic<size_t> minimum_free{kDeviceHeapSize};
+
+size_t FreeHeap() {
+  size_t used = mallinfo2().uordblks;
+  size_t free = used < kDeviceHeapSize ? kDeviceHeapSize - used : 0;
+  size_t low = minimum_free;
+  while (free < low && !minimum_free.compare_exchange_weak(low, free)) {
+  }
+  return free;
+}
+
+// As many as the IDF takes.
+const int kMaxShutdownHandlers = 5;
+std::mutex shutdown_mutex;
+shutdown_handler_t shutdown_handlers[kMaxShutdownHandlers];
+int num_shutdown_handlers = 0;
+
+}  // namespace
+
+uint32_t esp_get_free_heap_size() { return FreeHeap(); }
+
+uint32_t esp_random() {
+  static std::random_device device;
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  return device();
+}
+
+uint32_t esp_get_minimum_free_heap_size() {
+  FreeHeap();
+  return minimum_free;
+}
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler) {
+  std::lock_guard<std::mutex> lock(shutdown_mutex);
+  if (num_shutdown_handlers == kMaxShutdownHandlers) {
+    return ESP_ERR_NO_MEM;
+  }
+  shutdown_handlers[num_shutdown_handlers++] = handler;
+  return ESP_OK;
+}
+
+void esp_restart() {
+  int n;
+  {
+    std::lock_guard<std::mutex> lock(shutdown_mutex);
+    n = num_shutdown_handlers;
+  }
+  while (n > 0) {
+    shutdown_handlers[--n]();
+  }
+  printf("esp_restart(): ending simulation\n");
+  fflush(stdout);
+  _exit(0);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) { return FreeHeap(); }
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+  return esp_get_minimum_free_heap_size();
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return FreeHeap(); }
+
+void sntp_setoperatingmode(uint8_t operating_mode) {}
+void sntp_servermode_dhcp(int set_servers_from_dhcp) {}
+void sntp_setservername(uint8_t idx, const char* server) {}
+void sntp_init() {}
+void sntp_stop() {}
+sntp_sync_status_t sntp_get_sync_status() {
+  return SNTP_SYNC_STATUS_COMPLETED;
+}
+
+// As if SNTP set the clock at startup: from then on it runs on simulated
+// time, keeping pace with millis() at any speed.
+time_t time(time_t* out) noexcept {
+  static const time_t start = [] {
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec;
+  }();
+  const time_t now = start + host::SimMicros() / 1000000;
+  if (out != nullptr) {
+    *out = now;
+  }
+  return now;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback() { return ESP_OK; }
+
+struct esp_http_client {
+  esp_http_client_config_t config;
+};
+
+esp_http_client_handle_t esp_http_client_init(
+    const esp_http_client_config_t* config) {
+  return new esp_http_client{*config};
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client) {
+  if (client->config.event_handler != nullptr) {
+    esp_http_client_event_t event = {};
+    event.event_id = HTTP_EVENT_ERROR;
+    event.client = client;
+    client->config.event_handler(&event);
+  }
+  return ESP_ERR_HTTP_CONNECT;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client) {
+  delete client;
+  return ESP_OK;
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client) {
+  return false;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client) {
+  return 0;
+}
+
+esp_err_t esp_https_ota(const esp_http_client_config_t* config) {
+  return ESP_ERR_HTTP_CONNECT;
+}
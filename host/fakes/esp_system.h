@@ -0,0 +1,17 @@
+#ifndef _HOST_ESP_SYSTEM_H_
+#define _HOST_ESP_SYSTEM_H_
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+uint32_t esp_get_free_heap_size();
+uint32_t esp_get_minimum_free_heap_size();
+uint32_t esp_random();
+typedef void (*shutdown_handler_t)(void);
+// Up to 5, called by esp_restart() last registered first.
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler);
+// Runs the shutdown handlers and ends the simulation.
+void esp_restart() __attribute__((noreturn));
+
+#endif  // _HOST_ESP_SYSTEM_H_
@@ -0,0 +1,528 @@
+// FreeRTOS on pthreads. Every task gets its own painted stack so its high
+// water mark can be measured like on the device, and its own CPU clock.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host.h"
+
+namespace {
+
+const uint64_t kMicrosPerTick = 1000000 / configTICK_RATE_HZ;
+// x86-64 code needs more stack than Xtensa code; glibc's printf alone wants a
+// few KiB.
+const size_t kStackScale = 4;
+const size_t kMinHostStack = 64 * 1024;
+const uint8_t kStackPaint = 0xa5;
+
+// Wall clock time a wait of ticks from now ends.
+std::chrono::steady_clock::time_point Deadline(TickType_t ticks) {
+  return host::RealTimeAt(host::SimMicros() + ticks * kMicrosPerTick);
+}
+
+template <typename Pred>
+bool WaitFor(std::unique_lock<std::mutex>* lock, std::condition_variable* cv,
+             TickType_t ticks, Pred pred) {
+  if (ticks == portMAX_DELAY) {
+    cv->wait(*lock, pred);
+    return true;
+  }
+  return cv->wait_until(*lock, Deadline(ticks), pred);
+}
+
+uint64_t ThreadCpuMicros(clockid_t clock) {
+  struct timespec ts;
+  if (clock_gettime(clock, &ts) != 0) {
+    return 0;
+  }
+  return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+std::recursive_mutex critical_mutex;
+
+}  // namespace
+
+struct HostTask {
+  std::string name;
+  TaskFunction_t fn;
+  void* param;
+  UBaseType_t priority;
+  uint32_t stack_size;
+
+  uint8_t* stack;
+  size_t host_stack_size;
+  pthread_t thread;
+  std::atomic<bool> running{true};
+  uint64_t final_cpu_us = 0;
+
+  std::mutex mu;
+  std::condition_variable cv;
+  uint32_t notify_value = 0;
+  bool notify_pending = false;
+
+  uint32_t StackUsed() const {
+    const volatile uint8_t* p = stack;
+    size_t untouched = 0;
+    while (untouched < host_stack_size && p[untouched] == kStackPaint) {
+      ++untouched;
+    }
+    return host_stack_size - untouched;
+  }
+
+  uint64_t CpuMicros() const {
+    if (!running) {
+      return final_cpu_us;
+    }
+    clockid_t clock;
+    if (pthread_getcpuclockid(thread, &clock) != 0) {
+      return final_cpu_us;
+    }
+    return ThreadCpuMicros(clock);
+  }
+};
+
+namespace {
+
+std::mutex tasks_mutex;
+std::vector<HostTask*> tasks;
+thread_local HostTask* current_task = nullptr;
+
+void Finish(HostTask* task) {
+  task->final_cpu_us = ThreadCpuMicros(CLOCK_THREAD_CPUTIME_ID);
+  task->running = false;
+}
+
+void* Trampoline(void* arg) {
+  auto* task = reinterpret_cast<HostTask*>(arg);
+  current_task = task;
+  task->fn(task->param);
+  // A FreeRTOS task must not return, but don't take the process down for it.
+  fprintf(stderr, "freertos: task %s returned\n", task->name.c_str());
+  Finish(task);
+  return nullptr;
+}
+
+}  // namespace
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name,
+                       uint32_t stack_depth, void* param,
+                       UBaseType_t priority, TaskHandle_t* handle) {
+  auto* task = new HostTask;
+  task->name = name;
+  task->fn = fn;
+  task->param = param;
+  task->priority = priority;
+  task->stack_size = stack_depth;
+
+  const size_t page = sysconf(_SC_PAGESIZE);
+  size_t size = std::max(stack_depth * kStackScale, kMinHostStack);
+  size = (size + page - 1) / page * page;
+  // One PROT_NONE page below the stack turns an overflow into a crash.
+  void* mem = mmap(nullptr, size + page, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+  if (mem == MAP_FAILED) {
+    delete task;
+    return pdFAIL;
+  }
+  mprotect(mem, page, PROT_NONE);
+  task->stack = static_cast<uint8_t*>(mem) + page;
+  task->host_stack_size = size;
+  memset(task->stack, kStackPaint, size);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstack(&attr, task->stack, size);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  {
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    tasks.push_back(task);
+  }
+  int err = pthread_create(&task->thread, &attr, Trampoline, task);
+  pthread_attr_destroy(&attr);
+  if (err != 0) {
+    fprintf(stderr, "freertos: pthread_create(%s): %s\n", name, strerror(err));
+    task->running = false;
+    return pdFAIL;
+  }
+  if (handle != nullptr) {
+    *handle = task;
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name,
+                                   uint32_t stack_depth, void* param,
+                                   UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core_id) {
+  return xTaskCreate(fn, name, stack_depth, param, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task != nullptr && task != current_task) {
+    fprintf(stderr, "freertos: deleting another task is not supported\n");
+    return;
+  }
+  if (current_task == nullptr) {
+    fprintf(stderr, "freertos: vTaskDelete() outside a task\n");
+    return;
+  }
+  Finish(current_task);
+  pthread_exit(nullptr);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  if (ticks == 0) {
+    std::this_thread::yield();
+    return;
+  }
+  host::SleepSimMicros(ticks * kMicrosPerTick);
+}
+
+BaseType_t xTaskDelayUntil(TickType_t* previous_wake_time,
+                           TickType_t increment) {
+  const TickType_t target = *previous_wake_time + increment;
+  *previous_wake_time = target;
+  const uint64_t now_us = host::SimMicros();
+  const TickType_t now = now_us / kMicrosPerTick;
+  const int32_t ahead = static_cast<int32_t>(target - now);
+  if (ahead <= 0) {
+    return pdFALSE;
+  }
+  std::this_thread::sleep_until(
+      host::RealTimeAt((now_us / kMicrosPerTick + ahead) * kMicrosPerTick));
+  return pdTRUE;
+}
+
+void vTaskDelayUntil(TickType_t* previous_wake_time, TickType_t increment) {
+  xTaskDelayUntil(previous_wake_time, increment);
+}
+
+TickType_t xTaskGetTickCount() { return host::SimMicros() / kMicrosPerTick; }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return current_task; }
+
+const char* pcTaskGetName(TaskHandle_t task) {
+  if (task == nullptr) {
+    task = current_task;
+  }
+  return task != nullptr ? task->name.c_str() : "main";
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+  if (task == nullptr) {
+    task = current_task;
+  }
+  return task != nullptr ? task->priority : tskIDLE_PRIORITY;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  if (task == nullptr) {
+    task = current_task;
+  }
+  if (task == nullptr) {
+    return 0;
+  }
+  // Headroom left in the device-sized stack, by the host's measure.
+  const uint32_t used = task->StackUsed();
+  return used < task->stack_size ? task->stack_size - used : 0;
+}
+
+BaseType_t xPortGetCoreID() { return current_task != nullptr ? 1 : 0; }
+
+void vPortEnterCritical(portMUX_TYPE* mux) { critical_mutex.lock(); }
+void vPortExitCritical(portMUX_TYPE* mux) { critical_mutex.unlock(); }
+
+// Notifications.
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value,
+                       eNotifyAction action) {
+  std::lock_guard<std::mutex> lock(task->mu);
+  BaseType_t ret = pdPASS;
+  switch (action) {
+    case eNoAction:
+      break;
+    case eSetBits:
+      task->notify_value |= value;
+      break;
+    case eIncrement:
+      ++task->notify_value;
+      break;
+    case eSetValueWithOverwrite:
+      task->notify_value = value;
+      break;
+    case eSetValueWithoutOverwrite:
+      if (task->notify_pending) {
+        ret = pdFAIL;
+      } else {
+        task->notify_value = value;
+      }
+      break;
+  }
+  task->notify_pending = true;
+  task->cv.notify_all();
+  return ret;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  return xTaskNotify(task, 0, eIncrement);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+  HostTask* task = current_task;
+  std::unique_lock<std::mutex> lock(task->mu);
+  WaitFor(&lock, &task->cv, ticks_to_wait,
+          [task] { return task->notify_value != 0; });
+  const uint32_t value = task->notify_value;
+  if (value != 0) {
+    task->notify_value = clear_on_exit ? 0 : value - 1;
+  }
+  task->notify_pending = false;
+  return value;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit,
+                           uint32_t* value, TickType_t ticks_to_wait) {
+  HostTask* task = current_task;
+  std::unique_lock<std::mutex> lock(task->mu);
+  if (!task->notify_pending) {
+    task->notify_value &= ~clear_on_entry;
+  }
+  bool notified = WaitFor(&lock, &task->cv, ticks_to_wait,
+                          [task] { return task->notify_pending; });
+  if (value != nullptr) {
+    *value = task->notify_value;
+  }
+  if (!notified) {
+    return pdFALSE;
+  }
+  task->notify_value &= ~clear_on_exit;
+  task->notify_pending = false;
+  return pdTRUE;
+}
+
+// Queues, and semaphores as zero-size queues like FreeRTOS does it.
+
+struct HostQueue {
+  std::mutex mu;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  size_t length;
+  size_t item_size;
+  std::vector<uint8_t> items;
+  size_t head = 0;
+  size_t count = 0;
+
+  uint8_t* Slot(size_t i) {
+    return items.data() + ((head + i) % length) * item_size;
+  }
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+  auto* queue = new HostQueue;
+  queue->length = length;
+  queue->item_size = item_size;
+  queue->items.resize(length * item_size);
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+namespace {
+
+BaseType_t Send(QueueHandle_t queue, const void* item,
+                TickType_t ticks_to_wait, bool front, bool overwrite) {
+  std::unique_lock<std::mutex> lock(queue->mu);
+  if (overwrite && queue->count == queue->length) {
+    queue->head = (queue->head + 1) % queue->length;
+    --queue->count;
+  }
+  if (!WaitFor(&lock, &queue->not_full, ticks_to_wait,
+               [queue] { return queue->count < queue->length; })) {
+    return errQUEUE_FULL;
+  }
+  uint8_t* slot;
+  if (front) {
+    queue->head = (queue->head + queue->length - 1) % queue->length;
+    slot = queue->Slot(0);
+  } else {
+    slot = queue->Slot(queue->count);
+  }
+  if (queue->item_size > 0) {
+    memcpy(slot, item, queue->item_size);
+  }
+  ++queue->count;
+  queue->not_empty.notify_one();
+  return pdPASS;
+}
+
+BaseType_t Receive(QueueHandle_t queue, void* item, TickType_t ticks_to_wait,
+                   bool peek) {
+  std::unique_lock<std::mutex> lock(queue->mu);
+  if (!WaitFor(&lock, &queue->not_empty, ticks_to_wait,
+               [queue] { return queue->count > 0; })) {
+    return errQUEUE_EMPTY;
+  }
+  if (queue->item_size > 0) {
+    memcpy(item, queue->Slot(0), queue->item_size);
+  }
+  if (!peek) {
+    queue->head = (queue->head + 1) % queue->length;
+    --queue->count;
+    queue->not_full.notify_one();
+  }
+  return pdPASS;
+}
+
+}  // namespace
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item,
+                      TickType_t ticks_to_wait) {
+  return Send(queue, item, ticks_to_wait, /*front=*/false, /*overwrite=*/false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item,
+                            TickType_t ticks_to_wait) {
+  return Send(queue, item, ticks_to_wait, /*front=*/false, /*overwrite=*/false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item,
+                             TickType_t ticks_to_wait) {
+  return Send(queue, item, ticks_to_wait, /*front=*/true, /*overwrite=*/false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item) {
+  return Send(queue, item, 0, /*front=*/false, /*overwrite=*/true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item,
+                         TickType_t ticks_to_wait) {
+  return Receive(queue, item, ticks_to_wait, /*peek=*/false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item,
+                      TickType_t ticks_to_wait) {
+  return Receive(queue, item, ticks_to_wait, /*peek=*/true);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mu);
+  queue->head = 0;
+  queue->count = 0;
+  queue->not_full.notify_all();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mu);
+  return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mu);
+  return queue->length - queue->count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count,
+                                           UBaseType_t initial_count) {
+  QueueHandle_t queue = xQueueCreate(max_count, /*item_size=*/0);
+  queue->count = initial_count;
+  return queue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return xSemaphoreCreateCounting(1, 0);
+}
+
+// No priority inheritance or recursion, which the firmware doesn't rely on.
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return xSemaphoreCreateCounting(1, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore,
+                          TickType_t ticks_to_wait) {
+  return xQueueReceive(semaphore, nullptr, ticks_to_wait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  return xQueueSend(semaphore, nullptr, 0);
+}
+
+// Event groups.
+
+struct HostEventGroup {
+  std::mutex mu;
+  std::condition_variable cv;
+  EventBits_t bits = 0;
+};
+
+EventGroupHandle_t xEventGroupCreate() { return new HostEventGroup; }
+
+void vEventGroupDelete(EventGroupHandle_t group) { delete group; }
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+  std::lock_guard<std::mutex> lock(group->mu);
+  group->bits |= bits;
+  group->cv.notify_all();
+  return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+  std::lock_guard<std::mutex> lock(group->mu);
+  EventBits_t old_bits = group->bits;
+  group->bits &= ~bits;
+  return old_bits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+  std::lock_guard<std::mutex> lock(group->mu);
+  return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group,
+                                EventBits_t bits_to_wait_for,
+                                BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all_bits,
+                                TickType_t ticks_to_wait) {
+  std::unique_lock<std::mutex> lock(group->mu);
+  auto satisfied = [&] {
+    EventBits_t set = group->bits & bits_to_wait_for;
+    return wait_for_all_bits ? set == bits_to_wait_for : set != 0;
+  };
+  bool ok = WaitFor(&lock, &group->cv, ticks_to_wait, satisfied);
+  EventBits_t bits = group->bits;
+  if (ok && clear_on_exit) {
+    group->bits &= ~bits_to_wait_for;
+  }
+  return bits;
+}
+
+namespace host {
+
+std::vector<TaskStats> GetTaskStats() {
+  std::lock_guard<std::mutex> lock(tasks_mutex);
+  std::vector<TaskStats> stats;
+  for (const HostTask* task : tasks) {
+    stats.push_back({task->name, task->priority, task->stack_size,
+                     task->StackUsed(), task->CpuMicros(), task->running});
+  }
+  return stats;
+}
+
+}  // namespace host
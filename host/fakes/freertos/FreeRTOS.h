@@ -0,0 +1,41 @@
+#ifndef _HOST_FREERTOS_H_
+#define _HOST_FREERTOS_H_
+
+// Host stand-in for the subset of FreeRTOS the firmware uses, implemented on
+// top of pthreads. Tick rate matches the device (CONFIG_FREERTOS_HZ=1000).
+// Priorities are recorded but not enforced; every task is a plain thread.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_EMPTY ((BaseType_t)0)
+#define errQUEUE_FULL ((BaseType_t)0)
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms)*configTICK_RATE_HZ) / 1000))
+#define configMAX_PRIORITIES 25
+#define tskIDLE_PRIORITY ((UBaseType_t)0)
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+typedef struct {
+  int unused;
+} portMUX_TYPE;
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+
+BaseType_t xPortGetCoreID();
+
+#endif  // _HOST_FREERTOS_H_
@@ -0,0 +1,115 @@
+// Simulated clock and the thread that steps the simulated devices.
+
+#include "host.h"
+
+#include <atomic>
+#include <map>
+#include <thread>
+
+namespace host {
+namespace {
+
+std::atomic<double> sim_speed{1.0};
+uint16_t http_port = 8080;
+std::atomic<uint16_t> bound_http_port{0};
+
+std::chrono::steady_clock::time_point Start() {
+  static const auto start = std::chrono::steady_clock::now();
+  return start;
+}
+
+// Everything attached, in attach order.
+std::vector<SerialDevice*>& SerialDevices() {
+  static std::vector<SerialDevice*> devices;
+  return devices;
+}
+
+std::map<uint8_t, I2cDevice*>& I2cDevices() {
+  static std::map<uint8_t, I2cDevice*> devices;
+  return devices;
+}
+
+void StepDevices() {
+  uint64_t next_ms = SimMicros() / 1000;
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(DeviceMutex());
+      for (SerialDevice* device : SerialDevices()) {
+        device->Step(next_ms);
+      }
+      for (auto& entry : I2cDevices()) {
+        entry.second->Step(next_ms);
+      }
+    }
+    next_ms += kStepMs;
+    std::this_thread::sleep_until(RealTimeAt(next_ms * 1000));
+  }
+}
+
+}  // namespace
+
+void SetSpeed(double speed) {
+  Start();
+  sim_speed = speed;
+}
+
+double speed() { return sim_speed; }
+
+uint64_t SimMicros() {
+  auto elapsed = std::chrono::steady_clock::now() - Start();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() *
+         sim_speed / 1000;
+}
+
+std::chrono::steady_clock::time_point RealTimeAt(uint64_t sim_us) {
+  return Start() + std::chrono::nanoseconds(
+                       static_cast<int64_t>(sim_us * 1000 / sim_speed));
+}
+
+void SleepSimMicros(uint64_t sim_us) {
+  std::this_thread::sleep_until(RealTimeAt(SimMicros() + sim_us));
+}
+
+std::mutex& DeviceMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+void UartAttach(int port, SerialDevice* device) {
+  std::lock_guard<std::mutex> lock(DeviceMutex());
+  device->set_port(port);
+  SerialDevices().push_back(device);
+}
+
+void I2cAttach(uint8_t address, I2cDevice* device) {
+  std::lock_guard<std::mutex> lock(DeviceMutex());
+  I2cDevices()[address] = device;
+}
+
+I2cDevice* FindI2cDevice(uint8_t address) {
+  auto it = I2cDevices().find(address);
+  return it == I2cDevices().end() ? nullptr : it->second;
+}
+
+SerialDevice* FindSerialDevice(int port) {
+  for (SerialDevice* device : SerialDevices()) {
+    if (device->port() == port) {
+      return device;
+    }
+  }
+  return nullptr;
+}
+
+void StartDevices() { std::thread(StepDevices).detach(); }
+
+void SetHttpPort(uint16_t port) { http_port = port; }
+
+uint16_t MapPort(uint16_t device_port) {
+  return device_port == 80 ? http_port : device_port;
+}
+
+void SetBoundHttpPort(uint16_t port) { bound_http_port = port; }
+
+uint16_t BoundHttpPort() { return bound_http_port; }
+
+}  // namespace host
@@ -0,0 +1,118 @@
+#ifndef _HOST_HOST_H_
+#define _HOST_HOST_H_
+
+// Control surface of the host simulation: the simulated clock, the hooks
+// simulated devices use to sit on the other end of a UART or the I2C bus, and
+// per-task accounting. Nothing in lib/ or src/ includes this; only the fakes
+// and host/sim do.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace host {
+
+// Simulated time runs speed times faster than wall time. Set before any task
+// starts.
+void SetSpeed(double speed);
+double speed();
+
+// Microseconds of simulated time since the simulation started.
+uint64_t SimMicros();
+// Wall clock time at which the simulated clock reads sim_us.
+std::chrono::steady_clock::time_point RealTimeAt(uint64_t sim_us);
+void SleepSimMicros(uint64_t sim_us);
+
+// Held while a device is stepped or talked to, so device models need no
+// locking of their own.
+std::mutex& DeviceMutex();
+
+// The far end of a UART. Both the IDF UART driver and HardwareSerial route
+// the port's TX to OnReceive(); Send() delivers bytes to the firmware's RX.
+class SerialDevice {
+ public:
+  virtual ~SerialDevice() = default;
+
+  // Bytes the firmware wrote.
+  virtual void OnReceive(const uint8_t* data, size_t size) = 0;
+  // Called by the simulation thread every kStepMs of simulated time.
+  virtual void Step(uint64_t now_ms) = 0;
+
+  void set_port(int port) { port_ = port; }
+  int port() const { return port_; }
+
+ protected:
+  void Send(const uint8_t* data, size_t size);
+
+ private:
+  int port_ = -1;
+};
+
+class I2cDevice {
+ public:
+  virtual ~I2cDevice() = default;
+
+  // Return false to NACK.
+  virtual bool Write(const uint8_t* data, size_t size) = 0;
+  virtual bool Read(uint8_t* data, size_t size) = 0;
+  virtual void Step(uint64_t now_ms) {}
+};
+
+const uint64_t kStepMs = 10;
+
+void UartAttach(int port, SerialDevice* device);
+void I2cAttach(uint8_t address, I2cDevice* device);
+
+// Starts the thread that steps every attached device.
+void StartDevices();
+
+// Lookups for the fakes; call with DeviceMutex() held. Null if nothing is
+// attached there.
+SerialDevice* FindSerialDevice(int port);
+I2cDevice* FindI2cDevice(uint8_t address);
+
+// Firmware-side UART access shared by the IDF driver fake and HardwareSerial.
+size_t UartRead(int port, uint8_t* data, size_t size);
+int UartPeek(int port);
+size_t UartAvailable(int port);
+void UartWrite(int port, const uint8_t* data, size_t size);
+
+// I2C transfers at clock_hz, taking as long as the bits would on the wire.
+// Return false if nothing acknowledges the address.
+bool I2cWrite(uint8_t address, const uint8_t* data, size_t size,
+              uint32_t clock_hz);
+bool I2cRead(uint8_t address, uint8_t* data, size_t size, uint32_t clock_hz);
+
+// Port the fake WiFiServer and lwip_bind() bind on localhost in place of
+// device port 80; 0 picks a free one.
+void SetHttpPort(uint16_t port);
+uint16_t MapPort(uint16_t device_port);
+// Where the web server actually listens, once it does; 0 before.
+void SetBoundHttpPort(uint16_t port);
+uint16_t BoundHttpPort();
+
+// Whether the simulated network starts out saved; if not, the firmware has
+// to be given it through its portal. Set before any task starts.
+void SetWifiProvisioned(bool provisioned);
+
+struct TaskStats {
+  std::string name;
+  uint32_t priority;
+  // As requested from xTaskCreate(), in bytes.
+  uint32_t stack_size;
+  // Deepest stack use seen on the host, in bytes. x86-64 frames are larger
+  // than Xtensa ones, so this overestimates the device.
+  uint32_t stack_used;
+  uint64_t cpu_us;
+  bool running;
+};
+
+std::vector<TaskStats> GetTaskStats();
+
+}  // namespace host
+
+#endif  // _HOST_HOST_H_
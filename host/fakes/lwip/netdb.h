@@ -0,0 +1,8 @@
+#ifndef _HOST_LWIP_NETDB_H_
+#define _HOST_LWIP_NETDB_H_
+
+// lwIP's resolver, served by the host's.
+
+#include <netdb.h>
+
+#endif  // _HOST_LWIP_NETDB_H_
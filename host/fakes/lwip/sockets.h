@@ -0,0 +1,20 @@
+#ifndef _HOST_LWIP_SOCKETS_H_
+#define _HOST_LWIP_SOCKETS_H_
+
+// lwIP's BSD socket API, served by the host's own sockets. Like lwIP built
+// with LWIP_COMPAT_SOCKETS, bind() is a macro for lwip_bind(), which is where
+// the host moves a server off the device's port 80 (see host::MapPort()) and
+// keeps it on localhost.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+int lwip_bind(int s, const struct sockaddr* name, socklen_t namelen);
+#define bind(s, name, namelen) lwip_bind(s, name, namelen)
+
+#endif  // _HOST_LWIP_SOCKETS_H_
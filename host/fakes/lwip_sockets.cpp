@@ -0,0 +1,26 @@
+// The host side of lwip/sockets.h.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "host.h"
+
+int lwip_bind(int s, const struct sockaddr* name, socklen_t namelen) {
+  if (name->sa_family != AF_INET || namelen < sizeof(sockaddr_in)) {
+    return bind(s, name, namelen);
+  }
+  struct sockaddr_in addr = *reinterpret_cast<const sockaddr_in*>(name);
+  const uint16_t port = ntohs(addr.sin_port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(host::MapPort(port));
+  if (bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    return -1;
+  }
+  if (port == 80) {
+    socklen_t size = sizeof(addr);
+    getsockname(s, reinterpret_cast<sockaddr*>(&addr), &size);
+    host::SetBoundHttpPort(ntohs(addr.sin_port));
+  }
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include "nvs.h"
+
+#include <string.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::mutex mutex;
+// Namespace name by handle - 1.
+std::vector<std::string> handles;
+// Blobs by namespace, then key.
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>> blobs;
+
+// The namespace's blobs, or null for a bad handle. Takes the lock held.
+std::map<std::string, std::vector<uint8_t>>* Namespace(nvs_handle_t handle) {
+  if (handle == 0 || handle > handles.size() || handles[handle - 1].empty()) {
+    return nullptr;
+  }
+  return &blobs[handles[handle - 1]];
+}
+
+}  // namespace
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode,
+                   nvs_handle_t* out_handle) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (open_mode == NVS_READONLY && blobs.count(name) == 0) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  blobs[name];
+  handles.push_back(name);
+  *out_handle = handles.size();
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value,
+                       size_t* length) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto* space = Namespace(handle);
+  if (space == nullptr) {
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  }
+  auto it = space->find(key);
+  if (it == space->end()) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  if (out_value == nullptr) {
+    *length = it->second.size();
+    return ESP_OK;
+  }
+  if (*length < it->second.size()) {
+    return ESP_ERR_NVS_INVALID_LENGTH;
+  }
+  memcpy(out_value, it->second.data(), it->second.size());
+  *length = it->second.size();
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key,
+                       const void* value, size_t length) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto* space = Namespace(handle);
+  if (space == nullptr) {
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  }
+  const uint8_t* bytes = static_cast<const uint8_t*>(value);
+  (*space)[key].assign(bytes, bytes + length);
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto* space = Namespace(handle);
+  if (space == nullptr) {
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  }
+  return space->erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return Namespace(handle) != nullptr ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+void nvs_close(nvs_handle_t handle) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (Namespace(handle) != nullptr) {
+    handles[handle - 1].clear();
+  }
+}
@@ -0,0 +1,198 @@
+// UART ports shared by the IDF driver fake and HardwareSerial. Like the real
+// driver, each port has a bounded RX ring buffer, and an event queue once the
+// driver is installed; bytes that don't fit are dropped with a
+// UART_BUFFER_FULL event.
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+
+#include "driver/uart.h"
+#include "freertos/task.h"
+#include "host.h"
+
+namespace {
+
+// Room in the hardware FIFO, which is all a port has without the driver.
+const size_t kFifoSize = 128;
+
+struct Port {
+  std::mutex mu;
+  std::deque<uint8_t> rx;
+  size_t rx_capacity = kFifoSize;
+  QueueHandle_t events = nullptr;
+};
+
+Port ports[UART_NUM_MAX];
+
+bool Valid(int port) { return port >= 0 && port < UART_NUM_MAX; }
+
+void PostEvent(Port* port, uart_event_type_t type, size_t size) {
+  if (port->events == nullptr) {
+    return;
+  }
+  uart_event_t event = {};
+  event.type = type;
+  event.size = size;
+  xQueueSend(port->events, &event, /*ticks_to_wait=*/0);
+}
+
+}  // namespace
+
+namespace host {
+
+void SerialDevice::Send(const uint8_t* data, size_t size) {
+  if (!Valid(port_)) {
+    return;
+  }
+  Port* port = &ports[port_];
+  std::lock_guard<std::mutex> lock(port->mu);
+  size_t room = port->rx_capacity - std::min(port->rx_capacity, port->rx.size());
+  size_t accepted = std::min(room, size);
+  port->rx.insert(port->rx.end(), data, data + accepted);
+  if (accepted > 0) {
+    PostEvent(port, UART_DATA, accepted);
+  }
+  if (accepted < size) {
+    PostEvent(port, UART_BUFFER_FULL, size - accepted);
+  }
+}
+
+size_t UartRead(int port_num, uint8_t* data, size_t size) {
+  if (!Valid(port_num)) {
+    return 0;
+  }
+  Port* port = &ports[port_num];
+  std::lock_guard<std::mutex> lock(port->mu);
+  size_t n = std::min(size, port->rx.size());
+  std::copy(port->rx.begin(), port->rx.begin() + n, data);
+  port->rx.erase(port->rx.begin(), port->rx.begin() + n);
+  return n;
+}
+
+int UartPeek(int port_num) {
+  if (!Valid(port_num)) {
+    return -1;
+  }
+  Port* port = &ports[port_num];
+  std::lock_guard<std::mutex> lock(port->mu);
+  return port->rx.empty() ? -1 : port->rx.front();
+}
+
+size_t UartAvailable(int port_num) {
+  if (!Valid(port_num)) {
+    return 0;
+  }
+  Port* port = &ports[port_num];
+  std::lock_guard<std::mutex> lock(port->mu);
+  return port->rx.size();
+}
+
+void UartWrite(int port_num, const uint8_t* data, size_t size) {
+  std::lock_guard<std::mutex> lock(DeviceMutex());
+  SerialDevice* device = FindSerialDevice(port_num);
+  if (device != nullptr) {
+    device->OnReceive(data, size);
+  }
+}
+
+}  // namespace host
+
+esp_err_t uart_param_config(uart_port_t uart_num,
+                            const uart_config_t* uart_config) {
+  return Valid(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num,
+                       int rts_io_num, int cts_io_num) {
+  return Valid(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size,
+                              int tx_buffer_size, int queue_size,
+                              QueueHandle_t* uart_queue, int intr_alloc_flags) {
+  if (!Valid(uart_num)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  Port* port = &ports[uart_num];
+  std::lock_guard<std::mutex> lock(port->mu);
+  if (port->events != nullptr) {
+    return ESP_FAIL;
+  }
+  port->rx_capacity = rx_buffer_size + kFifoSize;
+  if (uart_queue != nullptr && queue_size > 0) {
+    port->events = xQueueCreate(queue_size, sizeof(uart_event_t));
+    *uart_queue = port->events;
+  }
+  return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num) {
+  if (!Valid(uart_num)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  Port* port = &ports[uart_num];
+  std::lock_guard<std::mutex> lock(port->mu);
+  if (port->events != nullptr) {
+    vQueueDelete(port->events);
+    port->events = nullptr;
+  }
+  port->rx_capacity = kFifoSize;
+  return ESP_OK;
+}
+
+esp_err_t uart_set_rx_full_threshold(uart_port_t uart_num, int threshold) {
+  return Valid(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_rx_timeout(uart_port_t uart_num, const uint8_t tout_thresh) {
+  return Valid(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t* size) {
+  if (!Valid(uart_num)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  *size = host::UartAvailable(uart_num);
+  return ESP_OK;
+}
+
+int uart_read_bytes(uart_port_t uart_num, void* buf, uint32_t length,
+                    TickType_t ticks_to_wait) {
+  if (!Valid(uart_num)) {
+    return -1;
+  }
+  auto* dst = static_cast<uint8_t*>(buf);
+  size_t read = host::UartRead(uart_num, dst, length);
+  if (read == length || ticks_to_wait == 0) {
+    return read;
+  }
+  const TickType_t start = xTaskGetTickCount();
+  while (read < length && xTaskGetTickCount() - start < ticks_to_wait) {
+    vTaskDelay(1);
+    read += host::UartRead(uart_num, dst + read, length - read);
+  }
+  return read;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void* src, size_t size) {
+  if (!Valid(uart_num)) {
+    return -1;
+  }
+  host::UartWrite(uart_num, static_cast<const uint8_t*>(src), size);
+  return size;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait) {
+  return Valid(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num) {
+  if (!Valid(uart_num)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  Port* port = &ports[uart_num];
+  std::lock_guard<std::mutex> lock(port->mu);
+  port->rx.clear();
+  return ESP_OK;
+}
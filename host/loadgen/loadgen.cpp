@@ -0,0 +1,280 @@
+#include "loadgen.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace loadgen {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Responses slower than this count as errors.
+const int kTimeoutS = 10;
+
+struct Worker {
+  std::vector<uint32_t> latencies_us;
+  uint64_t errors = 0;
+  uint64_t connects = 0;
+  uint64_t bytes = 0;
+};
+
+class Client {
+ public:
+  Client(const sockaddr_in& addr, Worker* worker)
+      : addr_(addr), worker_(worker) {}
+  ~Client() { Close(); }
+
+  // Sends request and reads the whole response. False on any failure, after
+  // which the connection is closed.
+  bool Get(const std::string& request, int* status) {
+    if (fd_ < 0 && !Connect()) {
+      return false;
+    }
+    if (send(fd_, request.data(), request.size(), MSG_NOSIGNAL) !=
+        static_cast<ssize_t>(request.size())) {
+      Close();
+      return false;
+    }
+    bool server_closes = false;
+    if (!ReadResponse(status, &server_closes)) {
+      Close();
+      return false;
+    }
+    if (server_closes) {
+      Close();
+    }
+    return true;
+  }
+
+  void Close() {
+    if (fd_ >= 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+    buffer_.clear();
+  }
+
+ private:
+  bool Connect() {
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    struct timeval timeout = {kTimeoutS, 0};
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    ++worker_->connects;
+    if (connect(fd_, reinterpret_cast<const sockaddr*>(&addr_),
+                sizeof(addr_)) != 0) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  // Reads until buffer_ holds at least size bytes; false on EOF or error.
+  bool Fill(size_t size) {
+    char chunk[4096];
+    while (buffer_.size() < size) {
+      ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+      if (n <= 0) {
+        return false;
+      }
+      worker_->bytes += n;
+      buffer_.append(chunk, n);
+    }
+    return true;
+  }
+
+  // Reads until buffer_ contains needle at or after from; returns where.
+  bool FillUntil(const char* needle, size_t from, size_t* pos) {
+    for (;;) {
+      *pos = buffer_.find(needle, from);
+      if (*pos != std::string::npos) {
+        return true;
+      }
+      if (!Fill(buffer_.size() + 1)) {
+        return false;
+      }
+    }
+  }
+
+  bool ReadResponse(int* status, bool* server_closes) {
+    size_t end;
+    if (!FillUntil("\r\n\r\n", 0, &end)) {
+      return false;
+    }
+    const size_t header_size = end + 4;
+    const std::string headers = buffer_.substr(0, header_size);
+    if (headers.rfind("HTTP/1.", 0) != 0 || headers.size() < 12) {
+      return false;
+    }
+    *status = atoi(headers.c_str() + 9);
+    *server_closes = HasHeader(headers, "Connection", "close");
+    const char* length = FindHeader(headers, "Content-Length");
+
+    size_t consumed;
+    if (length != nullptr) {
+      consumed = header_size + strtoul(length, nullptr, 10);
+      if (!Fill(consumed)) {
+        return false;
+      }
+    } else if (HasHeader(headers, "Transfer-Encoding", "chunked")) {
+      size_t pos = header_size;
+      for (;;) {
+        size_t line_end;
+        if (!FillUntil("\r\n", pos, &line_end)) {
+          return false;
+        }
+        const size_t chunk_size =
+            strtoul(buffer_.c_str() + pos, nullptr, 16);
+        pos = line_end + 2 + chunk_size + 2;
+        if (!Fill(pos)) {
+          return false;
+        }
+        if (chunk_size == 0) {
+          break;
+        }
+      }
+      consumed = pos;
+    } else {
+      // Delimited by the server closing the connection.
+      while (Fill(buffer_.size() + 1)) {
+      }
+      *server_closes = true;
+      consumed = buffer_.size();
+    }
+    buffer_.erase(0, consumed);
+    return true;
+  }
+
+  static const char* FindHeader(const std::string& headers, const char* name) {
+    const std::string needle = std::string("\r\n") + name + ":";
+    for (size_t pos = 0; pos + needle.size() <= headers.size(); ++pos) {
+      if (strncasecmp(headers.c_str() + pos, needle.c_str(), needle.size()) ==
+          0) {
+        const char* value = headers.c_str() + pos + needle.size();
+        return value + strspn(value, " \t");
+      }
+    }
+    return nullptr;
+  }
+
+  static bool HasHeader(const std::string& headers, const char* name,
+                        const char* value) {
+    const char* found = FindHeader(headers, name);
+    return found != nullptr && strncasecmp(found, value, strlen(value)) == 0;
+  }
+
+  const sockaddr_in addr_;
+  Worker* const worker_;
+  int fd_ = -1;
+  std::string buffer_;
+};
+
+void RunWorker(const Options& options, const sockaddr_in& addr,
+               Clock::time_point end, Worker* worker) {
+  const std::string request =
+      "GET " + options.path + " HTTP/1.1\r\nHost: " + options.host +
+      "\r\nUser-Agent: pneumatic_loadgen\r\n" +
+      (options.keep_alive ? "" : "Connection: close\r\n") + "\r\n";
+  Client client(addr, worker);
+  while (Clock::now() < end) {
+    const Clock::time_point start = Clock::now();
+    int status = 0;
+    if (!client.Get(request, &status) || status != 200) {
+      ++worker->errors;
+      // Don't spin on a server that isn't there.
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+    worker->latencies_us.push_back(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                              start)
+            .count());
+  }
+}
+
+}  // namespace
+
+Result Run(const Options& options) {
+  Result result = {};
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* info = nullptr;
+  if (getaddrinfo(options.host.c_str(), nullptr, &hints, &info) != 0) {
+    result.errors = 1;
+    return result;
+  }
+  sockaddr_in addr = *reinterpret_cast<sockaddr_in*>(info->ai_addr);
+  freeaddrinfo(info);
+  addr.sin_port = htons(options.port);
+
+  std::vector<Worker> workers(std::max(1, options.connections));
+  std::vector<std::thread> threads;
+  const Clock::time_point start = Clock::now();
+  const Clock::time_point end =
+      start + std::chrono::microseconds(
+                  static_cast<int64_t>(options.duration_s * 1e6));
+  for (Worker& worker : workers) {
+    threads.emplace_back(RunWorker, std::cref(options), std::cref(addr), end,
+                         &worker);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  result.elapsed_s =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<uint32_t> latencies_us;
+  for (const Worker& worker : workers) {
+    latencies_us.insert(latencies_us.end(), worker.latencies_us.begin(),
+                        worker.latencies_us.end());
+    result.errors += worker.errors;
+    result.connects += worker.connects;
+    result.bytes += worker.bytes;
+  }
+  result.requests = latencies_us.size();
+  if (!latencies_us.empty()) {
+    std::sort(latencies_us.begin(), latencies_us.end());
+    auto percentile = [&](double p) {
+      return latencies_us[std::min<size_t>(latencies_us.size() - 1,
+                                           p * latencies_us.size())];
+    };
+    result.p50_us = percentile(0.50);
+    result.p95_us = percentile(0.95);
+    result.p99_us = percentile(0.99);
+    result.max_us = latencies_us.back();
+  }
+  return result;
+}
+
+void PrintJson(const Options& options, const Result& result, FILE* out) {
+  fprintf(out,
+          "{\"path\":\"%s\",\"connections\":%d,\"keep_alive\":%s,"
+          "\"seconds\":%.2f,\"requests\":%llu,\"errors\":%llu,"
+          "\"connects\":%llu,\"bytes\":%llu,\"rps\":%.1f,\"p50_us\":%u,"
+          "\"p95_us\":%u,\"p99_us\":%u,\"max_us\":%u}\n",
+          options.path.c_str(), options.connections,
+          options.keep_alive ? "true" : "false", result.elapsed_s,
+          static_cast<unsigned long long>(result.requests),
+          static_cast<unsigned long long>(result.errors),
+          static_cast<unsigned long long>(result.connects),
+          static_cast<unsigned long long>(result.bytes),
+          result.elapsed_s > 0 ? result.requests / result.elapsed_s : 0.0,
+          result.p50_us, result.p95_us, result.p99_us, result.max_us);
+}
+
+}  // namespace loadgen
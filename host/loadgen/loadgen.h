@@ -0,0 +1,48 @@
+#ifndef _HOST_LOADGEN_H_
+#define _HOST_LOADGEN_H_
+
+// Closed-loop HTTP load: a number of connections, each sending a GET as soon
+// as the previous response has arrived, for a while. Enough to see how the
+// web server holds up under several scrapers at once, on the simulation or a
+// device on the LAN.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+namespace loadgen {
+
+struct Options {
+  std::string host = "127.0.0.1";
+  uint16_t port = 8080;
+  std::string path = "/varz";
+  int connections = 4;
+  double duration_s = 5;
+  // Reuse each connection, or open a new one per request.
+  bool keep_alive = true;
+};
+
+struct Result {
+  uint64_t requests;
+  // Failed connects, responses that didn't parse or didn't arrive in time,
+  // and statuses other than 200.
+  uint64_t errors;
+  uint64_t connects;
+  uint64_t bytes;
+  double elapsed_s;
+  // Latency percentiles over every successful request, in microseconds.
+  uint32_t p50_us;
+  uint32_t p95_us;
+  uint32_t p99_us;
+  uint32_t max_us;
+};
+
+Result Run(const Options& options);
+
+// One JSON object per line, like the benchmarks.
+void PrintJson(const Options& options, const Result& result, FILE* out);
+
+}  // namespace loadgen
+
+#endif  // _HOST_LOADGEN_H_
@@ -0,0 +1,59 @@
+// Load generator for the firmware's web server:
+//
+//   pneumatic_loadgen [--host=H] [--port=P] [--path=/varz] [--connections=N]
+//                     [--duration=S] [--close]
+//
+// Runs N concurrent closed-loop clients for S seconds and prints throughput
+// and latency percentiles as one JSON line. --close sends Connection: close
+// to measure the cost of a connection per request.
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "loadgen.h"
+
+int main(int argc, char** argv) {
+  loadgen::Options options;
+  const struct option kOptions[] = {
+      {"host", required_argument, nullptr, 'h'},
+      {"port", required_argument, nullptr, 'p'},
+      {"path", required_argument, nullptr, 'u'},
+      {"connections", required_argument, nullptr, 'c'},
+      {"duration", required_argument, nullptr, 'd'},
+      {"close", no_argument, nullptr, 'x'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "", kOptions, nullptr)) != -1) {
+    switch (opt) {
+      case 'h':
+        options.host = optarg;
+        break;
+      case 'p':
+        options.port = atoi(optarg);
+        break;
+      case 'u':
+        options.path = optarg;
+        break;
+      case 'c':
+        options.connections = atoi(optarg);
+        break;
+      case 'd':
+        options.duration_s = atof(optarg);
+        break;
+      case 'x':
+        options.keep_alive = false;
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [--host=H] [--port=P] [--path=/varz] "
+                "[--connections=N] [--duration=S] [--close]\n",
+                argv[0]);
+        return 2;
+    }
+  }
+  const loadgen::Result result = loadgen::Run(options);
+  loadgen::PrintJson(options, result, stdout);
+  return result.requests > 0 && result.errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,379 @@
+#include "devices.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace sim {
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+// A sine wave with the given period, in [-1, 1].
+double Wave(uint64_t now_ms, double period_s, double phase = 0) {
+  return sin(2 * kPi * (now_ms / 1000.0 / period_s + phase));
+}
+
+void PutWord(uint8_t* frame, size_t offset, uint16_t value) {
+  frame[offset] = value >> 8;
+  frame[offset + 1] = value & 0xff;
+}
+
+uint16_t Sum(const uint8_t* data, size_t size) {
+  uint16_t sum = 0;
+  for (size_t i = 0; i < size; ++i) {
+    sum += data[i];
+  }
+  return sum;
+}
+
+// 0x42 0x4d <length:16> <payload> <checksum:16>, where length counts the
+// payload and checksum.
+void BuildPlantowerFrame(const uint8_t* payload, size_t payload_size,
+                         uint8_t* frame) {
+  frame[0] = 0x42;
+  frame[1] = 0x4d;
+  PutWord(frame, 2, payload_size + 2);
+  memcpy(frame + 4, payload, payload_size);
+  PutWord(frame, 4 + payload_size, Sum(frame, 4 + payload_size));
+}
+
+uint16_t Clamp16(double value) {
+  return value < 0 ? 0 : value > 0xffff ? 0xffff : static_cast<uint16_t>(value);
+}
+
+uint8_t Mhz19Checksum(const uint8_t* frame) {
+  uint8_t sum = 0;
+  for (int i = 1; i < 8; ++i) {
+    sum += frame[i];
+  }
+  return 0xff - sum + 1;
+}
+
+// Smallest raw value in [0, max_raw] at which reading(raw) reaches target,
+// for a reading that rises (or falls) monotonically with raw. Pressure falls,
+// and wraps around at the very top of the ADC range, so the direction is
+// given rather than probed.
+template <typename ReadingFn>
+int32_t InvertMonotonic(ReadingFn reading, int64_t target, int32_t max_raw,
+                        bool rising) {
+  int32_t lo = 0;
+  int32_t hi = max_raw;
+  while (lo < hi) {
+    int32_t mid = lo + (hi - lo) / 2;
+    int64_t value = reading(mid);
+    if (rising ? value < target : value > target) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Trimming values from the BMP280 datasheet's worked example, plus humidity
+// values from a real BME280; the same ones the bme280 unit test uses.
+const uint8_t kCalib00[bme280::kCalib00Size] = {
+    0x70, 0x6b, 0x43, 0x67, 0x18, 0xfc, 0x7d, 0x8e, 0x43,
+    0xd6, 0xd0, 0x0b, 0x27, 0x0b, 0x8c, 0x00, 0xf9, 0xff,
+    0x8c, 0x3c, 0xf8, 0xc6, 0x70, 0x17, 0x00, 0x4b,
+};
+const uint8_t kCalib26[bme280::kCalib26Size] = {0x6a, 0x01, 0x00, 0x13,
+                                                0x29, 0x03, 0x1e};
+
+// Typical forced conversion with 1x oversampling everywhere.
+const uint64_t kMeasureTimeUs = 8000;
+
+}  // namespace
+
+// Room
+
+float Room::pm2_5(uint64_t now_ms) const {
+  // A slow daily swing plus a smaller one, like cooking twice a day.
+  return 9 + 5 * Wave(now_ms, 6 * 3600) + 3 * Wave(now_ms, 1800, 0.25);
+}
+
+float Room::co2_ppm(uint64_t now_ms) const {
+  return 700 + 250 * Wave(now_ms, 2 * 3600) + 40 * Wave(now_ms, 600);
+}
+
+float Room::temp_c(uint64_t now_ms) const {
+  return 21.5 + 1.5 * Wave(now_ms, 4 * 3600);
+}
+
+float Room::humidity_pct(uint64_t now_ms) const {
+  return 45 - 6 * Wave(now_ms, 4 * 3600);
+}
+
+float Room::pressure_pa(uint64_t now_ms) const {
+  return 101325 + 150 * Wave(now_ms, 12 * 3600);
+}
+
+// Pmsx003
+
+void Pmsx003::OnReceive(const uint8_t* data, size_t size) {
+  rx_.insert(rx_.end(), data, data + size);
+  while (rx_.size() >= 7) {
+    if (rx_[0] != 0x42 || rx_[1] != 0x4d) {
+      rx_.erase(rx_.begin());
+      continue;
+    }
+    if (Sum(rx_.data(), 5) == (rx_[5] << 8 | rx_[6])) {
+      HandleCommand(rx_[2], rx_[3] << 8 | rx_[4]);
+    }
+    rx_.erase(rx_.begin(), rx_.begin() + 7);
+  }
+}
+
+void Pmsx003::HandleCommand(uint8_t cmd, uint16_t arg) {
+  switch (cmd) {
+    case 0xe1:
+      passive_ = arg == 0;
+      SendAck(cmd, arg);
+      break;
+    case 0xe2:
+      read_requested_ = passive_ && !asleep_;
+      break;
+    case 0xe4:
+      if (arg == 0) {
+        asleep_ = true;
+        SendAck(cmd, arg);
+      } else if (asleep_) {
+        // Waking restarts the fan; the first frame comes a second later.
+        asleep_ = false;
+        next_frame_ms_ = now_ms_ + 1000;
+      }
+      break;
+  }
+}
+
+void Pmsx003::SendAck(uint8_t cmd, uint8_t arg) {
+  uint8_t payload[2] = {cmd, arg};
+  uint8_t frame[8];
+  BuildPlantowerFrame(payload, sizeof(payload), frame);
+  Send(frame, sizeof(frame));
+}
+
+void Pmsx003::SendFrame(uint64_t now_ms) {
+  double pm2_5 = room_->pm2_5(now_ms);
+  double pm1 = pm2_5 * 0.65;
+  double pm10 = pm2_5 * 1.3;
+  uint8_t payload[26] = {0};
+  // CF=1 and atmospheric concentrations read the same indoors.
+  PutWord(payload, 0, Clamp16(pm1));
+  PutWord(payload, 2, Clamp16(pm2_5));
+  PutWord(payload, 4, Clamp16(pm10));
+  PutWord(payload, 6, Clamp16(pm1));
+  PutWord(payload, 8, Clamp16(pm2_5));
+  PutWord(payload, 10, Clamp16(pm10));
+  // Particles per 0.1 L, roughly as a PMS5003 reports them for this mass.
+  PutWord(payload, 12, Clamp16(pm2_5 * 180));
+  PutWord(payload, 14, Clamp16(pm2_5 * 55));
+  PutWord(payload, 16, Clamp16(pm2_5 * 9));
+  PutWord(payload, 18, Clamp16(pm2_5 * 0.8));
+  PutWord(payload, 20, Clamp16(pm2_5 * 0.25));
+  PutWord(payload, 22, Clamp16(pm2_5 * 0.1));
+  // Version and error code.
+  payload[24] = 0x97;
+  uint8_t frame[32];
+  BuildPlantowerFrame(payload, sizeof(payload), frame);
+  Send(frame, sizeof(frame));
+  ++frames_sent_;
+}
+
+void Pmsx003::Step(uint64_t now_ms) {
+  now_ms_ = now_ms;
+  if (asleep_) {
+    return;
+  }
+  if (passive_) {
+    if (read_requested_) {
+      read_requested_ = false;
+      SendFrame(now_ms);
+    }
+    return;
+  }
+  if (now_ms >= next_frame_ms_) {
+    SendFrame(now_ms);
+    next_frame_ms_ = now_ms + 1000;
+  }
+}
+
+// Mhz19
+
+void Mhz19::OnReceive(const uint8_t* data, size_t size) {
+  rx_.insert(rx_.end(), data, data + size);
+  while (rx_.size() >= 9) {
+    if (rx_[0] != 0xff || rx_[1] != 0x01) {
+      rx_.erase(rx_.begin());
+      continue;
+    }
+    if (Mhz19Checksum(rx_.data()) == rx_[8]) {
+      HandleCommand(rx_.data());
+    }
+    rx_.erase(rx_.begin(), rx_.begin() + 9);
+  }
+}
+
+void Mhz19::HandleCommand(const uint8_t* frame) {
+  uint8_t response[9] = {0xff, frame[2]};
+  switch (frame[2]) {
+    case 0x86: {
+      uint16_t co2 = Clamp16(room_->co2_ppm(now_ms_));
+      if (co2 > range_) {
+        co2 = range_;
+      }
+      PutWord(response, 2, co2);
+      response[4] = static_cast<uint8_t>(room_->temp_c(now_ms_) + 40);
+      break;
+    }
+    case 0x79:
+      abc_ = frame[3] == 0xa0;
+      response[2] = 1;
+      break;
+    case 0x99:
+      range_ = frame[6] << 8 | frame[7];
+      response[2] = 1;
+      break;
+    case 0x87:
+    case 0x88:
+      // Calibration commands are not acknowledged.
+      return;
+    default:
+      return;
+  }
+  response[8] = Mhz19Checksum(response);
+  tx_.insert(tx_.end(), response, response + sizeof(response));
+}
+
+void Mhz19::Step(uint64_t now_ms) {
+  now_ms_ = now_ms;
+  // 9600 baud is about a byte per millisecond.
+  uint8_t buffer[host::kStepMs];
+  size_t n = 0;
+  while (n < sizeof(buffer) && !tx_.empty()) {
+    buffer[n++] = tx_.front();
+    tx_.pop_front();
+  }
+  if (n > 0) {
+    Send(buffer, n);
+  }
+}
+
+// Dsco220
+
+bool Dsco220::Read(uint8_t* data, size_t size) {
+  uint8_t payload[6] = {0};
+  PutWord(payload, 0, Clamp16(room_->co2_ppm(now_ms_)));
+  uint8_t frame[12];
+  BuildPlantowerFrame(payload, sizeof(payload), frame);
+  for (size_t i = 0; i < size; ++i) {
+    // Reading past the frame clocks out 0xff.
+    data[i] = i < sizeof(frame) ? frame[i] : 0xff;
+  }
+  return true;
+}
+
+// Bme280
+
+Bme280::Bme280(const Room* room)
+    : room_(room),
+      calibration_(bme280::ParseCalibration(kCalib00, kCalib26)) {
+  Reset();
+}
+
+void Bme280::Reset() {
+  memset(regs_, 0, sizeof(regs_));
+  regs_[bme280::kRegChipId] = bme280::kChipId;
+  memcpy(&regs_[bme280::kRegCalib00], kCalib00, sizeof(kCalib00));
+  memcpy(&regs_[bme280::kRegCalib26], kCalib26, sizeof(kCalib26));
+  // Skipped measurements read as 0x80000 / 0x8000.
+  const uint8_t kSkipped[bme280::kDataSize] = {0x80, 0, 0, 0x80, 0, 0, 0x80, 0};
+  memcpy(&regs_[bme280::kRegData], kSkipped, sizeof(kSkipped));
+  done_us_ = 0;
+}
+
+bool Bme280::Write(const uint8_t* data, size_t size) {
+  if (size == 0) {
+    return true;
+  }
+  pointer_ = data[0];
+  // Writes are register/value pairs.
+  for (size_t i = 0; i + 1 < size; i += 2) {
+    uint8_t reg = data[i];
+    uint8_t value = data[i + 1];
+    if (reg == bme280::kRegReset) {
+      if (value == bme280::kResetCommand) {
+        Reset();
+      }
+      continue;
+    }
+    regs_[reg] = value;
+    if (reg == bme280::kRegCtrlMeas &&
+        (value & 0x03) == bme280::kModeForced) {
+      done_us_ = host::SimMicros() + kMeasureTimeUs;
+    }
+  }
+  return true;
+}
+
+bool Bme280::Read(uint8_t* data, size_t size) {
+  uint64_t now_us = host::SimMicros();
+  if (done_us_ != 0 && now_us >= done_us_) {
+    Measure(now_us / 1000);
+  }
+  regs_[bme280::kRegStatus] = done_us_ != 0 ? bme280::kStatusMeasuring : 0;
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = regs_[static_cast<uint8_t>(pointer_ + i)];
+  }
+  return true;
+}
+
+void Bme280::Step(uint64_t now_ms) {
+  if (done_us_ != 0 && now_ms * 1000 >= done_us_) {
+    Measure(now_ms);
+  }
+}
+
+void Bme280::Measure(uint64_t now_ms) {
+  done_us_ = 0;
+  // Back to sleep after a forced conversion.
+  regs_[bme280::kRegCtrlMeas] &= ~0x03;
+
+  bme280::RawData raw = {0x80000, 0x80000, 0x8000};
+  auto compensate = [this](const bme280::RawData& raw) {
+    bme280::Reading reading = {};
+    bme280::Compensate(calibration_, raw, &reading);
+    return reading;
+  };
+  raw.adc_t = InvertMonotonic(
+      [&](int32_t adc) {
+        return compensate({raw.adc_p, adc, raw.adc_h}).temp_centi_c;
+      },
+      lround(room_->temp_c(now_ms) * 100), 0xfffff, /*rising=*/true);
+  raw.adc_p = InvertMonotonic(
+      [&](int32_t adc) {
+        return static_cast<int64_t>(
+            compensate({adc, raw.adc_t, raw.adc_h}).pressure_q24_8);
+      },
+      llround(room_->pressure_pa(now_ms) * 256), 0xfffff,
+      /*rising=*/false);
+  raw.adc_h = InvertMonotonic(
+      [&](int32_t adc) {
+        return static_cast<int64_t>(
+            compensate({raw.adc_p, raw.adc_t, adc}).humidity_q22_10);
+      },
+      llround(room_->humidity_pct(now_ms) * 1024), 0xffff,
+      /*rising=*/true);
+
+  uint8_t* out = &regs_[bme280::kRegData];
+  out[0] = raw.adc_p >> 12;
+  out[1] = raw.adc_p >> 4;
+  out[2] = (raw.adc_p & 0x0f) << 4;
+  out[3] = raw.adc_t >> 12;
+  out[4] = raw.adc_t >> 4;
+  out[5] = (raw.adc_t & 0x0f) << 4;
+  out[6] = raw.adc_h >> 8;
+  out[7] = raw.adc_h;
+}
+
+}  // namespace sim
@@ -0,0 +1,114 @@
+#ifndef _HOST_SIM_DEVICES_H_
+#define _HOST_SIM_DEVICES_H_
+
+// Byte-accurate models of the sensors on the board, written from the
+// datasheets rather than from the drivers so a driver bug can't hide behind a
+// matching model bug. Readings come from one slowly varying Room.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+#include "bme280.h"
+#include "host.h"
+
+namespace sim {
+
+// What the sensors are sitting in, as a function of simulated time.
+struct Room {
+  float pm2_5(uint64_t now_ms) const;
+  float co2_ppm(uint64_t now_ms) const;
+  float temp_c(uint64_t now_ms) const;
+  float humidity_pct(uint64_t now_ms) const;
+  float pressure_pa(uint64_t now_ms) const;
+};
+
+// PMS5003/PMS7003 on a UART: 32 byte frames every second in active mode, one
+// per 0xe2 in passive mode, none while asleep; mode and sleep commands are
+// acked with 8 byte frames.
+class Pmsx003 : public host::SerialDevice {
+ public:
+  explicit Pmsx003(const Room* room) : room_(room) {}
+
+  void OnReceive(const uint8_t* data, size_t size) override;
+  void Step(uint64_t now_ms) override;
+
+  int frames_sent() const { return frames_sent_; }
+
+ private:
+  void HandleCommand(uint8_t cmd, uint16_t arg);
+  void SendFrame(uint64_t now_ms);
+  void SendAck(uint8_t cmd, uint8_t arg);
+
+  const Room* room_;
+  std::vector<uint8_t> rx_;
+  bool asleep_ = false;
+  bool passive_ = false;
+  bool read_requested_ = false;
+  uint64_t now_ms_ = 0;
+  uint64_t next_frame_ms_ = 0;
+  int frames_sent_ = 0;
+};
+
+// MH-Z19B on a UART: 9 byte commands, 9 byte responses to everything except
+// zero and span calibration.
+class Mhz19 : public host::SerialDevice {
+ public:
+  explicit Mhz19(const Room* room) : room_(room) {}
+
+  void OnReceive(const uint8_t* data, size_t size) override;
+  void Step(uint64_t now_ms) override;
+
+ private:
+  void HandleCommand(const uint8_t* frame);
+
+  const Room* room_;
+  std::vector<uint8_t> rx_;
+  std::deque<uint8_t> tx_;
+  uint64_t now_ms_ = 0;
+  bool abc_ = true;
+  uint16_t range_ = 5000;
+};
+
+// Plantower DS-CO2-20 on I2C: every read returns a 12 byte frame.
+class Dsco220 : public host::I2cDevice {
+ public:
+  explicit Dsco220(const Room* room) : room_(room) {}
+
+  bool Write(const uint8_t* data, size_t size) override { return true; }
+  bool Read(uint8_t* data, size_t size) override;
+  void Step(uint64_t now_ms) override { now_ms_ = now_ms; }
+
+ private:
+  const Room* room_;
+  uint64_t now_ms_ = 0;
+};
+
+// BME280 on I2C: the register map, soft reset and forced mode conversions
+// that take as long as the datasheet says, using the trimming values from the
+// datasheet's example.
+class Bme280 : public host::I2cDevice {
+ public:
+  explicit Bme280(const Room* room);
+
+  bool Write(const uint8_t* data, size_t size) override;
+  bool Read(uint8_t* data, size_t size) override;
+  void Step(uint64_t now_ms) override;
+
+ private:
+  void Reset();
+  void Measure(uint64_t now_ms);
+
+  const Room* room_;
+  bme280::Calibration calibration_;
+  uint8_t regs_[256] = {0};
+  uint8_t pointer_ = 0;
+  // Sim time the running conversion finishes; 0 when idle.
+  uint64_t done_us_ = 0;
+};
+
+}  // namespace sim
+
+#endif  // _HOST_SIM_DEVICES_H_
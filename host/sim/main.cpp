@@ -0,0 +1,339 @@
+// Runs the whole firmware on the host: setup() and loop() in a loopTask like
+// the Arduino core, every FreeRTOS task on its own thread, and simulated
+// sensors on the other end of the UARTs and the I2C bus.
+//
+//   pneumatic_sim [--speed=N] [--duration=S] [--http-port=P] [--log-level=L]
+//                 [--check] [--unprovisioned]
+//
+// --speed runs simulated time N times faster than wall time. After --duration
+// simulated seconds (forever if 0) it prints what each task cost, and with
+// --check fetches /varz from the running firmware and fails unless every
+// sensor reported, then puts a short concurrent keep-alive load on the web
+// server and fails on any error or dropped connection. --unprovisioned
+// starts without a saved network, so the firmware comes up in its portal.
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+#include "devices.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host.h"
+#include "loadgen.h"
+
+// The firmware's entry points, from src/main.cpp.
+void setup();
+void loop();
+
+namespace {
+
+// The Arduino core's loopTask.
+const uint32_t kLoopTaskStackSize = 8 * 1024;
+const UBaseType_t kLoopTaskPriority = 1;
+
+// Sensor ports and addresses, as wired in src/main.cpp.
+const int kPmsx003Uart = 2;
+const int kMhz19Uart = 1;
+const uint8_t kDsco220Address = 0x08;
+const uint8_t kBme280Address = 0x76;
+
+void LoopTask(void* arg) {
+  setup();
+  for (;;) {
+    loop();
+  }
+}
+
+void PrintReport(uint64_t sim_ms) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  uint64_t process_cpu_us = usage.ru_utime.tv_sec * 1000000ull +
+                            usage.ru_utime.tv_usec +
+                            usage.ru_stime.tv_sec * 1000000ull +
+                            usage.ru_stime.tv_usec;
+
+  printf("\n# %llu ms simulated at %gx, %llu us host CPU\n",
+         static_cast<unsigned long long>(sim_ms), host::speed(),
+         static_cast<unsigned long long>(process_cpu_us));
+  printf("%-20s %4s %10s %10s %12s %10s\n", "task", "prio", "stack",
+         "stack_used", "cpu_us", "cpu_us/s");
+  for (const auto& task : host::GetTaskStats()) {
+    printf("%-20s %4u %10u %10u %12llu %10.1f%s\n", task.name.c_str(),
+           task.priority, task.stack_size, task.stack_used,
+           static_cast<unsigned long long>(task.cpu_us),
+           sim_ms > 0 ? task.cpu_us * 1000.0 / sim_ms : 0.0,
+           task.running ? "" : " (exited)");
+  }
+  printf("heap: %u free, %u minimum free\n", esp_get_free_heap_size(),
+         esp_get_minimum_free_heap_size());
+}
+
+// GET path from the firmware's web server, with any extra header lines;
+// empty on failure. HTTP/1.0, so the body comes back whole rather than in
+// chunks.
+std::string Fetch(uint16_t port, const char* path, const char* headers = "") {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  struct timeval timeout = {10, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  std::string response;
+  if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+    std::string request = std::string("GET ") + path +
+                          " HTTP/1.0\r\nHost: localhost\r\n" + headers +
+                          "\r\n";
+    send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+    char buffer[4096];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+      response.append(buffer, n);
+    }
+  }
+  close(fd);
+  return response;
+}
+
+// Number of events, up to count, that arrive on /events within timeout_s;
+// the stream never ends, so this hangs up once it has count of them.
+int CountEvents(uint16_t port, int count, int timeout_s) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  struct timeval timeout = {timeout_s, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  std::string stream;
+  int events = 0;
+  if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+    const char kRequest[] = "GET /events HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    send(fd, kRequest, strlen(kRequest), MSG_NOSIGNAL);
+    char buffer[4096];
+    ssize_t n;
+    while (events < count && (n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+      stream.append(buffer, n);
+      events = 0;
+      for (size_t pos = stream.find("\nevent: "); pos != std::string::npos;
+           pos = stream.find("\nevent: ", pos + 1)) {
+        ++events;
+      }
+    }
+  }
+  close(fd);
+  return stream.rfind("HTTP/1.1 200", 0) == 0 ? events : 0;
+}
+
+// Value of the first name{...} line of varz whose labels include label; 0 if
+// there is none.
+double MetricValue(const std::string& varz, const char* name,
+                   const char* label) {
+  const std::string prefix = std::string("\n") + name + "{";
+  for (size_t pos = varz.find(prefix); pos != std::string::npos;
+       pos = varz.find(prefix, pos + 1)) {
+    size_t end = varz.find('}', pos);
+    if (end == std::string::npos) {
+      break;
+    }
+    if (varz.substr(pos, end - pos).find(label) != std::string::npos) {
+      return atof(varz.c_str() + end + 1);
+    }
+  }
+  return 0;
+}
+
+// True if /varz looks like every sensor delivered a reading.
+bool Check() {
+  uint16_t port = host::BoundHttpPort();
+  if (port == 0) {
+    fprintf(stderr, "check: web server never started\n");
+    return false;
+  }
+  std::string varz = Fetch(port, "/varz");
+  printf("\n# /varz\n%s\n", varz.c_str());
+  if (varz.rfind("HTTP/1.1 200", 0) != 0) {
+    fprintf(stderr, "check: /varz failed\n");
+    return false;
+  }
+  // Metric name, and the label that picks the sensor.
+  const char* kWanted[][2] = {
+      {"pm_ug_m3", "size=\"pm2.5\""},
+      {"co2_ppm", "sensor=\"DS-CO2-20\""},
+      {"co2_ppm", "sensor=\"MH-Z19C\""},
+      {"pressure_pa", "sensor=\"BME280\""},
+  };
+  bool ok = true;
+  for (const auto& wanted : kWanted) {
+    if (MetricValue(varz, wanted[0], wanted[1]) <= 0) {
+      fprintf(stderr, "check: no reading for %s{%s}\n", wanted[0], wanted[1]);
+      ok = false;
+    }
+  }
+  std::string statusz = Fetch(port, "/statusz");
+  if (statusz.rfind("HTTP/1.1 200", 0) != 0) {
+    fprintf(stderr, "check: status page failed\n");
+    ok = false;
+  }
+  std::string shell = Fetch(port, "/", "Accept-Encoding: gzip\r\n");
+  if (shell.rfind("HTTP/1.1 200", 0) != 0 ||
+      shell.find("Content-Encoding: gzip") == std::string::npos) {
+    fprintf(stderr, "check: page shell failed\n");
+    ok = false;
+  }
+  std::string readings = Fetch(port, "/api/v1/readings");
+  printf("\n# /api/v1/readings\n%s\n", readings.c_str());
+  if (readings.rfind("HTTP/1.1 200", 0) != 0 ||
+      readings.find("\"pm2_5\":{\"ug_m3\":") == std::string::npos ||
+      readings.find("\"co2_ppm\":") == std::string::npos) {
+    fprintf(stderr, "check: readings failed\n");
+    ok = false;
+  }
+  // The sensors have been recording since boot.
+  std::string history =
+      Fetch(port, "/api/v1/history?metric=co2_ppm&from=-60&points=10");
+  printf("\n# /api/v1/history\n%s\n", history.c_str());
+  const size_t csv = history.find("\r\n\r\nt,min,max,mean,count\n");
+  // The header line and at least one bucket.
+  if (history.rfind("HTTP/1.1 200", 0) != 0 || csv == std::string::npos ||
+      std::count(history.begin() + csv, history.end(), '\n') < 4) {
+    fprintf(stderr, "check: history failed\n");
+    ok = false;
+  }
+  // And logging them to flash, the clock being set from the start.
+  std::string log =
+      Fetch(port, "/api/v1/log?metric=temp_c&from=-60&limit=10");
+  printf("\n# /api/v1/log\n%s\n", log.c_str());
+  const size_t log_csv = log.find("\r\n\r\nt,value\n");
+  if (log.rfind("HTTP/1.1 200", 0) != 0 || log_csv == std::string::npos ||
+      std::count(log.begin() + log_csv, log.end(), '\n') < 8) {
+    fprintf(stderr, "check: flash log failed\n");
+    ok = false;
+  }
+  // A full snapshot, then updates as the sensors publish.
+  if (CountEvents(port, 3, 10) < 2) {
+    fprintf(stderr, "check: /events failed\n");
+    ok = false;
+  }
+
+  loadgen::Options load;
+  load.port = port;
+  load.connections = 4;
+  load.duration_s = 1;
+  const loadgen::Result result = loadgen::Run(load);
+  printf("\n# load\n");
+  loadgen::PrintJson(load, result, stdout);
+  // Every client should get by on the one connection it opened.
+  if (result.requests == 0 || result.errors > 0 ||
+      result.connects != static_cast<uint64_t>(load.connections)) {
+    fprintf(stderr, "check: web server load failed\n");
+    ok = false;
+  }
+  return ok;
+}
+
+esp_log_level_t ParseLevel(const char* name) {
+  const char* kNames[] = {"none", "error", "warn", "info", "debug", "verbose"};
+  for (int i = 0; i < 6; ++i) {
+    if (strcmp(name, kNames[i]) == 0) {
+      return static_cast<esp_log_level_t>(i);
+    }
+  }
+  return ESP_LOG_INFO;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double speed = 10;
+  double duration_s = 0;
+  int http_port = 8080;
+  bool check = false;
+  bool provisioned = true;
+  const struct option kOptions[] = {
+      {"speed", required_argument, nullptr, 's'},
+      {"duration", required_argument, nullptr, 'd'},
+      {"http-port", required_argument, nullptr, 'p'},
+      {"log-level", required_argument, nullptr, 'l'},
+      {"check", no_argument, nullptr, 'c'},
+      {"unprovisioned", no_argument, nullptr, 'u'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "", kOptions, nullptr)) != -1) {
+    switch (opt) {
+      case 's':
+        speed = atof(optarg);
+        break;
+      case 'd':
+        duration_s = atof(optarg);
+        break;
+      case 'p':
+        http_port = atoi(optarg);
+        break;
+      case 'l':
+        esp_log_level_set("*", ParseLevel(optarg));
+        break;
+      case 'c':
+        check = true;
+        break;
+      case 'u':
+        provisioned = false;
+        break;
+      default:
+        fprintf(stderr,
+                "usage: %s [--speed=N] [--duration=S] [--http-port=P] "
+                "[--log-level=L] [--check] [--unprovisioned]\n",
+                argv[0]);
+        return 2;
+    }
+  }
+  if (speed <= 0) {
+    speed = 1;
+  }
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+
+  host::SetSpeed(speed);
+  host::SetHttpPort(http_port);
+  host::SetWifiProvisioned(provisioned);
+
+  static sim::Room room;
+  static sim::Pmsx003 pmsx003(&room);
+  static sim::Mhz19 mhz19(&room);
+  static sim::Dsco220 dsco220(&room);
+  static sim::Bme280 bme280(&room);
+  host::UartAttach(kPmsx003Uart, &pmsx003);
+  host::UartAttach(kMhz19Uart, &mhz19);
+  host::I2cAttach(kDsco220Address, &dsco220);
+  host::I2cAttach(kBme280Address, &bme280);
+  host::StartDevices();
+
+  xTaskCreate(LoopTask, "loopTask", kLoopTaskStackSize, nullptr,
+              kLoopTaskPriority, nullptr);
+
+  if (duration_s <= 0) {
+    for (;;) {
+      pause();
+    }
+  }
+  const uint64_t end_us = duration_s * 1000000;
+  std::this_thread::sleep_until(host::RealTimeAt(end_us));
+  bool ok = !check || Check();
+  PrintReport(host::SimMicros() / 1000);
+  fflush(stdout);
+  // The firmware's tasks never return; don't wait for them.
+  _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,277 @@
+#include "aqi.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+namespace aqi {
+
+namespace {
+
+const Category kCategories[kNumCategories] = {
+    {
+        .tag = "good",
+        .message = "Good 😀",
+        .low_aqi = 0,
+        .high_aqi = 50,
+        .color = 0x00e400,
+        .web_color = 0x68e143,
+        .led_color = 0x00ff00,
+    },
+    {
+        .tag = "moderate",
+        .message = "Moderate 😐",
+        .low_aqi = 51,
+        .high_aqi = 100,
+        .color = 0xffff00,
+        .web_color = 0xffff55,
+        .led_color = 0xffff00,
+    },
+    {
+        .tag = "unhealthy-for-sensitive-groups",
+        .message = "Unhealthy for sensitive groups 🙁",
+        .low_aqi = 101,
+        .high_aqi = 150,
+        .color = 0xff7e00,
+        .web_color = 0xef8533,
+        .led_color = 0xff6000,
+    },
+    {
+        .tag = "unhealthy",
+        .message = "Unhealthy 😷",
+        .low_aqi = 151,
+        .high_aqi = 200,
+        .color = 0xff0000,
+        .web_color = 0xea3324,
+        .led_color = 0xff0000,
+    },
+    {
+        .tag = "very-unhealthy",
+        .message = "Very Unhealthy 🤢",
+        .low_aqi = 201,
+        .high_aqi = 300,
+        .color = 0x8f3f97,
+        .web_color = 0x8c1a4b,
+        .led_color = 0xff0020,
+    },
+    {
+        .tag = "hazardous",
+        .message = "Hazardous 😵",
+        .low_aqi = 301,
+        .high_aqi = 400,
+        .color = 0x7e0023,
+        .web_color = 0x8c1a4b,
+        .led_color = 0xff0040,
+    },
+    {
+        // Note: Officially, this is still just "hazardous".
+        .tag = "very-hazardous",
+        .message = "Very Hazardous ☠️",
+        .low_aqi = 401,
+        .high_aqi = 500,
+        .color = 0x7e0023,
+        .web_color = 0x731425,
+        .led_color = 0xff0060,
+    },
+};
+
+struct Breakpoints {
+  float low_conc;
+  float high_conc;
+};
+
+// PM1.0 aqi isn't really defined!
+const Breakpoints kPm2_5[kNumCategories] = {
+    // good
+    {
+        .low_conc = 0.0,
+        .high_conc = 12.0,
+    },
+    // moderate
+    {
+        .low_conc = 12.1,
+        .high_conc = 35.4,
+    },
+    // unhealthy for sensitive groups
+    {
+        .low_conc = 35.5,
+        .high_conc = 55.4,
+    },
+    // unhealthy
+    {
+        .low_conc = 55.5,
+        .high_conc = 150.4,
+    },
+    // very unhealthy
+    {
+        .low_conc = 150.5,
+        .high_conc = 250.4,
+    },
+    // hazardous
+    {
+        .low_conc = 250.5,
+        .high_conc = 350.4,
+    },
+    {
+        .low_conc = 350.5,
+        .high_conc = 500.4,
+    },
+};
+const Breakpoints kPm10_0[kNumCategories] = {
+    // good
+    {
+        .low_conc = 0,
+        .high_conc = 54,
+    },
+    // moderate
+    {
+        .low_conc = 55,
+        .high_conc = 154,
+    },
+    // unhealthy for sensitive groups
+    {
+        .low_conc = 155,
+        .high_conc = 254,
+    },
+    // unhealthy
+    {
+        .low_conc = 255,
+        .high_conc = 354,
+    },
+    // very unhealthy
+    {
+        .low_conc = 355,
+        .high_conc = 424,
+    },
+    // hazardous
+    {
+        .low_conc = 425,
+        .high_conc = 504,
+    },
+    {
+        .low_conc = 505,
+        .high_conc = 604,
+    },
+};
+
+// CO2 aqi isn't a thing, just doing this for colors.
+const Breakpoints kCo2[kNumCategories] = {
+    // good, green
+    {
+        .low_conc = 0,
+        .high_conc = 700,
+    },
+    // moderate, yellow
+    {
+        .low_conc = 701,
+        .high_conc = 1000,
+    },
+    // unhealthy for sensitive groups, orange
+    {
+        .low_conc = 1001,
+        .high_conc = 1500,
+    },
+    // unhealthy, red
+    {
+        .low_conc = 1501,
+        .high_conc = 2000,
+    },
+    // very unhealthy, purple
+    {
+        .low_conc = 2001,
+        .high_conc = 3000,
+    },
+    // hazardous, maroon
+    {
+        .low_conc = 3001,
+        .high_conc = 4000,
+    },
+    {
+        .low_conc = 4001,
+        .high_conc = 5000,
+    },
+};
+
+// The AQI of conc on levels, after truncating it to truncate_decimals.
+// https://www.airnow.gov/aqi/aqi-calculator/
+// https://www.airnow.gov/sites/default/files/2020-05/aqi-technical-assistance-document-sept2018.pdf
+int Aqi(const Breakpoints* levels, int truncate_decimals, float conc) {
+  for (int i = 0; i < truncate_decimals; ++i) {
+    conc *= 10;
+  }
+  conc = int(conc);  // truncate
+  for (int i = 0; i < truncate_decimals; ++i) {
+    conc /= 10;
+  }
+
+  int i = 0;
+  while (i + 1 < kNumCategories && conc > levels[i].high_conc) {
+    ++i;
+  }
+  const Category& cat = kCategories[i];
+  return std::round(cat.low_aqi + float(cat.high_aqi - cat.low_aqi) /
+                                      float(levels[i].high_conc -
+                                            levels[i].low_conc) *
+                                      (conc - levels[i].low_conc));
+}
+
+}  // namespace
+
+const Category& GetCategory(int index) {
+  return kCategories[std::min(std::max(index, 0), kNumCategories - 1)];
+}
+
+int Pm2_5Aqi(float pm2_5) { return Aqi(kPm2_5, 1, pm2_5); }
+
+int Pm10Aqi(float pm10) { return Aqi(kPm10_0, 0, pm10); }
+
+int Co2Aqi(int co2_ppm) { return Aqi(kCo2, 0, co2_ppm); }
+
+Level GetLevel(int aqi) {
+  int i = 0;
+  while (i + 1 < kNumCategories && aqi > kCategories[i].high_aqi) {
+    ++i;
+  }
+  return {static_cast<int16_t>(aqi), static_cast<uint8_t>(i),
+          FgColor(kCategories[i].color)};
+}
+
+uint32_t FgColor(uint32_t bg_color) {
+  // https://www.w3.org/TR/AERT/#color-contrast
+  // range: [0,255000]
+  int brightness = (bg_color >> 16) * 299 + ((bg_color >> 8) & 0xff) * 587 +
+                   (bg_color & 0xff) * 114;
+  return (brightness > 127500) ? 0x000000 : 0xffffff;
+}
+
+Data Derive(const pmsx003::Data& pmsx003, const dsco220::Data& dsco220) {
+  Data data = {};
+  data.pm_1_0 = pmsx003.pm_1_0;
+  data.pm_2_5 = pmsx003.pm_2_5;
+  data.pm_10_0 = pmsx003.pm_10_0;
+  data.co2_ppm = dsco220.co2_ppm;
+  data.pm1_0 = GetLevel(Pm2_5Aqi(pmsx003.pm_1_0));
+  data.pm2_5 = GetLevel(Pm2_5Aqi(pmsx003.pm_2_5));
+  data.pm10_0 = GetLevel(Pm10Aqi(pmsx003.pm_10_0));
+  data.max = data.pm2_5.aqi >= data.pm10_0.aqi ? data.pm2_5 : data.pm10_0;
+  data.co2 = GetLevel(Co2Aqi(dsco220.co2_ppm));
+  return data;
+}
+
+void Update(void* task_data_arg, unsigned long cycle_ms) {
+  auto* task_data = reinterpret_cast<TaskData*>(task_data_arg);
+  // Only this job publishes, so the last snapshot says what it was made of.
+  const Data last = task_data->topic->Get().value;
+  const auto pmsx003 = task_data->pmsx003->Get();
+  const auto dsco220 = task_data->dsco220->Get();
+  if (pmsx003.seq == last.pmsx003_seq && dsco220.seq == last.dsco220_seq) {
+    return;
+  }
+  Data data = Derive(pmsx003.value, dsco220.value);
+  data.pmsx003_seq = pmsx003.seq;
+  data.dsco220_seq = dsco220.seq;
+  task_data->topic->Publish(
+      data, std::max(pmsx003.timestamp_ms, dsco220.timestamp_ms));
+}
+
+}  // namespace aqi
@@ -0,0 +1,93 @@
+#ifndef _AQI_H_
+#define _AQI_H_
+
+// US AQI from the particulate readings, and the same categories and colors
+// for CO2, worked out once per snapshot.
+//
+// Update() runs on the scheduler after the sensors publish and puts
+// everything derived from the latest PMSx003 and DS-CO2-20 snapshots into
+// one Topic<Data>, so the display, the LED and the web pages all show the
+// same numbers in the same colors without each redoing the float math.
+
+#include <stdint.h>
+
+#include "dsco220.h"
+#include "pmsx003.h"
+#include "sensor_bus.h"
+
+namespace aqi {
+
+struct Category {
+  // e.g. "good"; also the CSS class.
+  const char* tag;
+  const char* message;
+
+  uint16_t low_aqi;
+  uint16_t high_aqi;
+  uint32_t color;  // official AQI colors
+  uint32_t web_color;
+  uint32_t led_color;
+};
+
+const int kNumCategories = 7;
+const Category& GetCategory(int index);
+
+// An AQI and its category. All zero is a valid "good" level, which is what
+// readers get before the first snapshot.
+struct Level {
+  int16_t aqi;
+  uint8_t category_index;
+  // Black or white, whichever reads better on the category's color.
+  uint32_t fg_color;
+
+  const Category& category() const { return GetCategory(category_index); }
+};
+
+struct Data {
+  // Seqs of the snapshots these come from; 0 until the sensor's first.
+  uint32_t pmsx003_seq;
+  uint32_t dsco220_seq;
+  // The readings worked from.
+  float pm_1_0;
+  float pm_2_5;
+  float pm_10_0;
+  int co2_ppm;
+  // PM1.0 AQI is not a thing! Worked out anyway, on the PM2.5 scale.
+  Level pm1_0;
+  Level pm2_5;
+  Level pm10_0;
+  // The worse of PM2.5 and PM10.0: the AQI.
+  Level max;
+  // CO2 has no AQI; this only picks its category and colors.
+  Level co2;
+};
+
+// US AQI for a PM2.5 or PM10 concentration in ug/m^3, truncated the way
+// AirNow does.
+int Pm2_5Aqi(float pm2_5);
+int Pm10Aqi(float pm10);
+// CO2 in ppm on the same scale, for its colors.
+int Co2Aqi(int co2_ppm);
+
+// The level of an AQI, category and foreground color included.
+Level GetLevel(int aqi);
+
+// Black or white text for a background of bg_color, both 0xrrggbb.
+uint32_t FgColor(uint32_t bg_color);
+
+Data Derive(const pmsx003::Data& pmsx003, const dsco220::Data& dsco220);
+
+struct TaskData {
+  const sensor_bus::Topic<pmsx003::Data>* pmsx003;
+  const sensor_bus::Topic<dsco220::Data>* dsco220;
+  sensor_bus::Topic<Data>* topic;
+};
+
+// Scheduler job (see scheduler::JobFn); task_data is a TaskData*. Publishes
+// to topic whenever either sensor has, so it belongs on every tick, after
+// the jobs that poll them.
+void Update(void* task_data, unsigned long cycle_ms);
+
+}  // namespace aqi
+
+#endif  // _AQI_H_
@@ -0,0 +1,64 @@
+// Counts heap allocations for bench::State. Only built into benchmark
+// binaries, which define BENCH_COUNT_ALLOCATIONS:
+//
+// - On the ESP32 the bench environment links with
+//   -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc, which sends every call
+//   from the firmware, Arduino core and libstdc++ (operator new) through the
+//   __wrap_ functions here. Direct heap_caps_malloc() calls aren't seen.
+// - On glibc the functions here replace malloc() for the whole process.
+
+#include <stddef.h>
+
+#include "bench.h"
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+
+#if defined(ESP32)
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  bench::internal::CountAllocation(size);
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  bench::internal::CountAllocation(count * size);
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  bench::internal::CountAllocation(size);
+  return __real_realloc(ptr, size);
+}
+}  // extern "C"
+
+#elif defined(__GLIBC__)
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+  bench::internal::CountAllocation(size);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+  bench::internal::CountAllocation(count * size);
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  bench::internal::CountAllocation(size);
+  return __libc_realloc(ptr, size);
+}
+}  // extern "C"
+
+#endif
+
+#endif  // BENCH_COUNT_ALLOCATIONS
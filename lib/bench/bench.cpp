@@ -0,0 +1,218 @@
+#include "bench.h"
+
+#include <Arduino.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace bench {
+namespace {
+const char TAG[] = "bench";
+
+const int kMaxBenchmarks = 32;
+// Each timed loop grows iterations by at most this much, and at least 2x.
+const uint32_t kMaxGrowth = 100;
+const uint32_t kMaxIterations = 1000 * 1000 * 1000;
+
+struct Benchmark {
+  const char* name;
+  BenchmarkFn fn;
+};
+
+Benchmark& benchmark(int i) {
+  // A function static so registration from other files' static initializers
+  // doesn't depend on initialization order.
+  static Benchmark benchmarks[kMaxBenchmarks];
+  return benchmarks[i];
+}
+int benchmark_count = 0;
+
+// Allocations made by counting_task so far.
+TaskHandle_t volatile counting_task = nullptr;
+volatile uint32_t total_allocations = 0;
+volatile uint32_t total_allocated_bytes = 0;
+
+struct Run {
+  BenchmarkFn fn;
+  const Options* options;
+  SemaphoreHandle_t done;
+  // Filled in by TimingTask().
+  uint32_t iterations;
+  uint32_t elapsed_us;
+  uint32_t elapsed_cycles;
+  uint32_t allocations;
+  uint32_t allocated_bytes;
+  // Filled in by StackTask().
+  uint32_t stack_used;
+};
+
+// Grows the iteration count until one timed loop takes min_time_ms, the way
+// Google Benchmark does, then keeps that loop's numbers.
+void TimingTask(void* run_arg) {
+  auto* run = reinterpret_cast<Run*>(run_arg);
+  counting_task = xTaskGetCurrentTaskHandle();
+  const uint32_t min_time_us = run->options->min_time_ms * 1000;
+  uint32_t iterations = 1;
+  for (;;) {
+    State state(iterations);
+    run->fn(state);
+    run->iterations = iterations;
+    run->elapsed_us = state.elapsed_us();
+    run->elapsed_cycles = state.elapsed_cycles();
+    run->allocations = state.allocations();
+    run->allocated_bytes = state.allocated_bytes();
+    if (state.elapsed_us() >= min_time_us || iterations >= kMaxIterations) {
+      break;
+    }
+    // Aim 40% past the target so the next loop is very likely the last.
+    uint64_t next =
+        state.elapsed_us() == 0
+            ? uint64_t(iterations) * kMaxGrowth
+            : uint64_t(iterations) * min_time_us * 14 / 10 / state.elapsed_us();
+    next = std::max<uint64_t>(next, uint64_t(iterations) * 2);
+    next = std::min<uint64_t>(next, uint64_t(iterations) * kMaxGrowth);
+    iterations = std::min<uint64_t>(next, kMaxIterations);
+    // Let the idle task feed the watchdog between loops.
+    vTaskDelay(1);
+  }
+  counting_task = nullptr;
+  xSemaphoreGive(run->done);
+  vTaskDelete(nullptr);
+}
+
+// One iteration in a fresh task, so the high water mark is the benchmark's
+// and not that of the delays between timed loops.
+void StackTask(void* run_arg) {
+  auto* run = reinterpret_cast<Run*>(run_arg);
+  State state(1);
+  run->fn(state);
+  run->stack_used =
+      run->options->stack_size - uxTaskGetStackHighWaterMark(nullptr);
+  xSemaphoreGive(run->done);
+  vTaskDelete(nullptr);
+}
+
+bool RunTask(TaskFunction_t task, Run* run) {
+  // Same priority as the caller, so it isn't preempted by whoever started
+  // the run.
+  if (xTaskCreate(task, "bench", run->options->stack_size, run,
+                  uxTaskPriorityGet(nullptr), nullptr) != pdPASS) {
+    ESP_LOGE(TAG, "RunTask(): xTaskCreate() failed");
+    return false;
+  }
+  xSemaphoreTake(run->done, portMAX_DELAY);
+  return true;
+}
+
+bool RunOne(BenchmarkFn fn, const Options& options, bool timed, Run* run) {
+  *run = {};
+  run->fn = fn;
+  run->options = &options;
+  run->done = xSemaphoreCreateBinary();
+  if (run->done == nullptr) {
+    return false;
+  }
+  bool ok = RunTask(StackTask, run) && (!timed || RunTask(TimingTask, run));
+  vSemaphoreDelete(run->done);
+  return ok;
+}
+
+// The harness' own stack use, subtracted from every benchmark's.
+void BM_Empty(State& state) {
+  for (auto _ : state) {
+  }
+}
+
+}  // namespace
+
+void State::Start() {
+  remaining_ = iterations_;
+  start_allocations_ = total_allocations;
+  start_allocated_bytes_ = total_allocated_bytes;
+  start_us_ = micros();
+  start_cycles_ = ESP.getCycleCount();
+}
+
+void State::Stop() {
+  uint32_t cycles = ESP.getCycleCount();
+  uint32_t us = micros();
+  elapsed_cycles_ = cycles - start_cycles_;
+  elapsed_us_ = us - start_us_;
+  allocations_ = total_allocations - start_allocations_;
+  allocated_bytes_ = total_allocated_bytes - start_allocated_bytes_;
+}
+
+int Register(const char* name, BenchmarkFn fn) {
+  if (benchmark_count >= kMaxBenchmarks) {
+    return -1;
+  }
+  benchmark(benchmark_count) = {name, fn};
+  return benchmark_count++;
+}
+
+int RunAll(const Options& options, Print* out) {
+#ifdef ESP32
+  const char* target = "esp32";
+#else
+  const char* target = "host";
+#endif
+  out->printf(
+      "{\"context\":{\"target\":\"%s\",\"cpu_mhz\":%u,\"min_time_ms\":%u,"
+      "\"stack_size\":%u}}\n",
+      target, static_cast<unsigned>(ESP.getCpuFreqMHz()),
+      static_cast<unsigned>(options.min_time_ms),
+      static_cast<unsigned>(options.stack_size));
+
+  Run run;
+  if (!RunOne(BM_Empty, options, /*timed=*/false, &run)) {
+    return 0;
+  }
+  const uint32_t harness_stack = run.stack_used;
+
+  int count = 0;
+  for (int i = 0; i < benchmark_count; ++i) {
+    const Benchmark& bm = benchmark(i);
+    if (options.filter != nullptr && strstr(bm.name, options.filter) == nullptr) {
+      continue;
+    }
+    if (!RunOne(bm.fn, options, /*timed=*/true, &run)) {
+      continue;
+    }
+    Result result;
+    result.name = bm.name;
+    result.iterations = run.iterations;
+    result.ns = run.elapsed_us * 1000.0f / run.iterations;
+    result.cycles = float(run.elapsed_cycles) / run.iterations;
+    result.allocations = float(run.allocations) / run.iterations;
+    result.allocated_bytes = float(run.allocated_bytes) / run.iterations;
+    result.stack_bytes =
+        run.stack_used > harness_stack ? run.stack_used - harness_stack : 0;
+    out->printf(
+        "{\"bench\":\"%s\",\"iterations\":%u,\"ns\":%.1f,\"cycles\":%.1f,"
+        "\"allocs\":%.2f,\"alloc_bytes\":%.1f,\"stack_bytes\":%u}\n",
+        result.name, static_cast<unsigned>(result.iterations), result.ns,
+        result.cycles, result.allocations, result.allocated_bytes,
+        static_cast<unsigned>(result.stack_bytes));
+    ++count;
+  }
+  return count;
+}
+
+namespace internal {
+
+void CountAllocation(size_t size) {
+  if (counting_task == nullptr ||
+      xTaskGetCurrentTaskHandle() != counting_task) {
+    return;
+  }
+  total_allocations = total_allocations + 1;
+  total_allocated_bytes = total_allocated_bytes + size;
+}
+
+}  // namespace internal
+
+}  // namespace bench
@@ -0,0 +1,135 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+// A small Google Benchmark style harness that runs the same benchmarks on the
+// host and on the ESP32:
+//
+//   void BM_Foo(bench::State& state) {
+//     for (auto _ : state) {
+//       bench::DoNotOptimize(Foo());
+//     }
+//   }
+//   BENCHMARK(BM_Foo);
+//
+// Each benchmark runs in a task of its own so its stack high water mark can
+// be read afterwards. The timed loop is measured with micros() and the CPU
+// cycle counter, and heap allocations made by that task are counted (see
+// alloc_hooks.cpp). Results are printed one JSON object per line, so they can
+// be grepped out of a serial log and diffed between builds.
+
+#include <Print.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bench {
+
+class State {
+ public:
+  // Marked unused so `for (auto _ : state)` doesn't warn.
+  struct __attribute__((unused)) Value {};
+  class Iterator {
+   public:
+    explicit Iterator(State* state) : state_(state) {}
+    Value operator*() const { return {}; }
+    Iterator& operator++() {
+      --state_->remaining_;
+      return *this;
+    }
+    bool operator!=(const Iterator&) const {
+      if (state_->remaining_ > 0) {
+        return true;
+      }
+      state_->Stop();
+      return false;
+    }
+
+   private:
+    State* state_;
+  };
+
+  explicit State(uint32_t iterations) : iterations_(iterations) {}
+
+  // Starts the clocks; the loop stops them after the last iteration.
+  Iterator begin() {
+    Start();
+    return Iterator(this);
+  }
+  Iterator end() { return Iterator(this); }
+
+  uint32_t iterations() const { return iterations_; }
+
+  // What the timed loop cost, valid after it finished.
+  uint32_t elapsed_us() const { return elapsed_us_; }
+  uint32_t elapsed_cycles() const { return elapsed_cycles_; }
+  uint32_t allocations() const { return allocations_; }
+  uint32_t allocated_bytes() const { return allocated_bytes_; }
+
+ private:
+  void Start();
+  void Stop();
+
+  const uint32_t iterations_;
+  uint32_t remaining_ = 0;
+  uint32_t start_us_ = 0;
+  uint32_t start_cycles_ = 0;
+  uint32_t start_allocations_ = 0;
+  uint32_t start_allocated_bytes_ = 0;
+  uint32_t elapsed_us_ = 0;
+  uint32_t elapsed_cycles_ = 0;
+  uint32_t allocations_ = 0;
+  uint32_t allocated_bytes_ = 0;
+};
+
+typedef void (*BenchmarkFn)(State& state);
+
+// Adds a benchmark to the ones RunAll() runs; returns its index, or -1 if
+// there is no room. Use BENCHMARK() instead of calling this.
+int Register(const char* name, BenchmarkFn fn);
+
+#define BENCHMARK(fn) \
+  static const int fn##_benchmark_index_ = ::bench::Register(#fn, fn)
+
+// Keeps the compiler from optimizing away value, or the work producing it.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void ClobberMemory() { asm volatile("" : : : "memory"); }
+
+struct Options {
+  // Only benchmarks whose name contains filter run; null runs them all.
+  const char* filter = nullptr;
+  // Iterations grow until one timed loop takes at least this long.
+  uint32_t min_time_ms = 200;
+  // Of the task each benchmark runs in.
+  uint32_t stack_size = 8 * 1024;
+};
+
+struct Result {
+  const char* name;
+  uint32_t iterations;
+  // Per iteration.
+  float ns;
+  float cycles;
+  float allocations;
+  float allocated_bytes;
+  // Deepest stack use of the benchmark beyond what the harness itself needs.
+  uint32_t stack_bytes;
+};
+
+// Runs every matching benchmark and prints a context line followed by one
+// result line each to out. Returns the number of benchmarks run.
+int RunAll(const Options& options, Print* out);
+
+namespace internal {
+
+// Called by the allocation hooks for every malloc(), calloc() and growing
+// realloc(); counts the ones made by the task running a benchmark.
+void CountAllocation(size_t size);
+
+}  // namespace internal
+
+}  // namespace bench
+
+#endif  // _BENCH_H_
@@ -1,5 +1,6 @@
 #include "bme.h"
 
+#include <Arduino.h>
 #include <dump.h>
 #include <esp_log.h>
 
@@ -11,9 +12,12 @@ namespace {
 using dump::Ewma;
 
 const char TAG[] = "bme";
-const int kPollPeriodMs = 1000;
 const int kPollPeriodTicks =
     std::max<int>(1, kPollPeriodMs / portTICK_PERIOD_MS);
+// Worst case forced conversion time, plus a tick since vTaskDelay(n) may
+// return up to a tick early.
+const TickType_t kMeasureTicks =
+    bme280::kMaxMeasureTimeUs / 1000 / portTICK_PERIOD_MS + 2;
 
 #if 0
 bool CheckBsecStatus(const Bsec& bsec) {
@@ -62,23 +66,113 @@ void UpdateData(Data* data, float temp_c, float pressure_pa,
   }
 }
 
-bool PollBme280(Data* data) {
-    if (xSemaphoreTake(data->i2c_mutex, kPollPeriodTicks) !=
-        pdTRUE) {
-      ESP_LOGE(TAG, "PollBme280: failed to acquire i2c mutex");
-      return false;
-    }
+void Publish(TaskData* data, unsigned long timestamp_ms) {
+  if (data->topic != nullptr) {
+    data->topic->Publish(data->data, timestamp_ms);
+  }
+}
 
-    UpdateData(data, /* temp_c= */ data->bme280->readTemperature(),
-               /* pressure_pa= */ data->bme280->readPressure(),
-               /* humdity_pct= */ data->bme280->readHumidity());
+// Reads size consecutive registers starting at reg in one burst.
+bool ReadRegisters(TaskData* data, uint8_t reg, uint8_t* buffer,
+                   size_t size) {
+  auto status = data->i2c->WriteRead(data->i2c_device, &reg, 1, buffer, size,
+                                     /*deadline_ms=*/kPollPeriodMs);
+  if (status != i2c_bus::Status::kOk) {
+    ESP_LOGE(TAG, "ReadRegisters(0x%02x): i2c: %s", reg,
+             i2c_bus::StatusName(status));
+    return false;
+  }
+  return true;
+}
 
-    xSemaphoreGive(data->i2c_mutex);
-    return true;
+bool WriteRegister(TaskData* data, uint8_t reg, uint8_t value) {
+  uint8_t buffer[] = {reg, value};
+  auto status = data->i2c->Write(data->i2c_device, buffer, sizeof(buffer),
+                                 /*deadline_ms=*/kPollPeriodMs);
+  if (status != i2c_bus::Status::kOk) {
+    ESP_LOGE(TAG, "WriteRegister(0x%02x): i2c: %s", reg,
+             i2c_bus::StatusName(status));
+    return false;
+  }
+  return true;
+}
+
+bool InitBme280(TaskData* data) {
+  uint8_t chip_id = 0;
+  if (!ReadRegisters(data, bme280::kRegChipId, &chip_id, 1)) {
+    return false;
+  }
+  if (chip_id != bme280::kChipId) {
+    ESP_LOGW(TAG, "InitBme280: unexpected chip id: 0x%02x", chip_id);
+    return false;
+  }
+
+  if (!WriteRegister(data, bme280::kRegReset, bme280::kResetCommand)) {
+    return false;
+  }
+  // Start-up time is 2 ms; the trimming values are copied from NVM by then.
+  delay(10);
+
+  uint8_t calib00[bme280::kCalib00Size];
+  uint8_t calib26[bme280::kCalib26Size];
+  if (!ReadRegisters(data, bme280::kRegCalib00, calib00, sizeof(calib00)) ||
+      !ReadRegisters(data, bme280::kRegCalib26, calib26, sizeof(calib26))) {
+    return false;
+  }
+  data->bme280_calibration = bme280::ParseCalibration(calib00, calib26);
+
+  // No IIR filter, the readings get an EWMA instead. ctrl_hum only takes
+  // effect on the next ctrl_meas write, which every poll does.
+  return WriteRegister(data, bme280::kRegConfig, 0) &&
+         WriteRegister(data, bme280::kRegCtrlHum, bme280::kOversample1x) &&
+         WriteRegister(data, bme280::kRegCtrlMeas,
+                       bme280::CtrlMeas(bme280::kOversample1x,
+                                        bme280::kOversample1x,
+                                        bme280::kModeSleep));
+}
+
+// Triggers a forced conversion, then reads status and all three results in a
+// single burst. The sensor sleeps between polls, which also keeps it from
+// warming itself up.
+bool PollBme280(TaskData* data) {
+  if (!WriteRegister(data, bme280::kRegCtrlMeas,
+                     bme280::CtrlMeas(bme280::kOversample1x,
+                                      bme280::kOversample1x,
+                                      bme280::kModeForced))) {
+    return false;
+  }
+  // Let the bus serve others while converting.
+  vTaskDelay(kMeasureTicks);
+
+  // status, ctrl_meas, config, (reserved), then the data block.
+  uint8_t buffer[bme280::kRegData - bme280::kRegStatus + bme280::kDataSize];
+  if (!ReadRegisters(data, bme280::kRegStatus, buffer, sizeof(buffer))) {
+    return false;
+  }
+  if (buffer[0] & bme280::kStatusMeasuring) {
+    ESP_LOGW(TAG, "PollBme280: conversion still running");
+    return false;
+  }
+  auto raw =
+      bme280::ParseData(&buffer[bme280::kRegData - bme280::kRegStatus]);
+  if (!bme280::IsValid(raw)) {
+    ESP_LOGW(TAG, "PollBme280: no conversion results yet");
+    return false;
+  }
+  bme280::Reading reading;
+  if (!bme280::Compensate(data->bme280_calibration, raw, &reading)) {
+    ESP_LOGE(TAG, "PollBme280: bad calibration");
+    return false;
+  }
+
+  UpdateData(&data->data, /* temp_c= */ reading.temp_c(),
+             /* pressure_pa= */ reading.pressure_pa(),
+             /* humdity_pct= */ reading.humidity_pct());
+  return true;
 }
 
 #if 0
-bool PollBsec(Data* data) {
+bool PollBsec(TaskData* data) {
     if (xSemaphoreTake(data->i2c_mutex, kPollPeriodTicks) !=
         pdTRUE) {
       ESP_LOGE(TAG, "PollBsec: failed to acquire i2c mutex");
@@ -87,7 +181,7 @@ bool PollBsec(Data* data) {
 
     if (data->bsec->run()) {  // If new data is available
       // TODO: update EWMA time period to match BSEC polling
-      UpdateData(data, /* temp_c= */ data->bsec->temperature,
+      UpdateData(&data->data, /* temp_c= */ data->bsec->temperature,
                  /* pressure_pa= */ data->bsec->pressure,
                  /* humdity_pct= */ data->bsec->humidity);
 
@@ -116,28 +210,23 @@ bool PollBsec(Data* data) {
 
 }  // namespace
 
-bool Init(Data* data) {
-  if (xSemaphoreTake(data->i2c_mutex, kPollPeriodTicks) !=
-      pdTRUE) {
-    ESP_LOGE(TAG, "Init: failed to acquire i2c mutex");
-    return false;
-  }
-
-  data->sensor_name = "BME not found";
+bool Init(TaskData* data) {
+  data->data.sensor_name = "BME not found";
 
   // Try initializing BME280
   {
-    std::unique_ptr<Adafruit_BME280> bme280(new Adafruit_BME280());
-    if (bme280->begin(BME280_I2C_ADDRESS)) {
-      data->bme280 = std::move(bme280);
-      data->sensor_name = "BME280";
+    if (InitBme280(data)) {
+      data->bme280_found = true;
+      data->data.sensor_name = "BME280";
 
+      const auto& c = data->bme280_calibration;
       ESP_LOGI(TAG, "BME280 initialized at i2c: 0x%02x", BME280_I2C_ADDRESS);
-      data->bme280->getTemperatureSensor()->printSensorDetails();
-      data->bme280->getPressureSensor()->printSensorDetails();
-      data->bme280->getHumiditySensor()->printSensorDetails();
+      ESP_LOGI(TAG, "BME280 calibration: T: %u %d %d P: %u %d %d %d %d %d %d %d"
+               " %d H: %u %d %u %d %d %d",
+               c.t1, c.t2, c.t3, c.p1, c.p2, c.p3, c.p4, c.p5, c.p6, c.p7,
+               c.p8, c.p9, c.h1, c.h2, c.h3, c.h4, c.h5, c.h6);
 
-      xSemaphoreGive(data->i2c_mutex);
+      Publish(data, millis());
       return true;
     }
     ESP_LOGW(TAG, "BME280 not found at i2c: 0x%02x", BME280_I2C_ADDRESS);
@@ -150,7 +239,7 @@ bool Init(Data* data) {
     bsec->begin(BME680_I2C_ADDR_PRIMARY, Wire);
     if (CheckBsecStatus(*bsec)) {
       data->bsec = std::move(bsec);
-      data->sensor_name = "BME68x";
+      data->data.sensor_name = "BME68x";
       ESP_LOGI(TAG,
                "BME680 initialized at i2c: 0x%02x, BSEC library version: "
                "%d.%d.%d.%d",
@@ -179,58 +268,45 @@ bool Init(Data* data) {
       }
 
       xSemaphoreGive(data->i2c_mutex);
+      Publish(data, millis());
       return true;
     }
     ESP_LOGW(TAG, "BME680 not found at i2c: 0x%02x", BME680_I2C_ADDR_PRIMARY);
   }
 #endif
 
-  xSemaphoreGive(data->i2c_mutex);
+  // Still publish so readers see the sensor name.
+  Publish(data, millis());
   return false;
 }
 
-void TaskPoll(void* task_data_param) {
-  auto* data = reinterpret_cast<Data*>(task_data_param);
-
-  unsigned long last_print_time_ms = 0;
-  unsigned long last_poll_time_ms = 0;
-  for (;;) {
-    unsigned long now_ms = millis();
-    if (last_poll_time_ms && now_ms - last_poll_time_ms < kPollPeriodMs) {
-      // TODO: use vTaskDelayUntil()
-      delay(kPollPeriodMs - (now_ms - last_poll_time_ms));
-      last_poll_time_ms += kPollPeriodMs;
-    } else {
-      last_poll_time_ms = now_ms;
-    }
+void Poll(void* task_data_param, unsigned long cycle_ms) {
+  auto* data = reinterpret_cast<TaskData*>(task_data_param);
 
-    if (data->bme280 != nullptr) {
-      PollBme280(data);
-    }
+  bool polled = false;
+  if (data->bme280_found) {
+    polled = PollBme280(data);
+  }
 #if 0
-    if (data->bsec != nullptr) {
-      PollBsec(data);
-    }
+  if (data->bsec != nullptr) {
+    polled = PollBsec(data);
+  }
 #endif
-
-    if ((now_ms - last_print_time_ms) < 10 * 60 * 1000 &&
-        last_print_time_ms) {
-      // continue;
-    }
-    last_print_time_ms = now_ms;
-
-    ESP_LOGI(
-        TAG,
-        "bme::TaskPoll(): uptime: %s core: %d stackHighWater: %d"
-        " sensor: %s Temp: %.1f °C %.1f °F Pressure: %.3f hPa Humidity: %.1f",
-        dump::MillisHumanReadable(now_ms).c_str(), xPortGetCoreID(),
-        uxTaskGetStackHighWaterMark(nullptr),
-        data->sensor_name,  //
-        data->temp_c, dump::CToF(data->temp_c), data->pressure_pa / 100.0,
-        data->humidity_pct);
+  if (polled) {
+    Publish(data, cycle_ms);
   }
+}
 
-  vTaskDelete(NULL);
+void LogStatus(void* task_data_param, unsigned long cycle_ms) {
+  auto* data = reinterpret_cast<TaskData*>(task_data_param);
+  ESP_LOGI(
+      TAG,
+      "bme::LogStatus(): uptime: %s"
+      " sensor: %s Temp: %.1f °C %.1f °F Pressure: %.3f hPa Humidity: %.1f",
+      dump::MillisHumanReadable(cycle_ms).c_str(),
+      data->data.sensor_name,  //
+      data->data.temp_c, dump::CToF(data->data.temp_c),
+      data->data.pressure_pa / 100.0, data->data.humidity_pct);
 }
 
 }  // namespace bme
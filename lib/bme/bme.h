@@ -5,28 +5,45 @@
 
 #include <memory>
 
-#include <Adafruit_BME280.h>
 // #include <bsec.h>
 
+#include "bme280.h"
+#include "i2c_bus.h"
+#include "sensor_bus.h"
+
 #define BME280_I2C_ADDRESS 0x76
 
 namespace bme {
 
-struct Data {
-  SemaphoreHandle_t i2c_mutex;
-
-  std::unique_ptr<Adafruit_BME280> bme280;
-//   std::unique_ptr<Bsec> bsec;
+const int kPollPeriodMs = 1000;
 
+struct Data {
   const char* sensor_name;
   float temp_c;
   float pressure_pa;
   float humidity_pct;
 };
 
-bool Init(Data* data);
+struct TaskData {
+  i2c_bus::Bus* i2c;
+  // Id from i2c_bus::Bus::AddDevice().
+  int i2c_device;
+
+  bool bme280_found;
+  bme280::Calibration bme280_calibration;
+//   std::unique_ptr<Bsec> bsec;
+
+  // Owned by Poll(); everyone else reads snapshots from topic.
+  Data data;
+  sensor_bus::Topic<Data>* topic;
+};
+
+bool Init(TaskData* data);
 
-void TaskPoll(void* task_data_param);
+// Scheduler jobs (see scheduler::JobFn); task_data is a TaskData*. The
+// EWMAs assume Poll() runs every kPollPeriodMs.
+void Poll(void* task_data, unsigned long cycle_ms);
+void LogStatus(void* task_data, unsigned long cycle_ms);
 
 }  // namespace bme
 
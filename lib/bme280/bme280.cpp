@@ -0,0 +1,89 @@
+#include "bme280.h"
+
+namespace bme280 {
+namespace {
+
+uint16_t U16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+int16_t S16(const uint8_t* p) { return static_cast<int16_t>(U16(p)); }
+
+}  // namespace
+
+Calibration ParseCalibration(const uint8_t (&calib00)[kCalib00Size],
+                             const uint8_t (&calib26)[kCalib26Size]) {
+  Calibration c;
+  c.t1 = U16(&calib00[0]);
+  c.t2 = S16(&calib00[2]);
+  c.t3 = S16(&calib00[4]);
+  c.p1 = U16(&calib00[6]);
+  c.p2 = S16(&calib00[8]);
+  c.p3 = S16(&calib00[10]);
+  c.p4 = S16(&calib00[12]);
+  c.p5 = S16(&calib00[14]);
+  c.p6 = S16(&calib00[16]);
+  c.p7 = S16(&calib00[18]);
+  c.p8 = S16(&calib00[20]);
+  c.p9 = S16(&calib00[22]);
+  // calib00[24] (0xa0) is unused.
+  c.h1 = calib00[25];
+
+  c.h2 = S16(&calib26[0]);
+  c.h3 = calib26[2];
+  // h4 and h5 are 12-bit values sharing the nibbles of 0xe5.
+  c.h4 = static_cast<int16_t>(static_cast<int8_t>(calib26[3]) * 16 |
+                              (calib26[4] & 0x0f));
+  c.h5 = static_cast<int16_t>(static_cast<int8_t>(calib26[5]) * 16 |
+                              (calib26[4] >> 4));
+  c.h6 = static_cast<int8_t>(calib26[6]);
+  return c;
+}
+
+RawData ParseData(const uint8_t* data) {
+  RawData raw;
+  raw.adc_p = (data[0] << 12) | (data[1] << 4) | (data[2] >> 4);
+  raw.adc_t = (data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
+  raw.adc_h = (data[6] << 8) | data[7];
+  return raw;
+}
+
+bool Compensate(const Calibration& c, const RawData& raw, Reading* reading) {
+  // Temperature, shared with the other two as t_fine.
+  int32_t var1 =
+      ((((raw.adc_t >> 3) - (static_cast<int32_t>(c.t1) << 1))) * c.t2) >> 11;
+  int32_t var2 = (((((raw.adc_t >> 4) - c.t1) *
+                    ((raw.adc_t >> 4) - c.t1)) >> 12) * c.t3) >> 14;
+  int32_t t_fine = var1 + var2;
+  reading->temp_centi_c = (t_fine * 5 + 128) >> 8;
+
+  // Pressure.
+  int64_t p_var1 = static_cast<int64_t>(t_fine) - 128000;
+  int64_t p_var2 = p_var1 * p_var1 * c.p6;
+  p_var2 = p_var2 + ((p_var1 * c.p5) << 17);
+  p_var2 = p_var2 + (static_cast<int64_t>(c.p4) << 35);
+  p_var1 = ((p_var1 * p_var1 * c.p3) >> 8) + ((p_var1 * c.p2) << 12);
+  p_var1 = (((static_cast<int64_t>(1) << 47) + p_var1) * c.p1) >> 33;
+  if (p_var1 == 0) {
+    return false;
+  }
+  int64_t p = 1048576 - raw.adc_p;
+  p = (((p << 31) - p_var2) * 3125) / p_var1;
+  p_var1 = (static_cast<int64_t>(c.p9) * (p >> 13) * (p >> 13)) >> 25;
+  p_var2 = (static_cast<int64_t>(c.p8) * p) >> 19;
+  p = ((p + p_var1 + p_var2) >> 8) + (static_cast<int64_t>(c.p7) << 4);
+  reading->pressure_q24_8 = static_cast<uint32_t>(p);
+
+  // Humidity.
+  int32_t h = t_fine - 76800;
+  h = (((((raw.adc_h << 14) - (static_cast<int32_t>(c.h4) << 20) -
+          (static_cast<int32_t>(c.h5) * h)) +
+         16384) >> 15) *
+       (((((((h * c.h6) >> 10) * (((h * c.h3) >> 11) + 32768)) >> 10) +
+          2097152) * c.h2 + 8192) >> 14));
+  h = h - (((((h >> 15) * (h >> 15)) >> 7) * c.h1) >> 4);
+  h = h < 0 ? 0 : h;
+  h = h > 419430400 ? 419430400 : h;
+  reading->humidity_q22_10 = static_cast<uint32_t>(h >> 12);
+  return true;
+}
+
+}  // namespace bme280
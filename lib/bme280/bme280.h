@@ -0,0 +1,114 @@
+#ifndef _BME280_H_
+#define _BME280_H_
+
+// Register map and Bosch's fixed-point compensation for the BME280
+// (datasheet BST-BME280-DS002, section 4.2.3 and 8.2). No Arduino
+// dependencies so this can be unit tested on the host; the I2C side lives in
+// the bme driver.
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bme280 {
+
+const uint8_t kChipId = 0x60;
+
+const uint8_t kRegCalib00 = 0x88;  // 0x88..0xa1
+const uint8_t kRegChipId = 0xd0;
+const uint8_t kRegReset = 0xe0;
+const uint8_t kRegCalib26 = 0xe1;  // 0xe1..0xe7
+const uint8_t kRegCtrlHum = 0xf2;
+const uint8_t kRegStatus = 0xf3;
+const uint8_t kRegCtrlMeas = 0xf4;
+const uint8_t kRegConfig = 0xf5;
+const uint8_t kRegData = 0xf7;  // press[3] temp[3] hum[2]
+
+const size_t kCalib00Size = 26;
+const size_t kCalib26Size = 7;
+const size_t kDataSize = 8;
+
+const uint8_t kResetCommand = 0xb6;
+// kRegStatus bit set while a conversion is running.
+const uint8_t kStatusMeasuring = 0x08;
+
+// ctrl_meas/ctrl_hum oversampling; 1x is plenty with our EWMA on top.
+const uint8_t kOversample1x = 1;
+
+enum Mode : uint8_t {
+  kModeSleep = 0,
+  kModeForced = 1,
+  kModeNormal = 3,
+};
+
+inline uint8_t CtrlMeas(uint8_t osrs_t, uint8_t osrs_p, Mode mode) {
+  return (osrs_t << 5) | (osrs_p << 2) | mode;
+}
+
+// Longest a forced conversion takes at 1x oversampling of all three
+// channels: 1.25 + 2.3 + (2.3 + 0.575) * 2 ms.
+const uint32_t kMaxMeasureTimeUs = 9300;
+
+struct Calibration {
+  uint16_t t1;
+  int16_t t2;
+  int16_t t3;
+
+  uint16_t p1;
+  int16_t p2;
+  int16_t p3;
+  int16_t p4;
+  int16_t p5;
+  int16_t p6;
+  int16_t p7;
+  int16_t p8;
+  int16_t p9;
+
+  uint8_t h1;
+  int16_t h2;
+  uint8_t h3;
+  int16_t h4;
+  int16_t h5;
+  int8_t h6;
+};
+
+// Unpacks the two trimming blocks read from kRegCalib00 and kRegCalib26.
+Calibration ParseCalibration(const uint8_t (&calib00)[kCalib00Size],
+                             const uint8_t (&calib26)[kCalib26Size]);
+
+struct RawData {
+  int32_t adc_p;
+  int32_t adc_t;
+  int32_t adc_h;
+};
+
+// Unpacks the kDataSize byte burst read from kRegData.
+RawData ParseData(const uint8_t* data);
+
+// A measurement that was skipped (or hasn't completed since reset) reads as
+// 0x80000 / 0x8000.
+inline bool IsValid(const RawData& raw) {
+  return raw.adc_t != 0x80000 && raw.adc_p != 0x80000 && raw.adc_h != 0x8000;
+}
+
+struct Reading {
+  // 0.01 °C
+  int32_t temp_centi_c;
+  // Pa in Q24.8
+  uint32_t pressure_q24_8;
+  // %RH in Q22.10
+  uint32_t humidity_q22_10;
+
+  float temp_c() const { return temp_centi_c / 100.0f; }
+  float pressure_pa() const { return pressure_q24_8 / 256.0f; }
+  float humidity_pct() const { return humidity_q22_10 / 1024.0f; }
+};
+
+// Bosch's reference integer compensation: 32-bit for temperature and
+// humidity, 64-bit for pressure. Returns false if the pressure calibration
+// would divide by zero.
+bool Compensate(const Calibration& calibration, const RawData& raw,
+                Reading* reading);
+
+}  // namespace bme280
+
+#endif  // _BME280_H_
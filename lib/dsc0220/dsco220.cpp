@@ -4,59 +4,61 @@
 #include <dump.h>
 #include <esp_log.h>
 
-#include "pmsx003.h"
+#include "plantower.h"
 
 namespace dsco220 {
 namespace {
 const char TAG[] = "dsco220";
-}  // namespace
 
-bool Read(TwoWire* i2c, Data* data) {
-  while (i2c->available()) {
-    Serial.print("WTF: DS-CO2-20: available before: ");
-    Serial.println(i2c->read(), HEX);
-  }
+const size_t kFrameSize = 12;
+const uint32_t kReadDeadlineMs = 2000;
+const uint8_t kCmdRead = 0xe3;
 
-  const int kPacketSize = 12;
+constexpr plantower::Field<Data> kFields[] = {
+    // Readings outside of this range are outliers.
+    plantower::RawField("co2_ppm", 4, &Data::co2_ppm, /*min_value=*/301,
+                        /*max_value=*/9999),
+    plantower::RawField("calibration_param1", 6, &Data::calibration_param1),
+    plantower::RawField("calibration_param2", 8, &Data::calibration_param2),
+};
+static_assert(plantower::FitsInFrame(kFields, kFrameSize),
+              "DS-CO2-20 field outside frame");
 
-  i2c->requestFrom(0x08, kPacketSize);
+}  // namespace
 
-  unsigned long timeout_ms = 2000;
-  unsigned long start_time_ms = millis();
-  while (i2c->available() < kPacketSize &&
-         (millis() - start_time_ms) < timeout_ms) {
-    delay(10);
+plantower::FrameStatus Decode(const uint8_t* frame, size_t size, Data* data) {
+  return plantower::Decode<kFrameSize>(kFields, frame, size, data, dump::Ewma);
+}
+
+namespace {
+
+bool DecodeFrame(const uint8_t* frame, size_t size, Data* data) {
+  auto status = Decode(frame, size, data);
+  if (status == plantower::FrameStatus::kOutOfRange) {
+    ESP_LOGW(TAG, "Outlier CO2: %d ppm",
+             plantower::ReadWord(frame, kFields[0].offset));
+    // Not a bus error, just a reading to ignore.
+    return true;
   }
-  if (i2c->available() < kPacketSize) {
-    Serial.print("ERROR: DS-CO2-20: expect 12 bytes available, have: ");
-    Serial.println(i2c->available());
+  if (status != plantower::FrameStatus::kOk) {
+    ESP_LOGE(TAG, "Packet error: %s", plantower::FrameStatusName(status));
+    ESP_LOG_BUFFER_HEX_LEVEL(TAG, frame, size, ESP_LOG_ERROR);
     return false;
   }
+  return true;
+}
 
-  uint8_t buffer[kPacketSize] = {0};
-  i2c->readBytes(buffer, sizeof(buffer));
-
-  if (!pmsx003::VerifyPacket(buffer, sizeof(buffer))) {
-    Serial.print("ERROR: DS-CO2-20: Packet error!\n");
-    Serial.print("  Raw: ");
-    for (int i = 0; i < 12; ++i) {
-      Serial.print(buffer[i], HEX);
-      Serial.print(" ");
-    }
-    Serial.println();
-    return false;
-  }
+}  // namespace
 
-  uint16_t co2_ppm = (buffer[4] << 8) | buffer[5];
-  if (co2_ppm > 300 && co2_ppm < 10000) {
-    data->co2_ppm = co2_ppm;
-    data->calibration_param1 = (buffer[6] << 8) | buffer[7];
-    data->calibration_param2 = (buffer[8] << 8) | buffer[9];
-  } else {
-    ESP_LOGW(TAG, "Outlier CO2: %d ppm", co2_ppm);
+bool Read(i2c_bus::Bus* i2c, int device, Data* data) {
+  uint8_t buffer[kFrameSize] = {0};
+  auto status = i2c->Read(device, buffer, sizeof(buffer), kReadDeadlineMs);
+  if (status != i2c_bus::Status::kOk) {
+    ESP_LOGE(TAG, "Read(): i2c: %s", i2c_bus::StatusName(status));
+    return false;
   }
 
-  return true;
+  return DecodeFrame(buffer, sizeof(buffer), data);
 }
 
 bool Read(Stream* serial, Data* data) {
@@ -68,7 +70,8 @@ bool Read(Stream* serial, Data* data) {
     Serial.println(serial->read(), HEX);
   }
 
-  uint8_t cmd[7] = {0x42, 0x4d, 0xe3, 0x00, 0x00, 0x01, 0x72};
+  uint8_t cmd[plantower::kCommandSize];
+  plantower::BuildCommand(kCmdRead, 0, cmd);
   serial->write(cmd, sizeof(cmd));
 
   // Get to packet start byte
@@ -93,7 +96,7 @@ bool Read(Stream* serial, Data* data) {
     }
   }
 
-  const int kPacketSize = 12;
+  const int kPacketSize = kFrameSize;
   uint8_t buffer[kPacketSize] = {0};
   while (serial->available() < kPacketSize) {
     if (millis() - start_time_ms >= timeout_ms) {
@@ -107,77 +110,29 @@ bool Read(Stream* serial, Data* data) {
     return false;
   }
 
-  if (!pmsx003::VerifyPacket(buffer, sizeof(buffer))) {
-    Serial.print("ERROR: DS-CO2-20: Packet error!\n");
-    Serial.print("  Raw: ");
-    for (int i = 0; i < 12; ++i) {
-      Serial.print(buffer[i], HEX);
-      Serial.print(" ");
-    }
-    Serial.println();
-    return false;
-  }
-
-  data->co2_ppm = (buffer[4] << 8) | buffer[5];
-  data->calibration_param1 = (buffer[6] << 8) | buffer[7];
-  data->calibration_param2 = (buffer[8] << 8) | buffer[9];
-
-  return true;
+  return DecodeFrame(buffer, sizeof(buffer), data);
 }
 
-void TaskPollDsCo2(void* task_data_arg) {
-  SemaphoreHandle_t i2c_mutex =
-      reinterpret_cast<TaskData*>(task_data_arg)->i2c_mutex;
-  TwoWire* i2c = reinterpret_cast<TaskData*>(task_data_arg)->i2c;
-  Data* data = reinterpret_cast<TaskData*>(task_data_arg)->data;
-
-  unsigned long last_print_time_ms = 0;
-  // int dummy_co2ppm = 0;
-  for (;;) {
-    bool success = false;
-    if (xSemaphoreTake(i2c_mutex, 1000 / portTICK_PERIOD_MS) == pdTRUE) {
-      success = Read(i2c, data);
-      xSemaphoreGive(i2c_mutex);
-    } else {
-      Serial.print("ERROR: DS-CO2-20: failed to acquire i2c mutex\n");
-      continue;
-    }
-    /*
-    data->co2_ppm = dummy_co2ppm;
-    if (dummy_co2ppm < 1000) {
-        dummy_co2ppm += 100;
-    } else {
-        dummy_co2ppm += 500;
-    }
-    dummy_co2ppm %= 8000;
-    */
-
-    if (!success) {
-      Serial.print("ERROR: DS-CO2-20 Read() error\n");
-      delay(5000);
-      continue;
-    }
-
-    if ((millis() - last_print_time_ms) < 10 * 60 * 1000 &&
-        last_print_time_ms) {
-      delay(1000);
-      continue;
-    }
-    last_print_time_ms = millis();
-
-    ESP_LOGI(TAG, "TaskPollDsCo2(): uptime: %s core: %d stackHighWater: %d",
-             dump::MillisHumanReadable(millis()).c_str(), xPortGetCoreID(),
-             uxTaskGetStackHighWaterMark(nullptr));
-    Serial.print("DS-CO2-20 Results:");
-    Serial.print("  CO2: ");
-    Serial.print(data->co2_ppm);
-    Serial.print("ppm ");
-    Serial.print("\n");
-
-    delay(1000);
+void Poll(void* task_data_arg, unsigned long cycle_ms) {
+  auto* task_data = reinterpret_cast<TaskData*>(task_data_arg);
+  if (!Read(task_data->i2c, task_data->i2c_device, &task_data->data)) {
+    Serial.print("ERROR: DS-CO2-20 Read() error\n");
+    return;
   }
+  if (task_data->topic != nullptr) {
+    task_data->topic->Publish(task_data->data, cycle_ms);
+  }
+}
 
-  vTaskDelete(NULL);
+void LogStatus(void* task_data_arg, unsigned long cycle_ms) {
+  auto* task_data = reinterpret_cast<TaskData*>(task_data_arg);
+  ESP_LOGI(TAG, "dsco220::LogStatus(): uptime: %s",
+           dump::MillisHumanReadable(cycle_ms).c_str());
+  Serial.print("DS-CO2-20 Results:");
+  Serial.print("  CO2: ");
+  Serial.print(task_data->data.co2_ppm);
+  Serial.print("ppm ");
+  Serial.print("\n");
 }
 
 }  // namespace dsco220
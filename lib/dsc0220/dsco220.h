@@ -1,10 +1,11 @@
 #ifndef _DSCO220_H_
 #define _DSCO220_H_
 
-#include <freertos/FreeRTOS.h>
-#include <freertos/semphr.h>
 #include <Stream.h>
-#include <Wire.h>
+
+#include "i2c_bus.h"
+#include "plantower.h"
+#include "sensor_bus.h"
 
 namespace dsco220 {
 
@@ -15,16 +16,25 @@ struct Data {
 };
 
 struct TaskData {
-  Data* data;
-  TwoWire* i2c;
-  SemaphoreHandle_t i2c_mutex;
+  // Owned by Poll(); everyone else reads snapshots from topic.
+  Data data;
+  sensor_bus::Topic<Data>* topic;
+
+  i2c_bus::Bus* i2c;
+  // Id from i2c_bus::Bus::AddDevice().
+  int i2c_device;
 };
 
-bool Read(TwoWire* serial, Data* data);
+// Verifies and decodes a 12-byte frame into data, updating the EWMA.
+plantower::FrameStatus Decode(const uint8_t* frame, size_t size, Data* data);
+
+bool Read(i2c_bus::Bus* i2c, int device, Data* data);
 
 bool Read(Stream* serial, Data* data);
 
-void TaskPollDsCo2(void* task_data);
+// Scheduler jobs (see scheduler::JobFn); task_data is a TaskData*.
+void Poll(void* task_data, unsigned long cycle_ms);
+void LogStatus(void* task_data, unsigned long cycle_ms);
 
 }  // namespace dsco220
 
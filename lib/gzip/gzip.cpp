@@ -0,0 +1,220 @@
+#include "gzip.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace gzip {
+namespace {
+
+const int kMinMatch = 3;
+const int kMaxMatch = 258;
+
+// RFC 1951 3.2.5: lengths 3..258 are codes 257..285, distances 1..32768
+// codes 0..29, each a base plus that many extra bits.
+const uint16_t kLengthBase[] = {3,  4,  5,  6,   7,   8,   9,   10,  11, 13,
+                                15, 17, 19, 23,  27,  31,  35,  43,  51, 59,
+                                67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t kLengthExtra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t kDistanceBase[] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,    25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513,   769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+const uint8_t kDistanceExtra[] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                  4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                  9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+const uint32_t kCrcTable[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4,
+    0x4db26158, 0x5005713c, 0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+    0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c};
+
+// Multiplicative hash of the three bytes at p.
+uint32_t Hash(const uint8_t* p, int bits) {
+  return ((p[0] | p[1] << 8 | p[2] << 16) * 2654435761u) >> (32 - bits);
+}
+
+// ID1, ID2, deflate, no flags, no mtime, no extra flags, unknown OS.
+const uint8_t kHeader[] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+
+}  // namespace
+
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc) {
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ kCrcTable[crc & 0xf];
+    crc = (crc >> 4) ^ kCrcTable[crc & 0xf];
+  }
+  return ~crc;
+}
+
+void GzipPrint::Begin(Print* out) {
+  out_ = out;
+  crc_ = 0;
+  in_size_ = 0;
+  out_size_ = 0;
+  compressed_ = 0;
+  size_ = 0;
+  for (uint16_t& head : heads_) {
+    head = kNoPosition;
+  }
+  bit_buffer_ = 0;
+  bit_count_ = 0;
+  out_buffer_size_ = 0;
+  for (uint8_t c : kHeader) {
+    PutByte(c);
+  }
+}
+
+void GzipPrint::Finish() {
+  if (out_ == nullptr) {
+    return;
+  }
+  Compress(/*final=*/true);
+  if (bit_count_ > 0) {
+    PutBits(0, 8 - bit_count_);
+  }
+  for (int i = 0; i < 32; i += 8) {
+    PutByte(crc_ >> i);
+  }
+  for (int i = 0; i < 32; i += 8) {
+    PutByte(in_size_ >> i);
+  }
+  FlushOut();
+  out_ = nullptr;
+}
+
+size_t GzipPrint::write(const uint8_t* data, size_t size) {
+  if (out_ == nullptr) {
+    return 0;
+  }
+  crc_ = Crc32(data, size, crc_);
+  in_size_ += size;
+  size_t left = size;
+  while (left > 0) {
+    const size_t n = std::min(left, sizeof(data_) - size_);
+    memcpy(data_ + size_, data, n);
+    size_ += n;
+    data += n;
+    left -= n;
+    if (size_ < sizeof(data_)) {
+      break;
+    }
+    Compress(/*final=*/false);
+    // Slide the window down over what was just compressed.
+    const size_t shift = size_ - kWindowSize;
+    memmove(data_, data_ + shift, kWindowSize);
+    for (uint16_t& head : heads_) {
+      head = head != kNoPosition && head >= shift ? head - shift : kNoPosition;
+    }
+    compressed_ = kWindowSize;
+    size_ = kWindowSize;
+  }
+  return size;
+}
+
+void GzipPrint::Compress(bool final) {
+  // Block header: BFINAL, then BTYPE 01, fixed Huffman codes.
+  PutBits(final ? 1 : 0, 1);
+  PutBits(1, 2);
+  size_t pos = compressed_;
+  while (pos < size_) {
+    int length = 0;
+    size_t candidate = kNoPosition;
+    if (pos + kMinMatch <= size_) {
+      const uint32_t hash = Hash(data_ + pos, kHashBits);
+      candidate = heads_[hash];
+      heads_[hash] = pos;
+      if (candidate != kNoPosition) {
+        const int max_length = std::min<size_t>(kMaxMatch, size_ - pos);
+        while (length < max_length &&
+               data_[candidate + length] == data_[pos + length]) {
+          ++length;
+        }
+      }
+    }
+    if (length < kMinMatch) {
+      Literal(data_[pos]);
+      ++pos;
+      continue;
+    }
+    Match(length, pos - candidate);
+    // Later matches can start inside this one.
+    const size_t end = pos + length;
+    for (++pos; pos < end && pos + kMinMatch <= size_; ++pos) {
+      heads_[Hash(data_ + pos, kHashBits)] = pos;
+    }
+    pos = end;
+  }
+  compressed_ = size_;
+  // End of block, code 256.
+  PutCode(0, 7);
+}
+
+void GzipPrint::Literal(uint8_t c) {
+  if (c < 144) {
+    PutCode(0x30 + c, 8);
+  } else {
+    PutCode(0x190 + c - 144, 9);
+  }
+}
+
+void GzipPrint::Match(int length, int distance) {
+  int code = sizeof(kLengthBase) / sizeof(kLengthBase[0]) - 1;
+  while (kLengthBase[code] > length) {
+    --code;
+  }
+  // Length codes 257..279 are 7 bits, 280..287 8.
+  const int symbol = 257 + code;
+  if (symbol < 280) {
+    PutCode(symbol - 256, 7);
+  } else {
+    PutCode(0xc0 + symbol - 280, 8);
+  }
+  PutBits(length - kLengthBase[code], kLengthExtra[code]);
+
+  code = sizeof(kDistanceBase) / sizeof(kDistanceBase[0]) - 1;
+  while (kDistanceBase[code] > distance) {
+    --code;
+  }
+  PutCode(code, 5);
+  PutBits(distance - kDistanceBase[code], kDistanceExtra[code]);
+}
+
+void GzipPrint::PutCode(uint32_t code, int bits) {
+  uint32_t reversed = 0;
+  for (int i = 0; i < bits; ++i) {
+    reversed = (reversed << 1) | (code & 1);
+    code >>= 1;
+  }
+  PutBits(reversed, bits);
+}
+
+void GzipPrint::PutBits(uint32_t value, int bits) {
+  bit_buffer_ |= value << bit_count_;
+  bit_count_ += bits;
+  while (bit_count_ >= 8) {
+    PutByte(bit_buffer_);
+    bit_buffer_ >>= 8;
+    bit_count_ -= 8;
+  }
+}
+
+void GzipPrint::PutByte(uint8_t c) {
+  out_buffer_[out_buffer_size_++] = c;
+  ++out_size_;
+  if (out_buffer_size_ == sizeof(out_buffer_)) {
+    FlushOut();
+  }
+}
+
+void GzipPrint::FlushOut() {
+  if (out_buffer_size_ > 0) {
+    out_->write(out_buffer_, out_buffer_size_);
+    out_buffer_size_ = 0;
+  }
+}
+
+}  // namespace gzip
@@ -0,0 +1,525 @@
+#include "history.h"
+
+#include <Arduino.h>
+#include <dump.h>
+#include <esp_log.h>
+#include <esp_system.h>
+#include <freertos/semphr.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gzip.h"
+#include "metrics.h"
+
+namespace history {
+namespace {
+const char TAG[] = "history";
+
+constexpr MetricInfo kMetrics[kNumMetrics] = {
+    {"pm_ug_m3", "pm2.5", /*resolution=*/0.1, /*offset=*/0, /*decimals=*/1},
+    {"pm_ug_m3", "pm10.0", /*resolution=*/0.1, /*offset=*/0, /*decimals=*/1},
+    {"co2_ppm", nullptr, /*resolution=*/1, /*offset=*/0, /*decimals=*/0},
+    {"temp_c", nullptr, /*resolution=*/0.01, /*offset=*/0, /*decimals=*/2},
+    {"humidity_percent", nullptr, /*resolution=*/0.01, /*offset=*/0,
+     /*decimals=*/2},
+    // 1 Pa around sea level covers 67 to 132 kPa.
+    {"pressure_pa", nullptr, /*resolution=*/1, /*offset=*/100000,
+     /*decimals=*/0},
+};
+
+timeseries::Series series[kNumMetrics] = {
+    timeseries::Series(kMetrics[kPm2_5].resolution, kMetrics[kPm2_5].offset),
+    timeseries::Series(kMetrics[kPm10_0].resolution, kMetrics[kPm10_0].offset),
+    timeseries::Series(kMetrics[kCo2].resolution, kMetrics[kCo2].offset),
+    timeseries::Series(kMetrics[kTempC].resolution, kMetrics[kTempC].offset),
+    timeseries::Series(kMetrics[kHumidityPct].resolution,
+                       kMetrics[kHumidityPct].offset),
+    timeseries::Series(kMetrics[kPressurePa].resolution,
+                       kMetrics[kPressurePa].offset),
+};
+static_assert(sizeof(series) <= 50 * 1024, "history is over its RAM budget");
+
+// Guards series, and keeps Flush() from coming between Record()'s appends.
+SemaphoreHandle_t mutex = nullptr;
+
+// One query's worth of buckets, and the gzip stream it goes out through.
+struct QueryBuffers {
+  timeseries::Bucket buckets[timeseries::MaxTierBuckets()];
+  uint32_t starts_s[timeseries::MaxTierBuckets()];
+  gzip::GzipPrint gzip;
+};
+QueryBuffers query;
+// Guards query, for the whole of a request.
+SemaphoreHandle_t query_mutex = nullptr;
+// How long a request waits for another's query to finish. Not long: that
+// one goes at its client's pace, and the server has few workers to park.
+const unsigned long kQueryWaitMs = 100;
+
+const long kDefaultRangeS = 24 * 60 * 60;
+const long kDefaultPoints = 300;
+// Any earlier and the clock hasn't been set.
+const time_t kClockSetAfter = 1600000000;
+
+const char kLogPartition[] = "tslog";
+const long kDefaultLogRangeS = 60 * 60;
+const long kDefaultLogLimit = 10000;
+static_assert(kNumMetrics <= tslog::Log::kMaxStreams,
+              "a flash log stream per metric");
+// Mounted by Init(), if there is a partition for it.
+tslog::Log* flash_log = nullptr;
+// Record() fills a page every few minutes at most; the log queues a few.
+const unsigned long kWriteLogPeriodMs = 1000;
+
+// Snapshot if topic published since seq, which catches up.
+template <typename T>
+bool Newer(const sensor_bus::Topic<T>* topic, uint32_t* seq,
+           sensor_bus::Snapshot<T>* snapshot) {
+  if (topic == nullptr || topic->seq() == *seq || !topic->Read(snapshot)) {
+    return false;
+  }
+  *seq = snapshot->seq;
+  return true;
+}
+
+// Parses a decimal integer that is the whole of text.
+bool ParseInt(std::string_view text, long* value) {
+  char buffer[16];
+  if (text.empty() || text.size() >= sizeof(buffer)) {
+    return false;
+  }
+  memcpy(buffer, text.data(), text.size());
+  buffer[text.size()] = '\0';
+  char* end;
+  *value = strtol(buffer, &end, 10);
+  return *end == '\0';
+}
+
+// Takes query_mutex, or sends a 503 if another query holds it.
+bool TakeQuery(http_server::Response* response) {
+  if (xSemaphoreTake(query_mutex, kQueryWaitMs / portTICK_PERIOD_MS) ==
+      pdTRUE) {
+    return true;
+  }
+  response->AddHeader("Retry-After", "1");
+  http_server::SendStatus(response, 503, "busy");
+  return false;
+}
+
+// The metric named by the metric and size parameters; sends a 400 if none
+// is.
+bool FindMetric(const http_server::Request& request,
+                http_server::Response* response, Metric* metric) {
+  std::string_view name;
+  std::string_view size;
+  request.QueryParam("metric", &name);
+  request.QueryParam("size", &size);
+  if (!Find(name, size, metric)) {
+    http_server::SendStatus(response, 400, "unknown metric");
+    return false;
+  }
+  return true;
+}
+
+// A from or to parameter as seconds since boot.
+uint32_t SinceBoot(long value, uint32_t now_s, uint32_t boot_time) {
+  if (value <= 0) {
+    return value > -static_cast<long>(now_s) ? now_s + value : 0;
+  }
+  if (value < static_cast<long>(boot_time)) {
+    return 0;
+  }
+  return value - boot_time;
+}
+
+// The finest tier that reaches back to from_s, give or take the part of a
+// bucket the open one hasn't filled yet.
+int TierFor(uint32_t from_s, uint32_t now_s) {
+  if (from_s >= now_s) {
+    return 0;
+  }
+  for (int tier = 0; tier < timeseries::kNumTiers - 1; ++tier) {
+    const timeseries::TierSpec& spec = timeseries::kTiers[tier];
+    if (now_s - from_s <= spec.buckets * spec.bucket_s) {
+      return tier;
+    }
+  }
+  return timeseries::kNumTiers - 1;
+}
+
+void PrintCsv(Print* out, const MetricInfo& info,
+              const timeseries::Series& series, size_t count,
+              uint32_t boot_time) {
+  out->print("t,min,max,mean,count\n");
+  char line[6 * metrics::kMaxNumberSize];
+  for (size_t i = 0; i < count; ++i) {
+    const timeseries::Bucket& bucket = query.buckets[i];
+    size_t size = metrics::FormatInt(query.starts_s[i] + boot_time, line);
+    for (int16_t steps : {bucket.min, bucket.max, bucket.mean}) {
+      line[size++] = ',';
+      size +=
+          metrics::FormatFixed(series.Value(steps), info.decimals, line + size);
+    }
+    line[size++] = ',';
+    size += metrics::FormatInt(bucket.count, line + size);
+    line[size++] = '\n';
+    out->write(reinterpret_cast<const uint8_t*>(line), size);
+  }
+}
+
+// Appends value to out, little-endian.
+template <typename T>
+size_t PutLe(T value, uint8_t* out) {
+  static_assert(sizeof(T) == 2 || sizeof(T) == 4, "16 or 32 bits");
+  uint32_t bits = 0;
+  memcpy(&bits, &value, sizeof(T));
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    out[i] = bits >> (8 * i);
+  }
+  return sizeof(T);
+}
+
+void LogSample(Metric metric, float value, unsigned long timestamp_ms,
+               uint32_t boot_time) {
+  if (!isnan(value)) {
+    flash_log->Append(metric, boot_time + timestamp_ms / 1000,
+                      series[metric].Quantize(value));
+  }
+}
+
+struct LogQuery {
+  Print* out;
+  const timeseries::Series* series;
+  int decimals;
+  long left;
+};
+
+bool PrintSample(const tslog::Sample& sample, void* query_arg) {
+  auto* query = reinterpret_cast<LogQuery*>(query_arg);
+  if (query->left-- <= 0) {
+    return false;
+  }
+  char line[2 * metrics::kMaxNumberSize];
+  size_t size = metrics::FormatInt(sample.time_s, line);
+  line[size++] = ',';
+  size += metrics::FormatFixed(query->series->Value(sample.value),
+                               query->decimals, line + size);
+  line[size++] = '\n';
+  query->out->write(reinterpret_cast<const uint8_t*>(line), size);
+  return true;
+}
+
+void PrintBinary(Print* out, uint32_t bucket_s,
+                 const timeseries::Series& series, size_t count,
+                 uint32_t boot_time) {
+  uint8_t header[20] = {'P', 'N', 'H', '1'};
+  size_t size = 4;
+  size += PutLe(bucket_s, header + size);
+  size += PutLe(series.resolution(), header + size);
+  size += PutLe(series.offset(), header + size);
+  size += PutLe(static_cast<uint32_t>(count), header + size);
+  out->write(header, size);
+  for (size_t i = 0; i < count; ++i) {
+    const timeseries::Bucket& bucket = query.buckets[i];
+    uint8_t record[12];
+    size = PutLe(query.starts_s[i] + boot_time, record);
+    size += PutLe(bucket.min, record + size);
+    size += PutLe(bucket.max, record + size);
+    size += PutLe(bucket.mean, record + size);
+    size += PutLe(bucket.count, record + size);
+    out->write(record, size);
+  }
+}
+
+}  // namespace
+
+const MetricInfo& Info(Metric metric) { return kMetrics[metric]; }
+
+bool Find(std::string_view name, std::string_view size, Metric* metric) {
+  for (int i = 0; i < kNumMetrics; ++i) {
+    const MetricInfo& info = kMetrics[i];
+    if (name != info.name) {
+      continue;
+    }
+    if (info.size == nullptr || size == info.size ||
+        (size.empty() && i == kPm2_5)) {
+      *metric = static_cast<Metric>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void Init() {
+  if (mutex == nullptr) {
+    mutex = xSemaphoreCreateMutex();
+    query_mutex = xSemaphoreCreateMutex();
+  }
+  static tslog::PartitionFlash flash(kLogPartition);
+  static tslog::Log log(&flash);
+  if (!flash.ok()) {
+    ESP_LOGW(TAG, "Init(): no %s partition, not logging to flash",
+             kLogPartition);
+  } else if (log.Mount()) {
+    flash_log = &log;
+    const esp_err_t err = esp_register_shutdown_handler(Flush);
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "Init(): no shutdown handler: %s", esp_err_to_name(err));
+    }
+  }
+  ESP_LOGI(TAG, "Init(): %u metrics, %u bytes", kNumMetrics,
+           static_cast<unsigned>(StoreSize()));
+}
+
+void Record(void* task_data_arg, unsigned long cycle_ms) {
+  auto* task_data = reinterpret_cast<TaskData*>(task_data_arg);
+  sensor_bus::Snapshot<pmsx003::Data> pmsx003;
+  sensor_bus::Snapshot<dsco220::Data> dsco220;
+  sensor_bus::Snapshot<bme::Data> bme;
+  const bool pmsx003_new =
+      Newer(task_data->pmsx003, &task_data->pmsx003_seq, &pmsx003);
+  const bool dsco220_new =
+      Newer(task_data->dsco220, &task_data->dsco220_seq, &dsco220);
+  const bool bme_new = Newer(task_data->bme, &task_data->bme_seq, &bme);
+  if (!pmsx003_new && !dsco220_new && !bme_new) {
+    return;
+  }
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  if (pmsx003_new) {
+    series[kPm2_5].Add(pmsx003.value.pm_2_5, pmsx003.timestamp_ms);
+    series[kPm10_0].Add(pmsx003.value.pm_10_0, pmsx003.timestamp_ms);
+  }
+  if (dsco220_new) {
+    series[kCo2].Add(dsco220.value.co2_ppm, dsco220.timestamp_ms);
+  }
+  if (bme_new) {
+    series[kTempC].Add(bme.value.temp_c, bme.timestamp_ms);
+    series[kHumidityPct].Add(bme.value.humidity_pct, bme.timestamp_ms);
+    series[kPressurePa].Add(bme.value.pressure_pa, bme.timestamp_ms);
+  }
+
+  const time_t now = time(nullptr);
+  if (flash_log == nullptr || now <= kClockSetAfter) {
+    xSemaphoreGive(mutex);
+    return;
+  }
+  // Held steady, or times would jitter by a second as the two clocks tick
+  // over at different moments; SNTP stepping the clock still moves it.
+  const uint32_t boot_time = now - millis() / 1000;
+  if (task_data->boot_time == 0 ||
+      labs(static_cast<int32_t>(boot_time - task_data->boot_time)) > 1) {
+    task_data->boot_time = boot_time;
+  }
+  if (pmsx003_new) {
+    LogSample(kPm2_5, pmsx003.value.pm_2_5, pmsx003.timestamp_ms,
+              task_data->boot_time);
+    LogSample(kPm10_0, pmsx003.value.pm_10_0, pmsx003.timestamp_ms,
+              task_data->boot_time);
+  }
+  if (dsco220_new) {
+    LogSample(kCo2, dsco220.value.co2_ppm, dsco220.timestamp_ms,
+              task_data->boot_time);
+  }
+  if (bme_new) {
+    LogSample(kTempC, bme.value.temp_c, bme.timestamp_ms,
+              task_data->boot_time);
+    LogSample(kHumidityPct, bme.value.humidity_pct, bme.timestamp_ms,
+              task_data->boot_time);
+    LogSample(kPressurePa, bme.value.pressure_pa, bme.timestamp_ms,
+              task_data->boot_time);
+  }
+  xSemaphoreGive(mutex);
+}
+
+void LogStatus(void* task_data, unsigned long cycle_ms) {
+  uint32_t samples[kNumMetrics];
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (int i = 0; i < kNumMetrics; ++i) {
+    samples[i] = series[i].samples();
+  }
+  xSemaphoreGive(mutex);
+  ESP_LOGI(TAG,
+           "history::LogStatus(): uptime: %s bytes: %u samples: pm2_5: %u"
+           " pm10_0: %u co2_ppm: %u temp_c: %u humidity_pct: %u"
+           " pressure_pa: %u",
+           dump::MillisHumanReadable(cycle_ms).c_str(),
+           static_cast<unsigned>(StoreSize()), samples[kPm2_5],
+           samples[kPm10_0], samples[kCo2], samples[kTempC],
+           samples[kHumidityPct], samples[kPressurePa]);
+  if (flash_log != nullptr) {
+    const tslog::Stats stats = flash_log->stats();
+    ESP_LOGI(TAG,
+             "history::LogStatus(): flash log: samples: %u pages: %u/%u"
+             " erases: %u bad pages: %u dropped pages: %u bytes/sample: %.2f"
+             " write amplification: %.2f",
+             stats.samples, stats.pages_written,
+             static_cast<unsigned>(flash_log->pages()), stats.erases,
+             stats.bad_pages, stats.dropped_pages, stats.bytes_per_sample(),
+             stats.write_amplification());
+  }
+}
+
+size_t Read(Metric metric, int tier, uint32_t since_s,
+            timeseries::Point* points, size_t max_points) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  const size_t count =
+      series[metric].Read(tier, since_s, points, max_points);
+  xSemaphoreGive(mutex);
+  return count;
+}
+
+void ServeHistory(const http_server::Request& request,
+                  http_server::Response* response, void* arg) {
+  std::string_view param;
+  Metric metric;
+  if (!FindMetric(request, response, &metric)) {
+    return;
+  }
+  long from = -kDefaultRangeS;
+  long to = 0;
+  long points = kDefaultPoints;
+  if ((request.QueryParam("from", &param) && !ParseInt(param, &from)) ||
+      (request.QueryParam("to", &param) && !ParseInt(param, &to)) ||
+      (request.QueryParam("points", &param) && !ParseInt(param, &points))) {
+    http_server::SendStatus(response, 400, "bad from, to or points");
+    return;
+  }
+  bool binary = false;
+  if (request.QueryParam("format", &param)) {
+    if (param == "bin") {
+      binary = true;
+    } else if (param != "csv") {
+      http_server::SendStatus(response, 400, "format is csv or bin");
+      return;
+    }
+  }
+
+  const uint32_t now_s = millis() / 1000;
+  const time_t now = time(nullptr);
+  // Adding it to seconds since boot gives Unix time.
+  const uint32_t boot_time = now > kClockSetAfter ? now - now_s : 0;
+  const uint32_t from_s = SinceBoot(from, now_s, boot_time);
+  const uint32_t to_s = to == 0 ? now_s : SinceBoot(to, now_s, boot_time);
+  const int tier = TierFor(from_s, now_s);
+  const timeseries::Series& metric_series = series[metric];
+
+  if (!TakeQuery(response)) {
+    return;
+  }
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  size_t count = metric_series.Read(tier, from_s, to_s, query.buckets,
+                                    query.starts_s,
+                                    timeseries::MaxTierBuckets());
+  xSemaphoreGive(mutex);
+  count = timeseries::Downsample(query.buckets, query.starts_s, count,
+                                 points < 0 ? 0 : points);
+
+  response->set_content_type(binary ? "application/octet-stream"
+                                    : "text/csv; charset=utf-8");
+  response->AddHeader("Vary", "Accept-Encoding");
+  Print* out = response;
+  const bool gzipped =
+      request.Header("Accept-Encoding").find("gzip") != std::string_view::npos;
+  if (gzipped) {
+    response->AddHeader("Content-Encoding", "gzip");
+    query.gzip.Begin(response);
+    out = &query.gzip;
+  }
+  if (binary) {
+    PrintBinary(out, timeseries::kTiers[tier].bucket_s, metric_series, count,
+                boot_time);
+  } else {
+    PrintCsv(out, kMetrics[metric], metric_series, count, boot_time);
+  }
+  if (gzipped) {
+    query.gzip.Finish();
+  }
+  xSemaphoreGive(query_mutex);
+  ESP_LOGD(TAG, "ServeHistory(): %s tier: %d points: %u", kMetrics[metric].name,
+           tier, static_cast<unsigned>(count));
+}
+
+void ServeLog(const http_server::Request& request,
+              http_server::Response* response, void* arg) {
+  std::string_view param;
+  Metric metric;
+  if (!FindMetric(request, response, &metric)) {
+    return;
+  }
+  long from = -kDefaultLogRangeS;
+  long to = 0;
+  long limit = kDefaultLogLimit;
+  if ((request.QueryParam("from", &param) && !ParseInt(param, &from)) ||
+      (request.QueryParam("to", &param) && !ParseInt(param, &to)) ||
+      (request.QueryParam("limit", &param) && !ParseInt(param, &limit))) {
+    http_server::SendStatus(response, 400, "bad from, to or limit");
+    return;
+  }
+  const time_t now = time(nullptr);
+  if (flash_log == nullptr) {
+    http_server::SendStatus(response, 503, "no flash log");
+    return;
+  }
+  if (now <= kClockSetAfter) {
+    http_server::SendStatus(response, 503, "clock not set");
+    return;
+  }
+  // Negative: seconds ago.
+  const uint32_t from_s = from > 0 ? from : now + from > 0 ? now + from : 0;
+  const uint32_t to_s = to > 0 ? to : now + to > 0 ? now + to : 0;
+
+  if (!TakeQuery(response)) {
+    return;
+  }
+  response->set_content_type("text/csv; charset=utf-8");
+  response->AddHeader("Vary", "Accept-Encoding");
+  Print* out = response;
+  const bool gzipped =
+      request.Header("Accept-Encoding").find("gzip") != std::string_view::npos;
+  if (gzipped) {
+    response->AddHeader("Content-Encoding", "gzip");
+    query.gzip.Begin(response);
+    out = &query.gzip;
+  }
+  out->print("t,value\n");
+  LogQuery log_query = {out, &series[metric], kMetrics[metric].decimals,
+                        limit};
+  const size_t count =
+      flash_log->Scan(metric, from_s, to_s, PrintSample, &log_query);
+  if (gzipped) {
+    query.gzip.Finish();
+  }
+  xSemaphoreGive(query_mutex);
+  ESP_LOGD(TAG, "ServeLog(): %s samples: %u", kMetrics[metric].name,
+           static_cast<unsigned>(count));
+}
+
+void TaskWriteLog(void* unused) {
+  for (;; delay(kWriteLogPeriodMs)) {
+    if (flash_log != nullptr) {
+      flash_log->WriteOut();
+    }
+  }
+}
+
+void Flush() {
+  if (flash_log == nullptr) {
+    return;
+  }
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  flash_log->Flush();
+  xSemaphoreGive(mutex);
+  ESP_LOGI(TAG, "Flush(): flash log written out");
+}
+
+tslog::Stats LogStats() {
+  return flash_log == nullptr ? tslog::Stats{} : flash_log->stats();
+}
+
+size_t StoreSize() {
+  return sizeof(series) + sizeof(query) + sizeof(tslog::Log);
+}
+
+}  // namespace history
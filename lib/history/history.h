@@ -0,0 +1,126 @@
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+
+// Rolled-up history of the sensor readings, fed from the sensor bus.
+//
+// Every metric gets a timeseries::Series in static memory, checked against a
+// budget at compile time, so the history never competes for heap.
+//
+// GET /api/v1/history?metric=co2_ppm&from=-86400&points=300 serves a range
+// of one metric, named as on /varz, with size= picking a particulate size
+// as the label does there (pm2.5 by default):
+//
+//   from, to  Negative: seconds ago; 0 for to means now. Otherwise Unix
+//             time once SNTP has set the clock, or seconds since boot
+//             before that. The last day up to now by default.
+//   points    At most this many, downsampled with largest-triangle-three-
+//             buckets from the finest tier reaching back to from; 300 by
+//             default.
+//   format    csv (default): t,min,max,mean,count lines, t in the same
+//             units as from and to.
+//             bin: little-endian, a 20 byte header, "PNH1", uint32
+//             bucket_s, float32 resolution and offset, uint32 count, then
+//             count 12 byte records: uint32 t, int16 min, max and mean as
+//             steps (value = steps * resolution + offset), uint16 count.
+//
+// gzipped on the way out when the client takes it.
+//
+// Once SNTP has set the clock, every sample also goes to a tslog::Log in
+// the "tslog" flash partition, where it outlives reboots and OTA updates.
+// GET /api/v1/log?metric=co2_ppm&from=-3600 serves them as t,value lines,
+// from and to as above but always Unix time, the last hour by default, at
+// most limit (10000) of them.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string_view>
+
+#include "bme.h"
+#include "dsco220.h"
+#include "http_server.h"
+#include "pmsx003.h"
+#include "sensor_bus.h"
+#include "timeseries.h"
+#include "tslog.h"
+
+namespace history {
+
+enum Metric {
+  kPm2_5,
+  kPm10_0,
+  kCo2,
+  kTempC,
+  kHumidityPct,
+  kPressurePa,
+  kNumMetrics,
+};
+
+struct MetricInfo {
+  // As on /varz, e.g. "pm_ug_m3", and for particulates the size label.
+  const char* name;
+  const char* size;
+  // Stored to within resolution / 2, within 32767 * resolution of offset.
+  float resolution;
+  float offset;
+  // Decimals worth printing.
+  int decimals;
+};
+
+const MetricInfo& Info(Metric metric);
+// The metric called name, with size for particulates; false if none is.
+bool Find(std::string_view name, std::string_view size, Metric* metric);
+
+struct TaskData {
+  sensor_bus::Topic<pmsx003::Data>* pmsx003;
+  sensor_bus::Topic<dsco220::Data>* dsco220;
+  sensor_bus::Topic<bme::Data>* bme;
+
+  // Owned by Record(): the seq of each topic's last recorded snapshot.
+  uint32_t pmsx003_seq;
+  uint32_t dsco220_seq;
+  uint32_t bme_seq;
+  // Unix time at boot, once the clock is set.
+  uint32_t boot_time;
+};
+
+// Creates the lock readers share with Record(), and mounts the flash log.
+// Call from setup().
+void Init();
+
+// Scheduler jobs (see scheduler::JobFn); task_data is a TaskData*. Record()
+// adds every snapshot published since its last run, so running it every tick
+// of the scheduler that polls the sensors catches them all.
+void Record(void* task_data, unsigned long cycle_ms);
+void LogStatus(void* task_data, unsigned long cycle_ms);
+
+// timeseries::Series::Read() for metric. Safe from any task.
+size_t Read(Metric metric, int tier, uint32_t since_s,
+            timeseries::Point* points, size_t max_points);
+
+// Handler for /api/v1/history; see above. Queries take turns with each other
+// and with /api/v1/log: one that finds another streaming gets a 503.
+void ServeHistory(const http_server::Request& request,
+                  http_server::Response* response, void* arg);
+
+// Handler for /api/v1/log; see above.
+void ServeLog(const http_server::Request& request,
+              http_server::Response* response, void* arg);
+
+// Writes out the flash log's pages as Record() fills them, so the sensors'
+// scheduler never waits out a sector erase. Create it at a low priority.
+void TaskWriteLog(void* unused);
+
+// Writes out the flash log's part-full pages, which a restart would lose.
+// Init() registers it as a shutdown handler, so esp_restart() calls it.
+void Flush();
+
+// Of the flash log; all zero without one.
+tslog::Stats LogStats();
+
+// Static memory taken by the history, query buffers and flash log included.
+size_t StoreSize();
+
+}  // namespace history
+
+#endif  // _HISTORY_H_
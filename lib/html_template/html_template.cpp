@@ -0,0 +1,83 @@
+#include "html_template.h"
+
+#include <esp_log.h>
+#include <string.h>
+
+namespace html_template {
+namespace {
+
+const char TAG[] = "html_template";
+
+}  // namespace
+
+Template::Template(const char* text, const Field* fields, size_t num_fields)
+    : text_(text), fields_(fields) {
+  const size_t text_size = strlen(text);
+  if (text_size > UINT16_MAX) {
+    ESP_LOGE(TAG, "Template too long: %u bytes",
+             static_cast<unsigned>(text_size));
+    ok_ = false;
+    return;
+  }
+
+  // Start of the literal run not yet added.
+  size_t literal = 0;
+  const char* open;
+  for (const char* p = text; (open = strstr(p, "{{")); p = open + 2) {
+    const char* name = open + 2;
+    const char* close = strstr(name, "}}");
+    if (!close) {
+      break;
+    }
+    const size_t name_size = close - name;
+    int field = -1;
+    for (size_t i = 0; i < num_fields; ++i) {
+      if (strncmp(fields[i].name, name, name_size) == 0 &&
+          fields[i].name[name_size] == '\0') {
+        field = i;
+        break;
+      }
+    }
+    // Placeholders that can't be filled in are left as text, so they show.
+    if (field < 0) {
+      ESP_LOGE(TAG, "No field for placeholder %.*s",
+               static_cast<int>(name_size + 4), open);
+      ok_ = false;
+      continue;
+    }
+    // Filling one in takes up to three segments: the run ahead of it, the
+    // field, and the rest of the text.
+    if (num_segments_ + 3 > kMaxSegments) {
+      ESP_LOGE(TAG, "More than %d segments; not filling in the rest",
+               kMaxSegments);
+      ok_ = false;
+      break;
+    }
+    AddLiteral(literal, open - text - literal);
+    segments_[num_segments_++] = {0, 0, static_cast<int16_t>(field)};
+    literal = close + 2 - text;
+    open = close;
+  }
+  AddLiteral(literal, text_size - literal);
+}
+
+void Template::AddLiteral(size_t offset, size_t size) {
+  if (!size) {
+    return;
+  }
+  segments_[num_segments_++] = {static_cast<uint16_t>(offset),
+                                static_cast<uint16_t>(size), -1};
+}
+
+void Template::Render(Print* out, const void* values) const {
+  for (int i = 0; i < num_segments_; ++i) {
+    const Segment& segment = segments_[i];
+    if (segment.field >= 0) {
+      fields_[segment.field].write(out, values);
+    } else {
+      out->write(text_ + segment.offset, segment.size);
+    }
+  }
+}
+
+}  // namespace html_template
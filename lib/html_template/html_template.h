@@ -0,0 +1,65 @@
+#ifndef _HTML_TEMPLATE_H_
+#define _HTML_TEMPLATE_H_
+
+// Streaming templates with named placeholders, for the web pages.
+//
+// The template text is split once, up front, into literal runs and
+// placeholders, each placeholder resolved to the field that renders it.
+// Rendering then writes the literal runs straight from the text, which stays
+// in flash, and calls the fields' writers in between, so only the dynamic
+// values are ever formatted and nothing limits how long the page gets.
+//
+// Placeholders look like {{name}}; a name may appear any number of times.
+
+#include <Print.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace html_template {
+
+// A named value. write prints it to out from the values passed to Render().
+// Values are written as they are; nothing is HTML-escaped.
+struct Field {
+  const char* name;
+  void (*write)(Print* out, const void* values);
+};
+
+class Template {
+ public:
+  // Literal runs plus placeholders.
+  static const int kMaxSegments = 96;
+
+  // Splits text, which must outlive the template, and looks up every
+  // placeholder in fields. A placeholder that names no field, or one past
+  // kMaxSegments, is logged and rendered as literal text.
+  Template(const char* text, const Field* fields, size_t num_fields);
+  Template(const Template&) = delete;
+  Template& operator=(const Template&) = delete;
+
+  // Every placeholder named a field and the template fit.
+  bool ok() const { return ok_; }
+  int segments() const { return num_segments_; }
+
+  void Render(Print* out, const void* values) const;
+
+ private:
+  struct Segment {
+    // Offset and size of a literal run in the text; for a placeholder, the
+    // field writing it instead.
+    uint16_t offset;
+    uint16_t size;
+    int16_t field;
+  };
+
+  void AddLiteral(size_t offset, size_t size);
+
+  const char* const text_;
+  const Field* const fields_;
+  Segment segments_[kMaxSegments];
+  int num_segments_ = 0;
+  bool ok_ = true;
+};
+
+}  // namespace html_template
+
+#endif  // _HTML_TEMPLATE_H_
@@ -0,0 +1,165 @@
+#include "event_stream.h"
+
+#include <Arduino.h>
+#include <dump.h>
+#include <errno.h>
+#include <esp_log.h>
+#include <string.h>
+
+#include <lwip/sockets.h>
+
+namespace http_server {
+namespace {
+const char TAG[] = "event_stream";
+
+const char kKeepAlive[] = ":\n\n";
+}  // namespace
+
+EventStream::EventStream() : mutex_(xSemaphoreCreateMutex()) {
+  for (int& fd : fds_) {
+    fd = -1;
+  }
+}
+
+EventStream::~EventStream() {
+  for (int fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+  vSemaphoreDelete(mutex_);
+}
+
+void EventStream::Subscribe(Response* response, const char* event,
+                            RenderFn render, void* arg) {
+  int index = -1;
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  for (int i = 0; i < kMaxSubscribers; ++i) {
+    if (fds_[i] == -1) {
+      index = i;
+      fds_[i] = kReserved;
+      break;
+    }
+  }
+  xSemaphoreGive(mutex_);
+  if (index < 0) {
+    ++rejected_;
+    SendStatus(response, 503, "too many subscribers");
+    return;
+  }
+
+  // The headers go out blocking, like any response, so not under the lock.
+  response->set_content_type("text/event-stream");
+  response->AddHeader("Cache-Control", "no-cache");
+  const int fd = response->Detach();
+
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  fds_[index] = fd;
+  if (fd >= 0) {
+    ++subscribers_;
+    ++subscribed_;
+    if (Render(event, render, arg)) {
+      SendTo(index);
+    }
+  }
+  xSemaphoreGive(mutex_);
+}
+
+void EventStream::Publish(const char* event, RenderFn render, void* arg) {
+  if (subscribers_ == 0) {
+    return;
+  }
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  if (Render(event, render, arg)) {
+    ++events_;
+    SendToAll();
+  }
+  xSemaphoreGive(mutex_);
+}
+
+void EventStream::KeepAlive() {
+  if (subscribers_ == 0) {
+    return;
+  }
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  if (millis() - last_send_ms_ >= kKeepAliveMs) {
+    memcpy(buffer_, kKeepAlive, strlen(kKeepAlive));
+    size_ = strlen(kKeepAlive);
+    SendToAll();
+  }
+  xSemaphoreGive(mutex_);
+}
+
+bool EventStream::Render(const char* event, RenderFn render, void* arg) {
+  BufferPrint out(buffer_, sizeof(buffer_));
+  out.print("event: ");
+  out.print(event);
+  out.print("\ndata: ");
+  render(&out, arg);
+  out.print("\n\n");
+  size_ = out.size();
+  if (size_ > max_event_size_) {
+    max_event_size_ = size_;
+  }
+  if (out.overflow()) {
+    ESP_LOGE(TAG, "Render(): %s event is over %u bytes", event,
+             static_cast<unsigned>(sizeof(buffer_)));
+    return false;
+  }
+  return true;
+}
+
+void EventStream::SendToAll() {
+  for (int i = 0; i < kMaxSubscribers; ++i) {
+    if (fds_[i] >= 0) {
+      SendTo(i);
+    }
+  }
+  last_send_ms_ = millis();
+}
+
+void EventStream::SendTo(int index) {
+  const int fd = fds_[index];
+  ssize_t n;
+  do {
+    n = send(fd, buffer_, size_, MSG_DONTWAIT | MSG_NOSIGNAL);
+  } while (n < 0 && errno == EINTR);
+  if (n == static_cast<ssize_t>(size_)) {
+    return;
+  }
+  // Anything short of the whole event leaves the stream unusable.
+  if (n >= 0 || errno == EAGAIN || errno == EWOULDBLOCK) {
+    ESP_LOGW(TAG, "Dropping subscriber %d: not keeping up", index);
+    ++dropped_;
+  } else {
+    ESP_LOGD(TAG, "Subscriber %d gone: errno: %d", index, errno);
+    ++closed_;
+  }
+  close(fd);
+  fds_[index] = -1;
+  --subscribers_;
+}
+
+EventStream::Stats EventStream::stats() const {
+  Stats stats;
+  stats.subscribed = subscribed_;
+  stats.rejected = rejected_;
+  stats.events = events_;
+  stats.dropped = dropped_;
+  stats.closed = closed_;
+  stats.max_event_size = max_event_size_;
+  return stats;
+}
+
+void EventStream::LogStats() const {
+  const Stats s = stats();
+  ESP_LOGI(TAG,
+           "event_stream: uptime: %s subscribers: %d subscribed: %u"
+           " rejected: %u events: %u dropped: %u closed: %u"
+           " max_event_size: %u",
+           dump::MillisHumanReadable(millis()).c_str(), subscribers(),
+           s.subscribed, s.rejected, s.events, s.dropped, s.closed,
+           s.max_event_size);
+}
+
+}  // namespace http_server
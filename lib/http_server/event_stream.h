@@ -0,0 +1,101 @@
+#ifndef _EVENT_STREAM_H_
+#define _EVENT_STREAM_H_
+
+// Server-Sent Events: responses that stay open while the device pushes
+// events down them, for dashboards that want updates as they happen rather
+// than polling.
+//
+// A subscriber's socket is taken off the server, so it holds neither a
+// connection slot nor a worker, and events go out without blocking. A
+// subscriber whose socket buffer can't take a whole event, because the
+// client stopped reading or its network can't keep up, is dropped rather
+// than holding up the others; EventSource in a browser reconnects on its
+// own.
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "http_server.h"
+
+namespace http_server {
+
+class EventStream {
+ public:
+  static const int kMaxSubscribers = 4;
+  // Largest event, framing included.
+  static const size_t kMaxEventSize = 1024;
+  // A comment goes out when nothing else has for this long, so subscribers
+  // that went away are noticed, and quiet streams aren't timed out.
+  static const unsigned long kKeepAliveMs = 15 * 1000;
+
+  // Prints an event's data, which must be a single line.
+  typedef void (*RenderFn)(Print* out, void* arg);
+
+  EventStream();
+  ~EventStream();
+  EventStream(const EventStream&) = delete;
+  EventStream& operator=(const EventStream&) = delete;
+
+  // For a handler: takes over the response's connection and sends it a
+  // first event, e.g. a snapshot that later events are changes to. A 503
+  // if kMaxSubscribers are already listening.
+  void Subscribe(Response* response, const char* event, RenderFn render,
+                 void* arg);
+
+  // Renders an event and sends it to every subscriber, in publish order.
+  // Does nothing, not even the render, without subscribers.
+  void Publish(const char* event, RenderFn render, void* arg);
+
+  // Sends a comment if nothing has gone out for kKeepAliveMs. Call every
+  // few seconds.
+  void KeepAlive();
+
+  int subscribers() const { return subscribers_; }
+
+  struct Stats {
+    uint32_t subscribed;
+    // Turned away with a 503.
+    uint32_t rejected;
+    uint32_t events;
+    // Dropped for not keeping up.
+    uint32_t dropped;
+    // Gone: the client closed the connection or it broke.
+    uint32_t closed;
+    uint32_t max_event_size;
+  };
+  Stats stats() const;
+  void LogStats() const;
+
+ private:
+  // Marks a subscriber's slot taken while its headers go out.
+  static const int kReserved = -2;
+
+  // Frames an event into buffer_; false if it doesn't fit.
+  bool Render(const char* event, RenderFn render, void* arg);
+  // Sends buffer_ to subscriber index, dropping it unless it all goes out.
+  void SendTo(int index);
+  void SendToAll();
+
+  // Guards everything below.
+  SemaphoreHandle_t mutex_;
+  int fds_[kMaxSubscribers];
+  uint8_t buffer_[kMaxEventSize];
+  size_t size_ = 0;
+  unsigned long last_send_ms_ = 0;
+
+  std::atomic<int> subscribers_{0};
+  std::atomic<uint32_t> subscribed_{0};
+  std::atomic<uint32_t> rejected_{0};
+  std::atomic<uint32_t> events_{0};
+  std::atomic<uint32_t> dropped_{0};
+  std::atomic<uint32_t> closed_{0};
+  std::atomic<uint32_t> max_event_size_{0};
+};
+
+}  // namespace http_server
+
+#endif  // _EVENT_STREAM_H_
@@ -0,0 +1,818 @@
+#include "http_server.h"
+
+#include <Arduino.h>
+#include <dump.h>
+#include <errno.h>
+#include <esp_log.h>
+#include <freertos/task.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+
+#include <lwip/sockets.h>
+
+namespace http_server {
+namespace {
+const char TAG[] = "http_server";
+
+const char kCrLf[] = "\r\n";
+const char kEndOfHeaders[] = "\r\n\r\n";
+
+const char* ReasonPhrase(int status) {
+  switch (status) {
+    case 200:
+      return "OK";
+    case 204:
+      return "No Content";
+    case 302:
+      return "Found";
+    case 304:
+      return "Not Modified";
+    case 400:
+      return "Bad Request";
+    case 403:
+      return "Forbidden";
+    case 404:
+      return "Not Found";
+    case 405:
+      return "Method Not Allowed";
+    case 413:
+      return "Payload Too Large";
+    case 431:
+      return "Request Header Fields Too Large";
+    case 500:
+      return "Internal Server Error";
+    case 503:
+      return "Service Unavailable";
+    default:
+      return "";
+  }
+}
+
+std::string_view Trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+bool EqualsIgnoreCase(std::string_view a, const char* b) {
+  return a.size() == strlen(b) && strncasecmp(a.data(), b, a.size()) == 0;
+}
+
+// Value of header name in a block of "Name: value\r\n" lines.
+std::string_view FindHeader(std::string_view headers, const char* name) {
+  const size_t name_size = strlen(name);
+  while (!headers.empty()) {
+    size_t end = headers.find(kCrLf);
+    std::string_view line = headers.substr(0, end);
+    headers.remove_prefix(end == std::string_view::npos ? headers.size()
+                                                        : end + 2);
+    if (line.size() > name_size && line[name_size] == ':' &&
+        strncasecmp(line.data(), name, name_size) == 0) {
+      return Trim(line.substr(name_size + 1));
+    }
+  }
+  return std::string_view();
+}
+
+// Length of the first request in data once all of it has arrived, 0 while
+// more is expected, or minus the status to answer with if it can never fit.
+int RequestLength(const char* data, size_t size) {
+  const std::string_view buffered(data, size);
+  const size_t end = buffered.find(kEndOfHeaders);
+  if (end == std::string_view::npos) {
+    return size < Server::kMaxRequestSize ? 0 : -431;
+  }
+  const size_t header_size = end + strlen(kEndOfHeaders);
+  const std::string_view length =
+      FindHeader(buffered.substr(0, header_size), "Content-Length");
+  uint32_t body_size = 0;
+  if (!length.empty()) {
+    // Digits only: a sign or spaces make it malformed.
+    if (length.find_first_not_of("0123456789") != std::string_view::npos) {
+      return -400;
+    }
+    if (!ParseUint(length, &body_size)) {
+      return -413;
+    }
+  }
+  // Not the sum, which a huge length would wrap.
+  if (header_size > Server::kMaxRequestSize ||
+      body_size > Server::kMaxRequestSize - header_size) {
+    return -413;
+  }
+  return header_size + body_size <= size ? header_size + body_size : 0;
+}
+
+// Splits off everything up to the first sep, and the sep.
+std::string_view Split(std::string_view* s, char sep) {
+  const size_t pos = s->find(sep);
+  const std::string_view head = s->substr(0, pos);
+  s->remove_prefix(pos == std::string_view::npos ? s->size() : pos + 1);
+  return head;
+}
+
+// Value of key in "name=value" pairs joined by '&'.
+bool FindParam(std::string_view params, const char* key,
+               std::string_view* value) {
+  while (!params.empty()) {
+    std::string_view param = Split(&params, '&');
+    std::string_view name = Split(&param, '=');
+    if (name == key) {
+      *value = param;
+      return true;
+    }
+  }
+  return false;
+}
+
+int HexDigit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+}  // namespace
+
+std::string_view Request::Header(const char* name) const {
+  return FindHeader(headers_, name);
+}
+
+bool Request::Parse(std::string_view data, bool* keep_alive) {
+  const size_t line_end = data.find(kCrLf);
+  const size_t header_end = data.find(kEndOfHeaders);
+  std::string_view line = data.substr(0, line_end);
+  method_ = Split(&line, ' ');
+  std::string_view target = Split(&line, ' ');
+  const std::string_view version = line;
+  if (method_.empty() || target.empty() || target[0] != '/' ||
+      version.substr(0, 7) != "HTTP/1.") {
+    return false;
+  }
+  path_ = Split(&target, '?');
+  query_ = target;
+  headers_ = data.substr(line_end + 2, header_end + 2 - (line_end + 2));
+  body_ = data.substr(header_end + strlen(kEndOfHeaders));
+
+  // Persistent unless the client says otherwise, but not for HTTP/1.0.
+  const std::string_view connection = Header("Connection");
+  http_1_0_ = version == "HTTP/1.0";
+  if (http_1_0_) {
+    *keep_alive = EqualsIgnoreCase(connection, "keep-alive");
+  } else {
+    *keep_alive = !EqualsIgnoreCase(connection, "close");
+  }
+  return true;
+}
+
+bool Request::QueryParam(const char* key, std::string_view* value) const {
+  return FindParam(query_, key, value);
+}
+
+bool Request::FormParam(const char* key, std::string_view* value) const {
+  std::string_view content_type = Header("Content-Type");
+  return EqualsIgnoreCase(Trim(Split(&content_type, ';')),
+                          "application/x-www-form-urlencoded") &&
+         FindParam(body_, key, value);
+}
+
+bool Request::HasEtag(const char* etag) const {
+  // If-None-Match holds a list of ETags, or "*".
+  const std::string_view if_none_match = Header("If-None-Match");
+  if (if_none_match == "*") {
+    return true;
+  }
+  const size_t size = strlen(etag);
+  for (size_t pos = if_none_match.find(etag); pos != std::string_view::npos;
+       pos = if_none_match.find(etag, pos + 1)) {
+    // A whole entry, not the tail of a longer one.
+    const size_t end = pos + size;
+    if ((end == if_none_match.size() || if_none_match[end] == ',' ||
+         if_none_match[end] == ' ') &&
+        (pos == 0 || if_none_match[pos - 1] == ' ' ||
+         if_none_match[pos - 1] == ',' || if_none_match[pos - 1] == '/')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Request::AcceptsEncoding(const char* coding) const {
+  // Comma-separated codings, each maybe with ";q=" and a weight, where zero
+  // means "not this one". An exact match overrides "*".
+  std::string_view accept_encoding = Header("Accept-Encoding");
+  int wildcard = -1;
+  while (!accept_encoding.empty()) {
+    std::string_view entry = Split(&accept_encoding, ',');
+    const std::string_view name = Trim(Split(&entry, ';'));
+    bool accepted = true;
+    while (!entry.empty()) {
+      std::string_view param = Trim(Split(&entry, ';'));
+      if (param.size() >= 2 && (param[0] == 'q' || param[0] == 'Q') &&
+          param[1] == '=') {
+        // 0, 0., 0.0 and so on; anything else is some weight.
+        param.remove_prefix(2);
+        accepted = param.find_first_not_of("0.") != std::string_view::npos;
+      }
+    }
+    if (EqualsIgnoreCase(name, coding)) {
+      return accepted;
+    }
+    if (name == "*") {
+      wildcard = accepted;
+    }
+  }
+  return wildcard == 1;
+}
+
+bool Response::AddHeader(const char* name, const char* value) {
+  if (headers_sent_) {
+    return false;
+  }
+  const size_t room = sizeof(extra_headers_) - extra_headers_size_;
+  int n = snprintf(extra_headers_ + extra_headers_size_, room, "%s: %s\r\n",
+                   name, value);
+  if (n < 0 || static_cast<size_t>(n) >= room) {
+    extra_headers_[extra_headers_size_] = '\0';
+    return false;
+  }
+  extra_headers_size_ += n;
+  return true;
+}
+
+size_t Response::write(const uint8_t* data, size_t size) {
+  size_t written = 0;
+  while (written < size && !failed_) {
+    if (size_ == kBufferSize && !FlushChunk()) {
+      break;
+    }
+    size_t n = std::min(size - written, kBufferSize - size_);
+    memcpy(buffer_ + kChunkHeadroom + size_, data + written, n);
+    size_ += n;
+    written += n;
+  }
+  return written;
+}
+
+bool Response::SendBody(const void* data, size_t size) {
+  if (headers_sent_ || size_ > 0 || failed_) {
+    return false;
+  }
+  const bool has_body = size > 0 && !head_;
+  complete_ = SendHeaders(size, /*more=*/has_body) &&
+              (!has_body || Send(data, size, false));
+  return complete_;
+}
+
+int Response::Detach() {
+  if (headers_sent_ || size_ > 0 || failed_) {
+    return -1;
+  }
+  keep_alive_ = false;
+  detached_ = true;
+  if (!SendHeaders(/*content_length=*/-1, /*more=*/false)) {
+    detached_ = false;
+    return -1;
+  }
+  return fd_;
+}
+
+bool Response::Finish() {
+  if (failed_) {
+    return false;
+  }
+  if (complete_) {
+    return true;
+  }
+  if (!headers_sent_) {
+    // The whole body is buffered: no need for chunks.
+    const bool has_body = size_ > 0 && !head_;
+    return SendHeaders(size_, /*more=*/has_body) &&
+           (!has_body || Send(buffer_ + kChunkHeadroom, size_, false));
+  }
+  return FlushChunk() && (head_ || !chunked_ || Send("0\r\n\r\n", 5, false));
+}
+
+bool Response::SendHeaders(int content_length, bool more) {
+  char head[384];
+  int n = snprintf(head, sizeof(head),
+                   "HTTP/1.1 %d %s\r\n"
+                   "Content-Type: %s\r\n"
+                   "%s"
+                   "Connection: %s\r\n",
+                   status_, ReasonPhrase(status_), content_type_,
+                   extra_headers_, keep_alive_ ? "keep-alive" : "close");
+  if (n > 0 && static_cast<size_t>(n) < sizeof(head)) {
+    if (status_ == 204 || status_ == 304) {
+      // Never a body, and nothing to say about its length.
+      n += snprintf(head + n, sizeof(head) - n, "\r\n");
+    } else if (content_length >= 0) {
+      n += snprintf(head + n, sizeof(head) - n, "Content-Length: %d\r\n\r\n",
+                    content_length);
+    } else if (chunked_ && !detached_) {
+      n += snprintf(head + n, sizeof(head) - n,
+                    "Transfer-Encoding: chunked\r\n\r\n");
+    } else {
+      n += snprintf(head + n, sizeof(head) - n, "\r\n");
+    }
+  }
+  headers_sent_ = true;
+  if (n < 0 || static_cast<size_t>(n) >= sizeof(head)) {
+    ESP_LOGE(TAG, "SendHeaders(): headers too long");
+    failed_ = true;
+    return false;
+  }
+  return Send(head, n, more);
+}
+
+bool Response::FlushChunk() {
+  if (!headers_sent_) {
+    // HTTP/1.0 clients don't know chunks; the end of the connection marks
+    // the end of the body instead.
+    keep_alive_ = keep_alive_ && chunked_;
+    if (!SendHeaders(/*content_length=*/-1, /*more=*/!head_)) {
+      return false;
+    }
+  }
+  if (size_ == 0 || head_) {
+    size_ = 0;
+    return !failed_;
+  }
+  if (!chunked_) {
+    bool sent = Send(buffer_ + kChunkHeadroom, size_, false);
+    size_ = 0;
+    return sent;
+  }
+  char size_line[kChunkHeadroom + 1];
+  int n = snprintf(size_line, sizeof(size_line), "%x\r\n",
+                   static_cast<unsigned>(size_));
+  uint8_t* chunk = buffer_ + kChunkHeadroom - n;
+  memcpy(chunk, size_line, n);
+  memcpy(buffer_ + kChunkHeadroom + size_, kCrLf, 2);
+  bool sent = Send(chunk, n + size_ + 2, false);
+  size_ = 0;
+  return sent;
+}
+
+bool Response::Send(const void* data, size_t size, bool more) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while (size > 0 && !failed_) {
+    ssize_t n = send(fd_, p, size, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      ESP_LOGW(TAG, "Send(): fd: %d errno: %d", fd_, errno);
+      failed_ = true;
+      break;
+    }
+    p += n;
+    size -= n;
+  }
+  return !failed_;
+}
+
+bool UrlDecode(std::string_view encoded, char* out, size_t size) {
+  size_t n = 0;
+  for (size_t i = 0; i < encoded.size(); ++i) {
+    char c = encoded[i];
+    if (c == '+') {
+      c = ' ';
+    } else if (c == '%') {
+      const int high = i + 2 < encoded.size() ? HexDigit(encoded[i + 1]) : -1;
+      const int low = high < 0 ? -1 : HexDigit(encoded[i + 2]);
+      if (low < 0) {
+        return false;
+      }
+      c = static_cast<char>(high << 4 | low);
+      i += 2;
+    }
+    if (n + 1 >= size) {
+      return false;
+    }
+    out[n++] = c;
+  }
+  if (size == 0) {
+    return false;
+  }
+  out[n] = '\0';
+  return true;
+}
+
+bool ParseUint(std::string_view text, uint32_t* value) {
+  if (text.empty()) {
+    return false;
+  }
+  uint32_t n = 0;
+  for (char c : text) {
+    if (c < '0' || c > '9' || n > (UINT32_MAX - (c - '0')) / 10) {
+      return false;
+    }
+    n = n * 10 + (c - '0');
+  }
+  *value = n;
+  return true;
+}
+
+void SendStatus(Response* response, int status, const char* message) {
+  response->set_status(status);
+  response->set_content_type("text/plain; charset=utf-8");
+  response->print(message);
+  response->print("\n");
+}
+
+size_t BufferPrint::write(const uint8_t* data, size_t size) {
+  if (size > capacity_ - size_) {
+    overflow_ = true;
+    size = capacity_ - size_;
+  }
+  memcpy(data_ + size_, data, size);
+  size_ += size;
+  return size;
+}
+
+bool Server::AddRoute(const char* path, Handler handler, void* arg) {
+  if (route_count_ >= kMaxRoutes || running_) {
+    ESP_LOGE(TAG, "AddRoute(): can't add %s", path);
+    return false;
+  }
+  routes_[route_count_++] = {path, handler, arg};
+  return true;
+}
+
+const Server::Route* Server::FindRoute(std::string_view path) const {
+  for (int i = 0; i < route_count_; ++i) {
+    if (path == routes_[i].path || strcmp(routes_[i].path, "*") == 0) {
+      return &routes_[i];
+    }
+  }
+  return nullptr;
+}
+
+bool Server::Start(const Config& config) {
+  if (running_) {
+    return false;
+  }
+  config_ = config;
+  config_.workers = std::max(1, std::min(config_.workers, kMaxWorkers));
+  for (Connection& conn : conns_) {
+    conn.fd = -1;
+    conn.state = kFree;
+  }
+
+  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(config_.port);
+  if (listen_fd_ < 0 ||
+      bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) !=
+          0 ||
+      listen(listen_fd_, kMaxConnections) != 0) {
+    ESP_LOGE(TAG, "Start(): can't listen on port %u: errno: %d", config_.port,
+             errno);
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+  fcntl(listen_fd_, F_SETFL, fcntl(listen_fd_, F_GETFL, 0) | O_NONBLOCK);
+
+  wake_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addr_size = sizeof(addr);
+  if (wake_fd_ < 0 ||
+      bind(wake_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      getsockname(wake_fd_, reinterpret_cast<sockaddr*>(&addr), &addr_size) !=
+          0) {
+    ESP_LOGE(TAG, "Start(): no wake socket: errno: %d", errno);
+    close(wake_fd_);
+    close(listen_fd_);
+    wake_fd_ = listen_fd_ = -1;
+    return false;
+  }
+  wake_port_ = ntohs(addr.sin_port);
+  fcntl(wake_fd_, F_SETFL, fcntl(wake_fd_, F_GETFL, 0) | O_NONBLOCK);
+
+  ready_ = xQueueCreate(kMaxConnections, sizeof(int));
+  running_ = true;
+  if (xTaskCreate(LoopTask, "HttpServer", config_.loop_stack_size, this,
+                  config_.priority, nullptr) != pdPASS) {
+    ESP_LOGE(TAG, "Start(): xTaskCreate() failed");
+    running_ = false;
+    return false;
+  }
+  for (int i = 0; i < config_.workers; ++i) {
+    char name[24];
+    snprintf(name, sizeof(name), "HttpWorker%d", i);
+    if (xTaskCreate(WorkerTask, name, config_.worker_stack_size, this,
+                    config_.priority, nullptr) != pdPASS) {
+      ESP_LOGE(TAG, "Start(): xTaskCreate(%s) failed", name);
+    }
+  }
+  ESP_LOGI(TAG, "Start(): listening on port %u with %d workers", config_.port,
+           config_.workers);
+  return true;
+}
+
+void Server::LoopTask(void* server) {
+  reinterpret_cast<Server*>(server)->Loop();
+  vTaskDelete(NULL);
+}
+
+void Server::WorkerTask(void* server) {
+  reinterpret_cast<Server*>(server)->Work();
+  vTaskDelete(NULL);
+}
+
+void Server::Loop() {
+  for (;;) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(listen_fd_, &fds);
+    FD_SET(wake_fd_, &fds);
+    int max_fd = std::max(listen_fd_, wake_fd_);
+    for (const Connection& conn : conns_) {
+      if (conn.state == kIdle) {
+        FD_SET(conn.fd, &fds);
+        max_fd = std::max(max_fd, conn.fd);
+      }
+    }
+    // Wake up now and then to expire idle connections.
+    struct timeval timeout = {1, 0};
+    int n = select(max_fd + 1, &fds, nullptr, nullptr, &timeout);
+    if (n < 0) {
+      if (errno != EINTR) {
+        ESP_LOGE(TAG, "Loop(): select() failed: errno: %d", errno);
+        vTaskDelay(100 / portTICK_PERIOD_MS);
+      }
+      continue;
+    }
+    if (FD_ISSET(wake_fd_, &fds)) {
+      char drain[16];
+      while (recv(wake_fd_, drain, sizeof(drain), MSG_DONTWAIT) > 0) {
+      }
+    }
+    for (int i = 0; i < kMaxConnections; ++i) {
+      if (conns_[i].state == kIdle && FD_ISSET(conns_[i].fd, &fds)) {
+        Read(i);
+      }
+    }
+    if (FD_ISSET(listen_fd_, &fds)) {
+      Accept();
+    }
+    ExpireIdle(millis());
+  }
+}
+
+void Server::Accept() {
+  for (;;) {
+    int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      return;
+    }
+    int index = -1;
+    int open = 0;
+    for (int i = 0; i < kMaxConnections; ++i) {
+      if (conns_[i].state == kFree) {
+        index = index < 0 ? i : index;
+      } else {
+        ++open;
+      }
+    }
+    if (index < 0) {
+      // Make room by closing whichever connection has been idle, between
+      // requests, for longest.
+      for (int i = 0; i < kMaxConnections; ++i) {
+        const Connection& conn = conns_[i];
+        if (conn.state == kIdle && conn.size == 0 &&
+            (index < 0 || static_cast<long>(conn.since_ms -
+                                            conns_[index].since_ms) < 0)) {
+          index = i;
+        }
+      }
+      if (index >= 0) {
+        Close(index);
+        --open;
+        ++purged_;
+      }
+    }
+    if (index < 0) {
+      static const char kBusy[] =
+          "HTTP/1.1 503 Service Unavailable\r\n"
+          "Connection: close\r\n"
+          "Content-Length: 0\r\n\r\n";
+      send(fd, kBusy, strlen(kBusy), MSG_DONTWAIT | MSG_NOSIGNAL);
+      close(fd);
+      ++rejected_;
+      continue;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval send_timeout = {
+        static_cast<time_t>(config_.send_timeout_ms / 1000),
+        static_cast<suseconds_t>(config_.send_timeout_ms % 1000 * 1000)};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout,
+               sizeof(send_timeout));
+
+    sockaddr_in local_addr = {};
+    socklen_t local_addr_size = sizeof(local_addr);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&local_addr),
+                &local_addr_size);
+
+    Connection& conn = conns_[index];
+    conn.fd = fd;
+    conn.local_ip = local_addr.sin_addr.s_addr;
+    conn.requests = 0;
+    conn.size = 0;
+    conn.since_ms = millis();
+    conn.state = kIdle;
+    ++accepted_;
+    if (open + 1 > static_cast<int>(max_open_)) {
+      max_open_ = open + 1;
+    }
+  }
+}
+
+void Server::Read(int index) {
+  Connection& conn = conns_[index];
+  ssize_t n = recv(conn.fd, conn.buffer + conn.size,
+                   kMaxRequestSize - conn.size, MSG_DONTWAIT);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+    return;
+  }
+  if (n <= 0) {
+    // Closed by the client, or reset.
+    Close(index);
+    return;
+  }
+  if (conn.size == 0) {
+    conn.since_ms = millis();
+  }
+  conn.size += n;
+  if (RequestLength(conn.buffer, conn.size) != 0) {
+    conn.state = kBusy;
+    xQueueSend(ready_, &index, portMAX_DELAY);
+  }
+}
+
+void Server::ExpireIdle(unsigned long now_ms) {
+  for (int i = 0; i < kMaxConnections; ++i) {
+    const Connection& conn = conns_[i];
+    if (conn.state != kIdle) {
+      continue;
+    }
+    // Signed: a worker may have handed the connection back after now_ms.
+    const long idle_ms = static_cast<long>(now_ms - conn.since_ms);
+    if (conn.size > 0 && idle_ms > static_cast<long>(config_.request_timeout_ms)) {
+      ESP_LOGW(TAG, "Timed out waiting for a request, %u bytes so far",
+               static_cast<unsigned>(conn.size));
+      ++timeouts_;
+      Close(i);
+    } else if (conn.size == 0 &&
+               idle_ms > static_cast<long>(config_.idle_timeout_ms)) {
+      Close(i);
+    }
+  }
+}
+
+void Server::Close(int index) {
+  Connection& conn = conns_[index];
+  if (conn.fd >= 0) {
+    close(conn.fd);
+  }
+  conn.fd = -1;
+  conn.size = 0;
+  conn.state = kFree;
+}
+
+void Server::Work() {
+  for (;;) {
+    int index;
+    if (xQueueReceive(ready_, &index, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    Connection& conn = conns_[index];
+    if (Serve(&conn)) {
+      conn.since_ms = millis();
+      conn.state = kIdle;
+    } else {
+      Close(index);
+    }
+    Wake();
+  }
+}
+
+bool Server::Serve(Connection* conn) {
+  for (;;) {
+    const int length = RequestLength(conn->buffer, conn->size);
+    if (length == 0) {
+      return true;
+    }
+    Request request;
+    request.local_ip_ = conn->local_ip;
+    bool keep_alive = false;
+    if (length < 0 ||
+        !request.Parse(std::string_view(conn->buffer, length), &keep_alive)) {
+      ++errors_;
+      const int status = length < 0 ? -length : 400;
+      Response response(conn->fd, /*keep_alive=*/false, /*head=*/false,
+                        /*chunked=*/false);
+      SendStatus(&response, status, ReasonPhrase(status));
+      response.Finish();
+      return false;
+    }
+
+    ++requests_;
+    if (conn->requests++ > 0) {
+      ++reused_;
+    }
+    Response response(conn->fd, keep_alive, request.method() == "HEAD",
+                      /*chunked=*/!request.http_1_0_);
+    const uint32_t start_us = micros();
+    const Route* route = FindRoute(request.path());
+    if (route != nullptr) {
+      route->handler(request, &response, route->arg);
+    } else {
+      SendStatus(&response, 404, "not found");
+    }
+    const uint32_t handler_us = micros() - start_us;
+    if (handler_us > max_handler_us_) {
+      max_handler_us_ = handler_us;
+    }
+    if (response.detached_) {
+      // The socket is the handler's now.
+      conn->fd = -1;
+      return false;
+    }
+    if (!response.Finish()) {
+      ++errors_;
+      return false;
+    }
+    keep_alive = response.keep_alive_;
+    ESP_LOGD(TAG, "%.*s %.*s: %d in %u us",
+             static_cast<int>(request.method().size()), request.method().data(),
+             static_cast<int>(request.path().size()), request.path().data(),
+             response.status(), handler_us);
+
+    // Keep anything pipelined behind this request.
+    memmove(conn->buffer, conn->buffer + length, conn->size - length);
+    conn->size -= length;
+    if (!keep_alive) {
+      return false;
+    }
+  }
+}
+
+void Server::Wake() {
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(wake_port_);
+  const char kWake = 'w';
+  sendto(wake_fd_, &kWake, 1, MSG_DONTWAIT,
+         reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+}
+
+Stats Server::stats() const {
+  Stats stats;
+  stats.accepted = accepted_;
+  stats.purged = purged_;
+  stats.rejected = rejected_;
+  stats.requests = requests_;
+  stats.reused = reused_;
+  stats.timeouts = timeouts_;
+  stats.errors = errors_;
+  stats.max_open = max_open_;
+  stats.max_handler_us = max_handler_us_;
+  return stats;
+}
+
+void Server::LogStats() const {
+  const Stats s = stats();
+  ESP_LOGI(TAG,
+           "http_server: uptime: %s accepted: %u purged: %u rejected: %u"
+           " requests: %u reused: %u timeouts: %u errors: %u max_open: %u"
+           " max_handler_us: %u",
+           dump::MillisHumanReadable(millis()).c_str(), s.accepted, s.purged,
+           s.rejected, s.requests, s.reused, s.timeouts, s.errors, s.max_open,
+           s.max_handler_us);
+}
+
+}  // namespace http_server
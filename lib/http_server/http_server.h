@@ -0,0 +1,297 @@
+#ifndef _HTTP_SERVER_H_
+#define _HTTP_SERVER_H_
+
+// Event-driven HTTP/1.1 server on BSD sockets, for the status page, the
+// Prometheus metrics and the small command endpoints.
+//
+// One loop task select()s on the listening socket and every idle
+// connection, reads requests into a fixed per-connection buffer, and hands
+// each complete request to a small pool of worker tasks through a queue. A
+// worker owns the connection while it runs the route's handler and writes
+// the response, then returns it to the loop for the next request, so
+// connections are kept alive for scrapers and a slow client only ties up the
+// worker it landed on. Workers wake the loop through a UDP socket on
+// localhost, the same way esp_http_server does.
+
+#include <Print.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string_view>
+
+namespace http_server {
+
+// A complete request, parsed in place in its connection's buffer. Only
+// valid for the duration of the handler.
+class Request {
+ public:
+  std::string_view method() const { return method_; }
+  // Target up to the '?', e.g. "/varz".
+  std::string_view path() const { return path_; }
+  // Everything after the '?', not decoded; empty if there is none.
+  std::string_view query() const { return query_; }
+  std::string_view body() const { return body_; }
+  // The IPv4 address it came in on, in network order as IPAddress takes
+  // it, which tells the soft-AP's clients from the LAN's.
+  uint32_t local_ip() const { return local_ip_; }
+
+  // Value of the first header called name (case-insensitively), with
+  // surrounding whitespace trimmed; empty if absent.
+  std::string_view Header(const char* name) const;
+  // Value of key in the query string, not decoded. False if absent.
+  bool QueryParam(const char* key, std::string_view* value) const;
+  // The same for a posted form's body. False unless it is
+  // application/x-www-form-urlencoded.
+  bool FormParam(const char* key, std::string_view* value) const;
+  // Whether If-None-Match names etag, quotes included, so a 304 will do.
+  bool HasEtag(const char* etag) const;
+  // Whether Accept-Encoding allows coding, by name or "*", with a nonzero
+  // q-value.
+  bool AcceptsEncoding(const char* coding) const;
+
+ private:
+  friend class Server;
+
+  // Parses the complete request in data; keep_alive says whether the
+  // connection persists after it.
+  bool Parse(std::string_view data, bool* keep_alive);
+
+  std::string_view method_;
+  std::string_view path_;
+  std::string_view query_;
+  std::string_view headers_;
+  std::string_view body_;
+  uint32_t local_ip_ = 0;
+  bool http_1_0_ = false;
+};
+
+// Handlers print the body; the status line and headers are sent ahead of
+// the first chunk of it. A body that fits in the buffer goes out with a
+// Content-Length, anything longer with chunked transfer encoding, or for
+// HTTP/1.0 clients, up to the connection closing.
+class Response : public Print {
+ public:
+  static const size_t kBufferSize = 1024;
+
+  // These three only take effect before the first byte is sent.
+  void set_status(int status) { status_ = status; }
+  // Defaults to "text/plain; charset=utf-8".
+  void set_content_type(const char* content_type) {
+    content_type_ = content_type;
+  }
+  // Adds a header line; false if it doesn't fit or it's too late.
+  bool AddHeader(const char* name, const char* value);
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t size) override;
+
+  // Sends data as the whole body, with its Content-Length, straight from
+  // where it is rather than through the buffer. Only before anything else
+  // has been written; the response is complete after it.
+  bool SendBody(const void* data, size_t size);
+
+  // For bodies that outlive the handler, e.g. event streams: sends the
+  // headers, with the body running until the connection closes, and hands
+  // over the socket. The server forgets the connection; the caller must
+  // close() the socket. -1 if anything was written already or the headers
+  // didn't go out.
+  int Detach();
+
+  int status() const { return status_; }
+  // The client went away or stopped reading; further writes are dropped.
+  bool failed() const { return failed_; }
+
+ private:
+  friend class Server;
+
+  Response(int fd, bool keep_alive, bool head, bool chunked)
+      : fd_(fd), keep_alive_(keep_alive), head_(head), chunked_(chunked) {}
+
+  // Sends the headers and whatever is buffered, and ends the body.
+  bool Finish();
+  // A negative content_length means the body is still to come.
+  bool SendHeaders(int content_length, bool more);
+  // Sends the buffered body as one chunk.
+  bool FlushChunk();
+  bool Send(const void* data, size_t size, bool more);
+
+  const int fd_;
+  bool keep_alive_;
+  const bool head_;
+  // Whether the client takes chunked transfer encoding.
+  const bool chunked_;
+  int status_ = 200;
+  const char* content_type_ = "text/plain; charset=utf-8";
+  char extra_headers_[192] = {};
+  size_t extra_headers_size_ = 0;
+  bool headers_sent_ = false;
+  // SendBody() already sent everything.
+  bool complete_ = false;
+  // Detach() handed the socket over.
+  bool detached_ = false;
+  bool failed_ = false;
+  size_t size_ = 0;
+  // The body starts kChunkHeadroom bytes in, leaving room to put a chunk's
+  // size line in front of it and its CRLF behind it, so a chunk goes out in
+  // one send().
+  static const size_t kChunkHeadroom = 8;
+  uint8_t buffer_[kChunkHeadroom + kBufferSize + 2];
+};
+
+// Handlers run on a worker task and may block briefly, e.g. on a sensor
+// topic, but every request they hold up waits for a free worker.
+typedef void (*Handler)(const Request& request, Response* response,
+                        void* arg);
+
+struct Config {
+  uint16_t port = 80;
+  int workers = 2;
+  uint32_t worker_stack_size = 10240;
+  uint32_t loop_stack_size = 4096;
+  UBaseType_t priority = 1;
+  // Keep-alive connections idle for longer are closed.
+  uint32_t idle_timeout_ms = 60 * 1000;
+  // A connection that started a request must finish it within this long.
+  uint32_t request_timeout_ms = 5000;
+  // A worker gives up on a client that stops reading the response.
+  uint32_t send_timeout_ms = 5000;
+};
+
+struct Stats {
+  uint32_t accepted;
+  // Idle connections closed to make room for a new one.
+  uint32_t purged;
+  // Connections turned away with a 503 because every slot was busy.
+  uint32_t rejected;
+  uint32_t requests;
+  // Requests after the first on their connection.
+  uint32_t reused;
+  // Connections that started a request and didn't finish it in time.
+  uint32_t timeouts;
+  // Malformed or oversized requests, and responses cut short.
+  uint32_t errors;
+  uint32_t max_open;
+  uint32_t max_handler_us;
+};
+
+class Server {
+ public:
+  static const int kMaxRoutes = 16;
+  static const int kMaxConnections = 6;
+  static const int kMaxWorkers = 4;
+  // Request line, headers and body together.
+  static const size_t kMaxRequestSize = 1536;
+
+  Server() = default;
+  Server(const Server&) = delete;
+  Server& operator=(const Server&) = delete;
+
+  // Routes match the path exactly, in the order they were added; "*"
+  // matches any path. Unrouted paths get a 404. Call before Start().
+  bool AddRoute(const char* path, Handler handler, void* arg = nullptr);
+
+  // Listens and starts the loop and worker tasks. Call once.
+  bool Start(const Config& config);
+  bool running() const { return running_; }
+
+  Stats stats() const;
+  void LogStats() const;
+
+ private:
+  struct Route {
+    const char* path;
+    Handler handler;
+    void* arg;
+  };
+
+  enum State : uint8_t { kFree, kIdle, kBusy };
+
+  struct Connection {
+    int fd;
+    std::atomic<uint8_t> state;
+    // Requests served on this connection so far.
+    uint32_t requests;
+    // When the current request started arriving, or the connection last
+    // went idle.
+    unsigned long since_ms;
+    // Our end's address, for Request::local_ip().
+    uint32_t local_ip;
+    size_t size;
+    char buffer[kMaxRequestSize];
+  };
+
+  static void LoopTask(void* server);
+  static void WorkerTask(void* server);
+  void Loop();
+  void Work();
+
+  void Accept();
+  void Read(int index);
+  void ExpireIdle(unsigned long now_ms);
+  void Close(int index);
+  // Runs every complete request buffered on the connection; false if the
+  // connection should be closed.
+  bool Serve(Connection* conn);
+  // Wakes the loop after a worker is done with a connection.
+  void Wake();
+
+  const Route* FindRoute(std::string_view path) const;
+
+  Config config_;
+  Route routes_[kMaxRoutes] = {};
+  int route_count_ = 0;
+  bool running_ = false;
+  int listen_fd_ = -1;
+  int wake_fd_ = -1;
+  uint16_t wake_port_ = 0;
+  QueueHandle_t ready_ = nullptr;
+  Connection conns_[kMaxConnections] = {};
+
+  std::atomic<uint32_t> accepted_{0};
+  std::atomic<uint32_t> purged_{0};
+  std::atomic<uint32_t> rejected_{0};
+  std::atomic<uint32_t> requests_{0};
+  std::atomic<uint32_t> reused_{0};
+  std::atomic<uint32_t> timeouts_{0};
+  std::atomic<uint32_t> errors_{0};
+  std::atomic<uint32_t> max_open_{0};
+  std::atomic<uint32_t> max_handler_us_{0};
+};
+
+// Sets the status and makes message the whole plain text body, e.g. for
+// errors.
+void SendStatus(Response* response, int status, const char* message);
+
+// Decodes a query or form value into out, NUL-terminated: '+' to a space,
+// and %XX escapes. False if it doesn't fit or an escape is malformed.
+bool UrlDecode(std::string_view encoded, char* out, size_t size);
+// Parses a decimal number of digits only, no sign or spaces. False if
+// there are none, anything else, or it doesn't fit.
+bool ParseUint(std::string_view text, uint32_t* value);
+
+// Prints into a fixed buffer, noting when it runs out of room; for bodies
+// rendered ahead of sending them.
+class BufferPrint : public Print {
+ public:
+  BufferPrint(uint8_t* data, size_t capacity)
+      : data_(data), capacity_(capacity) {}
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t size) override;
+
+  size_t size() const { return size_; }
+  bool overflow() const { return overflow_; }
+
+ private:
+  uint8_t* const data_;
+  const size_t capacity_;
+  size_t size_ = 0;
+  bool overflow_ = false;
+};
+
+}  // namespace http_server
+
+#endif  // _HTTP_SERVER_H_
@@ -0,0 +1,151 @@
+#include "response_cache.h"
+
+#include <esp_log.h>
+#include <esp_system.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace http_server {
+namespace {
+const char TAG[] = "response_cache";
+}  // namespace
+
+ResponseCache::ResponseCache(const char* content_type, size_t capacity,
+                             RenderFn render, void* arg)
+    : content_type_(content_type),
+      capacity_(capacity),
+      render_(render),
+      arg_(arg),
+      nonce_(esp_random()),
+      render_mutex_(xSemaphoreCreateMutex()) {
+  for (Slot& slot : slots_) {
+    slot.data = static_cast<uint8_t*>(malloc(capacity_));
+    if (slot.data == nullptr) {
+      ESP_LOGE(TAG, "ResponseCache(): can't allocate %u bytes",
+               static_cast<unsigned>(capacity_));
+    }
+  }
+}
+
+ResponseCache::~ResponseCache() {
+  for (Slot& slot : slots_) {
+    free(slot.data);
+  }
+  vSemaphoreDelete(render_mutex_);
+}
+
+void ResponseCache::Serve(const Request& request, Response* response,
+                          uint32_t version) {
+  response->set_content_type(content_type_);
+  Slot* slot = Acquire(version);
+  if (slot != nullptr) {
+    ++hits_;
+  } else if (!TooBig(version)) {
+    // Only one render per version, however many requests are waiting on it.
+    xSemaphoreTake(render_mutex_, portMAX_DELAY);
+    slot = Acquire(version);
+    if (slot != nullptr) {
+      ++hits_;
+    } else if (!TooBig(version)) {
+      slot = Render(version);
+    }
+    xSemaphoreGive(render_mutex_);
+  }
+
+  if (slot == nullptr) {
+    ++uncached_;
+    render_(response, arg_);
+    return;
+  }
+  response->AddHeader("ETag", slot->etag);
+  // Let browsers keep a copy, but ask first.
+  response->AddHeader("Cache-Control", "no-cache");
+  if (request.HasEtag(slot->etag)) {
+    ++not_modified_;
+    response->set_status(304);
+    response->SendBody(nullptr, 0);
+  } else {
+    response->SendBody(slot->data, slot->size);
+  }
+  Release(slot);
+}
+
+ResponseCache::Slot* ResponseCache::Acquire(uint32_t version) {
+  Slot* slot = nullptr;
+  portENTER_CRITICAL(&mux_);
+  if (current_ >= 0 && slots_[current_].version == version) {
+    slot = &slots_[current_];
+    ++slot->users;
+  }
+  portEXIT_CRITICAL(&mux_);
+  return slot;
+}
+
+ResponseCache::Slot* ResponseCache::Render(uint32_t version) {
+  Slot* slot = nullptr;
+  portENTER_CRITICAL(&mux_);
+  for (int i = 0; i < kSlots; ++i) {
+    if (i != current_ && slots_[i].users == 0 && slots_[i].data != nullptr) {
+      slot = &slots_[i];
+      // Claimed for rendering; nobody else picks it while users > 0.
+      slot->users = 1;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&mux_);
+  if (slot == nullptr) {
+    return nullptr;
+  }
+
+  BufferPrint out(slot->data, capacity_);
+  render_(&out, arg_);
+  ++renders_;
+  if (out.size() > max_size_) {
+    max_size_ = out.size();
+  }
+  if (out.overflow()) {
+    ESP_LOGW(TAG, "Render(): body is over %u bytes; not caching it",
+             static_cast<unsigned>(capacity_));
+    portENTER_CRITICAL(&mux_);
+    --slot->users;
+    too_big_ = true;
+    too_big_version_ = version;
+    portEXIT_CRITICAL(&mux_);
+    return nullptr;
+  }
+  slot->size = out.size();
+  slot->version = version;
+  snprintf(slot->etag, sizeof(slot->etag), "\"%08x-%x\"",
+           static_cast<unsigned>(nonce_), static_cast<unsigned>(version));
+
+  portENTER_CRITICAL(&mux_);
+  current_ = slot - slots_;
+  portEXIT_CRITICAL(&mux_);
+  return slot;
+}
+
+bool ResponseCache::TooBig(uint32_t version) {
+  portENTER_CRITICAL(&mux_);
+  const bool too_big = too_big_ && too_big_version_ == version;
+  portEXIT_CRITICAL(&mux_);
+  return too_big;
+}
+
+void ResponseCache::Release(Slot* slot) {
+  portENTER_CRITICAL(&mux_);
+  --slot->users;
+  portEXIT_CRITICAL(&mux_);
+}
+
+ResponseCache::Stats ResponseCache::stats() const {
+  Stats stats;
+  stats.hits = hits_;
+  stats.renders = renders_;
+  stats.not_modified = not_modified_;
+  stats.uncached = uncached_;
+  stats.max_size = max_size_;
+  return stats;
+}
+
+}  // namespace http_server
@@ -0,0 +1,95 @@
+#ifndef _RESPONSE_CACHE_H_
+#define _RESPONSE_CACHE_H_
+
+// A rendered response body kept around until the data behind it changes,
+// so repeated requests cost a send() from a preallocated buffer instead of a
+// render. Callers pass a version that changes whenever the body would; the
+// body is rendered the first time a request sees a new version.
+//
+// Each body goes out with an ETag, and a request whose If-None-Match names
+// the current one gets a 304. ETags carry a per-boot nonce, so a version
+// seen before a reboot never matches one after it.
+//
+// Two buffers are enough for one render to go on while other workers are
+// still sending the previous body; if both are in use, or a body outgrows
+// its buffer, the request is rendered straight into the response instead.
+// A version that outgrew its buffer once isn't tried again.
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "http_server.h"
+
+namespace http_server {
+
+class ResponseCache {
+ public:
+  typedef void (*RenderFn)(Print* out, void* arg);
+
+  // capacity is the largest body that can be cached, per buffer.
+  ResponseCache(const char* content_type, size_t capacity, RenderFn render,
+                void* arg);
+  ~ResponseCache();
+  ResponseCache(const ResponseCache&) = delete;
+  ResponseCache& operator=(const ResponseCache&) = delete;
+
+  void Serve(const Request& request, Response* response, uint32_t version);
+
+  struct Stats {
+    uint32_t hits;
+    uint32_t renders;
+    uint32_t not_modified;
+    // Requests rendered into the response because no buffer was free or
+    // the body didn't fit.
+    uint32_t uncached;
+    uint32_t max_size;
+  };
+  Stats stats() const;
+
+ private:
+  static const int kSlots = 2;
+
+  struct Slot {
+    uint8_t* data;
+    size_t size;
+    uint32_t version;
+    char etag[24];
+    // Requests sending from this slot, or 1 while it is being rendered.
+    int users;
+  };
+
+  // The current slot, with a user added, if it holds version.
+  Slot* Acquire(uint32_t version);
+  // Renders version into a free slot and makes it current; the slot comes
+  // back with a user added. Null if no slot is free or the body didn't fit.
+  Slot* Render(uint32_t version);
+  // Whether version's body was already found not to fit.
+  bool TooBig(uint32_t version);
+  void Release(Slot* slot);
+
+  const char* const content_type_;
+  const size_t capacity_;
+  const RenderFn render_;
+  void* const arg_;
+  const uint32_t nonce_;
+  SemaphoreHandle_t render_mutex_;
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+  Slot slots_[kSlots] = {};
+  int current_ = -1;
+  bool too_big_ = false;
+  uint32_t too_big_version_ = 0;
+
+  std::atomic<uint32_t> hits_{0};
+  std::atomic<uint32_t> renders_{0};
+  std::atomic<uint32_t> not_modified_{0};
+  std::atomic<uint32_t> uncached_{0};
+  std::atomic<uint32_t> max_size_{0};
+};
+
+}  // namespace http_server
+
+#endif  // _RESPONSE_CACHE_H_
@@ -0,0 +1,330 @@
+#include "i2c_bus.h"
+
+#include <Arduino.h>
+#include <dump.h>
+#include <esp_log.h>
+
+namespace i2c_bus {
+namespace {
+const char TAG[] = "i2c_bus";
+
+// How long the bus task sleeps between stats checks when idle.
+const TickType_t kIdleTicks = 10000 / portTICK_PERIOD_MS;
+const unsigned long kStatsPeriodMs = 10 * 60 * 1000;
+// A transaction for the device already on the bus (and at its clock) may
+// jump ahead of one for another device whose deadline is this much sooner.
+const TickType_t kBatchWindowTicks =
+    std::max<TickType_t>(1, 20 / portTICK_PERIOD_MS);
+// Half an SCL period while clocking out a stuck device, ~100 kHz.
+const uint32_t kRecoveryHalfPeriodUs = 5;
+
+// Signed distance between tick counts, safe across wrap-around.
+int32_t TicksAfter(TickType_t a, TickType_t b) {
+  return static_cast<int32_t>(a - b);
+}
+
+}  // namespace
+
+const char* StatusName(Status status) {
+  switch (status) {
+    case Status::kOk:
+      return "ok";
+    case Status::kNack:
+      return "nack";
+    case Status::kBusError:
+      return "bus error";
+    case Status::kDeadlineMissed:
+      return "deadline missed";
+    case Status::kRejected:
+      return "rejected";
+  }
+  return "unknown";
+}
+
+bool Bus::Begin(uint32_t clock_hz) {
+  current_clock_hz_ = clock_hz;
+  if (!wire_->begin(sda_pin_, scl_pin_, clock_hz)) {
+    ESP_LOGE(TAG, "Begin(): TwoWire::begin() failed, trying recovery");
+    Recover();
+  }
+  return !BusStuck();
+}
+
+int Bus::AddDevice(const char* name, uint8_t address, uint32_t clock_hz) {
+  if (device_count_ >= kMaxDevices) {
+    ESP_LOGE(TAG, "AddDevice(): no room for %s", name);
+    return -1;
+  }
+  Device& device = devices_[device_count_];
+  device.name = name;
+  device.address = address;
+  device.clock_hz = clock_hz;
+  device.stats = {};
+  ESP_LOGI(TAG, "AddDevice(): %s at 0x%02x, %u Hz", name, address, clock_hz);
+  return device_count_++;
+}
+
+bool Bus::Start(UBaseType_t priority) {
+  queue_ = xQueueCreate(kMaxPending, sizeof(Transaction*));
+  if (queue_ == nullptr) {
+    ESP_LOGE(TAG, "Start(): xQueueCreate() failed");
+    return false;
+  }
+  if (xTaskCreate(Task, "i2c_bus", /*stack_size=*/3 * 1024, /*param=*/this,
+                  priority, /*handle=*/nullptr) != pdPASS) {
+    ESP_LOGE(TAG, "Start(): xTaskCreate() failed");
+    return false;
+  }
+  return true;
+}
+
+Status Bus::Write(int device, const uint8_t* data, size_t size,
+                  uint32_t deadline_ms, Priority priority) {
+  Transaction t = {};
+  t.device = device;
+  t.priority = priority;
+  t.tx = data;
+  t.tx_size = size;
+  return Submit(&t, deadline_ms);
+}
+
+Status Bus::Read(int device, uint8_t* data, size_t size, uint32_t deadline_ms,
+                 Priority priority) {
+  Transaction t = {};
+  t.device = device;
+  t.priority = priority;
+  t.rx = data;
+  t.rx_size = size;
+  return Submit(&t, deadline_ms);
+}
+
+Status Bus::WriteRead(int device, const uint8_t* tx, size_t tx_size,
+                      uint8_t* rx, size_t rx_size, uint32_t deadline_ms,
+                      Priority priority) {
+  Transaction t = {};
+  t.device = device;
+  t.priority = priority;
+  t.tx = tx;
+  t.tx_size = tx_size;
+  t.rx = rx;
+  t.rx_size = rx_size;
+  return Submit(&t, deadline_ms);
+}
+
+Status Bus::Run(int device, Callback callback, void* arg,
+                uint32_t deadline_ms, Priority priority) {
+  Transaction t = {};
+  t.device = device;
+  t.priority = priority;
+  t.callback = callback;
+  t.arg = arg;
+  return Submit(&t, deadline_ms);
+}
+
+Status Bus::Submit(Transaction* t, uint32_t deadline_ms) {
+  if (queue_ == nullptr || t->device < 0 || t->device >= device_count_) {
+    return Status::kRejected;
+  }
+  TickType_t deadline_ticks =
+      std::max<TickType_t>(1, deadline_ms / portTICK_PERIOD_MS);
+  t->waiter = xTaskGetCurrentTaskHandle();
+  t->submit_ticks = xTaskGetTickCount();
+  t->deadline_ticks = t->submit_ticks + deadline_ticks;
+  t->submit_us = micros();
+  if (xQueueSend(queue_, &t, deadline_ticks) != pdTRUE) {
+    ESP_LOGW(TAG, "Submit(): queue full for %s", devices_[t->device].name);
+    return Status::kRejected;
+  }
+  // The bus task completes every transaction it accepts, late ones included,
+  // so t stays valid until we are notified.
+  ulTaskNotifyTake(/*clear_on_exit=*/pdTRUE, portMAX_DELAY);
+  return t->status;
+}
+
+void Bus::Task(void* bus) {
+  reinterpret_cast<Bus*>(bus)->Loop();
+  vTaskDelete(NULL);
+}
+
+void Bus::Loop() {
+  unsigned long last_print_time_ms = millis();
+  for (;;) {
+    // Drain everything queued so the scheduler can choose among it, but only
+    // block when there is nothing left to run.
+    Transaction* t = nullptr;
+    TickType_t wait = pending_count_ ? 0 : kIdleTicks;
+    while (pending_count_ < kMaxPending &&
+           xQueueReceive(queue_, &t, wait) == pdTRUE) {
+      pending_[pending_count_++] = t;
+      wait = 0;
+    }
+
+    if (pending_count_ > 0) {
+      int next = PickNext();
+      t = pending_[next];
+      pending_[next] = pending_[--pending_count_];
+      Execute(t);
+    }
+
+    if (millis() - last_print_time_ms >= kStatsPeriodMs) {
+      last_print_time_ms = millis();
+      LogStats();
+    }
+  }
+}
+
+int Bus::PickNext() const {
+  // Highest priority first, then earliest deadline. Sticking with the current
+  // device batches its transfers without changing the clock in between.
+  auto effective_deadline = [this](const Transaction* t) {
+    return t->device == current_device_ ? t->deadline_ticks
+                                        : t->deadline_ticks + kBatchWindowTicks;
+  };
+  int best = 0;
+  for (int i = 1; i < pending_count_; ++i) {
+    const Transaction* a = pending_[i];
+    const Transaction* b = pending_[best];
+    if (a->priority != b->priority) {
+      if (a->priority > b->priority) {
+        best = i;
+      }
+      continue;
+    }
+    if (TicksAfter(effective_deadline(b), effective_deadline(a)) > 0) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+void Bus::Execute(Transaction* t) {
+  Device& device = devices_[t->device];
+  uint32_t bus_us = 0;
+  if (TicksAfter(xTaskGetTickCount(), t->deadline_ticks) > 0) {
+    t->status = Status::kDeadlineMissed;
+    ++device.stats.deadline_misses;
+  } else {
+    if (device.clock_hz != current_clock_hz_) {
+      wire_->setClock(device.clock_hz);
+      current_clock_hz_ = device.clock_hz;
+    }
+    current_device_ = t->device;
+
+    uint32_t start_us = micros();
+    t->status = Transfer(t);
+    bus_us = micros() - start_us;
+
+    if (t->status != Status::kOk) {
+      ++device.stats.errors;
+      ESP_LOGW(TAG, "Execute(): %s: %s", device.name, StatusName(t->status));
+      if (t->status == Status::kBusError && BusStuck()) {
+        Recover();
+      }
+    }
+  }
+
+  uint32_t latency_us = micros() - t->submit_us;
+  ++device.stats.transactions;
+  device.stats.total_latency_us += latency_us;
+  device.stats.total_bus_us += bus_us;
+  if (latency_us > device.stats.max_latency_us) {
+    device.stats.max_latency_us = latency_us;
+  }
+
+  // t lives on the waiter's stack; don't touch it after this.
+  xTaskNotifyGive(t->waiter);
+}
+
+Status Bus::Transfer(Transaction* t) {
+  uint16_t address = devices_[t->device].address;
+  if (t->callback != nullptr) {
+    return t->callback(wire_, t->arg) ? Status::kOk : Status::kBusError;
+  }
+
+  if (t->tx_size > 0) {
+    wire_->beginTransmission(address);
+    wire_->write(t->tx, t->tx_size);
+    // Keep the bus with a repeated start if a read follows.
+    uint8_t err = wire_->endTransmission(/*sendStop=*/t->rx_size == 0);
+    if (err == 2 || err == 3) {
+      return Status::kNack;
+    }
+    if (err != 0) {
+      return Status::kBusError;
+    }
+  }
+
+  if (t->rx_size > 0) {
+    size_t got = wire_->requestFrom(address, static_cast<uint8_t>(t->rx_size),
+                                    /*sendStop=*/true);
+    if (got == 0) {
+      return Status::kNack;
+    }
+    if (got != t->rx_size) {
+      // Don't leave stale bytes for the next transaction.
+      while (wire_->available()) {
+        wire_->read();
+      }
+      return Status::kBusError;
+    }
+    wire_->readBytes(t->rx, t->rx_size);
+  }
+  return Status::kOk;
+}
+
+bool Bus::BusStuck() {
+  // Both lines idle high; a device stuck mid-byte holds SDA low.
+  return digitalRead(sda_pin_) == LOW || digitalRead(scl_pin_) == LOW;
+}
+
+void Bus::Recover() {
+  ++recoveries_;
+  ESP_LOGW(TAG, "Recover(): bus stuck (sda: %d scl: %d), clocking it out",
+           digitalRead(sda_pin_), digitalRead(scl_pin_));
+  wire_->end();
+
+  // Clock SCL until the device holding SDA low finishes its byte (at most
+  // nine clocks), then issue a STOP.
+  pinMode(sda_pin_, INPUT_PULLUP);
+  pinMode(scl_pin_, OUTPUT_OPEN_DRAIN);
+  digitalWrite(scl_pin_, HIGH);
+  for (int i = 0; i < 9 && digitalRead(sda_pin_) == LOW; ++i) {
+    digitalWrite(scl_pin_, LOW);
+    delayMicroseconds(kRecoveryHalfPeriodUs);
+    digitalWrite(scl_pin_, HIGH);
+    delayMicroseconds(kRecoveryHalfPeriodUs);
+  }
+  pinMode(sda_pin_, OUTPUT_OPEN_DRAIN);
+  digitalWrite(sda_pin_, LOW);
+  delayMicroseconds(kRecoveryHalfPeriodUs);
+  digitalWrite(scl_pin_, HIGH);
+  delayMicroseconds(kRecoveryHalfPeriodUs);
+  digitalWrite(sda_pin_, HIGH);
+  delayMicroseconds(kRecoveryHalfPeriodUs);
+
+  wire_->begin(sda_pin_, scl_pin_, current_clock_hz_);
+  if (BusStuck()) {
+    ESP_LOGE(TAG, "Recover(): bus still stuck");
+  }
+}
+
+void Bus::LogStats() const {
+  ESP_LOGI(TAG, "i2c_bus: uptime: %s stackHighWater: %d recoveries: %u",
+           dump::MillisHumanReadable(millis()).c_str(),
+           uxTaskGetStackHighWaterMark(nullptr), recoveries_);
+  for (int i = 0; i < device_count_; ++i) {
+    const Device& device = devices_[i];
+    const DeviceStats& stats = device.stats;
+    uint32_t n = std::max<uint32_t>(1, stats.transactions);
+    ESP_LOGI(TAG,
+             "  %s (0x%02x @ %u Hz): transactions: %u errors: %u"
+             " deadline_misses: %u latency_us avg: %u max: %u bus_us avg: %u",
+             device.name, device.address, device.clock_hz, stats.transactions,
+             stats.errors, stats.deadline_misses,
+             static_cast<uint32_t>(stats.total_latency_us / n),
+             stats.max_latency_us,
+             static_cast<uint32_t>(stats.total_bus_us / n));
+  }
+}
+
+}  // namespace i2c_bus
@@ -0,0 +1,145 @@
+#ifndef _I2C_BUS_H_
+#define _I2C_BUS_H_
+
+// Single owner of an I2C bus. Drivers queue transactions instead of sharing
+// TwoWire behind a mutex; the bus task runs them one at a time, most urgent
+// first, switching the bus clock per device and recovering a bus that a
+// device holds low.
+
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+namespace i2c_bus {
+
+enum class Priority : uint8_t {
+  kLow = 0,
+  kNormal,
+  kHigh,
+};
+
+enum class Status : uint8_t {
+  kOk = 0,
+  // The device did not acknowledge its address or data.
+  kNack,
+  // Short read, bus timeout or arbitration loss.
+  kBusError,
+  // The transaction's deadline passed before the bus got to it.
+  kDeadlineMissed,
+  // Bad device id, or the queue stayed full.
+  kRejected,
+};
+
+const char* StatusName(Status status);
+
+// Runs arbitrary TwoWire code as one transaction, for third party drivers
+// that want the TwoWire object themselves.
+typedef bool (*Callback)(TwoWire* wire, void* arg);
+
+struct DeviceStats {
+  uint32_t transactions;
+  uint32_t errors;
+  uint32_t deadline_misses;
+  // Submit to completion, i.e. including time spent queued.
+  uint32_t max_latency_us;
+  uint64_t total_latency_us;
+  // Time the transactions held the bus.
+  uint64_t total_bus_us;
+};
+
+struct Device {
+  const char* name;
+  uint8_t address;
+  // Fastest clock the device is reliable at.
+  uint32_t clock_hz;
+  DeviceStats stats;
+};
+
+class Bus {
+ public:
+  static const int kMaxDevices = 8;
+  static const int kMaxPending = 8;
+
+  Bus(TwoWire* wire, int sda_pin, int scl_pin)
+      : wire_(wire), sda_pin_(sda_pin), scl_pin_(scl_pin) {}
+  Bus(const Bus&) = delete;
+  Bus& operator=(const Bus&) = delete;
+
+  // Brings up the bus. Until Start() is called the wire may be used directly,
+  // e.g. for scanning from setup().
+  bool Begin(uint32_t clock_hz);
+
+  // Registers a device and returns its id, or -1 if the table is full. Call
+  // before Start().
+  int AddDevice(const char* name, uint8_t address, uint32_t clock_hz);
+
+  // Starts the task that owns the bus from here on.
+  bool Start(UBaseType_t priority);
+
+  // Blocking transfers. deadline_ms bounds how long the transaction may wait
+  // for the bus; transactions past their deadline fail without touching the
+  // bus.
+  Status Write(int device, const uint8_t* data, size_t size,
+               uint32_t deadline_ms, Priority priority = Priority::kNormal);
+  Status Read(int device, uint8_t* data, size_t size, uint32_t deadline_ms,
+              Priority priority = Priority::kNormal);
+  // Write then read with a repeated start, e.g. to read registers.
+  Status WriteRead(int device, const uint8_t* tx, size_t tx_size, uint8_t* rx,
+                   size_t rx_size, uint32_t deadline_ms,
+                   Priority priority = Priority::kNormal);
+  Status Run(int device, Callback callback, void* arg, uint32_t deadline_ms,
+             Priority priority = Priority::kNormal);
+
+  int device_count() const { return device_count_; }
+  const Device& device(int id) const { return devices_[id]; }
+  uint32_t recoveries() const { return recoveries_; }
+
+  void LogStats() const;
+
+ private:
+  struct Transaction {
+    int device;
+    Priority priority;
+    TickType_t submit_ticks;
+    TickType_t deadline_ticks;
+    uint32_t submit_us;
+    const uint8_t* tx;
+    size_t tx_size;
+    uint8_t* rx;
+    size_t rx_size;
+    Callback callback;
+    void* arg;
+    TaskHandle_t waiter;
+    Status status;
+  };
+
+  static void Task(void* bus);
+
+  Status Submit(Transaction* t, uint32_t deadline_ms);
+  void Loop();
+  // Index into pending_ of the transaction to run next.
+  int PickNext() const;
+  void Execute(Transaction* t);
+  Status Transfer(Transaction* t);
+  bool BusStuck();
+  void Recover();
+
+  TwoWire* const wire_;
+  const int sda_pin_;
+  const int scl_pin_;
+  uint32_t current_clock_hz_ = 0;
+  int current_device_ = -1;
+  uint32_t recoveries_ = 0;
+
+  QueueHandle_t queue_ = nullptr;
+  Transaction* pending_[kMaxPending] = {};
+  int pending_count_ = 0;
+
+  Device devices_[kMaxDevices] = {};
+  int device_count_ = 0;
+};
+
+}  // namespace i2c_bus
+
+#endif  // _I2C_BUS_H_
@@ -0,0 +1,242 @@
+#include "metrics.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace metrics {
+namespace {
+
+const char kHexDigits[] = "0123456789abcdef";
+
+// The labels with everything but the escaped strings at their longest.
+static_assert(sizeof(Labels::common) >=
+                  sizeof("mac_address=\"00:00:00:00:00:00\","
+                         "ip_address=\"255.255.255.255\",hostname=\"\",") +
+                      2 * (sizeof(Identity::hostname) - 1),
+              "Labels::common can't hold the longest hostname");
+static_assert(sizeof(Labels::wifi) >=
+                  sizeof("ssid=\"\",bssid=\"00:00:00:00:00:00\","
+                         "channel=\"255\"") +
+                      2 * (sizeof(Identity::ssid) - 1),
+              "Labels::wifi can't hold the longest SSID");
+
+bool SameIdentity(const Identity& a, const Identity& b) {
+  return memcmp(a.mac, b.mac, sizeof(a.mac)) == 0 && a.ip == b.ip &&
+         strcmp(a.hostname, b.hostname) == 0 && strcmp(a.ssid, b.ssid) == 0 &&
+         memcmp(a.bssid, b.bssid, sizeof(a.bssid)) == 0 &&
+         a.channel == b.channel;
+}
+
+size_t FormatUint(uint64_t value, char* buf) {
+  char digits[20];
+  size_t n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+  for (size_t i = 0; i < n; ++i) {
+    buf[i] = digits[n - 1 - i];
+  }
+  buf[n] = '\0';
+  return n;
+}
+
+// Appends to a fixed buffer, dropping whatever doesn't fit.
+class Appender {
+ public:
+  Appender(char* buf, size_t size) : buf_(buf), size_(size) { buf_[0] = '\0'; }
+
+  void Append(const char* s) {
+    while (*s != '\0') {
+      Char(*s++);
+    }
+  }
+  void Char(char c) {
+    if (used_ + 1 < size_) {
+      buf_[used_++] = c;
+      buf_[used_] = '\0';
+    }
+  }
+  // A label value, escaped the way the exposition format wants.
+  void Quoted(const char* s) {
+    Char('"');
+    for (; *s != '\0'; ++s) {
+      if (*s == '\\' || *s == '"') {
+        Char('\\');
+        Char(*s);
+      } else if (*s == '\n') {
+        Append("\\n");
+      } else {
+        Char(*s);
+      }
+    }
+    Char('"');
+  }
+  // Lower case and colon separated.
+  void Mac(const uint8_t* mac) {
+    for (int i = 0; i < 6; ++i) {
+      if (i > 0) {
+        Char(':');
+      }
+      Char(kHexDigits[mac[i] >> 4]);
+      Char(kHexDigits[mac[i] & 0xf]);
+    }
+  }
+  void Uint(uint64_t value) {
+    char digits[kMaxNumberSize];
+    FormatUint(value, digits);
+    Append(digits);
+  }
+
+ private:
+  char* const buf_;
+  const size_t size_;
+  size_t used_ = 0;
+};
+
+}  // namespace
+
+size_t FormatInt(int64_t value, char* buf) {
+  if (value < 0) {
+    buf[0] = '-';
+    // Negate as unsigned so INT64_MIN survives.
+    return 1 + FormatUint(-static_cast<uint64_t>(value), buf + 1);
+  }
+  return FormatUint(value, buf);
+}
+
+size_t FormatFixed(double value, int digits, char* buf) {
+  if (isnan(value)) {
+    strcpy(buf, "NaN");
+    return 3;
+  }
+  if (isinf(value)) {
+    strcpy(buf, value > 0 ? "+Inf" : "-Inf");
+    return 4;
+  }
+  digits = std::max(0, std::min(digits, 6));
+  uint32_t scale = 1;
+  for (int i = 0; i < digits; ++i) {
+    scale *= 10;
+  }
+  const double scaled = fabs(value) * scale + 0.5;
+  if (scaled >= 1e18) {
+    // Beyond what fits in the integer below; no sensor gets here.
+    return snprintf(buf, kMaxNumberSize, "%.*e", digits, value);
+  }
+  const uint64_t units = static_cast<uint64_t>(scaled);
+  size_t n = 0;
+  if (value < 0 && units != 0) {
+    buf[n++] = '-';
+  }
+  n += FormatUint(units / scale, buf + n);
+  if (digits > 0) {
+    buf[n++] = '.';
+    uint32_t fraction = units % scale;
+    for (int i = digits - 1; i >= 0; --i) {
+      buf[n + i] = '0' + fraction % 10;
+      fraction /= 10;
+    }
+    n += digits;
+    buf[n] = '\0';
+  }
+  return n;
+}
+
+void RenderLabels(const Identity& identity, Labels* labels) {
+  Appender common(labels->common, sizeof(labels->common));
+  common.Append("mac_address=\"");
+  common.Mac(identity.mac);
+  common.Append("\",ip_address=\"");
+  for (int i = 0; i < 4; ++i) {
+    if (i > 0) {
+      common.Char('.');
+    }
+    common.Uint((identity.ip >> (8 * i)) & 0xff);
+  }
+  common.Append("\",hostname=");
+  common.Quoted(identity.hostname);
+  common.Char(',');
+
+  Appender wifi(labels->wifi, sizeof(labels->wifi));
+  wifi.Append("ssid=");
+  wifi.Quoted(identity.ssid);
+  wifi.Append(",bssid=\"");
+  static const uint8_t kNoBssid[6] = {};
+  if (memcmp(identity.bssid, kNoBssid, sizeof(kNoBssid)) != 0) {
+    wifi.Mac(identity.bssid);
+  }
+  wifi.Append("\",channel=\"");
+  wifi.Uint(identity.channel);
+  wifi.Char('"');
+}
+
+void LabelCache::Get(const Identity& identity, Labels* labels) {
+  portENTER_CRITICAL(&mux_);
+  const bool hit = valid_ && SameIdentity(identity_, identity);
+  if (hit) {
+    *labels = labels_;
+  }
+  portEXIT_CRITICAL(&mux_);
+  if (hit) {
+    return;
+  }
+
+  // Render outside the critical section; it's rare, and not that quick.
+  RenderLabels(identity, labels);
+  portENTER_CRITICAL(&mux_);
+  identity_ = identity;
+  labels_ = *labels;
+  valid_ = true;
+  ++renders_;
+  portEXIT_CRITICAL(&mux_);
+}
+
+void Writer::Int(const char* name, const char* labels, int64_t value) {
+  Begin(name, labels);
+  char number[kMaxNumberSize];
+  Append(number, FormatInt(value, number));
+  Append("\n", 1);
+}
+
+void Writer::Fixed(const char* name, const char* labels, double value) {
+  Begin(name, labels);
+  char number[kMaxNumberSize];
+  Append(number, FormatFixed(value, 2, number));
+  Append("\n", 1);
+}
+
+void Writer::Begin(const char* name, const char* labels) {
+  Append(name);
+  Append("{", 1);
+  Append(common_labels_);
+  Append(labels);
+  Append("} ", 2);
+}
+
+void Writer::Append(const char* s) { Append(s, strlen(s)); }
+
+void Writer::Append(const char* data, size_t size) {
+  while (size > 0) {
+    if (size_ == kBufferSize) {
+      Flush();
+    }
+    const size_t n = std::min(size, kBufferSize - size_);
+    memcpy(buffer_ + size_, data, n);
+    size_ += n;
+    data += n;
+    size -= n;
+  }
+}
+
+void Writer::Flush() {
+  if (size_ > 0) {
+    out_->write(reinterpret_cast<const uint8_t*>(buffer_), size_);
+    size_ = 0;
+  }
+}
+
+}  // namespace metrics
@@ -0,0 +1,104 @@
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+// Prometheus text exposition without the heap.
+//
+// Writer appends metric lines into a fixed buffer and hands it to the output
+// a buffer at a time. Numbers are formatted in place. LabelCache renders the
+// labels that start every line (MAC, IP, hostname) and the WiFi ones only
+// when the network identity changes; a scrape just copies them.
+
+#include <Print.h>
+#include <freertos/FreeRTOS.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace metrics {
+
+// What the cached labels are made of.
+struct Identity {
+  uint8_t mac[6];
+  // As IPAddress converts to it: first octet in the low byte.
+  uint32_t ip;
+  // As long as DNS allows a label.
+  char hostname[64];
+  // Empty, and the BSSID all zero, while not associated.
+  char ssid[33];
+  uint8_t bssid[6];
+  uint8_t channel;
+};
+
+// Big enough for the longest hostname and SSID with every character
+// escaped, so neither is ever cut short.
+struct Labels {
+  // mac_address="...",ip_address="...",hostname="...", with the trailing
+  // comma, ready for more labels to follow.
+  char common[208];
+  // ssid="...",bssid="...",channel="..."
+  char wifi[128];
+};
+
+class LabelCache {
+ public:
+  // Copies out the labels for identity, rendering them first if identity
+  // changed since the last call. Safe to call from several tasks.
+  void Get(const Identity& identity, Labels* labels);
+
+  // Times the labels were rendered.
+  uint32_t renders() const { return renders_; }
+
+ private:
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+  bool valid_ = false;
+  Identity identity_ = {};
+  Labels labels_ = {};
+  uint32_t renders_ = 0;
+};
+
+// Renders the labels for identity, uncached.
+void RenderLabels(const Identity& identity, Labels* labels);
+
+// Longest number FormatInt() or FormatFixed() writes, with its terminator.
+const size_t kMaxNumberSize = 32;
+
+// Formats value into buf, which must hold kMaxNumberSize bytes; returns the
+// length.
+size_t FormatInt(int64_t value, char* buf);
+// With digits (at most 6) decimal places, rounded half away from zero, like
+// Arduino's String(double, digits). NaN and infinities come out the way
+// Prometheus spells them.
+size_t FormatFixed(double value, int digits, char* buf);
+
+class Writer {
+ public:
+  static const size_t kBufferSize = 1024;
+
+  // common_labels starts every line's label set; see Labels::common.
+  Writer(Print* out, const char* common_labels)
+      : out_(out), common_labels_(common_labels) {}
+  ~Writer() { Flush(); }
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  // One line each: name{<common labels><labels>} value
+  void Int(const char* name, const char* labels, int64_t value);
+  // Two decimal places.
+  void Fixed(const char* name, const char* labels, double value);
+
+  // Hands whatever is buffered to the output.
+  void Flush();
+
+ private:
+  void Begin(const char* name, const char* labels);
+  void Append(const char* data, size_t size);
+  void Append(const char* s);
+
+  Print* const out_;
+  const char* const common_labels_;
+  size_t size_ = 0;
+  char buffer_[kBufferSize];
+};
+
+}  // namespace metrics
+
+#endif  // _METRICS_H_
@@ -1,157 +1,236 @@
 #include "mhz19.h"
 
+#include <esp_log.h>
+#include <string.h>
+
 #include "Arduino.h"
 #include "dump.h"
 
 namespace mhz19 {
-
-uint8_t Checksum(uint8_t* buf, int size) {
-  int8_t sum = 0;
-  // Skip first byte (0xff) and last byte (checksum)
-  for (int i = 1; i < size - 1; ++i) {
-    sum += buf[i];
-  }
-  return 0xff - sum + 1;
+namespace {
+const char TAG[] = "mhz19";
+const int kRequestQueueSize = 4;
+// A response takes ~10 ms at 9600 baud; anything not back by now is lost.
+const unsigned long kResponseTimeoutMs = 1000;
+
+struct CommandInfo {
+  const char* name;
+  uint8_t cmd;
+  // Calibration commands are not acknowledged.
+  bool has_response;
+};
+
+// Indexed by Command.
+const CommandInfo kCommands[] = {
+    {"read_co2", 0x86, true},        {"abc_on", 0x79, true},
+    {"abc_off", 0x79, true},         {"zero_calibrate", 0x87, false},
+    {"span_calibrate", 0x88, false}, {"set_range", 0x99, true},
+};
+
+const CommandInfo& Info(Command command) {
+  return kCommands[static_cast<int>(command)];
 }
 
-bool ReadPacket(Stream* serial, uint8_t* buffer, int size, uint8_t cmd,
-                unsigned long timeout_ms) {
-  unsigned long start_ms = millis();
-
-  while (serial->available() < size) {
-    if (millis() - start_ms > timeout_ms) {
-      Serial.print("ERROR: MH-Z19 timed out waiting for response");
-      Serial.print("ERROR: MH-Z19 expect 9 bytes available, have: ");
-      Serial.println(serial->available());
-      return false;
-    }
-    delay(10);
+void Publish(TaskData* data, unsigned long cycle_ms) {
+  if (data->topic != nullptr) {
+    data->topic->Publish(data->data, cycle_ms);
   }
+}
 
-  if (serial->readBytes(buffer, size) != size) {
-    Serial.print("ERROR: MH-Z19: didn't read enough bytes\n");
+bool Send(TaskData* data, const Request& request, unsigned long cycle_ms) {
+  uint8_t frame[kFrameSize];
+  BuildFrame(request, frame);
+  // 9 bytes always fit in the UART's TX FIFO, so this doesn't block.
+  size_t written = data->serial->write(frame, sizeof(frame));
+  if (written != sizeof(frame)) {
+    ESP_LOGE(TAG, "Send(%s): wrote %d bytes", CommandName(request.command),
+             static_cast<int>(written));
     return false;
   }
+  ++data->stats.requests;
+  data->current = request;
+  data->sent_ms = cycle_ms;
+  data->busy = Info(request.command).has_response;
+  return true;
+}
 
-  if (buffer[0] != 0xff || buffer[1] != cmd ||
-      buffer[size - 1] != Checksum(buffer, size)) {
-    Serial.print("ERROR: MH-Z19: invalid response\n");
+void HandleResponse(TaskData* data, unsigned long cycle_ms) {
+  const uint8_t* rx = data->rx;
+  if (!data->busy || rx[1] != Info(data->current.command).cmd) {
+    ++data->stats.unexpected;
+    ESP_LOGW(TAG, "HandleResponse(): unexpected response to 0x%02x", rx[1]);
+    return;
+  }
+  ++data->stats.responses;
+  data->busy = false;
+  if (data->current.command == Command::kReadCo2) {
+    data->data.co2_ppm = (rx[2] << 8) | rx[3];
+    data->data.temp_c = rx[4] - 40;
+    Publish(data, cycle_ms);
+    return;
+  }
+  ESP_LOGI(TAG, "%s(%u): done", CommandName(data->current.command),
+           data->current.arg);
+}
 
-    Serial.print("  Raw: ");
-    for (int i = 0; i < size; ++i) {
-      Serial.print(buffer[i], HEX);
-      Serial.print(" ");
+// Feeds everything buffered through the frame assembler without waiting for
+// more. Frames start with 0xff; after a bad checksum we resync on the next
+// 0xff inside the rejected frame.
+void DrainSerial(TaskData* data, unsigned long cycle_ms) {
+  while (data->serial->available() > 0) {
+    int c = data->serial->read();
+    if (c < 0) {
+      break;
+    }
+    if (data->rx_size == 0 && c != 0xff) {
+      ++data->stats.skipped_bytes;
+      continue;
+    }
+    data->rx[data->rx_size++] = c;
+    if (data->rx_size < kFrameSize) {
+      continue;
     }
-    Serial.println();
 
-    Serial.print("Expected Checksum: ");
-    Serial.println(Checksum(buffer, size), HEX);
-    return false;
+    if (data->rx[kFrameSize - 1] == Checksum(data->rx, kFrameSize)) {
+      data->rx_size = 0;
+      HandleResponse(data, cycle_ms);
+      continue;
+    }
+    ++data->stats.bad_checksum;
+    int start = 1;
+    while (start < kFrameSize && data->rx[start] != 0xff) {
+      ++start;
+    }
+    data->stats.skipped_bytes += start;
+    data->rx_size = kFrameSize - start;
+    memmove(data->rx, data->rx + start, data->rx_size);
   }
-
-  return true;
 }
 
-bool SetAutoBackgroundCalibration(Stream* serial, bool abc_on,
-                                  unsigned long timeout_ms) {
-  unsigned long start_ms = millis();
+}  // namespace
 
-  while (serial->available()) {
-    Serial.print("WARNING: MH-Z19 ABC wtf byte: ");
-    Serial.println(serial->read(), HEX);
-  }
+const char* CommandName(Command command) { return Info(command).name; }
 
-  uint8_t buffer[9] = {
-      0xff, 0x01, 0x79, static_cast<uint8_t>(abc_on ? 0xa0 : 0x00), 0x00, 0x00,
-      0x00, 0x00, 0x00};
-  buffer[8] = Checksum(buffer, sizeof(buffer));
-  for (int written = 0; written < sizeof(buffer);) {
-    written += serial->write(buffer + written, sizeof(buffer) - written);
-    if (millis() - start_ms > timeout_ms) {
-      Serial.print("ERROR: MH-Z19: ABC timed out writing command\n");
-      return false;
+bool ParseCommand(const char* name, Command* command) {
+  for (size_t i = 0; i < sizeof(kCommands) / sizeof(kCommands[0]); ++i) {
+    if (strcmp(name, kCommands[i].name) == 0) {
+      *command = static_cast<Command>(i);
+      return true;
     }
   }
+  return false;
+}
 
-  unsigned long elapsed = millis() - start_ms;
-  if (timeout_ms > elapsed) {
-    timeout_ms = timeout_ms - elapsed;
-  } else {
-    timeout_ms = 0;
-  }
-  return ReadPacket(serial, buffer, sizeof(buffer), buffer[2], timeout_ms);
+bool TakesArg(Command command) {
+  return command == Command::kSpanCalibrate || command == Command::kSetRange;
 }
 
-bool Read(Stream* serial, TaskData* data, unsigned long timeout_ms) {
-  unsigned long start_ms = millis();
+bool ValidArg(Command command, uint32_t arg) {
+  switch (command) {
+    case Command::kSpanCalibrate:
+      return arg >= kMinSpanPpm && arg <= kMaxSpanPpm;
+    case Command::kSetRange:
+      return arg == 2000 || arg == 5000;
+    default:
+      return true;
+  }
+}
 
-  while (serial->available()) {
-    Serial.print("WARNING: MH-Z19 Read wtf byte: ");
-    Serial.println(static_cast<uint8_t>(serial->read()), HEX);
+uint8_t Checksum(uint8_t* buf, int size) {
+  int8_t sum = 0;
+  // Skip first byte (0xff) and last byte (checksum)
+  for (int i = 1; i < size - 1; ++i) {
+    sum += buf[i];
   }
+  return 0xff - sum + 1;
+}
 
-  uint8_t buffer[9] = {0xff, 0x01, 0x86, 0x00, 0x00, 0x00, 0x00, 0x00, 0x79};
-  for (int written = 0; written < sizeof(buffer);) {
-    written += serial->write(buffer + written, sizeof(buffer) - written);
-    if (millis() - start_ms > timeout_ms) {
-      Serial.print("ERROR: MH-Z19 Read timed out writing command\n");
-      return false;
-    }
+void BuildFrame(const Request& request, uint8_t (&frame)[kFrameSize]) {
+  memset(frame, 0, kFrameSize);
+  frame[0] = 0xff;
+  frame[1] = 0x01;
+  frame[2] = Info(request.command).cmd;
+  switch (request.command) {
+    case Command::kAbcOn:
+      frame[3] = 0xa0;
+      break;
+    case Command::kSpanCalibrate:
+      frame[3] = request.arg >> 8;
+      frame[4] = request.arg & 0xff;
+      break;
+    case Command::kSetRange:
+      frame[6] = request.arg >> 8;
+      frame[7] = request.arg & 0xff;
+      break;
+    default:
+      break;
   }
+  frame[kFrameSize - 1] = Checksum(frame, kFrameSize);
+}
 
-  if (!ReadPacket(serial, buffer, sizeof(buffer), buffer[2], timeout_ms)) {
-    Serial.print("ERROR: MH-Z19: error reading packet\n");
+bool Init(TaskData* data, Stream* serial) {
+  data->serial = serial;
+  data->requests = xQueueCreate(kRequestQueueSize, sizeof(Request));
+  if (data->requests == nullptr) {
+    ESP_LOGE(TAG, "Init(): failed to create request queue");
     return false;
   }
+  // Whatever the sensor sent before we were listening is noise.
+  while (serial->available() > 0) {
+    serial->read();
+  }
+  return true;
+}
 
-  data->co2_ppm = (buffer[2] << 8) | buffer[3];
-  data->temp_c = buffer[4] - 40;
-
+bool Submit(TaskData* data, Command command, uint16_t arg) {
+  Request request = {command, arg};
+  if (xQueueSend(data->requests, &request, /*ticks_to_wait=*/0) != pdTRUE) {
+    ++data->stats.dropped;
+    ESP_LOGW(TAG, "Submit(%s): queue full", CommandName(command));
+    return false;
+  }
   return true;
 }
 
-void TaskPoll(void* task_data_param) {
+void Poll(void* task_data_param, unsigned long cycle_ms) {
   auto* task_data = reinterpret_cast<TaskData*>(task_data_param);
 
-  unsigned long last_print_time_ms = 0;
-  for (;;) {
-    if (!mhz19::Read(task_data->serial, task_data, /*timeout_ms=*/5000)) {
-      Serial.print("ERROR: failed to read MHZ-19c sensor");
-      delay(1000);
-      continue;
+  DrainSerial(task_data, cycle_ms);
+  if (task_data->busy) {
+    if (cycle_ms - task_data->sent_ms < kResponseTimeoutMs) {
+      return;
     }
-
-    if ((millis() - last_print_time_ms) < 10 * 60 * 1000 &&
-        last_print_time_ms) {
-      delay(2000);
-      continue;
-    }
-    last_print_time_ms = millis();
-
-    Serial.print("PollMhz19(): core: ");
-    Serial.println(xPortGetCoreID());
-    Serial.print("MH-Z19c Results: ");
-    /*
-    long now_ms = millis();
-    if (last_read_time_ms != -1) {
-        Serial.print("  [Elapsed: ");
-        Serial.print(now_ms - last_read_time_ms);
-        Serial.print(" ms]\n");
-    }
-    last_read_time_ms = now_ms;
-    */
-    Serial.print("  CO2: ");
-    Serial.print(task_data->co2_ppm);
-    Serial.print("ppm");
-    Serial.print("  Temp: ");
-    Serial.print(task_data->temp_c);
-    Serial.print(" °C ");
-    Serial.print(dump::CToF(task_data->temp_c));
-    Serial.print(" °F\n");
-    delay(2000);
+    ++task_data->stats.timeouts;
+    ESP_LOGW(TAG, "Poll(): %s timed out",
+             CommandName(task_data->current.command));
+    task_data->busy = false;
+    task_data->rx_size = 0;
   }
 
-  vTaskDelete(NULL);
+  Request request = {Command::kReadCo2, 0};
+  xQueueReceive(task_data->requests, &request, /*ticks_to_wait=*/0);
+  Send(task_data, request, cycle_ms);
+}
+
+void LogStatus(void* task_data_param, unsigned long cycle_ms) {
+  auto* task_data = reinterpret_cast<TaskData*>(task_data_param);
+  const auto& stats = task_data->stats;
+  ESP_LOGI(TAG,
+           "mhz19::LogStatus(): uptime: %s requests: %u responses: %u"
+           " timeouts: %u bad_checksum: %u unexpected: %u skipped_bytes: %u"
+           " dropped: %u",
+           dump::MillisHumanReadable(cycle_ms).c_str(), stats.requests,
+           stats.responses, stats.timeouts, stats.bad_checksum,
+           stats.unexpected, stats.skipped_bytes, stats.dropped);
+  Serial.print("MH-Z19c Results: ");
+  Serial.print("  CO2: ");
+  Serial.print(task_data->data.co2_ppm);
+  Serial.print("ppm");
+  Serial.print("  Temp: ");
+  Serial.print(task_data->data.temp_c);
+  Serial.print(" °C ");
+  Serial.print(dump::CToF(task_data->data.temp_c));
+  Serial.print(" °F\n");
 }
 
 }  // namespace mhz19
@@ -2,26 +2,105 @@
 #define MHZ19_H
 
 /**
+ * Non-blocking driver for the MH-Z19 CO2 sensor. Commands are queued from any
+ * task and sent one at a time by Poll(), which also collects the responses;
+ * nothing ever waits on the UART.
  */
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
 #include "Stream.h"
+#include "sensor_bus.h"
 
 namespace mhz19 {
 
-struct TaskData {
-  Stream* serial;
+const int kFrameSize = 9;
+
+enum class Command : uint8_t {
+  kReadCo2 = 0,
+  kAbcOn,
+  kAbcOff,
+  // Calibrates the current reading as 400 ppm. Leave the sensor in fresh air
+  // for 20 minutes first.
+  kZeroCalibrate,
+  // Calibrates the current reading as arg ppm.
+  kSpanCalibrate,
+  // Sets the detection range to arg ppm, e.g. 2000 or 5000.
+  kSetRange,
+};
 
+// Span gas concentrations the sensor calibrates against, in ppm.
+const uint16_t kMinSpanPpm = 1000;
+const uint16_t kMaxSpanPpm = 5000;
+
+const char* CommandName(Command command);
+// Inverse of CommandName().
+bool ParseCommand(const char* name, Command* command);
+// Whether command takes an arg, and whether arg is one it accepts: a span
+// between kMinSpanPpm and kMaxSpanPpm, or a range of 2000 or 5000. The rest
+// ignore it.
+bool TakesArg(Command command);
+bool ValidArg(Command command, uint32_t arg);
+
+struct Request {
+  Command command;
+  uint16_t arg;
+};
+
+struct Data {
   uint16_t co2_ppm;
   int8_t temp_c;
 };
 
+struct Stats {
+  uint32_t requests;
+  uint32_t responses;
+  uint32_t timeouts;
+  uint32_t bad_checksum;
+  // Responses to a command that wasn't in flight.
+  uint32_t unexpected;
+  uint32_t skipped_bytes;
+  // Requests dropped because the queue was full.
+  uint32_t dropped;
+};
+
+struct TaskData {
+  Stream* serial;
+  QueueHandle_t requests;
+
+  // The command in flight, if any.
+  bool busy;
+  Request current;
+  unsigned long sent_ms;
+
+  // Response bytes so far.
+  uint8_t rx[kFrameSize];
+  int rx_size;
+  Stats stats;
+
+  // Owned by Poll(); everyone else reads snapshots from topic.
+  Data data;
+  sensor_bus::Topic<Data>* topic;
+};
+
 uint8_t Checksum(uint8_t* buf, int size);
 
-bool SetAutoBackgroundCalibration(Stream* serial, bool abc_on,
-                                  unsigned long timeout_ms = 5000);
+// Fills in the 9 byte command frame for request.
+void BuildFrame(const Request& request, uint8_t (&frame)[kFrameSize]);
+
+// Creates the request queue. serial must already be open.
+bool Init(TaskData* data, Stream* serial);
 
-bool Read(Stream* serial, TaskData* data, unsigned long timeout_ms = 5000);
+// Queues a command for Poll() to send. Safe to call from any task; returns
+// false if the queue is full.
+bool Submit(TaskData* data, Command command, uint16_t arg = 0);
 
-void TaskPoll(void* task_data_param);
+// Scheduler jobs (see scheduler::JobFn); task_data is a TaskData*. Each Poll()
+// handles whatever response arrived since the last one, then sends the next
+// queued command, or a CO2 read if nothing is queued. Readings are therefore
+// published one period after they are requested.
+void Poll(void* task_data, unsigned long cycle_ms);
+void LogStatus(void* task_data, unsigned long cycle_ms);
 
 }  // namespace mhz19
 
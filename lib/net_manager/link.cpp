@@ -0,0 +1,279 @@
+#include "link.h"
+
+#include <algorithm>
+
+namespace net_manager {
+
+const char* StateName(LinkState state) {
+  switch (state) {
+    case LinkState::kIdle:
+      return "idle";
+    case LinkState::kConnecting:
+      return "connecting";
+    case LinkState::kAssociated:
+      return "associated";
+    case LinkState::kOnline:
+      return "online";
+    case LinkState::kBackoff:
+      return "backoff";
+    case LinkState::kPortal:
+      return "portal";
+  }
+  return "unknown";
+}
+
+void Link::Init() {
+  group_ = xEventGroupCreate();
+  mutex_ = xSemaphoreCreateMutex();
+}
+
+void Link::Start(unsigned long now_ms, bool have_network) {
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  Restart(now_ms, have_network);
+  xSemaphoreGive(mutex_);
+}
+
+void Link::Provision(unsigned long now_ms) {
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  provisioning_ = true;
+  leave_pending_ = true;
+  Restart(now_ms, /*have_network=*/true);
+  xSemaphoreGive(mutex_);
+}
+
+void Link::SetFastConnect(bool available) {
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  fast_available_ = available;
+  xSemaphoreGive(mutex_);
+}
+
+void Link::Handle(LinkEvent event, unsigned long now_ms, uint8_t reason) {
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  switch (event) {
+    case LinkEvent::kAssociated:
+      leave_pending_ = false;
+      if (state_ == LinkState::kConnecting) {
+        SetState(LinkState::kAssociated);
+      }
+      break;
+    case LinkEvent::kGotIp:
+      leave_pending_ = false;
+      if (state_ != LinkState::kOnline) {
+        if (stats_.connects == 0) {
+          stats_.boot_connect_ms = now_ms;
+        } else {
+          stats_.last_reconnect_ms = now_ms - down_ms_;
+          stats_.max_reconnect_ms =
+              std::max(stats_.max_reconnect_ms, stats_.last_reconnect_ms);
+        }
+        if (attempt_fast_) {
+          ++stats_.fast_connects;
+        }
+        if (provisioning_) {
+          ++stats_.provisions;
+          stats_.last_provision_ms = now_ms - portal_start_ms_;
+        }
+        provisioning_ = false;
+        in_portal_session_ = false;
+        attempt_fast_ = false;
+        fast_ok_ = true;
+        ++stats_.connects;
+        stats_.last_connect_ms = now_ms - attempt_start_ms_;
+        stats_.max_connect_ms =
+            std::max(stats_.max_connect_ms, stats_.last_connect_ms);
+        failures_in_row_ = 0;
+        backoff_ms_ = kMinBackoffMs;
+        SetState(LinkState::kOnline);
+      }
+      break;
+    case LinkEvent::kLostIp:
+      if (state_ == LinkState::kOnline) {
+        // Still associated; DHCP gets another kConnectTimeoutMs.
+        GoDown(now_ms);
+        attempt_start_ms_ = now_ms;
+        SetState(LinkState::kAssociated);
+      }
+      break;
+    case LinkEvent::kDisconnected:
+      if (leave_pending_ && reason == kReasonAssocLeave) {
+        // From kDisconnect or Provision(), not the attempt since.
+        leave_pending_ = false;
+        break;
+      }
+      stats_.last_reason = reason;
+      CountReason(reason);
+      if (state_ == LinkState::kOnline) {
+        GoDown(now_ms);
+        // Straight back, as the AP is likely still there.
+        retry_ms_ = now_ms;
+        SetState(LinkState::kBackoff);
+      } else if (state_ == LinkState::kConnecting ||
+                 state_ == LinkState::kAssociated) {
+        Fail(now_ms);
+      }
+      break;
+  }
+  xSemaphoreGive(mutex_);
+}
+
+Action Link::Poll(unsigned long now_ms) {
+  Action action = Action::kNone;
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  if ((state_ == LinkState::kConnecting ||
+       state_ == LinkState::kAssociated) &&
+      now_ms - attempt_start_ms_ >= TimeoutMs()) {
+    // The driver may still be at it; stop it before the next attempt.
+    Fail(now_ms);
+    leave_pending_ = true;
+    action = Action::kDisconnect;
+  } else if (state_ == LinkState::kBackoff &&
+             static_cast<long>(now_ms - retry_ms_) >= 0) {
+    attempt_start_ms_ = now_ms;
+    attempt_fast_ = fast_available_ && fast_ok_;
+    SetState(LinkState::kConnecting);
+    action = attempt_fast_ ? Action::kFastConnect : Action::kConnect;
+  } else if (state_ == LinkState::kPortal && portal_due_) {
+    portal_due_ = false;
+    action = Action::kStartPortal;
+  }
+  xSemaphoreGive(mutex_);
+  return action;
+}
+
+unsigned long Link::NextPollMs(unsigned long now_ms) {
+  // Often enough to notice a portal being left, or the clock wrapping.
+  unsigned long wait_ms = kMaxBackoffMs;
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  if (state_ == LinkState::kPortal && portal_due_) {
+    wait_ms = 0;
+  } else if (state_ == LinkState::kBackoff) {
+    wait_ms = static_cast<long>(retry_ms_ - now_ms) > 0 ? retry_ms_ - now_ms
+                                                        : 0;
+  } else if (state_ == LinkState::kConnecting ||
+             state_ == LinkState::kAssociated) {
+    const unsigned long elapsed_ms = now_ms - attempt_start_ms_;
+    const unsigned long timeout_ms = TimeoutMs();
+    wait_ms = elapsed_ms < timeout_ms ? timeout_ms - elapsed_ms : 0;
+  }
+  xSemaphoreGive(mutex_);
+  return wait_ms;
+}
+
+LinkState Link::state() {
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  const LinkState state = state_;
+  xSemaphoreGive(mutex_);
+  return state;
+}
+
+LinkStats Link::stats() {
+  if (mutex_ == nullptr) {
+    return stats_;
+  }
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  LinkStats stats = stats_;
+  stats.state = state_;
+  xSemaphoreGive(mutex_);
+  return stats;
+}
+
+EventBits_t Link::WaitOnline(TickType_t timeout_ticks) {
+  return xEventGroupWaitBits(group_, kOnlineBit, /*clear_on_exit=*/pdFALSE,
+                             /*wait_for_all_bits=*/pdFALSE, timeout_ticks) &
+         kOnlineBit;
+}
+
+EventBits_t Link::WaitChanged(TickType_t timeout_ticks) {
+  return xEventGroupWaitBits(group_, kChangedBit, /*clear_on_exit=*/pdTRUE,
+                             /*wait_for_all_bits=*/pdFALSE, timeout_ticks) &
+         kChangedBit;
+}
+
+void Link::Wake() { xEventGroupSetBits(group_, kChangedBit); }
+
+void Link::Restart(unsigned long now_ms, bool have_network) {
+  failures_in_row_ = 0;
+  backoff_ms_ = kMinBackoffMs;
+  fast_ok_ = true;
+  attempt_fast_ = false;
+  if (have_network) {
+    retry_ms_ = now_ms;
+    SetState(LinkState::kBackoff);
+  } else {
+    EnterPortal(now_ms);
+  }
+}
+
+void Link::SetState(LinkState state) {
+  state_ = state;
+  if (state == LinkState::kOnline) {
+    xEventGroupSetBits(group_, kOnlineBit | kChangedBit);
+  } else {
+    xEventGroupClearBits(group_, kOnlineBit);
+    xEventGroupSetBits(group_, kChangedBit);
+  }
+}
+
+void Link::Fail(unsigned long now_ms) {
+  ++stats_.failures;
+  if (attempt_fast_) {
+    // The cache is stale; scan straight away, without counting towards
+    // the portal.
+    ++stats_.fast_failures;
+    attempt_fast_ = false;
+    fast_ok_ = false;
+    retry_ms_ = now_ms;
+    SetState(LinkState::kBackoff);
+    return;
+  }
+  if (++failures_in_row_ >= kPortalAfterFailures) {
+    failures_in_row_ = 0;
+    EnterPortal(now_ms);
+    return;
+  }
+  retry_ms_ = now_ms + backoff_ms_;
+  backoff_ms_ =
+      backoff_ms_ < kMaxBackoffMs / 2 ? backoff_ms_ * 2 : kMaxBackoffMs;
+  SetState(LinkState::kBackoff);
+}
+
+void Link::CountReason(uint8_t reason) {
+  const int kOther = LinkStats::kMaxReasons - 1;
+  for (int i = 0; i < kOther; ++i) {
+    DisconnectCount& entry = stats_.reasons[i];
+    if (entry.count == 0) {
+      entry.reason = reason;
+    }
+    if (entry.reason == reason) {
+      ++entry.count;
+      return;
+    }
+  }
+  stats_.reasons[kOther].reason = 0;
+  ++stats_.reasons[kOther].count;
+}
+
+void Link::GoDown(unsigned long now_ms) {
+  ++stats_.disconnects;
+  down_ms_ = now_ms;
+}
+
+void Link::EnterPortal(unsigned long now_ms) {
+  // Whatever was provisioned didn't work.
+  provisioning_ = false;
+  if (!in_portal_session_) {
+    in_portal_session_ = true;
+    portal_start_ms_ = now_ms;
+    ++stats_.portal_sessions;
+  }
+  portal_due_ = true;
+  SetState(LinkState::kPortal);
+}
+
+unsigned long Link::TimeoutMs() const {
+  return attempt_fast_ && state_ == LinkState::kConnecting
+             ? kFastConnectTimeoutMs
+             : kConnectTimeoutMs;
+}
+
+}  // namespace net_manager
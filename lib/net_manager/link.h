@@ -0,0 +1,201 @@
+#ifndef _LINK_H_
+#define _LINK_H_
+
+// The station's connection to the access point, as a state machine fed the
+// IDF's WiFi and IP events:
+//
+//   kBackoff --retry due--> kConnecting --associated--> kAssociated
+//   kAssociated --got IP--> kOnline
+//   kOnline --lost IP--> kAssociated
+//   any --disconnected, or no IP within kConnectTimeoutMs--> kBackoff
+//   kBackoff --kPortalAfterFailures failures in a row--> kPortal
+//
+// Only the Link starts connecting; the driver's auto-reconnect is off. An
+// attempt that times out is called off with a disconnect, whose event is
+// not taken for the next attempt failing.
+//
+// With a cached AP (SetFastConnect()), the first attempt after each start
+// or drop goes straight to it without scanning; if that fails the next one
+// scans all channels, as does every attempt until it is online again.
+//
+// Whether it is online shows in an event group, so tasks that need the
+// network block on it instead of polling WiFi.isConnected(). The Link does
+// no I/O itself: Poll() says what to do next, so tests can drive it with
+// made up events and times.
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+
+namespace net_manager {
+
+enum LinkBits : EventBits_t {
+  // Associated and holding an IP.
+  kOnlineBit = 1 << 0,
+  // Set on every change of state; whoever drives the Link waits on it.
+  kChangedBit = 1 << 1,
+};
+
+enum class LinkState : uint8_t {
+  kIdle = 0,
+  kConnecting,
+  kAssociated,
+  kOnline,
+  kBackoff,
+  // Waiting for a network to be set up.
+  kPortal,
+};
+
+const char* StateName(LinkState state);
+
+enum class LinkEvent : uint8_t {
+  kAssociated,
+  kGotIp,
+  kLostIp,
+  kDisconnected,
+};
+
+// What Poll() wants done.
+enum class Action : uint8_t {
+  kNone,
+  // Start connecting to the saved network, scanning all channels.
+  kConnect,
+  // Start connecting to the cached AP on its channel, without a scan.
+  kFastConnect,
+  // Start the captive portal, if it isn't up. Call Start() again once it
+  // has a network.
+  kStartPortal,
+  // Disconnect the station, calling off an attempt that timed out.
+  kDisconnect,
+};
+
+// wifi_err_reason_t's WIFI_REASON_ASSOC_LEAVE: the station disconnected
+// itself.
+const uint8_t kReasonAssocLeave = 8;
+
+struct DisconnectCount {
+  // wifi_err_reason_t, or 0 for the rest.
+  uint8_t reason;
+  uint32_t count;
+};
+
+struct LinkStats {
+  static const int kMaxReasons = 8;
+
+  LinkState state;
+  // Times it got online, and went down again after.
+  uint32_t connects;
+  uint32_t disconnects;
+  // Attempts that never got online, fast ones included.
+  uint32_t failures;
+  // Fast attempts that got online, and that didn't.
+  uint32_t fast_connects;
+  uint32_t fast_failures;
+  // From starting to connect until an IP, for the last connect, and the
+  // slowest.
+  uint32_t last_connect_ms;
+  uint32_t max_connect_ms;
+  // Uptime when it first got online.
+  uint32_t boot_connect_ms;
+  // From going down until online again, for the last time, and the slowest.
+  uint32_t last_reconnect_ms;
+  uint32_t max_reconnect_ms;
+  // Times the portal was entered, and left online with a network set up in
+  // it, with how long it took from entering until online the last time.
+  uint32_t portal_sessions;
+  uint32_t provisions;
+  uint32_t last_provision_ms;
+  // Reason of the latest disconnect event.
+  uint8_t last_reason;
+  // Disconnect events by reason: the first kMaxReasons - 1 reasons seen,
+  // then the rest together. Unused slots have a count of 0.
+  DisconnectCount reasons[kMaxReasons];
+};
+
+// Handle(), Start() and Poll() may come from different tasks, as do the
+// readers.
+class Link {
+ public:
+  static const unsigned long kConnectTimeoutMs = 20 * 1000;
+  // To associate on a fast attempt; the AP answers within a beacon or two
+  // if it is still there.
+  static const unsigned long kFastConnectTimeoutMs = 3 * 1000;
+  static const unsigned long kMinBackoffMs = 1000;
+  static const unsigned long kMaxBackoffMs = 60 * 1000;
+  static const int kPortalAfterFailures = 5;
+
+  Link() = default;
+  Link(const Link&) = delete;
+  Link& operator=(const Link&) = delete;
+
+  // Creates the event group and lock; call before anything else.
+  void Init();
+
+  // Connects straight away, or goes to the portal if there is no saved
+  // network.
+  void Start(unsigned long now_ms, bool have_network);
+  // Starts over with a network set up from the portal; call before
+  // disconnecting the station from the last one, whose event then isn't
+  // taken for a failure. Getting online after counts as a provision.
+  void Provision(unsigned long now_ms);
+  // Whether there is a cached AP to try first.
+  void SetFastConnect(bool available);
+  void Handle(LinkEvent event, unsigned long now_ms, uint8_t reason = 0);
+  // Moves on timeouts and backoffs as of now_ms, returning what to do.
+  Action Poll(unsigned long now_ms);
+  // How long Poll() can wait, unless something happens first.
+  unsigned long NextPollMs(unsigned long now_ms);
+
+  LinkState state();
+  // All zero before Init().
+  LinkStats stats();
+  bool online() {
+    return group_ != nullptr && (xEventGroupGetBits(group_) & kOnlineBit);
+  }
+  // Block until bits are set or the timeout expires; the bits that were.
+  EventBits_t WaitOnline(TickType_t timeout_ticks);
+  EventBits_t WaitChanged(TickType_t timeout_ticks);
+  // Wakes WaitChanged() without a change, for news from elsewhere.
+  void Wake();
+
+ private:
+  // These take the lock held.
+  void Restart(unsigned long now_ms, bool have_network);
+  void SetState(LinkState state);
+  void Fail(unsigned long now_ms);
+  void CountReason(uint8_t reason);
+  void GoDown(unsigned long now_ms);
+  void EnterPortal(unsigned long now_ms);
+  unsigned long TimeoutMs() const;
+
+  EventGroupHandle_t group_ = nullptr;
+  SemaphoreHandle_t mutex_ = nullptr;
+  LinkState state_ = LinkState::kIdle;
+  // When the current attempt started, or the next one is due.
+  unsigned long attempt_start_ms_ = 0;
+  unsigned long retry_ms_ = 0;
+  unsigned long backoff_ms_ = kMinBackoffMs;
+  int failures_in_row_ = 0;
+  bool portal_due_ = false;
+  bool fast_available_ = false;
+  // Until a fast attempt fails; back on once online again.
+  bool fast_ok_ = true;
+  bool attempt_fast_ = false;
+  // Since kDisconnect or Provision(), until its event arrives or the next
+  // attempt gets somewhere without one.
+  bool leave_pending_ = false;
+  // When it last went down from kOnline.
+  unsigned long down_ms_ = 0;
+  // From entering the portal until online; a retry that ends up back in
+  // the portal is the same session.
+  bool in_portal_session_ = false;
+  unsigned long portal_start_ms_ = 0;
+  // Since Provision(), until online or back in the portal.
+  bool provisioning_ = false;
+  LinkStats stats_ = {};
+};
+
+}  // namespace net_manager
+
+#endif  // _LINK_H_
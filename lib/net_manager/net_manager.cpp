@@ -1,356 +1,570 @@
 #include "net_manager.h"
 
 #include <Arduino.h>
+#include <DNSServer.h>
 #include <WiFi.h>
-#include <WiFiManager.h>
 #include <dump.h>
 #include <esp_log.h>
 #include <esp_wifi.h>
+#include <nvs.h>
 
-#include <vector>
+#include <algorithm>
+#include <atomic>
+
+#include "link.h"
+#include "roam.h"
 
 namespace net_manager {
 namespace {
-const char TAG[] = "ui";
+const char TAG[] = "net_manager";
+
+const char kNvsNamespace[] = "net_manager";
+const char kApCacheKey[] = "ap";
+
+// The AP last connected to, so the next connect can skip the scan.
+struct ApCache {
+  static const uint8_t kVersion = 1;
+
+  uint8_t version;
+  uint8_t channel;
+  uint8_t bssid[6];
+  // Of the saved network it belongs to, as in wifi_sta_config_t.
+  uint8_t ssid[32];
+};
+
+ApCache ap_cache = {};
+const StaticIp* static_ip = nullptr;
+
+// Background roaming, while online: the RSSI is read every kRssiIntervalMs,
+// and the network's APs are scanned for every kScanIntervalMs, or
+// kDegradedScanIntervalMs while the current one is degraded. Gateway
+// probes come from AddGatewayProbe().
+const unsigned long kRssiIntervalMs = 10 * 1000;
+const unsigned long kScanIntervalMs = 5 * 60 * 1000;
+const unsigned long kDegradedScanIntervalMs = 60 * 1000;
+// Per channel. Short, as the station is away from its own channel
+// meanwhile.
+const uint32_t kScanDwellMs = 60;
+
+// Guards roam_table, which /varz reads.
+SemaphoreHandle_t roam_mutex = nullptr;
+RoamTable roam_table;
+unsigned long last_rssi_ms = 0;
+unsigned long last_scan_ms = 0;
+
+const uint16_t kDnsPort = 53;
+// How often the portal's DNS server is served.
+const unsigned long kDnsPollMs = 50;
+
+DNSServer dns_server;
+std::atomic<bool> portal_active{false};
+// When the portal last came up, and when it got online with it up.
+unsigned long portal_start_ms = 0;
+unsigned long portal_online_ms = 0;
+
+// Guards the portal's networks, and the credentials from Provision() until
+// DoTask applies them.
+SemaphoreHandle_t portal_mutex = nullptr;
+PortalNetwork portal_networks[kMaxPortalNetworks];
+int num_portal_networks = 0;
+bool provision_pending = false;
+char pending_ssid[33];
+char pending_password[64];
+}  // namespace
+
+Link link;
+
+bool HaveSavedNetwork() {
+  wifi_config_t config = {0};
+  esp_wifi_get_config(WIFI_IF_STA, &config);
+  return config.sta.ssid[0] != '\0';
 }
 
-WiFiManager wifi_manager;
+void LoadApCache() {
+  nvs_handle_t handle;
+  if (nvs_open(kNvsNamespace, NVS_READONLY, &handle) != ESP_OK) {
+    return;
+  }
+  size_t length = sizeof(ap_cache);
+  if (nvs_get_blob(handle, kApCacheKey, &ap_cache, &length) != ESP_OK ||
+      length != sizeof(ap_cache) || ap_cache.version != ApCache::kVersion) {
+    ap_cache = {};
+  }
+  nvs_close(handle);
+}
 
-wifi_ap_record_t* ScanFor(const char* ssid, unsigned long timeout_ms) {
-  Serial.println("WiFi: scan start");
-  unsigned long start_time_ms = millis();
+// Whether the cache is for the saved network.
+bool ApCacheValid() {
+  wifi_config_t config = {0};
+  esp_wifi_get_config(WIFI_IF_STA, &config);
+  return ap_cache.version == ApCache::kVersion && ap_cache.channel != 0 &&
+         memcmp(ap_cache.ssid, config.sta.ssid, sizeof(ap_cache.ssid)) == 0;
+}
 
-  WiFi.mode(WIFI_STA);
-  // WiFi.scanNetworks will return the number of networks found
-  int n = 0;
-  do {
-    unsigned long scan_start_time_ms = millis();
-    n = WiFi.scanNetworks();
-    Serial.print("ScanFor(): scan done in ");
-    Serial.print(millis() - scan_start_time_ms);
-    Serial.print(" ms\n");
-
-    if (n < 0) {
-      Serial.print("ScanFor(): Scan failed: ");
-      Serial.println(n);
-    } else if (n == 0) {
-      Serial.println("ScanFor(): no networks found");
+// Remembers the AP now connected to. Only writes when it changed, which
+// takes roaming or a new network.
+void SaveApCache() {
+  wifi_config_t config = {0};
+  wifi_ap_record_t ap_info;
+  if (esp_wifi_get_config(WIFI_IF_STA, &config) != ESP_OK ||
+      esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+    return;
+  }
+  ApCache cache = {};
+  cache.version = ApCache::kVersion;
+  cache.channel = ap_info.primary;
+  memcpy(cache.bssid, ap_info.bssid, sizeof(cache.bssid));
+  memcpy(cache.ssid, config.sta.ssid, sizeof(cache.ssid));
+  if (memcmp(&cache, &ap_cache, sizeof(cache)) == 0) {
+    return;
+  }
+  ap_cache = cache;
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(kNvsNamespace, NVS_READWRITE, &handle);
+  if (err == ESP_OK) {
+    err = nvs_set_blob(handle, kApCacheKey, &cache, sizeof(cache));
+    if (err == ESP_OK) {
+      err = nvs_commit(handle);
     }
-    delay(100);
-  } while (n <= 0 && (millis() - start_time_ms) < timeout_ms);
+    nvs_close(handle);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Saving the AP: %s", esp_err_to_name(err));
+  }
+}
+
+// Starts connecting to the saved network; the events say how it went. A
+// fast connect goes to the cached AP on its channel, without a scan.
+void Connect(bool fast) {
+  wifi_config_t config = {0};
+  esp_wifi_get_config(WIFI_IF_STA, &config);
+  char ssid[sizeof(config.sta.ssid) + 1] = {0};
+  memcpy(ssid, config.sta.ssid, sizeof(config.sta.ssid));
+  ESP_LOGI(TAG, "WiFi: Connecting to %s%s", ssid, fast ? " (fast)" : "");
+
+  if (fast) {
+    config.sta.scan_method = WIFI_FAST_SCAN;
+    config.sta.bssid_set = true;
+    memcpy(config.sta.bssid, ap_cache.bssid, sizeof(config.sta.bssid));
+    config.sta.channel = ap_cache.channel;
+  } else {
+    // The config read back still pins the fast attempt's AP: unpin it, or
+    // the full scan would only ever find that one.
+    config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    config.sta.bssid_set = false;
+    memset(config.sta.bssid, 0, sizeof(config.sta.bssid));
+    config.sta.channel = 0;
+  }
+  config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+  esp_wifi_set_config(WIFI_IF_STA, &config);
+  // Not mode(), which would take the portal's AP down.
+  WiFi.enableSTA(true);
+  if (WiFi.begin() == WL_CONNECT_FAILED) {
+    auto err = esp_wifi_connect();
+    ESP_LOGW(TAG, "esp_wifi_connect: %d", err);
+  }
+}
 
-  wifi_ap_record_t* ret = nullptr;
-  Serial.print(n);
-  Serial.println(" networks found");
+// Lists the networks in range for the setup page, one entry per SSID.
+void ScanForPortal() {
+  const int n = WiFi.scanNetworks();
+  xSemaphoreTake(portal_mutex, portMAX_DELAY);
+  num_portal_networks = 0;
   for (int i = 0; i < n; ++i) {
-    // Print SSID and RSSI for each network found
-    Serial.print(i + 1);
-    Serial.print(": ");
-    Serial.print(WiFi.SSID(i));
-    Serial.print(" (");
-    Serial.print(WiFi.RSSI(i));
-    Serial.print(")");
-    Serial.print((WiFi.encryptionType(i) == WIFI_AUTH_OPEN) ? " " : "*");
-    Serial.print("  channel: ");
-    Serial.print(WiFi.channel(i));
-    Serial.print("  BSSID: ");
-    Serial.print(WiFi.BSSIDstr(i));
-    Serial.print("\n");
-
-    if (ret == nullptr && !strcmp(ssid, WiFi.SSID(i).c_str())) {
-      ret = reinterpret_cast<wifi_ap_record_t*>(WiFi.getScanInfoByIndex(i));
+    const auto* record =
+        reinterpret_cast<wifi_ap_record_t*>(WiFi.getScanInfoByIndex(i));
+    if (record == nullptr || record->ssid[0] == '\0') {
+      continue;
     }
+    const char* ssid = reinterpret_cast<const char*>(record->ssid);
+    PortalNetwork* network = std::find_if(
+        portal_networks, portal_networks + num_portal_networks,
+        [ssid](const PortalNetwork& n) { return strcmp(n.ssid, ssid) == 0; });
+    if (network == portal_networks + num_portal_networks) {
+      if (num_portal_networks == kMaxPortalNetworks) {
+        continue;
+      }
+      ++num_portal_networks;
+      snprintf(network->ssid, sizeof(network->ssid), "%s", ssid);
+      network->rssi = record->rssi;
+    }
+    network->rssi = std::max(network->rssi, record->rssi);
+    network->open = record->authmode == WIFI_AUTH_OPEN;
   }
-  Serial.println("");
+  std::sort(portal_networks, portal_networks + num_portal_networks,
+            [](const PortalNetwork& a, const PortalNetwork& b) {
+              return a.rssi > b.rssi;
+            });
+  xSemaphoreGive(portal_mutex);
+  WiFi.scanDelete();
+}
 
-  return ret;
+// Brings up the soft AP and its DNS, unless they are up.
+void StartPortal() {
+  portal_start_ms = millis();
+  if (portal_active) {
+    return;
+  }
+  ScanForPortal();
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  char ap_ssid[16];
+  snprintf(ap_ssid, sizeof(ap_ssid), "pneumatic-%02x%02x", mac[4], mac[5]);
+  WiFi.softAP(ap_ssid);
+  dns_server.start(kDnsPort, "*", WiFi.softAPIP());
+  portal_active = true;
+  ESP_LOGI(TAG, "WiFi: portal up as %s, at http://%s/wifi", ap_ssid,
+           WiFi.softAPIP().toString().c_str());
 }
 
-enum Status {
-  STATUS_UNKNOWN = 0,
-  STATUS_DISCONNECTED,
-  STATUS_CONNECTING,
-  STATUS_CONNECTED,
-};
+void StopPortal() {
+  dns_server.stop();
+  WiFi.softAPdisconnect(/*wifioff=*/true);
+  portal_active = false;
+  ESP_LOGI(TAG, "WiFi: portal down");
+}
 
-Status status = STATUS_DISCONNECTED;
+// Saves the credentials from Provision(), if any, and starts over with them.
+void ApplyProvision() {
+  char ssid[sizeof(pending_ssid)];
+  char password[sizeof(pending_password)];
+  xSemaphoreTake(portal_mutex, portMAX_DELAY);
+  const bool pending = provision_pending;
+  provision_pending = false;
+  memcpy(ssid, pending_ssid, sizeof(ssid));
+  memcpy(password, pending_password, sizeof(password));
+  xSemaphoreGive(portal_mutex);
+  if (!pending) {
+    return;
+  }
+  ESP_LOGI(TAG, "WiFi: provisioned %s", ssid);
 
-bool Init() {
-  // Triggers low-level esp wifi init
-  WiFi.mode(WIFI_STA);
-  // Persist wifi config to flash (NVS)
-  WiFi.persistent(true);
-  WiFi.setSleep(false);
+  wifi_config_t config = {0};
+  esp_wifi_get_config(WIFI_IF_STA, &config);
+  memset(config.sta.ssid, 0, sizeof(config.sta.ssid));
+  memset(config.sta.password, 0, sizeof(config.sta.password));
+  // A 32 character SSID fills the field unterminated.
+  memcpy(config.sta.ssid, ssid, strlen(ssid));
+  memcpy(config.sta.password, password, strlen(password));
+  config.sta.bssid_set = false;
+  // Before the disconnect, so its event finds the Link expecting it. Poll()
+  // runs on this task, so nothing connects before the new config is in.
+  link.Provision(millis());
+  esp_wifi_disconnect();
+  esp_wifi_set_config(WIFI_IF_STA, &config);
+  link.SetFastConnect(ApCacheValid());
+}
+
+void LogConnected() {
+  const LinkStats stats = link.stats();
+  ESP_LOGI(TAG, "WiFi connected in %u ms (%u fast of %u)",
+           stats.last_connect_ms, stats.fast_connects, stats.connects);
+  WiFi.printDiag(Serial);
+
+  Serial.print("My MAC ADDRESS:  ");
+  Serial.println(WiFi.macAddress());
+  Serial.print("My IP:           ");
+  Serial.println(WiFi.localIP().toString());
+  Serial.print("My hostname:     ");
+  Serial.println(WiFi.getHostname());
+  Serial.print("SSID:            ");
+  Serial.println(WiFi.SSID());
+  Serial.print("BSSID:           ");
+  Serial.println(WiFi.BSSIDstr());
+  Serial.print("Channel:         ");
+  Serial.println(WiFi.channel());
+  Serial.print("RSSI:            ");
+  Serial.println(WiFi.RSSI());
+  Serial.print("TxPower:         ");
+  Serial.println(WiFi.getTxPower());
+  Serial.print("Gateway:         ");
+  Serial.println(WiFi.gatewayIP().toString());
+  Serial.print("Network:         ");
+  Serial.println(WiFi.networkID().toString());
+  Serial.print("Netmask:         ");
+  Serial.println(WiFi.subnetMask().toString());
+  Serial.print("Broadcast:       ");
+  Serial.println(WiFi.broadcastIP().toString());
+  Serial.print("Subnet CIDR:     ");
+  Serial.println(WiFi.subnetCIDR());
+}
+
+// Tells the table which AP it is on now.
+void StartRoaming(unsigned long now_ms) {
+  wifi_ap_record_t ap_info;
+  if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+    return;
+  }
+  xSemaphoreTake(roam_mutex, portMAX_DELAY);
+  roam_table.SetCurrent(ap_info.bssid, ap_info.primary, now_ms);
+  roam_table.AddRssi(ap_info.bssid, ap_info.primary, ap_info.rssi, now_ms);
+  xSemaphoreGive(roam_mutex);
+  last_rssi_ms = now_ms;
+  last_scan_ms = now_ms;
+}
+
+void ReadRssi() {
+  wifi_ap_record_t ap_info;
+  if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+    return;
+  }
+  xSemaphoreTake(roam_mutex, portMAX_DELAY);
+  roam_table.AddRssi(ap_info.bssid, ap_info.primary, ap_info.rssi, millis());
+  xSemaphoreGive(roam_mutex);
+}
+
+// Adds the saved network's APs in range to the table.
+void Scan() {
+  wifi_config_t config = {0};
+  esp_wifi_get_config(WIFI_IF_STA, &config);
+  char ssid[sizeof(config.sta.ssid) + 1] = {0};
+  memcpy(ssid, config.sta.ssid, sizeof(config.sta.ssid));
+
+  const unsigned long start_ms = millis();
+  const int n = WiFi.scanNetworks(/*async=*/false, /*show_hidden=*/false,
+                                  /*passive=*/false, kScanDwellMs);
+  const unsigned long now_ms = millis();
+  ESP_LOGD(TAG, "Scan: %d APs in %lu ms", n, now_ms - start_ms);
+  xSemaphoreTake(roam_mutex, portMAX_DELAY);
+  roam_table.CountScan();
+  for (int i = 0; i < n; ++i) {
+    const auto* record =
+        reinterpret_cast<wifi_ap_record_t*>(WiFi.getScanInfoByIndex(i));
+    if (record != nullptr &&
+        strcmp(ssid, reinterpret_cast<const char*>(record->ssid)) == 0) {
+      roam_table.AddRssi(record->bssid, record->primary, record->rssi,
+                         now_ms);
+    }
+  }
+  xSemaphoreGive(roam_mutex);
+  WiFi.scanDelete();
+}
+
+// Reads the RSSI, scans and roams when due; how long until it is next due.
+unsigned long Roam(unsigned long now_ms) {
+  if (now_ms - last_rssi_ms >= kRssiIntervalMs) {
+    ReadRssi();
+    last_rssi_ms = now_ms;
+  }
+  xSemaphoreTake(roam_mutex, portMAX_DELAY);
+  const bool degraded = roam_table.Degraded() != RoamReason::kNone;
+  xSemaphoreGive(roam_mutex);
+  const unsigned long scan_interval_ms =
+      degraded ? kDegradedScanIntervalMs : kScanIntervalMs;
+  if (now_ms - last_scan_ms >= scan_interval_ms) {
+    Scan();
+    last_scan_ms = now_ms;
+
+    RoamReason reason;
+    xSemaphoreTake(roam_mutex, portMAX_DELAY);
+    const ApQuality* target = roam_table.Decide(now_ms, &reason);
+    const ApQuality* current = roam_table.current();
+    if (target != nullptr) {
+      ESP_LOGI(TAG, "Roaming (%s): %d dBm -> %d dBm on channel %u",
+               RoamReasonName(reason), current->rssi(), target->rssi(),
+               target->channel);
+      // Reconnecting goes to the cached AP first.
+      memcpy(ap_cache.bssid, target->bssid, sizeof(ap_cache.bssid));
+      ap_cache.channel = target->channel;
+    }
+    xSemaphoreGive(roam_mutex);
+    if (target != nullptr) {
+      link.SetFastConnect(ApCacheValid());
+      esp_wifi_disconnect();
+      return 0;
+    }
+  }
+  return std::min(kRssiIntervalMs - (now_ms - last_rssi_ms),
+                  scan_interval_ms - (now_ms - last_scan_ms));
+}
+
+void Init(const StaticIp* ip) {
+  static_ip = ip;
+  roam_mutex = xSemaphoreCreateMutex();
+  portal_mutex = xSemaphoreCreateMutex();
+  link.Init();
+
+  WiFi.onEvent(
+      [](WiFiEvent_t event, WiFiEventInfo_t info) {
+        link.Handle(LinkEvent::kAssociated, millis());
+      },
+      ARDUINO_EVENT_WIFI_STA_CONNECTED);
 
-  // Set up some event handlers
   WiFi.onEvent(
       [](WiFiEvent_t event, WiFiEventInfo_t info) {
         Serial.print("WiFi connected. IP: ");
         Serial.println(IPAddress(info.got_ip.ip_info.ip.addr));
-        status = STATUS_CONNECTED;
+        link.Handle(LinkEvent::kGotIp, millis());
       },
       ARDUINO_EVENT_WIFI_STA_GOT_IP);
 
   WiFi.onEvent(
       [](WiFiEvent_t event, WiFiEventInfo_t info) {
-        Serial.print("WiFi lost connection. Reason: ");
-        Serial.println(info.wifi_sta_disconnected.reason);
-        Serial.print("WiFi not connected; status: ");
-        Serial.println(WiFi.status());
-        // WiFi.persistent(false);
-        // WiFi.disconnect(true);
-        status = STATUS_DISCONNECTED;
-        // ESP.restart();
+        ESP_LOGW(TAG, "WiFi lost IP");
+        link.Handle(LinkEvent::kLostIp, millis());
+      },
+      ARDUINO_EVENT_WIFI_STA_LOST_IP);
+
+  WiFi.onEvent(
+      [](WiFiEvent_t event, WiFiEventInfo_t info) {
+        ESP_LOGW(TAG, "WiFi lost connection. Reason: %u",
+                 info.wifi_sta_disconnected.reason);
+        link.Handle(LinkEvent::kDisconnected, millis(),
+                    info.wifi_sta_disconnected.reason);
       },
       ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
 
   WiFi.onEvent(
       [](WiFiEvent_t event, WiFiEventInfo_t info) {
-        // Serial.print("WiFi lost connection. Reason: ");
-        // Serial.println(info.wifi_sta_disconnected.reason);
-        Serial.print("WiFi not connected; status: ");
-        Serial.println(WiFi.status());
-        // WiFi.persistent(false);
-        // WiFi.disconnect(true);
-        status = STATUS_DISCONNECTED;
-        // ESP.restart();
+        ESP_LOGW(TAG, "WiFi station stopped");
+        link.Handle(LinkEvent::kDisconnected, millis());
       },
       ARDUINO_EVENT_WIFI_STA_STOP);
-
-  return true;
 }
 
-bool Connect(unsigned long timeout_ms) {
-  wifi_config_t config = {0};
-  char ssid[sizeof(config.sta.ssid) + 1] = {0};
-  char password[sizeof(config.sta.password) + 1] = {0};
-  int connect_failures = 0;
-  for (;;) {
-    delay(10);
-    if (status == STATUS_CONNECTED && WiFi.status() == WL_CONNECTED) {
-      Serial.print("Wifi: connected!");
-      break;
-    }
+bool Online() { return link.online(); }
 
-    esp_wifi_get_config(WIFI_IF_STA, &config);
-    // config.sta.ssid[0] = '\0';  // force captive portal
-    // config.sta.ssid[0] = 'b';  // force captive portal
-    if (connect_failures >= 3 || config.sta.ssid[0] == '\0') {
-      Serial.print("Wifi: no saved SSID, starting captive portal...");
-
-      // wifi_manager.setConfigPortalTimeout(/*seconds=*/ 180);  // blocking
-      // wifi_manager.setConnectRetries(3);  // blocking
-      // wifi_manager.setSaveConnectTimeout(/*seconds=*/ 20);  // blocking
-      // wifi_manager.setConnectTimeout(/*seconds=*/ 20);  // blocking
-      auto s = wifi_manager.startConfigPortal();  // blocking
-      Serial.print("WifiManager done, result: ");
-      Serial.println(s);
-      wifi_manager.stopConfigPortal();
-      esp_wifi_get_config(WIFI_IF_STA, &config);
-      if (config.sta.ssid[0] == '\0') {
-        Serial.print("Wifi: WifiManager failed no ssid...");
-      }
+bool WaitOnline(TickType_t timeout_ticks) {
+  return link.WaitOnline(timeout_ticks);
+}
 
-      memcpy(ssid, config.sta.ssid, sizeof(config.sta.ssid));
-      memcpy(password, config.sta.password, sizeof(config.sta.password));
-      Serial.print("Wifi: WiFiManager SSID: ");
-      Serial.println(ssid);
-      Serial.print("Wifi: WiFiManager password: ");
-      Serial.println(password);
-      continue;
-    }
+LinkStats Stats() { return link.stats(); }
+
+void AddGatewayProbe(bool answered, uint32_t rtt_us) {
+  if (roam_mutex == nullptr) {
+    return;
+  }
+  xSemaphoreTake(roam_mutex, portMAX_DELAY);
+  roam_table.AddProbe(answered, rtt_us);
+  xSemaphoreGive(roam_mutex);
+}
 
-    memcpy(ssid, config.sta.ssid, sizeof(config.sta.ssid));
-    memcpy(password, config.sta.password, sizeof(config.sta.password));
-    Serial.print("Wifi: saved SSID: ");
-    Serial.println(ssid);
-    Serial.print("Wifi: saved password: ");
-    Serial.println(password);
+RoamTable Roaming() {
+  if (roam_mutex == nullptr) {
+    return RoamTable();
+  }
+  xSemaphoreTake(roam_mutex, portMAX_DELAY);
+  const RoamTable table = roam_table;
+  xSemaphoreGive(roam_mutex);
+  return table;
+}
 
-    unsigned long start_time_ms = millis();
-    config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
-    config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
-    esp_wifi_set_config(WIFI_IF_STA, &config);
-
-#if 0
-        // WiFi.disconnect(/*wifioff=*/ true);
-        WiFi.disconnect();
-        status = STATUS_DISCONNECTED;
-        auto* ap_info = ScanFor(ssid, timeout_ms);
-        if (!ap_info) {
-            Serial.print("WiFi: Failed to find SSID: ");
-            Serial.println(ssid);
-            // ++connect_failures;
-            // continue;
-        } else {
-            Serial.print(" channel: ");
-            Serial.print(ap_info->primary);
-            Serial.print(" BSSID: ");
-            for (int i = 0; i < sizeof(ap_info->bssid); ++i) {
-                if (i > 0) {
-                    Serial.print(":");
-                }
-                Serial.print(ap_info->bssid[i] >> 4, HEX);
-                Serial.print(ap_info->bssid[i] & 0x0f, HEX);
-            }
-            Serial.print(" RSSI: ");
-            Serial.print(ap_info->rssi);
-            Serial.print("\n");
-
-            /*
-            config.sta.bssid_set = true;
-            memcpy(config.sta.bssid, ap_info->bssid, 6);
-            config.sta.channel = ap_info->primary;
-            */
-            config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
-            config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
-            config.sta.bssid_set = false;
-            memset(config.sta.bssid, 0, 6);
-            config.sta.channel = 0;
-            esp_wifi_set_config(WIFI_IF_STA, &config);
-        }
-#endif
-
-    Serial.print("WiFi: Connecting to ");
-    Serial.println(ssid);
-    // WiFi.disconnect(/*wifioff=*/ true);
-    // WiFi.mode(WIFI_OFF);
-    WiFi.mode(WIFI_STA);
-    // WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
-    // WiFi.setHostname("esp32dev");
-
-    Serial.print("WiFi: status: ");
-    Serial.println(status);
-    status = STATUS_CONNECTING;
-    if (WiFi.begin() == WL_CONNECT_FAILED) {
-      auto err = esp_wifi_connect();
-      Serial.print("esp_wifi_connect: ");
-      Serial.println(err);
-      status = STATUS_DISCONNECTED;
-    }
-    unsigned long backoff_ms = 10;
-    while (status != STATUS_CONNECTED &&
-           (millis() - start_time_ms) < timeout_ms) {
-      Serial.print("WiFi connecting... Status: ");
-      Serial.println(status);
-      if (status == STATUS_DISCONNECTED) {
-        // WiFi.disconnect(/*wifioff=*/ false, /*eraseap=*/ false);
-        // WiFi.disconnect(/*wifioff=*/ true);
-        Serial.print("WiFi: sleep for ");
-        Serial.println(dump::MillisHumanReadable(backoff_ms));
-        delay(backoff_ms);
-        backoff_ms *= 2;
-        status = STATUS_CONNECTING;
-        if (WiFi.begin() == WL_CONNECT_FAILED) {
-          auto err = esp_wifi_connect();
-          Serial.print("esp_wifi_connect: ");
-          Serial.println(err);
-          status = STATUS_DISCONNECTED;
-        }
-      }
-      delay(1000);
-    }
+bool PortalActive() { return portal_active; }
 
-    if (status != STATUS_CONNECTED) {
-      ++connect_failures;
-      Serial.print("WiFi failed to connect; status: ");
-      Serial.print(status);
-      Serial.print("; elapsed: ");
-      Serial.print((millis() - start_time_ms));
-      Serial.print(" ms");
-      Serial.print("; connect_failures: ");
-      Serial.println(connect_failures);
-      // WiFi.printDiag(Serial);
-      // return false;
-      continue;
-    }
+IPAddress PortalIp() { return WiFi.softAPIP(); }
 
-    // Connected!
-    connect_failures = 0;
-    Serial.print("WiFi connected in ");
-    Serial.print((millis() - start_time_ms));
-    Serial.print(" ms\n");
-    WiFi.printDiag(Serial);
-
-    Serial.print("My MAC ADDRESS:  ");
-    Serial.println(WiFi.macAddress());
-    Serial.print("My IP:           ");
-    Serial.println(WiFi.localIP().toString());
-    Serial.print("My hostname:     ");
-    Serial.println(WiFi.getHostname());
-    Serial.print("SSID:            ");
-    Serial.println(WiFi.SSID());
-    Serial.print("BSSID:           ");
-    Serial.println(WiFi.BSSIDstr());
-    Serial.print("Channel:         ");
-    Serial.println(WiFi.channel());
-    Serial.print("RSSI:            ");
-    Serial.println(WiFi.RSSI());
-    Serial.print("TxPower:         ");
-    Serial.println(WiFi.getTxPower());
-    Serial.print("Gateway:         ");
-    Serial.println(WiFi.gatewayIP().toString());
-    Serial.print("Network:         ");
-    Serial.println(WiFi.networkID().toString());
-    Serial.print("Netmask:         ");
-    Serial.println(WiFi.subnetMask().toString());
-    Serial.print("Broadcast:       ");
-    Serial.println(WiFi.broadcastIP().toString());
-    Serial.print("Subnet CIDR:     ");
-    Serial.println(WiFi.subnetCIDR());
-
-    return true;
+int PortalNetworks(PortalNetwork* networks, int max) {
+  if (portal_mutex == nullptr) {
+    return 0;
   }
+  xSemaphoreTake(portal_mutex, portMAX_DELAY);
+  const int n = std::min(max, num_portal_networks);
+  std::copy(portal_networks, portal_networks + n, networks);
+  xSemaphoreGive(portal_mutex);
+  return n;
+}
 
-  return false;
+bool Provision(const char* ssid, const char* password) {
+  const size_t ssid_length = strlen(ssid);
+  const size_t password_length = strlen(password);
+  if (portal_mutex == nullptr || ssid_length < 1 ||
+      ssid_length >= sizeof(pending_ssid) ||
+      (password_length != 0 && password_length < 8) ||
+      password_length >= sizeof(pending_password)) {
+    return false;
+  }
+  xSemaphoreTake(portal_mutex, portMAX_DELAY);
+  snprintf(pending_ssid, sizeof(pending_ssid), "%s", ssid);
+  snprintf(pending_password, sizeof(pending_password), "%s", password);
+  provision_pending = true;
+  xSemaphoreGive(portal_mutex);
+  link.Wake();
+  return true;
 }
 
 void DoTask(void* unused) {
-  Init();
+  // Triggers low-level esp wifi init
+  WiFi.mode(WIFI_STA);
+  // Persist wifi config to flash (NVS)
+  WiFi.persistent(true);
+  WiFi.setSleep(false);
+  // The Link decides when to reconnect, and how.
+  WiFi.setAutoReconnect(false);
+  if (static_ip != nullptr) {
+    WiFi.config(static_ip->ip, static_ip->gateway, static_ip->subnet,
+                static_ip->dns);
+  }
+  LoadApCache();
+  link.SetFastConnect(ApCacheValid());
+  link.Start(millis(), HaveSavedNetwork());
 
-  const unsigned long kResetIntervalMs = 48 * 60 * 60 * 1000;
-  unsigned long last_connect_time = millis();
   unsigned long last_print_time_ms = 0;
+  LinkState last_state = LinkState::kIdle;
   for (;;) {
-    delay(10);
     if ((millis() - last_print_time_ms) > 10 * 60 * 1000 ||
         !last_print_time_ms) {
       ESP_LOGI(TAG,
-               "net_manager::DoTask(): uptime: %s core: %d stackHighWater: %d",
+               "net_manager::DoTask(): uptime: %s core: %d stackHighWater: %d"
+               " state: %s",
                dump::MillisHumanReadable(millis()).c_str(), xPortGetCoreID(),
-               uxTaskGetStackHighWaterMark(nullptr));
+               uxTaskGetStackHighWaterMark(nullptr),
+               StateName(link.state()));
       last_print_time_ms = millis();
     }
-    if (false && status == STATUS_CONNECTED &&
-        millis() - last_connect_time > kResetIntervalMs) {
-      Serial.print("WiFi: Resetting...");
-      // WiFi.disconnect(/*wifioff=*/ true, /*eraseap=*/ false);
-      WiFi.disconnect(/*wifioff=*/true);
-      status = STATUS_DISCONNECTED;
-      delay(10);
+
+    switch (link.Poll(millis())) {
+      case Action::kConnect:
+        Connect(/*fast=*/false);
+        break;
+      case Action::kFastConnect:
+        Connect(/*fast=*/true);
+        break;
+      case Action::kStartPortal:
+        StartPortal();
+        break;
+      case Action::kDisconnect:
+        esp_wifi_disconnect();
+        break;
+      case Action::kNone:
+        break;
     }
-    if (status == STATUS_CONNECTED && WiFi.status() != WL_CONNECTED) {
-      Serial.print("Mismatch in status!");
-      Serial.println(WiFi.status());
-      Serial.println(status);
-      status = STATUS_DISCONNECTED;
-      continue;
+
+    ApplyProvision();
+
+    const LinkState state = link.state();
+    if (state != last_state) {
+      ESP_LOGI(TAG, "WiFi: %s -> %s", StateName(last_state),
+               StateName(state));
+      if (state == LinkState::kOnline) {
+        LogConnected();
+        SaveApCache();
+        link.SetFastConnect(ApCacheValid());
+        StartRoaming(millis());
+        portal_online_ms = millis();
+      }
+      last_state = state;
     }
-    if (status == STATUS_CONNECTED && WiFi.status() == WL_CONNECTED) {
-      delay(5000);
-      continue;
+    if (portal_active) {
+      dns_server.processNextRequest();
+      if (state == LinkState::kOnline &&
+          millis() - portal_online_ms >= kPortalLingerMs) {
+        StopPortal();
+      } else if (state == LinkState::kPortal && HaveSavedNetwork() &&
+                 millis() - portal_start_ms >= kPortalRetryMs) {
+        // The network may be back. Retrying takes the AP off its channel
+        // now and then, as the station scans.
+        link.Start(millis(), /*have_network=*/true);
+      }
     }
-
-    Serial.print("WiFi not connected; status: ");
-    Serial.println(WiFi.status());
-    Serial.println(status);
-    if (Connect(/*timeout_ms=*/20000)) {
-      Serial.print("WiFi: Connected");
-    } else {
-      Serial.print("WiFi: Resetting...");
-      // WiFi.disconnect(/*wifioff=*/ true);
+    // Until the next event, timeout, retry or roaming chore.
+    unsigned long wait_ms = link.NextPollMs(millis());
+    if (state == LinkState::kOnline) {
+      wait_ms = std::min(wait_ms, Roam(millis()));
+    }
+    if (portal_active) {
+      wait_ms = std::min(wait_ms, kDnsPollMs);
     }
-    last_connect_time = millis();
+    link.WaitChanged(wait_ms / portTICK_PERIOD_MS + 1);
   }
   vTaskDelete(nullptr);
 }
@@ -1,11 +1,75 @@
 #ifndef NET_MANAGER_H
 #define NET_MANAGER_H
 
+#include <IPAddress.h>
+#include <freertos/FreeRTOS.h>
+
+#include "link.h"
+#include "roam.h"
+
 namespace net_manager {
 
-bool Connect(unsigned long timeout_ms);
+// An address to use instead of DHCP.
+struct StaticIp {
+  IPAddress ip;
+  IPAddress gateway;
+  IPAddress subnet;
+  IPAddress dns;
+};
+
+// A network seen as the portal came up, for its setup page.
+struct PortalNetwork {
+  char ssid[33];
+  int8_t rssi;
+  bool open;
+};
+const int kMaxPortalNetworks = 16;
+
+// Hooks up the WiFi events. Call from setup() before starting any task that
+// waits on the network. With a static_ip, which must outlive the task, the
+// station skips DHCP.
+void Init(const StaticIp* static_ip = nullptr);
+// Keeps the station connected, falling back to the captive portal. The AP
+// it last got online with is kept in NVS, and connected to first without a
+// scan. While online, it scans now and then and, going by the RSSI and the
+// gateway probes, roams to a better AP of the network when the current one
+// degrades.
+//
+// The portal is a soft AP next to the station, whose DNS answers every name
+// with the AP's own address, so phones joining it open the setup page; the
+// web server serves that, while everything else keeps running. Meanwhile a
+// saved network is retried every kPortalRetryMs, and the portal stays up
+// for kPortalLingerMs once online, for the page to show how it went.
 void DoTask(void* unused);
 
+const unsigned long kPortalRetryMs = 5 * 60 * 1000;
+const unsigned long kPortalLingerMs = 60 * 1000;
+
+// Whether the station is associated and has an IP.
+bool Online();
+// Blocks until Online() or the timeout expires; returns Online().
+bool WaitOnline(TickType_t timeout_ticks);
+
+// All zero before Init().
+LinkStats Stats();
+// A round trip to the gateway through the current AP, for roaming.
+void AddGatewayProbe(bool answered, uint32_t rtt_us);
+// A copy of what the background scans and gateway probes found; empty
+// before Init().
+RoamTable Roaming();
+
+// Whether the portal's soft AP is up.
+bool PortalActive();
+// The address of the soft AP, for links to the setup page.
+IPAddress PortalIp();
+// Copies up to max of the networks the portal saw, strongest first; returns
+// how many.
+int PortalNetworks(PortalNetwork* networks, int max);
+// Saves ssid and password as the network, and connects to it without a
+// reboot. False, saving nothing, unless ssid has 1 to 32 characters and the
+// password is empty or has 8 to 63.
+bool Provision(const char* ssid, const char* password);
+
 }  // namespace net_manager
 
 #endif  // NET_MANAGER_H
@@ -0,0 +1,153 @@
+#include "roam.h"
+
+#include <string.h>
+
+namespace net_manager {
+
+const char* RoamReasonName(RoamReason reason) {
+  switch (reason) {
+    case RoamReason::kNone:
+      return "none";
+    case RoamReason::kWeakSignal:
+      return "weak_signal";
+    case RoamReason::kLoss:
+      return "loss";
+    case RoamReason::kLatency:
+      return "latency";
+  }
+  return "unknown";
+}
+
+int ApQuality::rssi() const {
+  if (rssi_count == 0) {
+    return 0;
+  }
+  int sum = 0;
+  for (int i = 0; i < rssi_count; ++i) {
+    sum += rssi_history[i];
+  }
+  return sum / rssi_count;
+}
+
+int ApQuality::loss_percent() const {
+  if (probe_count == 0) {
+    return 0;
+  }
+  return __builtin_popcount(lost_bits) * 100 / probe_count;
+}
+
+void RoamTable::SetCurrent(const uint8_t* bssid, uint8_t channel,
+                           unsigned long now_ms) {
+  ApQuality* ap = Find(bssid, now_ms);
+  ap->channel = channel;
+  ap->last_seen_ms = now_ms;
+  current_ = ap - aps_;
+}
+
+void RoamTable::AddRssi(const uint8_t* bssid, uint8_t channel, int8_t rssi,
+                        unsigned long now_ms) {
+  ApQuality* ap = Find(bssid, now_ms);
+  ap->channel = channel;
+  ap->last_seen_ms = now_ms;
+  ap->rssi_history[ap->rssi_next] = rssi;
+  ap->rssi_next = (ap->rssi_next + 1) % ApQuality::kRssiHistory;
+  if (ap->rssi_count < ApQuality::kRssiHistory) {
+    ++ap->rssi_count;
+  }
+}
+
+void RoamTable::AddProbe(bool ok, uint32_t rtt_us) {
+  if (current_ < 0) {
+    return;
+  }
+  ApQuality& ap = aps_[current_];
+  ap.lost_bits = (ap.lost_bits << 1) | !ok;
+  if (ap.probe_count < ApQuality::kProbeWindow) {
+    ++ap.probe_count;
+  }
+  if (ok) {
+    // An 1/8 EWMA, like TCP's SRTT.
+    ap.rtt_us = ap.rtt_us == 0 ? rtt_us
+                               : ap.rtt_us + (static_cast<int32_t>(rtt_us) -
+                                              static_cast<int32_t>(ap.rtt_us)) /
+                                                 8;
+  }
+}
+
+RoamReason RoamTable::Degraded() const {
+  const ApQuality* ap = current();
+  if (ap == nullptr) {
+    return RoamReason::kNone;
+  }
+  if (ap->rssi_count > 0 && ap->rssi() < kWeakRssi) {
+    return RoamReason::kWeakSignal;
+  }
+  if (ap->probe_count >= kMinProbes) {
+    if (ap->loss_percent() > kMaxLossPercent) {
+      return RoamReason::kLoss;
+    }
+    if (ap->rtt_us > kMaxRttUs) {
+      return RoamReason::kLatency;
+    }
+  }
+  return RoamReason::kNone;
+}
+
+const ApQuality* RoamTable::Decide(unsigned long now_ms, RoamReason* reason) {
+  *reason = Degraded();
+  if (*reason == RoamReason::kNone ||
+      (roamed_ && now_ms - last_roam_ms_ < kMinRoamIntervalMs)) {
+    return nullptr;
+  }
+  const int min_rssi = *reason == RoamReason::kWeakSignal
+                           ? aps_[current_].rssi() + kHysteresisDb
+                           : kWeakRssi + kHysteresisDb;
+  const ApQuality* best = nullptr;
+  for (int i = 0; i < size_; ++i) {
+    const ApQuality& ap = aps_[i];
+    if (i == current_ || ap.rssi_count == 0 ||
+        now_ms - ap.last_seen_ms > kStaleMs || ap.rssi() < min_rssi ||
+        (ap.probe_count >= kMinProbes &&
+         ap.loss_percent() > kMaxLossPercent)) {
+      continue;
+    }
+    if (best == nullptr || ap.rssi() > best->rssi()) {
+      best = &ap;
+    }
+  }
+  if (best == nullptr) {
+    ++stats_.roams[static_cast<int>(RoamReason::kNone)];
+    return nullptr;
+  }
+  ++stats_.roams[static_cast<int>(*reason)];
+  roamed_ = true;
+  last_roam_ms_ = now_ms;
+  return best;
+}
+
+ApQuality* RoamTable::Find(const uint8_t* bssid, unsigned long now_ms) {
+  for (int i = 0; i < size_; ++i) {
+    if (memcmp(aps_[i].bssid, bssid, sizeof(aps_[i].bssid)) == 0) {
+      return &aps_[i];
+    }
+  }
+  int index = size_;
+  if (size_ < kMaxAps) {
+    ++size_;
+  } else {
+    index = current_ == 0 ? 1 : 0;
+    for (int i = 0; i < kMaxAps; ++i) {
+      if (i != current_ &&
+          now_ms - aps_[i].last_seen_ms > now_ms - aps_[index].last_seen_ms) {
+        index = i;
+      }
+    }
+  }
+  ApQuality& ap = aps_[index];
+  ap = {};
+  memcpy(ap.bssid, bssid, sizeof(ap.bssid));
+  ap.last_seen_ms = now_ms;
+  return &ap;
+}
+
+}  // namespace net_manager
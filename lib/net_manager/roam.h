@@ -0,0 +1,112 @@
+#ifndef _ROAM_H_
+#define _ROAM_H_
+
+// What the station knows about the APs of its network, for roaming: every
+// BSSID a background scan has seen, with its recent RSSI, and the gateway
+// latency and loss measured while connected through it.
+//
+// Decide() roams only when the current AP is degraded, at most once every
+// kMinRoamIntervalMs. Away from a weak AP, the other has to be kHysteresisDb
+// stronger, so two APs of similar strength don't flap; away from a lossy or
+// slow one, it has to be that much above weak, and not lossy itself. Like the
+// Link, it does no I/O and takes the time as an argument; it has no lock.
+
+#include <stdint.h>
+
+namespace net_manager {
+
+enum class RoamReason : uint8_t {
+  kNone = 0,
+  kWeakSignal,
+  kLoss,
+  kLatency,
+};
+const int kNumRoamReasons = 4;
+
+const char* RoamReasonName(RoamReason reason);
+
+struct ApQuality {
+  static const int kRssiHistory = 8;
+  // Probes that count towards the loss.
+  static const int kProbeWindow = 16;
+
+  uint8_t bssid[6];
+  uint8_t channel;
+  // The latest RSSI readings in dBm, as a ring: rssi_next is where the
+  // next one goes.
+  int8_t rssi_history[kRssiHistory];
+  uint8_t rssi_count;
+  uint8_t rssi_next;
+  unsigned long last_seen_ms;
+  // Gateway round trip, smoothed, and the last kProbeWindow probes: one
+  // bit each, set if lost.
+  uint32_t rtt_us;
+  uint16_t lost_bits;
+  uint8_t probe_count;
+
+  // Mean of rssi_history; 0 without any.
+  int rssi() const;
+  int loss_percent() const;
+};
+
+struct RoamStats {
+  uint32_t scans;
+  // By RoamReason; kNone counts the times it was degraded but stayed, for
+  // want of a better AP.
+  uint32_t roams[kNumRoamReasons];
+};
+
+class RoamTable {
+ public:
+  static const int kMaxAps = 8;
+  // Below this the current AP is weak.
+  static const int kWeakRssi = -72;
+  // A candidate has to be this much stronger than the current AP.
+  static const int kHysteresisDb = 8;
+  // Judging loss and latency takes this many probes.
+  static const int kMinProbes = 8;
+  static const int kMaxLossPercent = 25;
+  static const uint32_t kMaxRttUs = 150 * 1000;
+  // Candidates not seen in this long are ignored.
+  static const unsigned long kStaleMs = 15 * 60 * 1000;
+  static const unsigned long kMinRoamIntervalMs = 10 * 60 * 1000;
+
+  // Connected to bssid; probes and connected RSSI readings go to it.
+  void SetCurrent(const uint8_t* bssid, uint8_t channel, unsigned long now_ms);
+  // An RSSI reading, from a scan or the current connection.
+  void AddRssi(const uint8_t* bssid, uint8_t channel, int8_t rssi,
+               unsigned long now_ms);
+  void CountScan() { ++stats_.scans; }
+  // A gateway probe through the current AP; rtt_us only counts if ok.
+  void AddProbe(bool ok, uint32_t rtt_us);
+
+  // Why the current AP is degraded, or kNone.
+  RoamReason Degraded() const;
+  // The AP to roam to, or null to stay; sets *reason. Counts the decision
+  // when the current AP is degraded.
+  const ApQuality* Decide(unsigned long now_ms, RoamReason* reason);
+
+  int size() const { return size_; }
+  const ApQuality& ap(int i) const { return aps_[i]; }
+  // Null until SetCurrent().
+  const ApQuality* current() const {
+    return current_ < 0 ? nullptr : &aps_[current_];
+  }
+  const RoamStats& stats() const { return stats_; }
+
+ private:
+  // The entry for bssid, added if need be, evicting the stalest other than
+  // the current one.
+  ApQuality* Find(const uint8_t* bssid, unsigned long now_ms);
+
+  ApQuality aps_[kMaxAps] = {};
+  int size_ = 0;
+  int current_ = -1;
+  bool roamed_ = false;
+  unsigned long last_roam_ms_ = 0;
+  RoamStats stats_ = {};
+};
+
+}  // namespace net_manager
+
+#endif  // _ROAM_H_
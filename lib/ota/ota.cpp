@@ -10,6 +10,8 @@
 
 #include "constants.h"
 #include "dump.h"
+#include "history.h"
+#include "net_manager.h"
 
 namespace ota {
 namespace {
@@ -72,16 +74,12 @@ void TaskOta(void* unused) {
           dump::MillisHumanReadable(millis()).c_str(),
           dump::MillisHumanReadable(next_update_time_ms - millis()).c_str(),
           xPortGetCoreID(), uxTaskGetStackHighWaterMark(nullptr));
-      if (!WiFi.isConnected()) {
+      if (!net_manager::Online()) {
         ESP_LOGW(TAG, "TaskOta: Waiting for WiFi...");
       }
       last_print_time_ms = millis();
     }
-    while (!WiFi.isConnected() && last_print_time_ms &&
-           ((millis() - last_print_time_ms) <= 60 * 1000)) {
-      delay(1000);
-    }
-    if (!WiFi.isConnected()) {
+    if (!net_manager::WaitOnline(60 * 1000 / portTICK_PERIOD_MS)) {
       continue;
     }
     if (millis() < next_update_time_ms) {
@@ -184,6 +182,8 @@ void TaskOta(void* unused) {
     ESP_LOGW(TAG, "Successfully updated OTA, stackHighWater: %d, Restarting...",
              uxTaskGetStackHighWaterMark(nullptr));
     delay(100);
+    // The shutdown handler does too; this makes sure of it.
+    history::Flush();
     esp_restart();
   }
 }
@@ -0,0 +1,188 @@
+#include "plantower.h"
+
+#include <string.h>
+
+namespace plantower {
+
+const char* FrameStatusName(FrameStatus status) {
+  switch (status) {
+    case FrameStatus::kOk:
+      return "ok";
+    case FrameStatus::kBadSize:
+      return "bad size";
+    case FrameStatus::kBadMagic:
+      return "bad magic";
+    case FrameStatus::kBadLength:
+      return "bad length";
+    case FrameStatus::kBadChecksum:
+      return "bad checksum";
+    case FrameStatus::kOutOfRange:
+      return "out of range";
+  }
+  return "unknown";
+}
+
+FrameStatus VerifyFrame(const uint8_t* frame, size_t size) {
+  if (size < kHeaderSize + 2) {
+    return FrameStatus::kBadSize;
+  }
+  if (frame[0] != kMagic0 || frame[1] != kMagic1) {
+    return FrameStatus::kBadMagic;
+  }
+  // Length counts everything after the length field, checksum included.
+  size_t frame_size = kHeaderSize + ReadWord(frame, 2);
+  if (frame_size != size) {
+    return FrameStatus::kBadLength;
+  }
+  size_t checksum_offset = size - 2;
+  uint16_t checksum = 0;
+  for (size_t i = 0; i < checksum_offset; ++i) {
+    checksum += frame[i];
+  }
+  if (checksum != ReadWord(frame, checksum_offset)) {
+    return FrameStatus::kBadChecksum;
+  }
+  return FrameStatus::kOk;
+}
+
+void BuildCommand(uint8_t cmd, uint16_t data,
+                  uint8_t (&command)[kCommandSize]) {
+  command[0] = kMagic0;
+  command[1] = kMagic1;
+  command[2] = cmd;
+  command[3] = data >> 8;
+  command[4] = data & 0xff;
+  uint16_t checksum = 0;
+  for (size_t i = 0; i < kCommandSize - 2; ++i) {
+    checksum += command[i];
+  }
+  command[5] = checksum >> 8;
+  command[6] = checksum & 0xff;
+}
+
+size_t FrameParser::Feed(const uint8_t* data, size_t size) {
+  size_t consumed = 0;
+  while (consumed < size) {
+    size_t want = 0;
+    uint8_t* dst = Reserve(&want);
+    if (want > size - consumed) {
+      want = size - consumed;
+    }
+    memcpy(dst, data + consumed, want);
+    Commit(want);
+    consumed += want;
+    if (ready_) {
+      break;
+    }
+  }
+  return consumed;
+}
+
+uint8_t* FrameParser::Reserve(size_t* size) {
+  if (ready_) {
+    // Previous frame has been consumed; start looking for the next one.
+    ready_ = false;
+    Resync();
+  }
+  *size = (state_ == kWantBody) ? frame_size_ - size_ : 1;
+  return buffer_ + size_;
+}
+
+void FrameParser::Commit(size_t size) {
+  if (size == 0) {
+    return;
+  }
+  if (state_ != kWantBody) {
+    CommitHeaderByte(buffer_[size_]);
+    return;
+  }
+
+  // Everything except the trailing two bytes is covered by the checksum.
+  size_t checksum_offset = frame_size_ - 2;
+  for (size_t i = size_; i < size_ + size && i < checksum_offset; ++i) {
+    checksum_ += buffer_[i];
+  }
+  size_ += size;
+  if (size_ < frame_size_) {
+    return;
+  }
+
+  uint16_t expected =
+      (buffer_[checksum_offset] << 8) | buffer_[checksum_offset + 1];
+  if (checksum_ != expected) {
+    ++stats_.bad_checksum;
+    Resync();
+    return;
+  }
+  ++stats_.frames;
+  ready_ = true;
+}
+
+void FrameParser::CommitHeaderByte(uint8_t c) {
+  switch (state_) {
+    case kWantMagic0:
+      if (c != kMagic0) {
+        ++stats_.skipped_bytes;
+        return;
+      }
+      checksum_ = c;
+      size_ = 1;
+      state_ = kWantMagic1;
+      return;
+
+    case kWantMagic1:
+      if (c == kMagic0) {
+        // 0x42 0x42 0x4d: the second 0x42 may be the real start.
+        ++stats_.skipped_bytes;
+        buffer_[0] = c;
+        return;
+      }
+      if (c != kMagic1) {
+        stats_.skipped_bytes += 2;
+        Resync();
+        return;
+      }
+      checksum_ += c;
+      size_ = 2;
+      state_ = kWantLengthHigh;
+      return;
+
+    case kWantLengthHigh:
+      checksum_ += c;
+      size_ = 3;
+      state_ = kWantLengthLow;
+      return;
+
+    case kWantLengthLow:
+      frame_size_ = kHeaderSize + ((buffer_[2] << 8) | c);
+      if (frame_size_ < kHeaderSize + 2 || frame_size_ > kMaxFrameSize) {
+        ++stats_.bad_length;
+        stats_.skipped_bytes += kHeaderSize;
+        Resync();
+        return;
+      }
+      checksum_ += c;
+      size_ = kHeaderSize;
+      state_ = kWantBody;
+      return;
+
+    case kWantBody:
+      break;
+  }
+}
+
+void FrameParser::Overrun() {
+  ++stats_.overruns;
+  if (!ready_) {
+    Resync();
+  }
+}
+
+void FrameParser::Resync() {
+  state_ = kWantMagic0;
+  size_ = 0;
+  frame_size_ = 0;
+  checksum_ = 0;
+}
+
+}  // namespace plantower
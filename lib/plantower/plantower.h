@@ -0,0 +1,219 @@
+#ifndef _PLANTOWER_H_
+#define _PLANTOWER_H_
+
+// Plantower serial protocol helpers shared by the PMSx003 and DS-CO2-20
+// drivers. No Arduino dependencies so this can be unit tested on the host.
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace plantower {
+
+const uint8_t kMagic0 = 0x42;
+const uint8_t kMagic1 = 0x4d;
+
+// Two magic bytes plus the 16-bit frame length.
+const size_t kHeaderSize = 4;
+// Largest frame we accept. PMSx003 frames are 32 bytes, DS-CO2-20 frames are
+// 12 bytes; the PMS5003ST sends 40.
+const size_t kMaxFrameSize = 40;
+
+enum class FrameStatus {
+  kOk = 0,
+  kBadSize,
+  kBadMagic,
+  kBadLength,
+  kBadChecksum,
+  kOutOfRange,
+};
+
+const char* FrameStatusName(FrameStatus status);
+
+// Checks the size, magic bytes, length field and checksum of a complete
+// frame. Silent so it can run on every frame; callers decide what to log.
+FrameStatus VerifyFrame(const uint8_t* frame, size_t size);
+
+inline uint16_t ReadWord(const uint8_t* frame, size_t offset) {
+  return (frame[offset] << 8) | frame[offset + 1];
+}
+
+// Host to sensor commands: 0x42 0x4d <cmd> <data:16> <checksum:16>.
+const size_t kCommandSize = 7;
+
+// Fills command with cmd and its 16-bit argument, checksum included.
+void BuildCommand(uint8_t cmd, uint16_t data, uint8_t (&command)[kCommandSize]);
+
+// One big-endian 16-bit field of a device's frame, and where it lands in the
+// driver's DataT. A field either stores the raw word, or a scaled value that
+// is optionally smoothed by an EWMA over ewma_periods samples. Samples
+// outside [min_value, max_value] reject the whole frame as an outlier.
+template <typename DataT>
+struct Field {
+  const char* name;
+  uint8_t offset;
+  bool is_signed;
+  float scale;
+  float min_value;
+  float max_value;
+  uint16_t DataT::*raw;
+  float DataT::*value;
+  int ewma_periods;
+};
+
+template <typename DataT>
+constexpr Field<DataT> RawField(const char* name, uint8_t offset,
+                                uint16_t DataT::*raw, float min_value = 0,
+                                float max_value = 0xffff) {
+  return {name, offset, false, 1, min_value, max_value, raw, nullptr, 0};
+}
+
+template <typename DataT>
+constexpr Field<DataT> ValueField(const char* name, uint8_t offset,
+                                  float DataT::*value, int ewma_periods = 0,
+                                  float scale = 1, bool is_signed = false) {
+  return {name,          offset,  is_signed, scale, -1e9f,
+          1e9f,          nullptr, value,     ewma_periods};
+}
+
+// True when every field sits between the header and the checksum of a
+// frame_size byte frame. Meant for static_assert() next to each layout.
+template <typename DataT, size_t N>
+constexpr bool FitsInFrame(const Field<DataT> (&fields)[N], size_t frame_size) {
+  for (size_t i = 0; i < N; ++i) {
+    if (fields[i].offset < kHeaderSize ||
+        fields[i].offset + 2u > frame_size - 2u ||
+        (fields[i].raw == nullptr) == (fields[i].value == nullptr)) {
+      return false;
+    }
+  }
+  return frame_size <= kMaxFrameSize;
+}
+
+typedef float (*EwmaFn)(float new_value, float prev_ewma, int periods);
+
+// Verifies a frame_size byte frame and decodes every field of the layout into
+// data. Nothing is written unless the whole frame is valid.
+template <size_t kFrameSize, typename DataT, size_t N>
+FrameStatus Decode(const Field<DataT> (&fields)[N], const uint8_t* frame,
+                   size_t size, DataT* data, EwmaFn ewma) {
+  static_assert(kFrameSize <= kMaxFrameSize, "frame too large");
+  if (size != kFrameSize) {
+    return FrameStatus::kBadSize;
+  }
+  FrameStatus status = VerifyFrame(frame, size);
+  if (status != FrameStatus::kOk) {
+    return status;
+  }
+
+  float values[N];
+  for (size_t i = 0; i < N; ++i) {
+    uint16_t word = ReadWord(frame, fields[i].offset);
+    float value = fields[i].is_signed ? static_cast<int16_t>(word) : word;
+    values[i] = value * fields[i].scale;
+    if (values[i] < fields[i].min_value || values[i] > fields[i].max_value) {
+      return FrameStatus::kOutOfRange;
+    }
+  }
+  for (size_t i = 0; i < N; ++i) {
+    const Field<DataT>& field = fields[i];
+    if (field.raw != nullptr) {
+      data->*field.raw = ReadWord(frame, field.offset);
+    } else if (field.ewma_periods > 0) {
+      data->*field.value =
+          ewma(values[i], data->*field.value, field.ewma_periods);
+    } else {
+      data->*field.value = values[i];
+    }
+  }
+  return FrameStatus::kOk;
+}
+
+// Incremental parser for Plantower frames:
+//   0x42 0x4d <length:16> <payload> <checksum:16>
+// where length counts the payload and checksum bytes, and the checksum is the
+// 16-bit sum of every byte before it.
+//
+// Bytes are written straight into the frame buffer, and parsing stops as soon
+// as a complete, checksummed frame is available so it can be decoded in place
+// with frame() before more bytes are fed in.
+class FrameParser {
+ public:
+  struct Stats {
+    uint32_t frames;
+    uint32_t skipped_bytes;
+    uint32_t bad_length;
+    uint32_t bad_checksum;
+    uint32_t overruns;
+  };
+
+  // Feeds bytes to the parser, returning how many were consumed. Stops right
+  // after a complete frame, so callers should check ready() and call again
+  // with the remaining bytes.
+  size_t Feed(const uint8_t* data, size_t size);
+
+  // Zero-copy feeding: returns where the next bytes belong and sets *size to
+  // how many may be written there. Follow with Commit() of the bytes actually
+  // written. Header bytes are taken one at a time; the rest of the frame is
+  // handed out in one piece.
+  uint8_t* Reserve(size_t* size);
+  void Commit(size_t size);
+
+  // Drains whatever a Stream-like source (available()/readBytes()) has
+  // buffered, without blocking. Returns true when a new frame is ready.
+  template <typename StreamT>
+  bool ReadFrom(StreamT* stream) {
+    for (;;) {
+      int available = stream->available();
+      if (available <= 0) {
+        return false;
+      }
+      size_t want = 0;
+      uint8_t* dst = Reserve(&want);
+      if (want > static_cast<size_t>(available)) {
+        want = available;
+      }
+      size_t got = stream->readBytes(dst, want);
+      if (got == 0) {
+        return false;
+      }
+      Commit(got);
+      if (ready_) {
+        return true;
+      }
+    }
+  }
+
+  // Bytes were dropped by the driver (RX FIFO or ring buffer overrun), so any
+  // partial frame is garbage.
+  void Overrun();
+
+  bool ready() const { return ready_; }
+  const uint8_t* frame() const { return buffer_; }
+  size_t frame_size() const { return ready_ ? size_ : 0; }
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  enum State {
+    kWantMagic0 = 0,
+    kWantMagic1,
+    kWantLengthHigh,
+    kWantLengthLow,
+    kWantBody,
+  };
+
+  void Resync();
+  void CommitHeaderByte(uint8_t c);
+
+  State state_ = kWantMagic0;
+  bool ready_ = false;
+  size_t size_ = 0;
+  size_t frame_size_ = 0;
+  uint16_t checksum_ = 0;
+  uint8_t buffer_[kMaxFrameSize] = {0};
+  Stats stats_ = {};
+};
+
+}  // namespace plantower
+
+#endif  // _PLANTOWER_H_
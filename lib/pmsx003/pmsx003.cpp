@@ -6,188 +6,351 @@
 namespace pmsx003 {
 namespace {
 const char TAG[] = "pmsx003";
-} // namespace
+const int kRxBufferSize = 256;
+const int kEventQueueSize = 8;
+const unsigned long kReadTimeoutMs = 5000;
+const int kEwmaPeriods = 11;
 
-using dump::Ewma;
+const uint8_t kCmdRead = 0xe2;
+const uint8_t kCmdMode = 0xe1;
+const uint8_t kCmdSleep = 0xe4;
+// Sampling gives up if the passive mode queries go unanswered this long
+// beyond one per second.
+const unsigned long kSampleSlackMs = 5000;
+
+// Frame layout shared by the PMS5003/PMS7003/PMSA003: all fields are
+// big-endian 16-bit words.
+constexpr plantower::Field<Data> kFields[] = {
+    plantower::RawField("pm1_raw", 4, &Data::pm1Raw),
+    plantower::RawField("pm25_raw", 6, &Data::pm25Raw),
+    plantower::RawField("pm10_raw", 8, &Data::pm10Raw),
+    plantower::ValueField("pm_1_0", 10, &Data::pm_1_0, kEwmaPeriods),
+    plantower::ValueField("pm_2_5", 12, &Data::pm_2_5, kEwmaPeriods),
+    plantower::ValueField("pm_10_0", 14, &Data::pm_10_0, kEwmaPeriods),
+    plantower::ValueField("particles_gt_0_3", 16, &Data::particles_gt_0_3,
+                          kEwmaPeriods),
+    plantower::ValueField("particles_gt_0_5", 18, &Data::particles_gt_0_5,
+                          kEwmaPeriods),
+    plantower::ValueField("particles_gt_1_0", 20, &Data::particles_gt_1_0,
+                          kEwmaPeriods),
+    plantower::ValueField("particles_gt_2_5", 22, &Data::particles_gt_2_5,
+                          kEwmaPeriods),
+    plantower::ValueField("particles_gt_5_0", 24, &Data::particles_gt_5_0,
+                          kEwmaPeriods),
+    plantower::ValueField("particles_gt_10_0", 26,
+                          &Data::particles_gt_10_0, kEwmaPeriods),
+};
+static_assert(plantower::FitsInFrame(kFields, kFrameSize),
+              "PMSx003 field outside frame");
+
+}  // namespace
 
 bool VerifyPacket(uint8_t* packet, int size) {
-  if (size < 6) {
-    Serial.print("ERROR: Plantower: Invalid Packet Size!\n");
+  return plantower::VerifyFrame(packet, size) == plantower::FrameStatus::kOk;
+}
+
+bool InitUart(TaskData* data, uart_port_t uart, int rx_pin, int tx_pin) {
+  uart_config_t config = {
+      .baud_rate = 9600,
+      .data_bits = UART_DATA_8_BITS,
+      .parity = UART_PARITY_DISABLE,
+      .stop_bits = UART_STOP_BITS_1,
+      .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+  };
+  esp_err_t err = uart_param_config(uart, &config);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "uart_param_config() failed: %s", esp_err_to_name(err));
     return false;
   }
-
-  // First two magic bytes: 0x42 0x4d
-  if (packet[0] != 0x42 || packet[1] != 0x4d) {
-    Serial.print("ERROR: Plantower: Invalid packet, unxpected magic bytes: ");
-    Serial.print(packet[0], HEX);
-    Serial.print(" ");
-    Serial.print(packet[1], HEX);
-    Serial.print("\n");
+  err = uart_set_pin(uart, tx_pin, rx_pin, UART_PIN_NO_CHANGE,
+                     UART_PIN_NO_CHANGE);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "uart_set_pin() failed: %s", esp_err_to_name(err));
     return false;
   }
-
-  // remaining bytes (does not includ magic, or length)
-  uint16_t frameSize = (packet[2] << 8) | packet[3];
-  if ((frameSize + 4) > size) {
-    Serial.print("ERROR: Plantower: Invalid packet, too long! Frame length: ");
-    Serial.print(frameSize);
-    Serial.print("\n");
+  err = uart_driver_install(uart, kRxBufferSize, /*tx_buffer_size=*/0,
+                            kEventQueueSize, &data->uart_queue,
+                            /*intr_alloc_flags=*/0);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "uart_driver_install() failed: %s", esp_err_to_name(err));
     return false;
-  } else if ((frameSize + 4) < size) {
-    Serial.print("WARN: Plantower: frame length+6 < buffer size: ");
-    Serial.print(frameSize);
-    Serial.print("\n");
   }
+  // Raise one UART_DATA event per frame instead of interrupting every few
+  // bytes; the RX timeout still flushes partial frames.
+  uart_set_rx_full_threshold(uart, kFrameSize);
+  data->uart = uart;
 
-  uint16_t checksumOffset = 4 + frameSize - 2;
-  uint16_t checksum = 0;
-  for (int i = 0; i < checksumOffset; ++i) {
-    checksum += packet[i];
+  if (data->duty_cycle.period_ms == 0) {
+    data->state = State::kActive;
+    return SetSleep(data, false) && SetPassiveMode(data, false);
   }
-  if (checksum !=
-      ((packet[checksumOffset] << 8) | packet[checksumOffset + 1])) {
-    Serial.print(
-        "ERROR: Plantower: Invalid packet, unxpected checksum, calculated: ");
-    Serial.print(checksum >> 8, HEX);
-    Serial.print(" ");
-    Serial.print(checksum & 0xff, HEX);
-    Serial.print(", got: ");
-    Serial.print(packet[checksumOffset], HEX);
-    Serial.print(" ");
-    Serial.print(packet[checksumOffset + 1], HEX);
-    Serial.print("\n");
+  data->state = State::kSleeping;
+  data->next_wake_ms = 0;
+  return SetSleep(data, true);
+}
+
+namespace {
+
+bool SendCommand(TaskData* data, uint8_t cmd, uint16_t arg) {
+  uint8_t command[plantower::kCommandSize];
+  plantower::BuildCommand(cmd, arg, command);
+  int written = uart_write_bytes(data->uart,
+                                 reinterpret_cast<const char*>(command),
+                                 sizeof(command));
+  if (written != sizeof(command)) {
+    ESP_LOGE(TAG, "SendCommand(0x%02x, %d): wrote %d bytes", cmd, arg,
+             written);
     return false;
   }
-
-  // All good!
   return true;
 }
 
-bool Read(Stream* serial, TaskData* data, unsigned long timeout_ms) {
-  unsigned long start_time_ms = millis();
+}  // namespace
+
+bool SetPassiveMode(TaskData* data, bool passive) {
+  return SendCommand(data, kCmdMode, passive ? 0 : 1);
+}
+
+bool RequestRead(TaskData* data) { return SendCommand(data, kCmdRead, 0); }
+
+bool SetSleep(TaskData* data, bool sleep) {
+  return SendCommand(data, kCmdSleep, sleep ? 0 : 1);
+}
+
+const char* StateName(State state) {
+  switch (state) {
+    case State::kActive:
+      return "active";
+    case State::kSleeping:
+      return "sleeping";
+    case State::kStabilizing:
+      return "stabilizing";
+    case State::kSampling:
+      return "sampling";
+  }
+  return "unknown";
+}
+
+plantower::FrameStatus Decode(const uint8_t* frame, size_t size, Data* data) {
+  return plantower::Decode<kFrameSize>(kFields, frame, size, data,
+                                       dump::Ewma);
+}
+
+namespace {
+
+float NoEwma(float new_value, float prev_ewma, int periods) {
+  return new_value;
+}
+
+enum class DrainMode {
+  // Fan still spinning up, or a frame we didn't ask for.
+  kDiscard,
+  // Active mode: fold every frame into the EWMAs.
+  kSmooth,
+  // Passive mode: add every frame to the running sum.
+  kAccumulate,
+};
+
+void Accumulate(const Data& sample, Data* sum) {
+  for (const auto& field : kFields) {
+    if (field.value != nullptr) {
+      sum->*field.value += sample.*field.value;
+    } else {
+      sum->*field.raw = sample.*field.raw;
+    }
+  }
+}
+
+void Average(const Data& sum, int count, Data* data) {
+  for (const auto& field : kFields) {
+    if (field.value != nullptr) {
+      data->*field.value = sum.*field.value / count;
+    } else {
+      data->*field.raw = sum.*field.raw;
+    }
+  }
+}
 
-  // Get to packet start byte
-  while (true) {
-    int c = serial->peek();
-    if (c == 0x42) {
+// Moves everything the UART driver has buffered straight into the parser's
+// frame buffer, handling each complete frame in place. Returns the number of
+// frames decoded.
+int DrainUart(TaskData* data, DrainMode mode) {
+  int frames = 0;
+  size_t buffered = 0;
+  uart_get_buffered_data_len(data->uart, &buffered);
+  while (buffered > 0) {
+    size_t want = 0;
+    uint8_t* dst = data->parser.Reserve(&want);
+    if (want > buffered) {
+      want = buffered;
+    }
+    int read = uart_read_bytes(data->uart, dst, want, /*ticks_to_wait=*/0);
+    if (read <= 0) {
       break;
     }
-    if (millis() - start_time_ms >= timeout_ms) {
-      Serial.print("ERROR: PMSx003: timed out waiting for data\n");
-      return false;
+    buffered -= read;
+    data->parser.Commit(read);
+    if (!data->parser.ready()) {
+      continue;
     }
-    if (c == -1) {
-      // Nothing there.
-      delay(10);
+    if (data->parser.frame_size() != kFrameSize) {
+      // Command acks are 8 byte frames.
+      ESP_LOGD(TAG, "DrainUart(): %d byte frame, cmd: 0x%02x",
+               static_cast<int>(data->parser.frame_size()),
+               data->parser.frame()[4]);
       continue;
-    } else {
-      Serial.print("WARN: PMSx003: Waiting for 0x42, got: 0x");
-      Serial.println(c, HEX);
-      Serial.println(serial->read(), HEX);
+    }
+    if (mode == DrainMode::kDiscard) {
       continue;
     }
-  }
 
-  const int kPacketSize = 32;
-  uint8_t buffer[kPacketSize] = {0};
-  while (serial->available() < kPacketSize) {
-    if (millis() - start_time_ms >= timeout_ms) {
-      Serial.print("ERROR: PMSx003: timed out waiting for PMSx003 data\n");
-      return false;
+    Data sample = {};
+    Data* dst_data = mode == DrainMode::kSmooth ? &data->data : &sample;
+    auto status = plantower::Decode<kFrameSize>(
+        kFields, data->parser.frame(), data->parser.frame_size(), dst_data,
+        mode == DrainMode::kSmooth ? dump::Ewma : NoEwma);
+    if (status != plantower::FrameStatus::kOk) {
+      ESP_LOGW(TAG, "DrainUart(): dropping %d byte frame: %s",
+               static_cast<int>(data->parser.frame_size()),
+               plantower::FrameStatusName(status));
+      continue;
     }
-    delay(10);
+    if (mode == DrainMode::kAccumulate) {
+      Accumulate(sample, &data->sum);
+      ++data->sample_count;
+    }
+    ++frames;
   }
-  if (serial->readBytes(buffer, kPacketSize) < kPacketSize) {
-    Serial.print("ERROR: PMSx003: WTF: did not read enough bytes");
-    return false;
+  return frames;
+}
+
+void Publish(TaskData* data, unsigned long cycle_ms) {
+  data->last_frame_ms = cycle_ms;
+  if (data->topic != nullptr) {
+    data->topic->Publish(data->data, cycle_ms);
   }
+}
 
-  /*
-Serial.print("\nPMSx003 data:\n");
-Serial.print("  Raw: ");
-int val;
-for (int i = 0; i+1 < kPacketSize; i += 2) {
-  // 16-bit big-endian values.
-  val = (buffer[i] << 8) | buffer[i+1];
-  Serial.print(val);
-  Serial.print(" ");
-}
-Serial.println("");
-  */
-
-  if (!VerifyPacket(buffer, sizeof(buffer))) {
-    Serial.print("ERROR: PMSx003: Packet error!\n");
-    return false;
+void Enter(TaskData* data, State state, unsigned long cycle_ms) {
+  ESP_LOGD(TAG, "%s -> %s", StateName(data->state), StateName(state));
+  data->state = state;
+  data->state_ms = cycle_ms;
+}
+
+void PollActive(TaskData* data, unsigned long cycle_ms) {
+  if (DrainUart(data, DrainMode::kSmooth) > 0) {
+    Publish(data, cycle_ms);
+    return;
   }
+  if (cycle_ms - data->last_frame_ms > kReadTimeoutMs) {
+    ESP_LOGE(TAG, "Poll(): no data from PMSx003 in %lu ms",
+             cycle_ms - data->last_frame_ms);
+  }
+}
 
-  data->pm1Raw = (buffer[4] << 8) | buffer[5];
-  data->pm25Raw = (buffer[6] << 8) | buffer[7];
-  data->pm10Raw = (buffer[8] << 8) | buffer[9];
-
-  uint16_t pm_1_0 = (buffer[10] << 8) | buffer[11];
-  data->pm_1_0 = Ewma(pm_1_0, data->pm_1_0, 11);
-  uint16_t pm_2_5 = (buffer[12] << 8) | buffer[13];
-  data->pm_2_5 = Ewma(pm_2_5, data->pm_2_5, 11);
-  uint16_t pm_10_0 = (buffer[14] << 8) | buffer[15];
-  data->pm_10_0 = Ewma(pm_10_0, data->pm_10_0, 11);
-
-  uint16_t particles_gt_0_3 = (buffer[16] << 8) | buffer[17];
-  data->particles_gt_0_3 = Ewma(particles_gt_0_3, data->particles_gt_0_3, 11);
-  uint16_t particles_gt_0_5 = (buffer[18] << 8) | buffer[19];
-  data->particles_gt_0_5 = Ewma(particles_gt_0_5, data->particles_gt_0_5, 11);
-  uint16_t particles_gt_1_0 = (buffer[20] << 8) | buffer[21];
-  data->particles_gt_1_0 = Ewma(particles_gt_1_0, data->particles_gt_1_0, 11);
-  uint16_t particles_gt_2_5 = (buffer[22] << 8) | buffer[23];
-  data->particles_gt_2_5 = Ewma(particles_gt_2_5, data->particles_gt_2_5, 11);
-  uint16_t particles_gt_5_0 = (buffer[24] << 8) | buffer[25];
-  data->particles_gt_5_0 = Ewma(particles_gt_5_0, data->particles_gt_5_0, 11);
-  uint16_t particles_gt_10_0 = (buffer[26] << 8) | buffer[27];
-  data->particles_gt_10_0 =
-      Ewma(particles_gt_10_0, data->particles_gt_10_0, 11);
-
-  /*
-Serial.print("  [ug/m^3] PM1.0: ");
-Serial.print(data->pm_1_0);
-Serial.print("  PM2.5: ");
-Serial.print(data->pm_2_5);
-Serial.print("  PM10: ");
-Serial.print(data->pm_10_0);
-Serial.println();
-  */
+// Sleeping -> stabilizing -> sampling -> sleeping, with the times taken from
+// the scheduler's cycle timeline. Nothing read before the end of the
+// stabilization window is used.
+void PollDutyCycle(TaskData* data, unsigned long cycle_ms) {
+  const DutyCycle& duty_cycle = data->duty_cycle;
+  switch (data->state) {
+    case State::kActive:
+      break;
 
-  return true;
+    case State::kSleeping:
+      DrainUart(data, DrainMode::kDiscard);
+      if (static_cast<long>(cycle_ms - data->next_wake_ms) < 0) {
+        return;
+      }
+      // Wake-to-wake, so the period doesn't stretch by the awake time.
+      data->next_wake_ms += duty_cycle.period_ms;
+      if (static_cast<long>(cycle_ms - data->next_wake_ms) >= 0) {
+        data->next_wake_ms = cycle_ms + duty_cycle.period_ms;
+      }
+      SetSleep(data, false);
+      Enter(data, State::kStabilizing, cycle_ms);
+      return;
+
+    case State::kStabilizing:
+      DrainUart(data, DrainMode::kDiscard);
+      if (cycle_ms - data->state_ms < duty_cycle.stabilize_ms) {
+        return;
+      }
+      // Switch to queries so every sample we average is one we asked for
+      // after the fan settled.
+      SetPassiveMode(data, true);
+      data->sum = {};
+      data->sample_count = 0;
+      Enter(data, State::kSampling, cycle_ms);
+      RequestRead(data);
+      return;
+
+    case State::kSampling:
+      DrainUart(data, DrainMode::kAccumulate);
+      if (data->sample_count < duty_cycle.samples) {
+        if (cycle_ms - data->state_ms >
+            duty_cycle.samples * 1000ul + kSampleSlackMs) {
+          ESP_LOGE(TAG, "Poll(): only %d of %d samples, going back to sleep",
+                   data->sample_count, duty_cycle.samples);
+          SetSleep(data, true);
+          Enter(data, State::kSleeping, cycle_ms);
+          return;
+        }
+        RequestRead(data);
+        return;
+      }
+      Average(data->sum, data->sample_count, &data->data);
+      Publish(data, cycle_ms);
+      SetSleep(data, true);
+      Enter(data, State::kSleeping, cycle_ms);
+      return;
+  }
 }
 
-void TaskPoll(void* task_param) {
-  auto* task_data = reinterpret_cast<TaskData*>(task_param);
-  unsigned long last_print_time_ms = 0;
-  for (;;) {
-    if (!pmsx003::Read(task_data->serial, task_data, /*timeout_ms=*/5000)) {
-      Serial.print("ERROR: failed to read PMSX003 sensor");
-      delay(1000);
-      continue;
-    }
+}  // namespace
 
-    if ((millis() - last_print_time_ms) < 10 * 60 * 1000 &&
-        last_print_time_ms) {
-      continue;
+void Poll(void* task_data_arg, unsigned long cycle_ms) {
+  auto* task_data = reinterpret_cast<TaskData*>(task_data_arg);
+
+  // The data itself is drained below whether or not there are events; the
+  // events only matter for overruns.
+  uart_event_t event;
+  while (xQueueReceive(task_data->uart_queue, &event, /*ticks_to_wait=*/0) ==
+         pdTRUE) {
+    if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+      // Bytes were dropped; whatever partial frame we have is garbage.
+      ESP_LOGW(TAG, "Poll(): RX overrun (event: %d)", event.type);
+      uart_flush_input(task_data->uart);
+      xQueueReset(task_data->uart_queue);
+      task_data->parser.Overrun();
+      return;
     }
-    last_print_time_ms = millis();
-
-    ESP_LOGI(TAG, "pmsx003::TaskPoll(): uptime: %s core: %d stackHighWater: %d",
-             dump::MillisHumanReadable(millis()).c_str(), xPortGetCoreID(),
-             uxTaskGetStackHighWaterMark(nullptr));
-    Serial.print("PMSx003 data:");
-    Serial.print("  [ug/m^3] PM1.0: ");
-    Serial.print(task_data->pm_1_0);
-    Serial.print("  PM2.5: ");
-    Serial.print(task_data->pm_2_5);
-    Serial.print("  PM10: ");
-    Serial.print(task_data->pm_10_0);
-    Serial.println();
   }
 
-  vTaskDelete(NULL);
+  if (task_data->state == State::kActive) {
+    PollActive(task_data, cycle_ms);
+  } else {
+    PollDutyCycle(task_data, cycle_ms);
+  }
+}
+
+void LogStatus(void* task_data_arg, unsigned long cycle_ms) {
+  auto* task_data = reinterpret_cast<TaskData*>(task_data_arg);
+  const auto& stats = task_data->parser.stats();
+  ESP_LOGI(TAG,
+           "pmsx003::LogStatus(): uptime: %s state: %s frames: %u"
+           " skipped_bytes: %u bad_length: %u bad_checksum: %u overruns: %u",
+           dump::MillisHumanReadable(cycle_ms).c_str(),
+           StateName(task_data->state), stats.frames, stats.skipped_bytes,
+           stats.bad_length, stats.bad_checksum, stats.overruns);
+  Serial.print("PMSx003 data:");
+  Serial.print("  [ug/m^3] PM1.0: ");
+  Serial.print(task_data->data.pm_1_0);
+  Serial.print("  PM2.5: ");
+  Serial.print(task_data->data.pm_2_5);
+  Serial.print("  PM10: ");
+  Serial.print(task_data->data.pm_10_0);
+  Serial.println();
 }
 
 }  // namespace pmsx003
@@ -3,13 +3,18 @@
 
 /**
  */
-#include "Stream.h"
+#include <driver/uart.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include "plantower.h"
+#include "sensor_bus.h"
 
 namespace pmsx003 {
 
-struct TaskData {
-  Stream* serial;
+const size_t kFrameSize = 32;
 
+struct Data {
   uint16_t pm1Raw;
   uint16_t pm25Raw;
   uint16_t pm10Raw;
@@ -26,11 +31,67 @@ struct TaskData {
   float particles_gt_10_0;
 };
 
+// Sleep/wake cycling to spare the fan. The sensor wakes every period_ms,
+// runs its fan for stabilize_ms without any readings being used, then
+// answers `samples` passive mode queries whose average gets published before
+// it goes back to sleep.
+struct DutyCycle {
+  // 0 keeps the sensor awake, streaming in active mode.
+  uint32_t period_ms;
+  // Plantower asks for at least 30 s after waking for stable readings.
+  uint32_t stabilize_ms;
+  int samples;
+};
+
+enum class State : uint8_t {
+  kActive = 0,
+  kSleeping,
+  kStabilizing,
+  kSampling,
+};
+
+const char* StateName(State state);
+
+struct TaskData {
+  uart_port_t uart;
+  QueueHandle_t uart_queue;
+  plantower::FrameParser parser;
+  DutyCycle duty_cycle;
+
+  // Owned by Poll(); everyone else reads snapshots from topic.
+  Data data;
+  sensor_bus::Topic<Data>* topic;
+  unsigned long last_frame_ms;
+
+  State state;
+  // Scheduler cycle the state was entered in.
+  unsigned long state_ms;
+  unsigned long next_wake_ms;
+  // Running sum of this wake-up's samples.
+  Data sum;
+  int sample_count;
+};
+
 bool VerifyPacket(uint8_t* packet, int size);
 
-bool Read(Stream* serial, TaskData* data, unsigned long timeout_ms = 5000);
+// Installs the IDF UART driver for the sensor, with an event queue Poll()
+// checks for overruns. Set data->duty_cycle first: with a duty cycle the
+// sensor is put to sleep until the first Poll() wakes it.
+bool InitUart(TaskData* data, uart_port_t uart, int rx_pin, int tx_pin);
+
+// Sensor commands; the PMSx003 acks each with a short frame.
+bool SetPassiveMode(TaskData* data, bool passive);
+bool RequestRead(TaskData* data);
+bool SetSleep(TaskData* data, bool sleep);
+
+// Verifies and decodes a 32-byte frame into data, updating the EWMAs.
+plantower::FrameStatus Decode(const uint8_t* frame, size_t size, Data* data);
 
-void TaskPoll(void* task_data);
+// Scheduler jobs (see scheduler::JobFn); task_data is a TaskData*. The
+// sensor streams a frame about every second and passive mode reads one
+// sample per call, so Poll() should run about once a second.
+void Poll(void* task_data, unsigned long cycle_ms);
+void LogStatus(void* task_data, unsigned long cycle_ms);
 
 }  // namespace pmsx003
 
@@ -0,0 +1,161 @@
+#include "prober.h"
+
+#include <Arduino.h>
+#include <errno.h>
+#include <lwip/netdb.h>
+#include <lwip/sockets.h>
+#include <string.h>
+
+namespace prober {
+
+int Histogram::Bucket(uint32_t us) {
+  if (us < kMinUs) {
+    return 0;
+  }
+  const int msb = 31 - __builtin_clz(us);
+  const int doubling = msb - 7;  // log2(kMinUs)
+  if (doubling >= kDoublings) {
+    return kNumBuckets - 1;
+  }
+  const int sub = (us >> (msb - 3)) & (kSubBuckets - 1);
+  return 1 + doubling * kSubBuckets + sub;
+}
+
+uint32_t Histogram::Midpoint(int bucket) {
+  if (bucket == 0) {
+    return kMinUs / 2;
+  }
+  const int doubling = (bucket - 1) / kSubBuckets;
+  const int sub = (bucket - 1) % kSubBuckets;
+  const uint32_t width = 1u << (doubling + 4);
+  return (kSubBuckets + sub) * width + width / 2;
+}
+
+void Histogram::Add(uint32_t us) {
+  uint16_t& bucket = buckets_[Bucket(us)];
+  if (bucket < UINT16_MAX) {
+    ++bucket;
+  }
+  ++count_;
+}
+
+void Histogram::Clear() {
+  memset(buckets_, 0, sizeof(buckets_));
+  count_ = 0;
+}
+
+uint32_t Histogram::Quantile(double q, const Histogram* other) const {
+  // From the buckets rather than count_, which doesn't saturate.
+  uint32_t total = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    total += buckets_[i] + (other != nullptr ? other->buckets_[i] : 0);
+  }
+  if (total == 0) {
+    return 0;
+  }
+  uint32_t rank = static_cast<uint32_t>(q * total + 0.999999);
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint32_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += buckets_[i] + (other != nullptr ? other->buckets_[i] : 0);
+    if (seen >= rank) {
+      return Midpoint(i);
+    }
+  }
+  return Midpoint(kNumBuckets - 1);
+}
+
+void Target::Init() { mutex_ = xSemaphoreCreateMutex(); }
+
+void Target::Add(bool answered, uint32_t rtt_us, unsigned long now_ms) {
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  const unsigned long elapsed_ms = now_ms - window_start_ms_;
+  if (elapsed_ms >= kWindowMs) {
+    if (elapsed_ms >= 2 * kWindowMs) {
+      windows_[current_].Clear();
+    }
+    current_ ^= 1;
+    windows_[current_].Clear();
+    window_start_ms_ = now_ms;
+  }
+  ++stats_.probes;
+  if (answered) {
+    windows_[current_].Add(rtt_us);
+    stats_.last_rtt_us = rtt_us;
+  } else {
+    ++stats_.lost;
+  }
+  const Histogram* previous = &windows_[current_ ^ 1];
+  stats_.p50_us = windows_[current_].Quantile(0.50, previous);
+  stats_.p95_us = windows_[current_].Quantile(0.95, previous);
+  stats_.p99_us = windows_[current_].Quantile(0.99, previous);
+  xSemaphoreGive(mutex_);
+}
+
+Stats Target::stats() {
+  if (mutex_ == nullptr) {
+    return stats_;
+  }
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  const Stats stats = stats_;
+  xSemaphoreGive(mutex_);
+  return stats;
+}
+
+bool ConnectRtt(uint32_t ip, uint16_t port, unsigned long timeout_ms,
+                uint32_t* rtt_us) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return false;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = ip;
+
+  const unsigned long start_us = micros();
+  bool answered = false;
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) ==
+      0) {
+    answered = true;
+  } else if (errno == ECONNREFUSED) {
+    answered = true;
+  } else if (errno == EINPROGRESS) {
+    fd_set write_fds;
+    FD_ZERO(&write_fds);
+    FD_SET(fd, &write_fds);
+    struct timeval timeout = {};
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    if (select(fd + 1, nullptr, &write_fds, nullptr, &timeout) == 1) {
+      int err = 0;
+      socklen_t len = sizeof(err);
+      getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+      answered = err == 0 || err == ECONNREFUSED;
+    }
+  }
+  *rtt_us = micros() - start_us;
+  close(fd);
+  return answered;
+}
+
+bool ConnectRtt(const char* host, uint16_t port, unsigned long timeout_ms,
+                uint32_t* rtt_us) {
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* result = nullptr;
+  if (getaddrinfo(host, nullptr, &hints, &result) != 0 || result == nullptr) {
+    *rtt_us = 0;
+    return false;
+  }
+  const uint32_t ip =
+      reinterpret_cast<struct sockaddr_in*>(result->ai_addr)->sin_addr.s_addr;
+  freeaddrinfo(result);
+  return ConnectRtt(ip, port, timeout_ms, rtt_us);
+}
+
+}  // namespace prober
@@ -0,0 +1,112 @@
+#ifndef _PROBER_H_
+#define _PROBER_H_
+
+// Round trip times to the gateway and to a host upstream, for telling a bad
+// link from a bad uplink.
+//
+// A probe times a TCP connect. A refused connect is a round trip too, so the
+// gateway needs nothing listening, and unlike ICMP it needs no raw socket.
+// Each Target keeps loss counters and streaming histograms: the latest two
+// windows of kWindowMs, so its percentiles cover the last 5 to 10 minutes
+// in a fixed few hundred bytes.
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+
+namespace prober {
+
+// Log-linear buckets: kSubBuckets to each doubling from kMinUs, so any value
+// is off by at most 1/16 of itself. Counts saturate.
+class Histogram {
+ public:
+  static const int kSubBuckets = 8;
+  static const uint32_t kMinUs = 128;
+  // 128 us to 16.8 s; slower lands in the last bucket.
+  static const int kDoublings = 17;
+  static const int kNumBuckets = 1 + kDoublings * kSubBuckets;
+
+  void Add(uint32_t us);
+  void Clear();
+  uint32_t count() const { return count_; }
+  // The q quantile, 0 < q <= 1, of this histogram and other together (which
+  // may be null), as its bucket's midpoint; 0 without any values.
+  uint32_t Quantile(double q, const Histogram* other = nullptr) const;
+
+  static int Bucket(uint32_t us);
+  static uint32_t Midpoint(int bucket);
+
+ private:
+  uint16_t buckets_[kNumBuckets] = {};
+  uint32_t count_ = 0;
+};
+
+struct Stats {
+  // Since boot.
+  uint32_t probes;
+  uint32_t lost;
+  // Of the latest probe that was answered.
+  uint32_t last_rtt_us;
+  // Over the last kWindowMs to 2 * kWindowMs.
+  uint32_t p50_us;
+  uint32_t p95_us;
+  uint32_t p99_us;
+};
+
+// Safe to Add() to from one task while others read stats().
+class Target {
+ public:
+  static const unsigned long kWindowMs = 5 * 60 * 1000;
+
+  explicit Target(const char* name) : name_(name) {}
+  Target(const Target&) = delete;
+  Target& operator=(const Target&) = delete;
+
+  // Creates the lock; call before Add().
+  void Init();
+  void Add(bool answered, uint32_t rtt_us, unsigned long now_ms);
+
+  const char* name() const { return name_; }
+  // All zero before Init().
+  Stats stats();
+
+ private:
+  const char* name_;
+  SemaphoreHandle_t mutex_ = nullptr;
+  Histogram windows_[2];
+  int current_ = 0;
+  unsigned long window_start_ms_ = 0;
+  Stats stats_ = {};
+};
+
+// Connects to ip (in lwIP order) and port, waiting up to timeout_ms. True
+// if the host answered, either way, with the round trip in *rtt_us.
+bool ConnectRtt(uint32_t ip, uint16_t port, unsigned long timeout_ms,
+                uint32_t* rtt_us);
+// Resolves host first, which the round trip doesn't include. False if it
+// doesn't resolve.
+bool ConnectRtt(const char* host, uint16_t port, unsigned long timeout_ms,
+                uint32_t* rtt_us);
+
+const unsigned long kProbeIntervalMs = 10 * 1000;
+const unsigned long kProbeTimeoutMs = 2000;
+
+struct TaskData {
+  // Where to probe past the gateway; probed over TCP on upstream_port.
+  const char* upstream_host;
+  uint16_t upstream_port;
+};
+
+// Readies Gateway() and Upstream(); call from setup() before DoTask.
+void Init();
+// Probes the gateway and upstream every kProbeIntervalMs while online,
+// handing the gateway's to net_manager for roaming. task_data is a
+// TaskData*.
+void DoTask(void* task_data);
+
+Target& Gateway();
+Target& Upstream();
+
+}  // namespace prober
+
+#endif  // _PROBER_H_
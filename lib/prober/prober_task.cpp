@@ -0,0 +1,55 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_log.h>
+
+#include "net_manager.h"
+#include "prober.h"
+
+namespace prober {
+namespace {
+const char TAG[] = "prober";
+
+// DNS; a refused connect times the round trip just as well.
+const uint16_t kGatewayPort = 53;
+
+Target gateway("gateway");
+Target upstream("upstream");
+}  // namespace
+
+Target& Gateway() { return gateway; }
+Target& Upstream() { return upstream; }
+
+void Init() {
+  gateway.Init();
+  upstream.Init();
+}
+
+void DoTask(void* task_data_arg) {
+  const TaskData* task_data = reinterpret_cast<TaskData*>(task_data_arg);
+  ESP_LOGI(TAG, "Probing the gateway and %s:%u", task_data->upstream_host,
+           task_data->upstream_port);
+  for (;;) {
+    net_manager::WaitOnline(portMAX_DELAY);
+    const unsigned long start_ms = millis();
+
+    uint32_t rtt_us = 0;
+    bool answered = ConnectRtt(static_cast<uint32_t>(WiFi.gatewayIP()),
+                               kGatewayPort, kProbeTimeoutMs, &rtt_us);
+    gateway.Add(answered, rtt_us, millis());
+    net_manager::AddGatewayProbe(answered, rtt_us);
+
+    answered = ConnectRtt(task_data->upstream_host, task_data->upstream_port,
+                          kProbeTimeoutMs, &rtt_us);
+    upstream.Add(answered, rtt_us, millis());
+    ESP_LOGV(TAG, "upstream: %s in %u us", answered ? "answered" : "lost",
+             rtt_us);
+
+    const unsigned long elapsed_ms = millis() - start_ms;
+    if (elapsed_ms < kProbeIntervalMs) {
+      vTaskDelay((kProbeIntervalMs - elapsed_ms) / portTICK_PERIOD_MS);
+    }
+  }
+  vTaskDelete(nullptr);
+}
+
+}  // namespace prober
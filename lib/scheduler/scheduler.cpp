@@ -0,0 +1,126 @@
+#include "scheduler.h"
+
+#include <Arduino.h>
+#include <dump.h>
+#include <esp_log.h>
+
+namespace scheduler {
+namespace {
+const char TAG[] = "scheduler";
+const unsigned long kStatsPeriodMs = 10 * 60 * 1000;
+}  // namespace
+
+int Scheduler::AddJob(const char* name, JobFn fn, void* arg,
+                      uint32_t period_ms, uint32_t phase_ms) {
+  if (job_count_ >= kMaxJobs) {
+    ESP_LOGE(TAG, "AddJob(): no room for %s", name);
+    return -1;
+  }
+  period_ms -= period_ms % tick_ms_;
+  phase_ms -= phase_ms % tick_ms_;
+  if (period_ms == 0 || phase_ms >= period_ms) {
+    ESP_LOGE(TAG, "AddJob(): %s: bad period: %u ms phase: %u ms", name,
+             period_ms, phase_ms);
+    return -1;
+  }
+  Job& job = jobs_[job_count_];
+  job.name = name;
+  job.fn = fn;
+  job.arg = arg;
+  job.period_ms = period_ms;
+  job.phase_ms = phase_ms;
+  job.next_due_ms = phase_ms;
+  job.stats = {};
+  return job_count_++;
+}
+
+bool Scheduler::Start(const char* task_name, uint32_t stack_size,
+                      UBaseType_t priority) {
+  if (xTaskCreate(Task, task_name, stack_size, /*param=*/this, priority,
+                  /*handle=*/nullptr) != pdPASS) {
+    ESP_LOGE(TAG, "Start(): xTaskCreate() failed");
+    return false;
+  }
+  return true;
+}
+
+void Scheduler::Task(void* scheduler) {
+  reinterpret_cast<Scheduler*>(scheduler)->Loop();
+  vTaskDelete(NULL);
+}
+
+void Scheduler::Loop() {
+  const TickType_t tick_ticks =
+      std::max<TickType_t>(1, tick_ms_ / portTICK_PERIOD_MS);
+  TickType_t last_wake = xTaskGetTickCount();
+  // The timeline starts now; elapsed_ms counts scheduled time, not wall time,
+  // so periods never accumulate drift.
+  const unsigned long start_ms = millis();
+  // 64 bits so it survives millis() wrapping.
+  uint64_t elapsed_ms = 0;
+  unsigned long last_print_time_ms = start_ms;
+
+  for (;;) {
+    for (int i = 0; i < job_count_; ++i) {
+      Job& job = jobs_[i];
+      if (elapsed_ms < job.next_due_ms) {
+        continue;
+      }
+      // Overdue after an overrun: only the latest cycle it missed.
+      const uint64_t missed = (elapsed_ms - job.next_due_ms) / job.period_ms;
+      job.stats.skipped += missed;
+      const uint64_t due_ms = job.next_due_ms + missed * job.period_ms;
+      job.next_due_ms = due_ms + job.period_ms;
+      uint32_t start_us = micros();
+      job.fn(job.arg, /*cycle_ms=*/start_ms + due_ms - job.phase_ms);
+      uint32_t run_us = micros() - start_us;
+
+      ++job.stats.runs;
+      job.stats.total_run_us += run_us;
+      if (run_us > job.stats.max_run_us) {
+        job.stats.max_run_us = run_us;
+      }
+      if (millis() - (start_ms + due_ms) >= tick_ms_) {
+        ++job.stats.late;
+      }
+    }
+
+    if (millis() - last_print_time_ms >= kStatsPeriodMs) {
+      last_print_time_ms = millis();
+      LogStats();
+    }
+
+    vTaskDelayUntil(&last_wake, tick_ticks);
+    elapsed_ms += tick_ms_;
+    // If the jobs overran, vTaskDelayUntil() returns right away; skip the
+    // ticks we missed rather than running them back to back. Jobs due in
+    // them are overdue on the next one.
+    while (static_cast<int32_t>(xTaskGetTickCount() - last_wake) >=
+           static_cast<int32_t>(tick_ticks)) {
+      last_wake += tick_ticks;
+      elapsed_ms += tick_ms_;
+      ++overruns_;
+    }
+  }
+}
+
+void Scheduler::LogStats() const {
+  ESP_LOGI(TAG,
+           "scheduler: uptime: %s core: %d stackHighWater: %d tick: %u ms"
+           " overruns: %u",
+           dump::MillisHumanReadable(millis()).c_str(), xPortGetCoreID(),
+           uxTaskGetStackHighWaterMark(nullptr), tick_ms_, overruns_);
+  for (int i = 0; i < job_count_; ++i) {
+    const Job& job = jobs_[i];
+    uint32_t runs = std::max<uint32_t>(1, job.stats.runs);
+    ESP_LOGI(TAG,
+             "  %s: period: %u ms phase: %u ms runs: %u late: %u skipped: %u"
+             " run_us avg: %u max: %u",
+             job.name, job.period_ms, job.phase_ms, job.stats.runs,
+             job.stats.late, job.stats.skipped,
+             static_cast<uint32_t>(job.stats.total_run_us / runs),
+             job.stats.max_run_us);
+  }
+}
+
+}  // namespace scheduler
@@ -0,0 +1,84 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+// Runs periodic jobs cooperatively from a single task on a fixed,
+// vTaskDelayUntil() based timeline, instead of one task per sensor with its
+// own delay() arithmetic.
+//
+// Every job has a period and a phase offset, both multiples of the
+// scheduler's tick. A job runs at phase, phase + period, phase + 2 * period,
+// ... and is handed the start of the cycle it belongs to, so jobs with the
+// same period share one timestamp per cycle even when their phases spread
+// them out to keep the I2C bus quiet.
+//
+// When the jobs overrun, the ticks they ran into are skipped rather than
+// run back to back; a job that fell due in them runs once on the next tick,
+// for the latest cycle it missed.
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdint.h>
+
+namespace scheduler {
+
+// Jobs may block briefly (e.g. on an I2C transaction), but everything due on
+// a tick has to finish within the tick or later jobs run late.
+typedef void (*JobFn)(void* arg, unsigned long cycle_ms);
+
+struct JobStats {
+  uint32_t runs;
+  // Runs that started a tick or more after they were due.
+  uint32_t late;
+  // Cycles dropped because a later one was due by the time it ran.
+  uint32_t skipped;
+  uint32_t max_run_us;
+  uint64_t total_run_us;
+};
+
+struct Job {
+  const char* name;
+  JobFn fn;
+  void* arg;
+  uint32_t period_ms;
+  uint32_t phase_ms;
+  // When it is next due, in the scheduler's elapsed time.
+  uint64_t next_due_ms;
+  JobStats stats;
+};
+
+class Scheduler {
+ public:
+  static const int kMaxJobs = 16;
+
+  explicit Scheduler(uint32_t tick_ms) : tick_ms_(tick_ms) {}
+  Scheduler(const Scheduler&) = delete;
+  Scheduler& operator=(const Scheduler&) = delete;
+
+  // Registers a job; period_ms and phase_ms are rounded down to whole ticks.
+  // Returns the job's id, or -1 on error. Call before Start().
+  int AddJob(const char* name, JobFn fn, void* arg, uint32_t period_ms,
+             uint32_t phase_ms = 0);
+
+  bool Start(const char* task_name, uint32_t stack_size,
+             UBaseType_t priority);
+
+  int job_count() const { return job_count_; }
+  const Job& job(int id) const { return jobs_[id]; }
+  // Ticks where the jobs overran into the next tick.
+  uint32_t overruns() const { return overruns_; }
+
+  void LogStats() const;
+
+ private:
+  static void Task(void* scheduler);
+  void Loop();
+
+  const uint32_t tick_ms_;
+  uint32_t overruns_ = 0;
+  Job jobs_[kMaxJobs] = {};
+  int job_count_ = 0;
+};
+
+}  // namespace scheduler
+
+#endif  // _SCHEDULER_H_
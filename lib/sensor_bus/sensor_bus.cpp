@@ -0,0 +1,79 @@
+#include "sensor_bus.h"
+
+#include <esp_log.h>
+#include <freertos/semphr.h>
+
+namespace sensor_bus {
+namespace {
+const char TAG[] = "sensor_bus";
+
+struct Registered {
+  // Null for a free slot.
+  EventGroupHandle_t group;
+  EventBits_t bits;
+};
+
+// Guards readers.
+SemaphoreHandle_t registry_mutex = nullptr;
+Registered readers[Reader::kMaxReaders];
+}  // namespace
+
+void Init() {
+  if (registry_mutex == nullptr) {
+    registry_mutex = xSemaphoreCreateMutex();
+  }
+}
+
+Reader::Reader(EventBits_t bits) : bits_(bits) {
+  xSemaphoreTake(registry_mutex, portMAX_DELAY);
+  for (Registered& reader : readers) {
+    if (reader.group == nullptr) {
+      group_ = xEventGroupCreate();
+      reader = {group_, bits};
+      break;
+    }
+  }
+  xSemaphoreGive(registry_mutex);
+  if (group_ == nullptr) {
+    ESP_LOGE(TAG, "Out of readers; this one will only time out");
+  }
+}
+
+Reader::~Reader() {
+  if (group_ == nullptr) {
+    return;
+  }
+  xSemaphoreTake(registry_mutex, portMAX_DELAY);
+  for (Registered& reader : readers) {
+    if (reader.group == group_) {
+      reader = {};
+    }
+  }
+  xSemaphoreGive(registry_mutex);
+  vEventGroupDelete(group_);
+}
+
+EventBits_t Reader::Wait(TickType_t timeout_ticks) {
+  if (group_ == nullptr) {
+    vTaskDelay(timeout_ticks);
+    return 0;
+  }
+  return xEventGroupWaitBits(group_, bits_, /*clear_on_exit=*/pdTRUE,
+                             /*wait_for_all_bits=*/pdFALSE, timeout_ticks) &
+         bits_;
+}
+
+void Notify(EventBits_t bits) {
+  if (registry_mutex == nullptr) {
+    return;
+  }
+  xSemaphoreTake(registry_mutex, portMAX_DELAY);
+  for (const Registered& reader : readers) {
+    if (reader.group != nullptr && (reader.bits & bits)) {
+      xEventGroupSetBits(reader.group, reader.bits & bits);
+    }
+  }
+  xSemaphoreGive(registry_mutex);
+}
+
+}  // namespace sensor_bus
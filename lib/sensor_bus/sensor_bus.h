@@ -0,0 +1,160 @@
+#ifndef _SENSOR_BUS_H_
+#define _SENSOR_BUS_H_
+
+// Publish/subscribe hand-off of sensor readings between the poll tasks and
+// everything that displays or exports them.
+//
+// Each driver publishes immutable, timestamped, sequence-numbered snapshots
+// into a Topic. Writers never wait on readers: a Topic keeps two slots and
+// alternates between them, each guarded by a seqlock, so a reader copies the
+// latest complete snapshot and only retries if the writer lapped it
+// mid-copy.
+//
+// A task that blocks on topics does it through its own Reader, in which
+// every publish latches until the task waits, so one that lands between
+// checking a seq and waiting wakes the wait straight away.
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <type_traits>
+
+namespace sensor_bus {
+
+// One bit per topic, in each Reader's event group.
+enum TopicBits : EventBits_t {
+  kPmsx003 = 1 << 0,
+  kDsco220 = 1 << 1,
+  kBme = 1 << 2,
+  kMhz19 = 1 << 3,
+  kAllSensors = kPmsx003 | kDsco220 | kBme | kMhz19,
+  // Derived from the sensors' snapshots rather than read from a sensor.
+  kAqi = 1 << 4,
+};
+
+template <typename T>
+struct Snapshot {
+  // 1 for the first publish; 0 means nothing has been published yet.
+  uint32_t seq;
+  unsigned long timestamp_ms;
+  T value;
+};
+
+// Creates the lock Readers register under. Call from setup() before any
+// task starts.
+void Init();
+
+// One task's wakeups for the topics in bits. There is room for kMaxReaders
+// at a time; each gives its slot back when destroyed.
+class Reader {
+ public:
+  static const int kMaxReaders = 8;
+
+  explicit Reader(EventBits_t bits);
+  ~Reader();
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+
+  // Blocks until any of its topics has published since the last Wait(), or
+  // the timeout expires. Returns those bits, clearing them; 0 on timeout.
+  EventBits_t Wait(TickType_t timeout_ticks);
+
+ private:
+  EventGroupHandle_t group_ = nullptr;
+  const EventBits_t bits_;
+};
+
+// Latches bits in every Reader waiting for any of them.
+void Notify(EventBits_t bits);
+
+template <typename T>
+class Topic {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "snapshots are copied without locks");
+
+ public:
+  explicit Topic(EventBits_t bit) : bit_(bit) {}
+  Topic(const Topic&) = delete;
+  Topic& operator=(const Topic&) = delete;
+
+  // Only one task may publish to a topic.
+  void Publish(const T& value, unsigned long timestamp_ms) {
+    uint32_t seq = seq_.load(std::memory_order_relaxed) + 1;
+    Slot& slot = slots_[seq & 1];
+    uint32_t lock = slot.lock.load(std::memory_order_relaxed);
+    slot.lock.store(lock + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.snapshot.seq = seq;
+    slot.snapshot.timestamp_ms = timestamp_ms;
+    slot.snapshot.value = value;
+    slot.lock.store(lock + 2, std::memory_order_release);
+    seq_.store(seq, std::memory_order_release);
+    Notify(bit_);
+  }
+
+  // Copies the latest snapshot. Returns false, leaving out untouched, if
+  // nothing has been published yet.
+  bool Read(Snapshot<T>* out) const {
+    for (;;) {
+      uint32_t seq = seq_.load(std::memory_order_acquire);
+      if (seq == 0) {
+        return false;
+      }
+      const Slot& slot = slots_[seq & 1];
+      uint32_t lock = slot.lock.load(std::memory_order_acquire);
+      if (lock & 1) {
+        // The writer has published twice since we loaded seq; start over
+        // with the newer slot.
+        continue;
+      }
+      *out = slot.snapshot;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.lock.load(std::memory_order_relaxed) == lock) {
+        return true;
+      }
+    }
+  }
+
+  // The latest snapshot, or a zeroed one (seq == 0) before the first publish.
+  Snapshot<T> Get() const {
+    Snapshot<T> snapshot = {};
+    Read(&snapshot);
+    return snapshot;
+  }
+
+  uint32_t seq() const { return seq_.load(std::memory_order_acquire); }
+
+  // Blocks on reader until a snapshot newer than seq is published. Returns
+  // false on timeout.
+  bool WaitNewer(Reader* reader, uint32_t seq,
+                 TickType_t timeout_ticks) const {
+    const TickType_t start = xTaskGetTickCount();
+    while (this->seq() == seq) {
+      // A bit latched by an earlier publish, already read, wakes it early.
+      const TickType_t elapsed = xTaskGetTickCount() - start;
+      if (elapsed >= timeout_ticks) {
+        return false;
+      }
+      reader->Wait(timeout_ticks - elapsed);
+    }
+    return true;
+  }
+
+  EventBits_t bit() const { return bit_; }
+
+ private:
+  struct Slot {
+    std::atomic<uint32_t> lock{0};
+    Snapshot<T> snapshot = {};
+  };
+
+  const EventBits_t bit_;
+  std::atomic<uint32_t> seq_{0};
+  Slot slots_[2];
+};
+
+}  // namespace sensor_bus
+
+#endif  // _SENSOR_BUS_H_
@@ -5,6 +5,8 @@
 #include <WiFiClient.h>
 #include <esp_log.h>
 
+#include "net_manager.h"
+
 namespace sensor_community {
 namespace {
 WiFiClient wifi_client;
@@ -26,6 +28,9 @@ bool Push(const ui::TaskData* data) {
   http_client.setTimeout(20000);
   http_client.setUserAgent(String(kSoftwareVersion) + '/' + macAddress);
 
+  const auto pmsx003_data = data->pmsx003->Get().value;
+  const auto bme_data = data->bme->Get().value;
+
   // Send PM data.
   String payload = R"({
             "software_version": "{software_version}",
@@ -36,9 +41,9 @@ bool Push(const ui::TaskData* data) {
             ]
         })";
   payload.replace("{software_version}", kSoftwareVersion);
-  payload.replace("{pm1_0}", String(data->pmsx003_data->pm_1_0));
-  payload.replace("{pm2_5}", String(data->pmsx003_data->pm_2_5));
-  payload.replace("{pm10_0}", String(data->pmsx003_data->pm_10_0));
+  payload.replace("{pm1_0}", String(pmsx003_data.pm_1_0));
+  payload.replace("{pm2_5}", String(pmsx003_data.pm_2_5));
+  payload.replace("{pm10_0}", String(pmsx003_data.pm_10_0));
 
   // Serial.print("SensorCommunity: Payload:\n");
   // Serial.print(payload);
@@ -75,9 +80,9 @@ bool Push(const ui::TaskData* data) {
             ]
         })";
   payload.replace("{software_version}", kSoftwareVersion);
-  payload.replace("{temperature}", String(data->bme_data->temp_c));
-  payload.replace("{humidity}", String(data->bme_data->humidity_pct));
-  payload.replace("{pressure}", String(data->bme_data->pressure_pa));
+  payload.replace("{temperature}", String(bme_data.temp_c));
+  payload.replace("{humidity}", String(bme_data.humidity_pct));
+  payload.replace("{pressure}", String(bme_data.pressure_pa));
 
   // Serial.print("SensorCommunity: Payload:\n");
   // Serial.print(payload);
@@ -116,9 +121,8 @@ void TaskSensorCommunity(void* task_param) {
   delay(60000);
 
   for (;;) {
-    if (!WiFi.isConnected()) {
+    if (!net_manager::WaitOnline(10000 / portTICK_PERIOD_MS)) {
       ESP_LOGW(TAG, "TaskSensorCommunity: Waiting for WiFi...");
-      delay(10000);
       continue;
     }
     Serial.print("TaskSensorCommunity(): core: ");
@@ -0,0 +1,227 @@
+#include "timeseries.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace timeseries {
+namespace {
+
+// sum / count, rounded to the nearest step.
+int16_t Mean(int32_t sum, uint16_t count) {
+  const int32_t half = count / 2;
+  return (sum >= 0 ? sum + half : sum - half) / count;
+}
+
+}  // namespace
+
+void Series::Add(float value, unsigned long timestamp_ms) {
+  if (isnan(value)) {
+    return;
+  }
+  const uint32_t now_s = timestamp_ms / 1000;
+  // Every tier's index moves with the first's, so checking one will do.
+  if (samples_ != 0 && now_s / kTiers[0].bucket_s < open_[0].index) {
+    Clear();
+  }
+  const int16_t steps = Quantize(value);
+  for (int tier = 0; tier < kNumTiers; ++tier) {
+    const uint32_t index = now_s / kTiers[tier].bucket_s;
+    if (index != open_[tier].index) {
+      Advance(tier, index);
+    }
+    Open& open = open_[tier];
+    if (open.count == 0) {
+      open.min = steps;
+      open.max = steps;
+    } else if (steps < open.min) {
+      open.min = steps;
+    } else if (steps > open.max) {
+      open.max = steps;
+    }
+    // A full count still fits the sum; past it only min and max move.
+    if (open.count < UINT16_MAX) {
+      open.sum += steps;
+      ++open.count;
+    }
+  }
+  ++samples_;
+}
+
+void Series::Advance(int tier, uint32_t index) {
+  Open& open = open_[tier];
+  const uint16_t size = kTiers[tier].buckets;
+  Bucket* buckets = ring(tier);
+  const uint32_t skipped = index - open.index - 1;
+  if (skipped >= size) {
+    memset(buckets, 0, size * sizeof(Bucket));
+  } else {
+    Bucket& closed = buckets[open.index % size];
+    if (open.count == 0) {
+      closed = {};
+    } else {
+      closed = {open.min, open.max, Mean(open.sum, open.count), open.count};
+    }
+    for (uint32_t i = 1; i <= skipped; ++i) {
+      buckets[(open.index + i) % size] = {};
+    }
+  }
+  open = {};
+  open.index = index;
+}
+
+template <typename Visitor>
+size_t Series::Visit(int tier, uint32_t from_s, uint32_t to_s, size_t max,
+                     Visitor visit) const {
+  const TierSpec& spec = kTiers[tier];
+  const Open& open = open_[tier];
+  const Bucket* ring = this->ring(tier);
+  const Bucket open_bucket =
+      open.count == 0
+          ? Bucket{}
+          : Bucket{open.min, open.max, Mean(open.sum, open.count),
+                   open.count};
+  auto bucket = [&](uint32_t index) -> const Bucket& {
+    return index == open.index ? open_bucket : ring[index % spec.buckets];
+  };
+
+  // The ring holds the buckets - 1 before the open one; the slot of the
+  // oldest is the open bucket's.
+  uint32_t first = open.index >= spec.buckets - 1u
+                       ? open.index - (spec.buckets - 1u)
+                       : 0;
+  const uint32_t from =
+      from_s / spec.bucket_s + (from_s % spec.bucket_s != 0 ? 1 : 0);
+  if (from > first) {
+    first = from;
+  }
+  const uint32_t last = std::min(to_s / spec.bucket_s, open.index);
+  if (first > last) {
+    return 0;
+  }
+
+  size_t total = 0;
+  for (uint32_t index = first; index <= last; ++index) {
+    if (bucket(index).count != 0) {
+      ++total;
+    }
+  }
+  size_t skip = total > max ? total - max : 0;
+  for (uint32_t index = first; index <= last; ++index) {
+    if (bucket(index).count == 0) {
+      continue;
+    }
+    if (skip > 0) {
+      --skip;
+      continue;
+    }
+    visit(index * spec.bucket_s, bucket(index));
+  }
+  return std::min(total, max);
+}
+
+size_t Series::Read(int tier, uint32_t since_s, Point* points,
+                    size_t max_points) const {
+  size_t count = 0;
+  return Visit(tier, since_s, UINT32_MAX, max_points,
+               [&](uint32_t start_s, const Bucket& bucket) {
+                 Point& point = points[count++];
+                 point.start_s = start_s;
+                 point.min = Value(bucket.min);
+                 point.max = Value(bucket.max);
+                 point.mean = Value(bucket.mean);
+                 point.count = bucket.count;
+               });
+}
+
+size_t Series::Read(int tier, uint32_t from_s, uint32_t to_s,
+                    Bucket* buckets, uint32_t* starts_s,
+                    size_t max_buckets) const {
+  size_t count = 0;
+  return Visit(tier, from_s, to_s, max_buckets,
+               [&](uint32_t start_s, const Bucket& bucket) {
+                 buckets[count] = bucket;
+                 starts_s[count++] = start_s;
+               });
+}
+
+void Series::Clear() {
+  samples_ = 0;
+  memset(open_, 0, sizeof(open_));
+  memset(buckets_, 0, sizeof(buckets_));
+}
+
+int16_t Series::Quantize(float value) const {
+  const float steps = roundf((value - offset_) / resolution_);
+  if (steps > INT16_MAX) {
+    return INT16_MAX;
+  }
+  if (steps < -INT16_MAX) {
+    return -INT16_MAX;
+  }
+  return steps;
+}
+
+Bucket* Series::ring(int tier) { return buckets_ + TotalBuckets(tier); }
+
+const Bucket* Series::ring(int tier) const {
+  return buckets_ + TotalBuckets(tier);
+}
+
+size_t Downsample(Bucket* buckets, uint32_t* starts_s, size_t count,
+                  size_t threshold) {
+  if (threshold < 3) {
+    threshold = 3;
+  }
+  if (count <= threshold) {
+    return count;
+  }
+  // The first and last stay; the rest are split into threshold - 2 even
+  // ranges, and each keeps the bucket making the largest triangle with the
+  // one kept before it and the average of the next range. The kept bucket
+  // goes at or before the start of its range, which has been read by then,
+  // so it can be done in place. Times are relative to the first, so floats
+  // keep them to the second.
+  const float every = static_cast<float>(count - 2) / (threshold - 2);
+  const uint32_t t0 = starts_s[0];
+  float a_x = 0;
+  float a_y = buckets[0].mean;
+  size_t kept = 1;
+  for (size_t range = 0; range < threshold - 2; ++range) {
+    const size_t begin = static_cast<size_t>(range * every) + 1;
+    const size_t end = static_cast<size_t>((range + 1) * every) + 1;
+    const size_t next_end =
+        std::min(static_cast<size_t>((range + 2) * every) + 1, count);
+    float next_x = 0;
+    float next_y = 0;
+    for (size_t i = end; i < next_end; ++i) {
+      next_x += starts_s[i] - t0;
+      next_y += buckets[i].mean;
+    }
+    next_x /= next_end - end;
+    next_y /= next_end - end;
+
+    size_t best = begin;
+    float best_area = -1;
+    for (size_t i = begin; i < end; ++i) {
+      const float area =
+          fabsf((a_x - next_x) * (buckets[i].mean - a_y) -
+                (a_x - (starts_s[i] - t0)) * (next_y - a_y));
+      if (area > best_area) {
+        best_area = area;
+        best = i;
+      }
+    }
+    a_x = starts_s[best] - t0;
+    a_y = buckets[best].mean;
+    buckets[kept] = buckets[best];
+    starts_s[kept] = starts_s[best];
+    ++kept;
+  }
+  buckets[kept] = buckets[count - 1];
+  starts_s[kept] = starts_s[count - 1];
+  return kept + 1;
+}
+
+}  // namespace timeseries
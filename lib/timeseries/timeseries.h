@@ -0,0 +1,140 @@
+#ifndef _TIMESERIES_H_
+#define _TIMESERIES_H_
+
+// Fixed-footprint history of one metric, rolled up into tiers of ever
+// coarser buckets as samples come in.
+//
+// Each tier is a ring of buckets holding the min, max, mean and sample count
+// over bucket_s seconds. Every sample goes into the open bucket of every
+// tier, so the coarse tiers are as exact as the fine ones rather than
+// averages of averages. When a sample lands past a tier's open bucket, that
+// bucket is closed into the ring, overwriting the oldest, and any it skipped
+// are recorded as empty.
+//
+// Values are stored as int16 steps of a per-series resolution around an
+// offset, 8 bytes a bucket, and sizeof(Series) is fixed by kTiers: declare
+// them statically and the whole history is accounted for at link time.
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace timeseries {
+
+struct TierSpec {
+  uint32_t bucket_s;
+  uint16_t buckets;
+};
+
+// 10 s for 10 minutes, 2 min for 24 hours and 3 h for 30 days.
+constexpr TierSpec kTiers[] = {
+    {/*bucket_s=*/10, /*buckets=*/60},
+    {/*bucket_s=*/2 * 60, /*buckets=*/720},
+    {/*bucket_s=*/3 * 60 * 60, /*buckets=*/240},
+};
+constexpr int kNumTiers = sizeof(kTiers) / sizeof(kTiers[0]);
+
+constexpr size_t TotalBuckets(int tiers = kNumTiers) {
+  return tiers == 0 ? 0 : kTiers[tiers - 1].buckets + TotalBuckets(tiers - 1);
+}
+
+// The most buckets one tier has, i.e. that one Read() can return.
+constexpr size_t MaxTierBuckets(int tiers = kNumTiers) {
+  return tiers == 0 ? 0
+                    : kTiers[tiers - 1].buckets > MaxTierBuckets(tiers - 1)
+                          ? kTiers[tiers - 1].buckets
+                          : MaxTierBuckets(tiers - 1);
+}
+
+struct Bucket {
+  int16_t min;
+  int16_t max;
+  int16_t mean;
+  // 0 for a bucket without samples. Saturates.
+  uint16_t count;
+};
+static_assert(sizeof(Bucket) == 8, "buckets are packed for RAM");
+
+// A bucket with its values back in the metric's units.
+struct Point {
+  // Seconds since boot at the start of the bucket.
+  uint32_t start_s;
+  float min;
+  float max;
+  float mean;
+  uint16_t count;
+};
+
+// Not thread safe; the owner serializes Add() against Read().
+class Series {
+ public:
+  // Values are kept to within resolution / 2. Those more than 32767 steps
+  // from offset are clamped. constexpr, so a static Series is zeroed memory
+  // rather than a constructor run at boot.
+  constexpr explicit Series(float resolution, float offset = 0)
+      : resolution_(resolution), offset_(offset) {}
+  Series(const Series&) = delete;
+  Series& operator=(const Series&) = delete;
+
+  // Samples must come in timestamp order. One from before the open buckets,
+  // i.e. millis() wrapped, starts the history over. NaNs are skipped.
+  void Add(float value, unsigned long timestamp_ms);
+
+  // Copies out tier's buckets that have samples and start at or after
+  // since_s, oldest first, ending with the one still filling. Returns how
+  // many, at most max_points: the oldest ones are left out.
+  size_t Read(int tier, uint32_t since_s, Point* points,
+              size_t max_points) const;
+  // The same, as stored, for buckets starting from from_s through to_s,
+  // with their starts in starts_s.
+  size_t Read(int tier, uint32_t from_s, uint32_t to_s, Bucket* buckets,
+              uint32_t* starts_s, size_t max_buckets) const;
+
+  // A stored min, max or mean in the metric's units, and a value as stored.
+  float Value(int32_t steps) const { return steps * resolution_ + offset_; }
+  int16_t Quantize(float value) const;
+  float resolution() const { return resolution_; }
+  float offset() const { return offset_; }
+
+  // Forgets everything.
+  void Clear();
+
+  uint32_t samples() const { return samples_; }
+
+ private:
+  // The bucket a tier is filling, at full precision.
+  struct Open {
+    // start_s / bucket_s.
+    uint32_t index;
+    int32_t sum;
+    int16_t min;
+    int16_t max;
+    uint16_t count;
+  };
+
+  // Calls visit(start_s, bucket) for the last max of tier's buckets with
+  // samples between from_s and to_s, oldest first. Returns how many.
+  template <typename Visitor>
+  size_t Visit(int tier, uint32_t from_s, uint32_t to_s, size_t max,
+               Visitor visit) const;
+  // Closes tier's open bucket and records the ones up to index as empty.
+  void Advance(int tier, uint32_t index);
+  Bucket* ring(int tier);
+  const Bucket* ring(int tier) const;
+
+  const float resolution_;
+  const float offset_;
+  uint32_t samples_ = 0;
+  Open open_[kNumTiers] = {};
+  Bucket buckets_[TotalBuckets()] = {};
+};
+
+// Largest-triangle-three-buckets: keeps threshold of the count buckets,
+// the first and last among them, picking the ones that best keep the shape
+// of the line through their means. In place; returns the new count.
+// Thresholds under 3 are taken as 3.
+size_t Downsample(Bucket* buckets, uint32_t* starts_s, size_t count,
+                  size_t threshold);
+
+}  // namespace timeseries
+
+#endif  // _TIMESERIES_H_
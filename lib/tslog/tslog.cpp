@@ -0,0 +1,553 @@
+#include "tslog.h"
+
+#include <esp_log.h>
+#include <string.h>
+
+#include "gzip.h"
+
+namespace tslog {
+namespace {
+const char TAG[] = "tslog";
+
+const uint8_t kMagic = 'T';
+
+void PutLe(uint32_t value, int bytes, uint8_t* out) {
+  for (int i = 0; i < bytes; ++i) {
+    out[i] = value >> (8 * i);
+  }
+}
+
+uint32_t GetLe(const uint8_t* in, int bytes) {
+  uint32_t value = 0;
+  for (int i = bytes - 1; i >= 0; --i) {
+    value = value << 8 | in[i];
+  }
+  return value;
+}
+
+// Header fields, by offset.
+enum : size_t {
+  kMagicAt = 0,
+  kStreamAt = 1,
+  kCountAt = 2,
+  kSeqAt = 4,
+  kWrittenAt = 8,
+  kFirstTimeAt = 12,
+  kFirstValueAt = 16,
+  kBitsAt = 18,
+  kCrcAt = 20,
+};
+static_assert(kCrcAt + 4 == kHeaderSize, "header layout");
+
+// Variable-length codes: code i of n is i ones, then a zero unless it is the
+// last, then value + bias in bits bits. The first has no bits and takes only
+// 0.
+struct Code {
+  int bits;
+  int32_t bias;
+};
+
+// Delta of deltas of times.
+const Code kTimeCodes[] = {{0, 0}, {7, 63}, {9, 255}, {12, 2047}, {32, 0}};
+// Deltas of values.
+const Code kValueCodes[] = {{0, 0}, {4, 8}, {9, 256}, {17, 65536}};
+
+// The shortest code that takes value.
+template <size_t N>
+size_t CodeFor(const Code (&codes)[N], int64_t value) {
+  for (size_t i = 0; i < N - 1; ++i) {
+    const int64_t biased = value + codes[i].bias;
+    if (biased >= 0 && biased < (int64_t{1} << codes[i].bits)) {
+      return i;
+    }
+  }
+  return N - 1;
+}
+
+template <size_t N>
+uint32_t CodeBits(const Code (&codes)[N], size_t i) {
+  return i + (i < N - 1 ? 1 : 0) + codes[i].bits;
+}
+
+// Most significant bit first, after the header.
+void PutBits(uint8_t* page, uint32_t* at, uint32_t value, int bits) {
+  for (int i = bits - 1; i >= 0; --i, ++*at) {
+    if (value >> i & 1) {
+      page[kHeaderSize + *at / 8] |= 0x80 >> (*at % 8);
+    }
+  }
+}
+
+uint32_t GetBits(const uint8_t* page, uint32_t* at, int bits) {
+  uint32_t value = 0;
+  for (int i = 0; i < bits; ++i, ++*at) {
+    value = value << 1 | (page[kHeaderSize + *at / 8] >> (7 - *at % 8) & 1);
+  }
+  return value;
+}
+
+template <size_t N>
+void Put(uint8_t* page, uint32_t* at, const Code (&codes)[N], size_t i,
+         int64_t value) {
+  // The zero after the ones is already there.
+  PutBits(page, at, (1u << i) - 1, i);
+  if (i < N - 1) {
+    ++*at;
+  }
+  PutBits(page, at, value + codes[i].bias, codes[i].bits);
+}
+
+template <size_t N>
+int64_t Get(const uint8_t* page, uint32_t* at, const Code (&codes)[N]) {
+  size_t i = 0;
+  while (i < N - 1 && GetBits(page, at, 1) == 1) {
+    ++i;
+  }
+  const uint32_t raw = GetBits(page, at, codes[i].bits);
+  if (codes[i].bits == 32) {
+    return static_cast<int32_t>(raw);
+  }
+  return static_cast<int64_t>(raw) - codes[i].bias;
+}
+
+// Whether a page read from flash holds nothing but 0xff.
+bool Blank(const uint8_t* page) {
+  for (size_t i = 0; i < kPageSize; ++i) {
+    if (page[i] != 0xff) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+PartitionFlash::PartitionFlash(const char* label)
+    : partition_(esp_partition_find_first(
+          ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label)) {}
+
+size_t PartitionFlash::size() const {
+  return partition_ == nullptr ? 0
+                               : partition_->size / kSectorSize * kSectorSize;
+}
+
+bool PartitionFlash::Read(size_t offset, void* data, size_t size) {
+  return esp_partition_read(partition_, offset, data, size) == ESP_OK;
+}
+
+bool PartitionFlash::Write(size_t offset, const void* data, size_t size) {
+  return esp_partition_write(partition_, offset, data, size) == ESP_OK;
+}
+
+bool PartitionFlash::Erase(size_t offset, size_t size) {
+  return esp_partition_erase_range(partition_, offset, size) == ESP_OK;
+}
+
+bool ParsePage(const uint8_t* page, PageInfo* info) {
+  if (page[kMagicAt] != kMagic) {
+    return false;
+  }
+  const uint32_t bits = GetLe(page + kBitsAt, 2);
+  if (bits > kPayloadBits) {
+    return false;
+  }
+  uint32_t crc = gzip::Crc32(page, kCrcAt);
+  crc = gzip::Crc32(page + kHeaderSize, (bits + 7) / 8, crc);
+  if (crc != GetLe(page + kCrcAt, 4)) {
+    return false;
+  }
+  info->stream = page[kStreamAt];
+  info->count = GetLe(page + kCountAt, 2);
+  info->seq = GetLe(page + kSeqAt, 4);
+  info->written_s = GetLe(page + kWrittenAt, 4);
+  info->first_s = GetLe(page + kFirstTimeAt, 4);
+  return true;
+}
+
+bool DecodePage(const uint8_t* page, bool (*fn)(const Sample&, void*),
+                void* arg) {
+  const uint16_t count = GetLe(page + kCountAt, 2);
+  const uint32_t bits = GetLe(page + kBitsAt, 2);
+  Sample sample = {GetLe(page + kFirstTimeAt, 4),
+                   static_cast<int16_t>(GetLe(page + kFirstValueAt, 2))};
+  int64_t delta_s = 0;
+  uint32_t at = 0;
+  for (uint16_t i = 0; i < count; ++i) {
+    if (i > 0) {
+      // A page that claims more than it holds is cut short.
+      if (at >= bits) {
+        return true;
+      }
+      delta_s += Get(page, &at, kTimeCodes);
+      sample.time_s += delta_s;
+      sample.value += Get(page, &at, kValueCodes);
+    }
+    if (!fn(sample, arg)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Log::Mount() {
+  const size_t sectors = flash_->size() / kSectorSize;
+  if (sectors < 2) {
+    ESP_LOGE(TAG, "Mount(): %u bytes of flash, need 2 sectors",
+             static_cast<unsigned>(flash_->size()));
+    return false;
+  }
+  if (mutex_ == nullptr) {
+    mutex_ = xSemaphoreCreateMutex();
+    flash_mutex_ = xSemaphoreCreateMutex();
+  }
+  pages_ = sectors * kPagesPerSector;
+
+  // The newest sector starts with the highest seq, or has it on its first
+  // whole page if power went while the one before it was written.
+  uint8_t page[kPageSize];
+  PageInfo info;
+  size_t newest = sectors;
+  uint32_t newest_seq = 0;
+  for (size_t sector = 0; sector < sectors; ++sector) {
+    if (FirstPage(sector, &info) && info.seq >= newest_seq) {
+      newest = sector;
+      newest_seq = info.seq;
+    }
+  }
+  head_ = 0;
+  seq_ = 1;
+  last_s_ = 0;
+  queue_front_ = 0;
+  queued_ = 0;
+  if (newest < sectors) {
+    // Resume after its last page that isn't blank, torn ones included:
+    // they may be half programmed.
+    const size_t first = newest * kPagesPerSector;
+    size_t used = 0;
+    for (size_t i = 0; i < kPagesPerSector; ++i) {
+      if (Erased(first + i)) {
+        continue;
+      }
+      used = i + 1;
+      if (flash_->Read((first + i) * kPageSize, page, kPageSize) &&
+          ParsePage(page, &info)) {
+        seq_ = info.seq + 1;
+        last_s_ = info.written_s;
+      } else {
+        ++stats_.bad_pages;
+      }
+    }
+    head_ = (first + used) % pages_;
+  }
+  mounted_ = true;
+  ESP_LOGI(TAG, "Mount(): %u pages, head: %u seq: %u written: %u",
+           static_cast<unsigned>(pages_), static_cast<unsigned>(head_),
+           seq_, last_s_);
+  return true;
+}
+
+bool Log::Append(int stream, uint32_t time_s, int16_t value) {
+  if (!mounted_ || stream < 0 || stream >= kMaxStreams) {
+    return false;
+  }
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  ++stats_.samples;
+  if (time_s > last_s_) {
+    last_s_ = time_s;
+  }
+  Page& page = streams_[stream];
+  bool ok = true;
+  if (page.count > 0 && Encode(&page, time_s, value)) {
+    ++page.count;
+  } else {
+    ok = Queue(stream);
+    memset(page.data, 0, sizeof(page.data));
+    page.count = 1;
+    page.bits = 0;
+    page.first_s = time_s;
+    page.first_value = value;
+    page.last_s = time_s;
+    page.last_delta_s = 0;
+    page.last_value = value;
+  }
+  xSemaphoreGive(mutex_);
+  return ok;
+}
+
+bool Log::WriteOut() {
+  if (!mounted_) {
+    return false;
+  }
+  xSemaphoreTake(flash_mutex_, portMAX_DELAY);
+  const bool ok = WriteQueued();
+  xSemaphoreGive(flash_mutex_);
+  return ok;
+}
+
+void Log::Flush() {
+  if (!mounted_) {
+    return;
+  }
+  xSemaphoreTake(flash_mutex_, portMAX_DELAY);
+  WriteQueued();
+  // One at a time, so there is always room on the queue.
+  for (int stream = 0; stream < kMaxStreams; ++stream) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    Queue(stream);
+    xSemaphoreGive(mutex_);
+    WriteQueued();
+  }
+  xSemaphoreGive(flash_mutex_);
+}
+
+bool Log::Encode(Page* page, uint32_t time_s, int16_t value) {
+  const int64_t delta_s = static_cast<int64_t>(time_s) - page->last_s;
+  if (delta_s < 0 || delta_s > INT32_MAX) {
+    return false;
+  }
+  const int64_t delta_of_delta = delta_s - page->last_delta_s;
+  const int32_t value_delta = value - page->last_value;
+  const size_t time_code = CodeFor(kTimeCodes, delta_of_delta);
+  const size_t value_code = CodeFor(kValueCodes, value_delta);
+  if (page->bits + CodeBits(kTimeCodes, time_code) +
+          CodeBits(kValueCodes, value_code) >
+      kPayloadBits) {
+    return false;
+  }
+  Put(page->data, &page->bits, kTimeCodes, time_code, delta_of_delta);
+  Put(page->data, &page->bits, kValueCodes, value_code, value_delta);
+  page->last_s = time_s;
+  page->last_delta_s = delta_s;
+  page->last_value = value;
+  return true;
+}
+
+bool Log::Queue(int stream) {
+  Page& page = streams_[stream];
+  if (page.count == 0) {
+    return true;
+  }
+  if (queued_ == kMaxQueuedPages) {
+    ESP_LOGW(TAG, "Queue(): %d pages waiting; dropping stream %d's",
+             queued_, stream);
+    ++stats_.dropped_pages;
+    page.count = 0;
+    return false;
+  }
+  Page& queued = queue_[(queue_front_ + queued_) % kMaxQueuedPages];
+  queued = page;
+  queued.stream = stream;
+  queued.written_s = last_s_;
+  ++queued_;
+  page.count = 0;
+  return true;
+}
+
+bool Log::WriteQueued() {
+  bool ok = true;
+  for (;;) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    Page* page = queued_ > 0 ? &queue_[queue_front_] : nullptr;
+    xSemaphoreGive(mutex_);
+    if (page == nullptr) {
+      return ok;
+    }
+    // Append() only adds behind it, and Scan() waits for flash_mutex_, so
+    // it is ours until dequeued.
+    ok = WritePage(page) && ok;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    queue_front_ = (queue_front_ + 1) % kMaxQueuedPages;
+    --queued_;
+    xSemaphoreGive(mutex_);
+  }
+}
+
+bool Log::WritePage(Page* page) {
+  if (head_ % kPagesPerSector == 0) {
+    if (!flash_->Erase(head_ * kPageSize, kSectorSize)) {
+      ESP_LOGE(TAG, "WritePage(): erasing sector %u failed",
+               static_cast<unsigned>(head_ / kPagesPerSector));
+      return false;
+    }
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    ++stats_.erases;
+    xSemaphoreGive(mutex_);
+  }
+  const size_t payload_bytes =
+      FillHeader(page, page->stream, seq_, page->written_s);
+  const bool ok =
+      flash_->Write(head_ * kPageSize, page->data, kHeaderSize + payload_bytes);
+  if (!ok) {
+    ESP_LOGE(TAG, "WritePage(): writing page %u failed",
+             static_cast<unsigned>(head_));
+  }
+  // A failed page is skipped like a torn one.
+  head_ = (head_ + 1) % pages_;
+  ++seq_;
+  if (ok) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    ++stats_.pages_written;
+    stats_.samples_written += page->count;
+    stats_.payload_bytes += payload_bytes;
+    xSemaphoreGive(mutex_);
+  }
+  return ok;
+}
+
+size_t Log::FillHeader(Page* page, int stream, uint32_t seq,
+                       uint32_t written_s) {
+  uint8_t* header = page->data;
+  header[kMagicAt] = kMagic;
+  header[kStreamAt] = stream;
+  PutLe(page->count, 2, header + kCountAt);
+  PutLe(seq, 4, header + kSeqAt);
+  PutLe(written_s, 4, header + kWrittenAt);
+  PutLe(page->first_s, 4, header + kFirstTimeAt);
+  PutLe(static_cast<uint16_t>(page->first_value), 2, header + kFirstValueAt);
+  PutLe(page->bits, 2, header + kBitsAt);
+  const size_t payload_bytes = (page->bits + 7) / 8;
+  uint32_t crc = gzip::Crc32(header, kCrcAt);
+  crc = gzip::Crc32(header + kHeaderSize, payload_bytes, crc);
+  PutLe(crc, 4, header + kCrcAt);
+  return payload_bytes;
+}
+
+size_t Log::Scan(int stream, uint32_t from_s, uint32_t to_s,
+                 bool (*fn)(const Sample& sample, void* arg), void* arg) {
+  if (!mounted_ || from_s > to_s) {
+    return 0;
+  }
+  const size_t sectors = pages_ / kPagesPerSector;
+  // Holding the flash still, so nothing moves from the queue onto it before
+  // the queue is read, below.
+  xSemaphoreTake(flash_mutex_, portMAX_DELAY);
+  // Sectors in ring order, from the one after the newest page's.
+  const size_t newest = (head_ + pages_ - 1) % pages_ / kPagesPerSector;
+  const size_t oldest = (newest + 1) % sectors;
+  auto sector_at = [&](size_t position) {
+    return (oldest + position) % sectors;
+  };
+
+  // The first sector starting after from_s; the one before may hold some
+  // from_s onwards too. Pages with samples from from_s on were all written
+  // from from_s on, so none of the sectors before matter. A sector with no
+  // time to go by, torn or never written, goes by the next one that has.
+  uint8_t page[kPageSize];
+  PageInfo info;
+  size_t low = 0;
+  size_t high = sectors;
+  while (low < high) {
+    const size_t mid = (low + high) / 2;
+    size_t probe = mid;
+    while (probe < high && !FirstPage(sector_at(probe), &info)) {
+      ++probe;
+    }
+    if (probe < high && info.written_s < from_s) {
+      low = probe + 1;
+    } else {
+      high = mid;
+    }
+  }
+  size_t start = low;
+  while (start > 0) {
+    --start;
+    if (FirstPage(sector_at(start), &info)) {
+      break;
+    }
+  }
+
+  struct Filter {
+    uint32_t from_s;
+    uint32_t to_s;
+    bool (*fn)(const Sample&, void*);
+    void* arg;
+    size_t count;
+    bool done;
+  } filter = {from_s, to_s, fn, arg, 0, false};
+  auto visit = [](const Sample& sample, void* filter_arg) {
+    auto* filter = reinterpret_cast<Filter*>(filter_arg);
+    if (sample.time_s < filter->from_s) {
+      return true;
+    }
+    if (sample.time_s > filter->to_s || !filter->fn(sample, filter->arg)) {
+      filter->done = true;
+      return false;
+    }
+    ++filter->count;
+    return true;
+  };
+
+  for (size_t position = start; position < sectors && !filter.done;
+       ++position) {
+    const size_t first = sector_at(position) * kPagesPerSector;
+    for (size_t i = 0; i < kPagesPerSector && !filter.done; ++i) {
+      const bool read = flash_->Read((first + i) * kPageSize, page, kPageSize);
+      if (!read || !ParsePage(page, &info) || info.stream != stream ||
+          info.written_s < from_s) {
+        continue;
+      }
+      if (info.first_s > to_s) {
+        filter.done = true;
+        break;
+      }
+      DecodePage(page, visit, &filter);
+    }
+  }
+  // Then what is still waiting to be written: the queue, oldest first, and
+  // the page being filled. Append() may be adding to both.
+  for (int i = 0; !filter.done; ++i) {
+    Page pending;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    const bool queued = i < queued_;
+    if (queued) {
+      pending = queue_[(queue_front_ + i) % kMaxQueuedPages];
+    } else {
+      pending = streams_[stream];
+      pending.stream = stream;
+      pending.written_s = last_s_;
+    }
+    xSemaphoreGive(mutex_);
+    if (pending.stream == stream && pending.count > 0) {
+      FillHeader(&pending, stream, 0, pending.written_s);
+      DecodePage(pending.data, visit, &filter);
+    }
+    if (!queued) {
+      break;
+    }
+  }
+  xSemaphoreGive(flash_mutex_);
+  return filter.count;
+}
+
+Stats Log::stats() {
+  if (mutex_ == nullptr) {
+    return stats_;
+  }
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  const Stats stats = stats_;
+  xSemaphoreGive(mutex_);
+  return stats;
+}
+
+bool Log::FirstPage(size_t sector, PageInfo* info) {
+  uint8_t page[kPageSize];
+  for (size_t i = 0; i < kPagesPerSector; ++i) {
+    const bool read = flash_->Read(sector * kSectorSize + i * kPageSize, page,
+                                   kPageSize);
+    if (read && ParsePage(page, info)) {
+      return true;
+    }
+    // Pages are programmed in order, so nothing follows a blank one.
+    if (read && Blank(page)) {
+      return false;
+    }
+  }
+  return false;
+}
+
+bool Log::Erased(size_t page) {
+  uint8_t data[kPageSize];
+  return flash_->Read(page * kPageSize, data, kPageSize) && Blank(data);
+}
+
+}  // namespace tslog
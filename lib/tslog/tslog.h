@@ -0,0 +1,219 @@
+#ifndef _TSLOG_H_
+#define _TSLOG_H_
+
+// Append-only time-series log on raw NOR flash, kept across reboots and OTA
+// updates.
+//
+// Samples of up to kMaxStreams streams, each a Unix time and an int16 value,
+// are packed into a RAM page per stream, Gorilla style: timestamps as the
+// delta of their deltas, values as the delta from the last, each in a
+// variable-length bit code, so a steady once-a-second reading takes a byte
+// or less. A full page is programmed in one write, with a header carrying
+// its sequence number, the time it was written and a CRC.
+//
+// Append() never touches the flash, so it is quick enough for a task polling
+// sensors: a page that fills up is queued in RAM, and WriteOut(), called from
+// a task that can wait out a sector erase, programs it.
+//
+// The flash is a ring of 4 KB sectors, filled a page at a time and erased
+// just before reuse, oldest first, so every sector wears the same. Power
+// lost mid-write leaves at most one page failing its CRC, which reads skip,
+// and whatever was still in RAM. Mount() finds the newest page again.
+//
+// Pages go out in the order they were written, so Scan() binary searches
+// the sectors by write time before reading pages in order. Sectors without
+// a whole page hold nothing to scan; the search goes by their neighbours.
+
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace tslog {
+
+struct PageInfo;
+
+const size_t kPageSize = 256;
+const size_t kSectorSize = 4096;
+const size_t kPagesPerSector = kSectorSize / kPageSize;
+// Magic, stream, count, seq, written_s, first_s, first value, payload bits
+// and CRC.
+const size_t kHeaderSize = 24;
+const size_t kPayloadBits = (kPageSize - kHeaderSize) * 8;
+
+// NOR flash: erasing sets a sector to 0xff, writing only clears bits.
+class Flash {
+ public:
+  virtual ~Flash() = default;
+
+  // Whole sectors.
+  virtual size_t size() const = 0;
+  virtual bool Read(size_t offset, void* data, size_t size) = 0;
+  virtual bool Write(size_t offset, const void* data, size_t size) = 0;
+  // A whole number of sectors.
+  virtual bool Erase(size_t offset, size_t size) = 0;
+};
+
+// The data partition labelled label.
+class PartitionFlash : public Flash {
+ public:
+  explicit PartitionFlash(const char* label);
+
+  // False if there is no such partition.
+  bool ok() const { return partition_ != nullptr; }
+
+  size_t size() const override;
+  bool Read(size_t offset, void* data, size_t size) override;
+  bool Write(size_t offset, const void* data, size_t size) override;
+  bool Erase(size_t offset, size_t size) override;
+
+ private:
+  const esp_partition_t* partition_;
+};
+
+struct Sample {
+  uint32_t time_s;
+  int16_t value;
+};
+
+struct Stats {
+  // Appended, and of those in pages written to flash.
+  uint32_t samples;
+  uint32_t samples_written;
+  uint32_t pages_written;
+  uint32_t erases;
+  // Of the samples in written pages, encoded.
+  uint32_t payload_bytes;
+  // Pages skipped by Mount() or reads for a bad CRC.
+  uint32_t bad_pages;
+  // Full pages lost because the queue was full, WriteOut() not keeping up.
+  uint32_t dropped_pages;
+
+  // Flash taken per sample.
+  float bytes_per_sample() const {
+    return samples_written == 0
+               ? 0
+               : static_cast<float>(pages_written) * kPageSize /
+                     samples_written;
+  }
+  // Flash taken per byte of encoded samples: the cost of headers, and of
+  // pages flushed part full.
+  float write_amplification() const {
+    return payload_bytes == 0 ? 0
+                              : static_cast<float>(pages_written) * kPageSize /
+                                    payload_bytes;
+  }
+};
+
+// Safe from any task; Append() has to be called in time order per stream.
+class Log {
+ public:
+  static const int kMaxStreams = 8;
+  // Full pages waiting for WriteOut().
+  static const int kMaxQueuedPages = 4;
+
+  // flash must have at least two sectors.
+  explicit Log(Flash* flash) : flash_(flash) {}
+  Log(const Log&) = delete;
+  Log& operator=(const Log&) = delete;
+
+  // Picks up after the newest page on flash. False if the flash is unusable;
+  // the log then drops everything.
+  bool Mount();
+
+  // Adds a sample to stream, which has to come no earlier than the stream's
+  // last. Queued for WriteOut() once its page fills up; false if the queue
+  // was full and that page had to be dropped.
+  bool Append(int stream, uint32_t time_s, int16_t value);
+  // Programs the queued pages, erasing sectors as it goes, which can take
+  // tens of milliseconds. False if any of them failed.
+  bool WriteOut();
+  // Writes out the queued pages and every part-full one, e.g. before a
+  // restart.
+  void Flush();
+
+  // Calls fn(sample, arg) for stream's samples from from_s through to_s,
+  // oldest first and those not yet written last, until fn returns false.
+  // Returns how many fn took. WriteOut() waits until it is done.
+  size_t Scan(int stream, uint32_t from_s, uint32_t to_s,
+              bool (*fn)(const Sample& sample, void* arg), void* arg);
+
+  Stats stats();
+  size_t pages() const { return pages_; }
+
+ private:
+  struct Page {
+    uint8_t data[kPageSize];
+    uint16_t count;
+    uint32_t bits;
+    uint32_t first_s;
+    int16_t first_value;
+    uint32_t last_s;
+    int32_t last_delta_s;
+    int16_t last_value;
+    // Once queued.
+    uint8_t stream;
+    uint32_t written_s;
+  };
+
+  // Encodes a sample after the page's first; false if it doesn't fit.
+  static bool Encode(Page* page, uint32_t time_s, int16_t value);
+  // Fills in page's header, returning the size of its payload.
+  static size_t FillHeader(Page* page, int stream, uint32_t seq,
+                           uint32_t written_s);
+  // Moves stream's page onto the queue, stamped as written at last_s_, and
+  // starts it over; false if the queue is full and it was dropped. Takes
+  // mutex_.
+  bool Queue(int stream);
+  // Programs and dequeues the queued pages; false if any failed. Takes
+  // flash_mutex_.
+  bool WriteQueued();
+  // Programs a queued page at head_.
+  bool WritePage(Page* page);
+  // The header of sector's first whole page, torn ones skipped; false if it
+  // has none.
+  bool FirstPage(size_t sector, PageInfo* info);
+  // Whether page holds nothing but 0xff.
+  bool Erased(size_t page);
+
+  Flash* const flash_;
+  // Held for the flash, and the head and seq below, while pages are written
+  // out or scanned. Never held by Append().
+  SemaphoreHandle_t flash_mutex_ = nullptr;
+  // Guards the pages in RAM and stats_; only ever held briefly.
+  SemaphoreHandle_t mutex_ = nullptr;
+  size_t pages_ = 0;
+  bool mounted_ = false;
+  // Next page to program, and its sequence number.
+  size_t head_ = 0;
+  uint32_t seq_ = 1;
+  // The latest time appended, which pages are stamped as written at.
+  uint32_t last_s_ = 0;
+  Page streams_[kMaxStreams] = {};
+  // A ring, oldest first.
+  Page queue_[kMaxQueuedPages] = {};
+  int queue_front_ = 0;
+  int queued_ = 0;
+  Stats stats_ = {};
+};
+
+struct PageInfo {
+  uint8_t stream;
+  uint16_t count;
+  uint32_t seq;
+  uint32_t written_s;
+  uint32_t first_s;
+};
+
+// The header of a page as read from flash; false if it isn't a whole page,
+// e.g. erased or torn.
+bool ParsePage(const uint8_t* page, PageInfo* info);
+// Calls fn(sample, arg) for the samples of a page ParsePage() took, until
+// it returns false. Returns false if fn did.
+bool DecodePage(const uint8_t* page, bool (*fn)(const Sample&, void*),
+                void* arg);
+
+}  // namespace tslog
+
+#endif  // _TSLOG_H_
@@ -1,6 +1,8 @@
 #ifndef _HTML_H_
 #define _HTML_H_
 
+// The status page. DoStatusz() fills in the {{name}} placeholders; see
+// html_template.h.
 const char indexTemplate[] = R"(
 
 <!doctype html>
@@ -55,7 +57,7 @@ div.aqiBoxTitle {
 div.aqiBoxAqi {
 	font-size: 3em;
 	text-align: center;
-	width: 100%%;
+	width: 100%;
 }
 div.aqiBoxDetails {
 	position: absolute;
@@ -66,9 +68,9 @@ div.aqiBoxDetails {
 .all-center {
 	margin: 0;
 	position: absolute;
-	top: 50%%;
-	left: 50%%;
-	transform: translate(-50%%, -50%%);
+	top: 50%;
+	left: 50%;
+	transform: translate(-50%, -50%);
 }
 
 div.bonusText {
@@ -79,60 +81,60 @@ div.bonusText {
 	</style>
 </head>
 
-<body style="font-family: monospace" class="%s">
+<body style="font-family: monospace" class="{{aqi_class}}">
 
 <div style="display:flex; justify-content:center; align-items:center; padding:1em">
 <div>
 
 	<div style="margin:3em">
-	<H1 style="justify-content: center; text-align:center; font-size: min(15em,25vw); font-weight: bold; margin: 0">%d</h1>
-	<H2 style="justify-content: center; text-align:center; font-size: min(3em,5vw); margin: 0">%s</h2>
+	<H1 style="justify-content: center; text-align:center; font-size: min(15em,25vw); font-weight: bold; margin: 0">{{aqi}}</h1>
+	<H2 style="justify-content: center; text-align:center; font-size: min(3em,5vw); margin: 0">{{aqi_message}}</h2>
 	</div>
 
 	<div style="display:flex; flex-wrap: wrap; justify-content:center; align-items:center; padding:1em; white-space:nowrap">
-		<div class="aqiBox %s">
+		<div class="aqiBox {{pm1_0_class}}">
 			<div class="aqiBoxTitle">PM 1.0</div>
-			<div class="aqiBoxAqi all-center">%d</div>
-			<div class="aqiBoxDetails">%.1f µg/m<sup>3</sup></div>
+			<div class="aqiBoxAqi all-center">{{pm1_0_aqi}}</div>
+			<div class="aqiBoxDetails">{{pm1_0}} µg/m<sup>3</sup></div>
 		</div>
 
-		<div class="aqiBox %s">
+		<div class="aqiBox {{pm2_5_class}}">
 			<div class="aqiBoxTitle">PM 2.5</div>
-			<div class="aqiBoxAqi all-center">%d</div>
-			<div class="aqiBoxDetails">%.1f µg/m<sup>3</sup></div>
+			<div class="aqiBoxAqi all-center">{{pm2_5_aqi}}</div>
+			<div class="aqiBoxDetails">{{pm2_5}} µg/m<sup>3</sup></div>
 		</div>
 
-		<div class="aqiBox %s">
+		<div class="aqiBox {{pm10_0_class}}">
 			<div class="aqiBoxTitle">PM 10.0</div>
-			<div class="aqiBoxAqi all-center">%d</div>
-			<div class="aqiBoxDetails">%.1f µg/m<sup>3</sup></div>
+			<div class="aqiBoxAqi all-center">{{pm10_0_aqi}}</div>
+			<div class="aqiBoxDetails">{{pm10_0}} µg/m<sup>3</sup></div>
 		</div>
 	</div>
 
 	<div style="display:flex; flex-wrap: wrap; justify-content:center; align-items:center; padding:1em; white-space:nowrap">
-	<div class="aqiBox %s">
+	<div class="aqiBox {{co2_class}}">
 		<div class="aqiBoxTitle">CO2</div>
-		<div class="aqiBoxAqi all-center" style="font-size:2.5em">%d</div>
+		<div class="aqiBoxAqi all-center" style="font-size:2.5em">{{co2_ppm}}</div>
 		<div class="aqiBoxDetails">ppm</sup></div>
 	</div>
 	</div>
 
 	<div style="display:flex; flex-wrap: wrap; justify-content:center; align-items:center; padding:1em; white-space:nowrap">
-	  <div class="bonusText">%.1f°C</div>
-	  <div class="bonusText">%.1f°F</div>
-	  <div class="bonusText">RH: %.0f%%</div>
-	  <div class="bonusText">%.2f hPa</div>
+	  <div class="bonusText">{{temp_c}}°C</div>
+	  <div class="bonusText">{{temp_f}}°F</div>
+	  <div class="bonusText">RH: {{humidity_pct}}%</div>
+	  <div class="bonusText">{{pressure_hpa}} hPa</div>
 	</div>
 
 	<div style="text-align:left">
-Uptime: %s<br />
-PMSA003:    particles/dL: >=0.3µm: %.1f >=0.5µm: %.1f >=1.0µm: %.1f >=2.5µm: %.1f >=5.0µm: %.1f >=10.0µm: %.1f
+Uptime: {{uptime}}<br />
+PMSA003:    particles/dL: >=0.3µm: {{particles_gt_0_3}} >=0.5µm: {{particles_gt_0_5}} >=1.0µm: {{particles_gt_1_0}} >=2.5µm: {{particles_gt_2_5}} >=5.0µm: {{particles_gt_5_0}} >=10.0µm: {{particles_gt_10_0}}
 <br />
-MH-Z19C:    CO2:  %dppm  %d°C     %.1f°F
+MH-Z19C:    CO2:  {{mhz19_co2_ppm}}ppm  {{mhz19_temp_c}}°C     {{mhz19_temp_f}}°F
 <br />
-DS-020-20:  CO2: %dppm 
+DS-020-20:  CO2: {{dsco220_co2_ppm}}ppm 
 <br />
-%s:         %.2f°C  %.2f°F  %.2f Pa  RH: %.2f%%
+{{bme_name}}:         {{bme_temp_c}}°C  {{bme_temp_f}}°F  {{bme_pressure_pa}} Pa  RH: {{bme_humidity_pct}}%
 <br />
 	</div>
 
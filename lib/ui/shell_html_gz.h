@@ -0,0 +1,202 @@
+// Generated by tools/embed_gzip.py from shell.html; do not edit.
+
+#ifndef _SHELL_HTML_GZ_H_
+#define _SHELL_HTML_GZ_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 6863 bytes, 2242 gzipped.
+const char kShellHtmlEtag[] = R"("fe66e07680301eaf")";
+const size_t kShellHtmlGzSize = 2242;
+const uint8_t kShellHtmlGz[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xbd, 0x59,
+    0xdd, 0x72, 0xdb, 0xb8, 0x15, 0xbe, 0xb6, 0x9e, 0x02, 0x51, 0x27, 0x4b,
+    0xa9, 0x2b, 0x52, 0x14, 0x65, 0x79, 0x13, 0xd9, 0xd2, 0x4e, 0xea, 0x24,
+    0xb3, 0xed, 0xc4, 0x8d, 0x5b, 0xa7, 0x37, 0xcd, 0x64, 0x34, 0x10, 0x09,
+    0x8a, 0x88, 0x49, 0x82, 0x21, 0x40, 0xc9, 0x4a, 0xd6, 0xef, 0xd4, 0x9b,
+    0x7d, 0x81, 0x3c, 0x59, 0xcf, 0x01, 0x7f, 0xf5, 0x67, 0x47, 0x49, 0xa7,
+    0xbe, 0xa0, 0x48, 0xe0, 0x9c, 0xef, 0x1c, 0x7c, 0xe7, 0x07, 0x04, 0x7d,
+    0xf1, 0xc4, 0x13, 0xae, 0x5a, 0x27, 0x8c, 0x04, 0x2a, 0x0a, 0xa7, 0xad,
+    0x0b, 0xfc, 0x21, 0x21, 0x8d, 0x17, 0x93, 0x36, 0x8b, 0xdb, 0x38, 0xc0,
+    0xa8, 0x37, 0x6d, 0x9d, 0x5c, 0x28, 0xae, 0x42, 0x36, 0x7d, 0x75, 0x73,
+    0x3d, 0x74, 0xc8, 0x8b, 0x7f, 0xfc, 0xf5, 0xa2, 0x9f, 0x0f, 0xc0, 0x4c,
+    0xc4, 0x14, 0x25, 0x6e, 0x40, 0x53, 0xc9, 0xd4, 0xc4, 0xc8, 0x94, 0x6f,
+    0x3e, 0x33, 0xaa, 0xf1, 0x98, 0x46, 0x6c, 0x62, 0x2c, 0x39, 0x5b, 0x25,
+    0x22, 0x55, 0x06, 0x71, 0x45, 0xac, 0x58, 0x0c, 0x72, 0x3c, 0xe6, 0x8a,
+    0xd3, 0xd0, 0x94, 0x2e, 0x0d, 0xd9, 0x64, 0xd0, 0x23, 0xa5, 0x8c, 0xe9,
+    0x73, 0x35, 0x71, 0xc5, 0x92, 0xa5, 0x1a, 0x45, 0xaa, 0x35, 0x9a, 0x69,
+    0x59, 0x0b, 0x21, 0x3c, 0xf2, 0xa5, 0x45, 0xc8, 0x9c, 0xba, 0xb7, 0x8b,
+    0x54, 0x64, 0xb1, 0x67, 0xba, 0x22, 0x14, 0xe9, 0x98, 0xfc, 0xe9, 0xec,
+    0x19, 0x1b, 0x9c, 0x0e, 0xcf, 0x5b, 0xf7, 0x2d, 0x2b, 0x12, 0x1e, 0x4b,
+    0xa9, 0x62, 0x87, 0x44, 0x7d, 0xf8, 0x1b, 0x8d, 0xb4, 0x68, 0x16, 0xc3,
+    0xe2, 0x42, 0x15, 0xac, 0x4d, 0x5f, 0xa4, 0xa6, 0x64, 0xb1, 0x04, 0x97,
+    0x96, 0xcc, 0x44, 0x8d, 0x44, 0x1e, 0x02, 0x60, 0xfe, 0xb3, 0xd1, 0x70,
+    0xb8, 0x09, 0x70, 0x50, 0x96, 0x0e, 0x87, 0xce, 0xe9, 0x39, 0x4c, 0x36,
+    0xcc, 0x6b, 0x55, 0x58, 0xde, 0xda, 0x7c, 0x54, 0xff, 0x99, 0x3b, 0xa0,
+    0xa7, 0xf3, 0x7d, 0xfa, 0x01, 0xfd, 0x4c, 0x53, 0x4f, 0x64, 0xf2, 0x78,
+    0x55, 0x6d, 0xfa, 0x51, 0xfd, 0x5f, 0x86, 0x83, 0x53, 0x67, 0xb4, 0x4f,
+    0x5f, 0x2a, 0x88, 0x98, 0x56, 0x13, 0x09, 0x75, 0xb9, 0x5a, 0x8f, 0x89,
+    0x6d, 0x69, 0x46, 0x3d, 0xbe, 0xb4, 0x52, 0xb1, 0x82, 0xb9, 0x13, 0x8f,
+    0xcb, 0x24, 0xa4, 0x30, 0xe5, 0x87, 0xec, 0xee, 0xbc, 0x75, 0x82, 0x3f,
+    0xe6, 0x2a, 0xa5, 0xc9, 0x98, 0xe0, 0x15, 0x46, 0x3e, 0x66, 0x52, 0x71,
+    0x7f, 0x6d, 0x16, 0x19, 0x31, 0x26, 0x2e, 0x5c, 0x59, 0x0a, 0x33, 0x34,
+    0xe4, 0x8b, 0xd8, 0xe4, 0x8a, 0x45, 0xb2, 0x31, 0x9a, 0x50, 0xcf, 0xe3,
+    0xf1, 0x62, 0x4c, 0x06, 0x2c, 0x82, 0xc7, 0x55, 0x00, 0x02, 0xa6, 0x04,
+    0x0f, 0xd8, 0x98, 0xc4, 0x22, 0x07, 0xcd, 0x5d, 0xa0, 0x9f, 0xf8, 0x5f,
+    0xc4, 0x1d, 0x7a, 0x91, 0x08, 0x0c, 0xa9, 0x88, 0xc7, 0x24, 0x65, 0x21,
+    0xc5, 0xe0, 0x82, 0x66, 0xc0, 0xf8, 0x22, 0x00, 0x7b, 0x67, 0x1a, 0x27,
+    0xe2, 0xb1, 0xb9, 0xe2, 0x9e, 0x0a, 0xca, 0x81, 0xca, 0x0e, 0x2c, 0x2a,
+    0x97, 0xa0, 0xe9, 0x82, 0xc7, 0xf8, 0xfc, 0x4b, 0x3e, 0xe0, 0x83, 0xc7,
+    0xe6, 0xaa, 0x40, 0x99, 0x8b, 0xd0, 0x83, 0xb1, 0xb9, 0x48, 0x21, 0xef,
+    0xc6, 0x44, 0x8a, 0x90, 0xd7, 0xcf, 0x25, 0x9b, 0xf3, 0x10, 0x08, 0xde,
+    0x74, 0xef, 0x1d, 0x96, 0xcf, 0xa6, 0x8f, 0x74, 0x0e, 0xda, 0x99, 0x42,
+    0x1f, 0x95, 0x48, 0xd0, 0xe0, 0x50, 0xdb, 0x0b, 0x99, 0xaf, 0x6a, 0x77,
+    0xb4, 0x75, 0xc9, 0x3f, 0xb3, 0x82, 0x89, 0x26, 0xe8, 0x8b, 0x4f, 0x1c,
+    0x21, 0x1b, 0x22, 0x39, 0x82, 0x62, 0x77, 0xca, 0xd4, 0xb4, 0x36, 0x08,
+    0x2d, 0x56, 0x3d, 0xb0, 0xed, 0xa7, 0x9b, 0x28, 0x2f, 0xa1, 0x70, 0x79,
+    0x28, 0x0f, 0x3a, 0x37, 0x17, 0x4a, 0x89, 0xa8, 0xf6, 0x28, 0xcd, 0x99,
+    0x38, 0xec, 0xa0, 0x45, 0xc3, 0xd0, 0xcc, 0xed, 0x22, 0x68, 0x45, 0xe8,
+    0xf9, 0x43, 0xab, 0x1f, 0xa1, 0x5b, 0xc5, 0xda, 0xf3, 0x7b, 0x95, 0xd2,
+    0x58, 0x42, 0xa9, 0x82, 0x69, 0x7d, 0x0b, 0x11, 0x65, 0x1d, 0x13, 0xe6,
+    0x7a, 0x04, 0xaf, 0x5d, 0x34, 0x15, 0x40, 0x27, 0x09, 0x1c, 0xb4, 0x72,
+    0x38, 0xbf, 0xf6, 0xb2, 0xd1, 0x70, 0x2a, 0xe7, 0x62, 0x2e, 0xe2, 0x4c,
+    0xbe, 0x03, 0xd1, 0xa6, 0xcb, 0x83, 0x83, 0x09, 0xd0, 0x58, 0xb5, 0x93,
+    0xaf, 0xfa, 0xe4, 0xa2, 0x5f, 0x34, 0xaf, 0x8b, 0x7e, 0xde, 0x45, 0x5b,
+    0x17, 0x73, 0xe1, 0xad, 0x89, 0x1e, 0x9d, 0xb4, 0xb5, 0x86, 0x4f, 0x23,
+    0x1e, 0x42, 0x99, 0x44, 0x22, 0x16, 0x3a, 0x99, 0xdb, 0xc4, 0xa3, 0x8a,
+    0x9a, 0xee, 0xa4, 0x0d, 0xc1, 0xb0, 0x14, 0x5d, 0xb4, 0x51, 0x0f, 0x1c,
+    0x2a, 0xd5, 0xca, 0xca, 0xd2, 0x85, 0x45, 0xb6, 0x57, 0x59, 0xac, 0x87,
+    0x34, 0x6b, 0xa8, 0x1c, 0x2b, 0x33, 0x1b, 0x16, 0x81, 0x9d, 0x1d, 0x30,
+    0x01, 0xfa, 0xa4, 0x89, 0x5d, 0x2c, 0x73, 0xa8, 0x05, 0x4e, 0x2e, 0x82,
+    0xc1, 0x86, 0xaf, 0xf9, 0xea, 0xa0, 0x60, 0x3a, 0x03, 0x88, 0x74, 0xcf,
+    0x19, 0x2d, 0x57, 0xdd, 0x73, 0xb2, 0x43, 0x46, 0xb1, 0x82, 0xdb, 0x7c,
+    0x05, 0x4b, 0x1a, 0x66, 0xac, 0x3d, 0x05, 0x0a, 0x06, 0x1a, 0xd2, 0x39,
+    0x00, 0x09, 0x36, 0x7b, 0x08, 0xb8, 0xa9, 0x1d, 0x31, 0x29, 0xe9, 0x22,
+    0xd7, 0x77, 0x50, 0xbf, 0xdf, 0xf4, 0xda, 0x0d, 0xa9, 0x94, 0x93, 0x36,
+    0xb4, 0x1c, 0x74, 0x77, 0x63, 0x2c, 0xcf, 0xe4, 0x9a, 0xcc, 0x24, 0x92,
+    0x77, 0xb6, 0x3d, 0xb4, 0x92, 0x68, 0x30, 0xb3, 0x0b, 0x5a, 0x4f, 0xf6,
+    0xa9, 0xe8, 0xba, 0x6c, 0x4f, 0xaf, 0xaf, 0xc8, 0xc0, 0xb2, 0x0b, 0x73,
+    0x7b, 0x05, 0xb1, 0xd6, 0xea, 0xbc, 0xae, 0xdd, 0xde, 0xb4, 0x04, 0xb2,
+    0xe8, 0xfc, 0x61, 0x98, 0xa2, 0xd8, 0x40, 0x08, 0xc2, 0x1f, 0x1f, 0x40,
+    0xc9, 0x16, 0xb3, 0x68, 0x58, 0x98, 0xf0, 0x26, 0xed, 0x01, 0x42, 0xa2,
+    0xf8, 0x94, 0x7c, 0xfd, 0x63, 0xd1, 0x8f, 0x2e, 0x64, 0x96, 0x4c, 0x87,
+    0x30, 0x04, 0x3f, 0x95, 0xad, 0x8a, 0xaa, 0x6f, 0xe4, 0xc5, 0x99, 0x8d,
+    0xbe, 0x8d, 0x17, 0xc7, 0x1a, 0xfd, 0x18, 0x2f, 0x68, 0xe9, 0xc7, 0x79,
+    0x41, 0x94, 0xff, 0x07, 0x2f, 0x03, 0xfb, 0x9b, 0x13, 0xc6, 0xfe, 0xe1,
+    0x8c, 0xb1, 0xff, 0x37, 0x29, 0x63, 0xff, 0x58, 0xce, 0x3c, 0x58, 0x66,
+    0x0f, 0xb1, 0xe6, 0x49, 0x57, 0x38, 0x4e, 0x4d, 0xd7, 0x41, 0xb6, 0x2e,
+    0xdf, 0x3a, 0xb5, 0xd1, 0x47, 0x89, 0xda, 0xe9, 0x18, 0x0e, 0x6e, 0x35,
+    0x35, 0x81, 0xa5, 0x59, 0xb8, 0xce, 0x92, 0x24, 0x6a, 0xb0, 0xf7, 0x00,
+    0x79, 0x20, 0xb8, 0xb5, 0xdc, 0x07, 0x97, 0x4d, 0x48, 0x73, 0xb0, 0xda,
+    0x1c, 0xb6, 0x83, 0x30, 0x8f, 0x98, 0x05, 0x4d, 0x37, 0x99, 0xb9, 0xfb,
+    0xa8, 0xff, 0xfa, 0x9f, 0xcb, 0xd2, 0xd6, 0xf7, 0xe2, 0xf9, 0xc0, 0xc3,
+    0x7e, 0xe8, 0xd7, 0x8f, 0x42, 0xff, 0xf3, 0xb7, 0x31, 0xd9, 0x85, 0x0f,
+    0xb2, 0x88, 0x7b, 0xf0, 0x1a, 0x37, 0x4b, 0x5c, 0x55, 0x23, 0xdb, 0x15,
+    0xf2, 0xd3, 0xef, 0x70, 0x39, 0x49, 0xa1, 0x71, 0x67, 0x29, 0x9b, 0x25,
+    0xb4, 0xf6, 0x3b, 0xa8, 0x1e, 0x00, 0xdf, 0xa9, 0xf3, 0x31, 0xb8, 0xa6,
+    0xfb, 0x23, 0x50, 0xc4, 0xbd, 0xb1, 0x5f, 0xe3, 0xeb, 0x00, 0x44, 0xe3,
+    0x5f, 0x89, 0xe2, 0x11, 0xdb, 0x5e, 0x4c, 0xa6, 0x47, 0x67, 0x91, 0xac,
+    0x4d, 0xe6, 0x43, 0x95, 0xa9, 0x8b, 0x79, 0x4a, 0xfa, 0xd3, 0xd6, 0xf5,
+    0xd5, 0xcd, 0x0b, 0xa8, 0x94, 0x31, 0x81, 0xbf, 0x84, 0xa6, 0x8a, 0xbb,
+    0x21, 0x93, 0x7d, 0xef, 0xcd, 0x98, 0x4c, 0x27, 0xf0, 0xd2, 0xf5, 0xf5,
+    0x8f, 0x68, 0x1b, 0xba, 0xaa, 0xad, 0x52, 0x7a, 0x96, 0xb0, 0x74, 0xe6,
+    0x85, 0xd6, 0x42, 0xcd, 0xec, 0xd9, 0xde, 0x32, 0x6b, 0x21, 0xd6, 0xe8,
+    0x68, 0xac, 0xd1, 0x01, 0x2c, 0xd8, 0x8d, 0x8e, 0xc4, 0x82, 0x8d, 0xe3,
+    0x00, 0x96, 0x73, 0xb4, 0x5f, 0xce, 0x41, 0xbf, 0x46, 0x47, 0xfb, 0x35,
+    0x3a, 0xe8, 0x17, 0x36, 0xd0, 0x63, 0x17, 0x69, 0x1f, 0x40, 0x2b, 0x42,
+    0x7d, 0xf5, 0x9b, 0xf9, 0xef, 0xc1, 0xf3, 0x4b, 0x1d, 0x6a, 0x68, 0x3a,
+    0xf0, 0xbb, 0x89, 0x1d, 0x05, 0x9f, 0x07, 0xcf, 0x9b, 0x8d, 0x43, 0x6b,
+    0xc3, 0xfd, 0x7e, 0xc1, 0xa2, 0x14, 0x1b, 0xf5, 0x8c, 0xc0, 0x0f, 0x89,
+    0x3e, 0x5a, 0xb5, 0xa5, 0xa7, 0x2f, 0x6f, 0x4c, 0xdb, 0xb1, 0x4d, 0xc7,
+    0x1e, 0x17, 0x9e, 0x6e, 0x82, 0xee, 0xe9, 0x71, 0xa5, 0xab, 0x25, 0xc2,
+    0x6e, 0x19, 0xe2, 0x99, 0x56, 0xa4, 0x95, 0xac, 0x66, 0x61, 0x8f, 0xc3,
+    0xfb, 0x9a, 0x96, 0xb3, 0xb9, 0xc8, 0xa3, 0xba, 0x52, 0x53, 0xf7, 0xf5,
+    0x3e, 0xdd, 0xdd, 0xf6, 0xb0, 0xd9, 0x11, 0xae, 0x29, 0x21, 0xc7, 0x34,
+    0xab, 0x5a, 0xf5, 0x69, 0x49, 0x46, 0xd5, 0x4a, 0x8a, 0xdf, 0xea, 0x51,
+    0xba, 0x29, 0x4f, 0xd4, 0xb4, 0xd5, 0xef, 0x93, 0xd7, 0x3c, 0x84, 0x63,
+    0x0e, 0x8f, 0x89, 0x0a, 0x18, 0x34, 0x82, 0x05, 0x23, 0x7e, 0x2a, 0x22,
+    0xd2, 0x67, 0x4b, 0xd8, 0x78, 0x24, 0xa1, 0x12, 0x8e, 0x8d, 0x14, 0x5f,
+    0x99, 0x25, 0x1c, 0x82, 0x23, 0x06, 0x92, 0x3d, 0x22, 0x52, 0x32, 0x5f,
+    0x93, 0x44, 0x84, 0x21, 0x8c, 0x23, 0x48, 0x9f, 0x26, 0xbc, 0xbf, 0x1c,
+    0xf4, 0x2b, 0x51, 0xee, 0x6b, 0x3c, 0x8f, 0x2d, 0xb9, 0xcb, 0x88, 0xca,
+    0xd2, 0x58, 0xea, 0x01, 0xa9, 0x40, 0x24, 0x22, 0x74, 0x45, 0xd7, 0x16,
+    0x79, 0x15, 0xb2, 0x48, 0x1b, 0xc1, 0x0f, 0x24, 0x64, 0x15, 0x50, 0x85,
+    0x58, 0x20, 0x06, 0xc7, 0x83, 0x00, 0x8e, 0xd0, 0x60, 0x83, 0xc3, 0x6c,
+    0x42, 0x55, 0x50, 0x3a, 0x58, 0x1a, 0x18, 0x17, 0x84, 0xc0, 0x9b, 0x77,
+    0x4a, 0xb0, 0x37, 0xf6, 0xc8, 0x8a, 0x83, 0x58, 0x4e, 0x06, 0xc2, 0x78,
+    0xcc, 0xe5, 0x11, 0x85, 0xa5, 0xd1, 0xd8, 0x2b, 0xe2, 0x43, 0x28, 0x7e,
+    0x7a, 0x81, 0xa3, 0xbf, 0x84, 0xc3, 0x56, 0xaf, 0xd8, 0xb0, 0x35, 0x02,
+    0xcd, 0x1b, 0xba, 0xd5, 0x82, 0x79, 0xa9, 0xc8, 0xed, 0x35, 0x2c, 0xed,
+    0x4a, 0x92, 0x09, 0x1c, 0xba, 0x6c, 0x38, 0x0c, 0xb5, 0xfc, 0x2c, 0x76,
+    0xf1, 0x84, 0x86, 0xc7, 0x87, 0x4e, 0x8c, 0xb6, 0xe0, 0xd8, 0xd8, 0xd5,
+    0xe7, 0xff, 0x94, 0xe1, 0xea, 0xc8, 0x8d, 0x4a, 0xc1, 0xaf, 0x4e, 0xdc,
+    0x85, 0x0a, 0xf5, 0x6e, 0x14, 0x54, 0x69, 0x47, 0x0b, 0xf5, 0x88, 0x61,
+    0x1b, 0xfa, 0x54, 0x56, 0x60, 0xd7, 0x1e, 0x20, 0x3e, 0x22, 0xf8, 0x70,
+    0x02, 0x23, 0x93, 0x29, 0x5c, 0xfe, 0x4c, 0x9e, 0x93, 0x3e, 0x19, 0x91,
+    0x9f, 0xc9, 0xd0, 0xe9, 0xc1, 0x0c, 0x6c, 0x16, 0x63, 0x30, 0x89, 0x93,
+    0x70, 0xed, 0xe3, 0x31, 0x15, 0x87, 0xb3, 0xa2, 0xf3, 0x47, 0x12, 0x67,
+    0x10, 0x02, 0x3f, 0x50, 0x20, 0x38, 0x42, 0x5e, 0x01, 0x5d, 0x96, 0x1f,
+    0x0a, 0x91, 0x76, 0x40, 0x40, 0x2b, 0xd9, 0xdd, 0xf3, 0x86, 0x90, 0xb7,
+    0x29, 0x84, 0x32, 0xcf, 0xce, 0x4e, 0xb7, 0x84, 0x82, 0x5d, 0xa1, 0xe1,
+    0x19, 0xc8, 0x90, 0xa7, 0x24, 0xff, 0x98, 0x53, 0x0a, 0x46, 0xbb, 0x82,
+    0x67, 0x5a, 0xec, 0xcc, 0xce, 0xc5, 0x0a, 0x82, 0x3a, 0x1e, 0xf9, 0x15,
+    0x4c, 0xff, 0x4c, 0x0c, 0xcf, 0x20, 0x63, 0x62, 0x18, 0x5d, 0xb8, 0x47,
+    0x3a, 0x81, 0x22, 0x07, 0xef, 0x8d, 0xc0, 0x28, 0x46, 0xa2, 0x72, 0x24,
+    0x82, 0x91, 0x56, 0x59, 0xae, 0x38, 0x23, 0x35, 0x6e, 0x39, 0x2d, 0x0d,
+    0xb4, 0x70, 0xdf, 0x6b, 0xdd, 0x37, 0x43, 0x04, 0x6e, 0xdc, 0x66, 0x49,
+    0xa7, 0xcc, 0x94, 0x9e, 0xce, 0x9f, 0x8d, 0x58, 0xe1, 0x80, 0x05, 0x07,
+    0x48, 0xae, 0x3a, 0x86, 0x65, 0x74, 0xad, 0x94, 0x79, 0x99, 0xcb, 0x3a,
+    0x1d, 0xd1, 0x23, 0xb7, 0x6c, 0xdd, 0x45, 0x52, 0x05, 0x99, 0x4c, 0x48,
+    0x9c, 0x85, 0x21, 0x38, 0x2d, 0xc0, 0x5d, 0xf1, 0x1e, 0x66, 0x3e, 0xf4,
+    0xaa, 0xfc, 0xcb, 0x23, 0x5a, 0xd9, 0xcc, 0x12, 0x0f, 0xcf, 0xe1, 0xd5,
+    0x6c, 0x1e, 0x57, 0x48, 0xac, 0x4e, 0x4e, 0x12, 0x23, 0xc2, 0x27, 0x9e,
+    0x70, 0x33, 0xcc, 0x77, 0xeb, 0x53, 0xc6, 0xd2, 0xf5, 0x0d, 0x0b, 0x99,
+    0xab, 0x44, 0xfa, 0x22, 0x0c, 0x3b, 0xc6, 0xfb, 0x3c, 0x9b, 0x3f, 0x18,
+    0xdd, 0x6e, 0x11, 0xcf, 0x90, 0x29, 0xa2, 0x8f, 0x8d, 0x40, 0xef, 0xce,
+    0x8a, 0x98, 0x85, 0xf2, 0x92, 0x29, 0xeb, 0xb6, 0x08, 0x1a, 0xd4, 0x5b,
+    0x27, 0x17, 0x7f, 0x52, 0xf8, 0xfd, 0xd3, 0x4f, 0x0d, 0x31, 0xbf, 0x84,
+    0x25, 0x15, 0x68, 0x23, 0x0f, 0xdf, 0x37, 0x04, 0x3f, 0xe4, 0x30, 0x05,
+    0xec, 0xfd, 0x16, 0x78, 0x41, 0xca, 0x2e, 0x9a, 0x61, 0x1a, 0x85, 0x06,
+    0x61, 0xa1, 0x64, 0x5a, 0xa5, 0x46, 0xf5, 0x76, 0x15, 0xf4, 0xaf, 0xa5,
+    0xc4, 0x6b, 0x7e, 0xc7, 0xbc, 0x0d, 0xd1, 0xa6, 0x65, 0xec, 0xb0, 0x77,
+    0xea, 0x32, 0x3f, 0xd7, 0x97, 0x5a, 0x3a, 0xe8, 0xdf, 0xc3, 0xaf, 0xdb,
+    0xe0, 0x77, 0xd3, 0x41, 0x6c, 0x37, 0x71, 0xed, 0x24, 0xb3, 0x74, 0x3b,
+    0x78, 0xc3, 0xa5, 0x82, 0xe4, 0x88, 0xc4, 0x92, 0xed, 0xc8, 0x6e, 0x7a,
+    0xb9, 0x31, 0xf7, 0x70, 0xc4, 0xdc, 0x2e, 0xf9, 0xfd, 0x77, 0x48, 0xff,
+    0xf3, 0xe3, 0xdc, 0xa0, 0x9e, 0xf7, 0x80, 0x0f, 0xf7, 0x1b, 0xd9, 0x88,
+    0x8d, 0xb9, 0x53, 0xe4, 0x20, 0x53, 0x6e, 0xd0, 0x31, 0xb6, 0xfb, 0xb3,
+    0xd1, 0x2d, 0x4c, 0x58, 0xd0, 0x54, 0x63, 0xf0, 0x53, 0x26, 0xc0, 0x23,
+    0xab, 0xdb, 0x49, 0xe9, 0xdb, 0x93, 0x72, 0xca, 0x12, 0xb7, 0xdd, 0xc6,
+    0x1c, 0x81, 0x6e, 0x8c, 0x5f, 0x39, 0x63, 0xb6, 0x22, 0xaf, 0xd2, 0x14,
+    0x0a, 0xbf, 0x12, 0x94, 0x8a, 0xaa, 0x4c, 0x16, 0xce, 0xd5, 0x24, 0x35,
+    0x5a, 0x41, 0x25, 0xfa, 0x51, 0x8a, 0xb8, 0x53, 0x49, 0xde, 0x6f, 0x3b,
+    0x55, 0xec, 0x25, 0x1b, 0x4e, 0x6d, 0x57, 0x5a, 0x6d, 0xa6, 0x0a, 0x3f,
+    0x7e, 0x5f, 0xda, 0x0d, 0xa0, 0xa1, 0x3f, 0xd9, 0x1a, 0x7b, 0xac, 0xb9,
+    0x14, 0x39, 0xea, 0xe8, 0xba, 0x3f, 0x04, 0x82, 0xf4, 0x97, 0x08, 0x95,
+    0xa2, 0xcf, 0x63, 0x38, 0xa1, 0xad, 0x0b, 0x55, 0x88, 0xcb, 0x3b, 0x68,
+    0xcb, 0x22, 0x53, 0x1d, 0x0c, 0x40, 0xaf, 0xdc, 0x45, 0xba, 0x79, 0xaf,
+    0x80, 0x2d, 0xe9, 0x1d, 0x6c, 0x60, 0x3e, 0x4f, 0x31, 0x5f, 0x71, 0x73,
+    0x25, 0x01, 0x6c, 0xae, 0x0c, 0xbf, 0x44, 0x97, 0x6d, 0xe5, 0x9c, 0xe0,
+    0xe7, 0xbc, 0x94, 0x88, 0x98, 0x49, 0xb8, 0x84, 0x6b, 0xbd, 0x29, 0xe2,
+    0xff, 0x15, 0xe2, 0x05, 0xf3, 0xac, 0x46, 0x8f, 0x03, 0x9f, 0x80, 0xa2,
+    0x3c, 0x22, 0x79, 0x09, 0xd4, 0x74, 0x91, 0x2f, 0xf7, 0xe7, 0xd5, 0x70,
+    0xb1, 0x8d, 0x4f, 0xf2, 0x48, 0xe1, 0xc3, 0x8d, 0xc8, 0x52, 0xe8, 0x76,
+    0x46, 0xb1, 0xc3, 0xe7, 0x8c, 0xe4, 0xf7, 0xb8, 0x4c, 0x2d, 0xf3, 0x46,
+    0xe3, 0xb3, 0xb4, 0x63, 0x54, 0x19, 0x03, 0x39, 0x5c, 0x47, 0xe2, 0xed,
+    0xfc, 0x23, 0x14, 0x97, 0x05, 0xec, 0xc0, 0x81, 0xa4, 0x91, 0xe6, 0x7f,
+    0xbb, 0x79, 0xfb, 0x77, 0x7c, 0x45, 0x95, 0x65, 0xc1, 0x74, 0x0b, 0xbe,
+    0xf7, 0x87, 0xed, 0x88, 0x90, 0xdd, 0x37, 0xdd, 0x04, 0x7e, 0x30, 0xe7,
+    0x60, 0x55, 0x39, 0xf5, 0x5f, 0x1e, 0x44, 0x6b, 0xc6, 0x2e, 0xb7, 0x0b,
+    0xb1, 0xb8, 0x0c, 0x85, 0x64, 0x1e, 0x49, 0x61, 0x2b, 0x00, 0xc2, 0x15,
+    0x30, 0x0c, 0x0c, 0x02, 0x65, 0x31, 0xac, 0x4b, 0x7f, 0xf9, 0x6e, 0xbc,
+    0xbe, 0x48, 0xca, 0x3d, 0x12, 0x0b, 0xab, 0xae, 0xd8, 0xdc, 0x0d, 0x5c,
+    0xcd, 0x1a, 0xf6, 0x7a, 0xa5, 0x1b, 0x63, 0x83, 0x5c, 0xeb, 0xf2, 0xcd,
+    0xdb, 0x9b, 0x57, 0x2f, 0xeb, 0x82, 0xc9, 0x2b, 0xb2, 0x51, 0xaf, 0x3a,
+    0x25, 0x10, 0x6a, 0xc5, 0x63, 0x4f, 0xac, 0xac, 0x86, 0x72, 0xae, 0x55,
+    0x46, 0x18, 0x04, 0xf3, 0x8e, 0x8a, 0x83, 0x25, 0xcc, 0x3d, 0xbc, 0xc9,
+    0x95, 0xaf, 0x70, 0x70, 0x8b, 0xeb, 0xd5, 0x1f, 0x58, 0xf5, 0xbf, 0xaf,
+    0xfe, 0x0b, 0x23, 0xe0, 0x70, 0x56, 0xcf, 0x1a, 0x00, 0x00,
+};
+
+#endif  // _SHELL_HTML_GZ_H_
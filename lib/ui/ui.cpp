@@ -1,15 +1,29 @@
 #include "ui.h"
 
+#include <ArduinoJson.h>
 #include <TFT_eSPI.h>
 #include <WiFi.h>
-#include <WiFiServer.h>
 #include <dump.h>
 #include <esp_log.h>
 #include <esp_wifi.h>
 #include <freertos/task.h>
+#include <math.h>
 
+#include <algorithm>
+#include <atomic>
+
+#include "aqi.h"
 #include "constants.h"
+#include "event_stream.h"
+#include "history.h"
 #include "html.h"
+#include "html_template.h"
+#include "http_server.h"
+#include "metrics.h"
+#include "net_manager.h"
+#include "prober.h"
+#include "response_cache.h"
+#include "shell_html_gz.h"
 
 namespace ui {
 
@@ -91,261 +105,6 @@ void TaskTft() {
   delay(5000);
 }
 
-float calcAQI(int val, int concL, int concH, int aqiL, int aqiH) {
-  return aqiL + float(val - concL) * (aqiH - aqiL) / (concH - concL);
-}
-
-uint32_t FgColor(uint32_t bg_color) {
-  // https://www.w3.org/TR/AERT/#color-contrast
-  // range: [0,255000]
-  int brightness = (bg_color >> 16) * 299 + ((bg_color >> 8) & 0xff) * 587 +
-                   (bg_color & 0xff) * 114;
-  return (brightness > 127500) ? 0x000000 : 0xffffff;
-}
-
-struct AqiCategory {
-  const char* tag;
-  const char* message;
-
-  uint16_t low_aqi;
-  uint16_t high_aqi;
-  uint32_t color;  // official AQI colors
-  uint32_t web_color;
-  uint32_t led_color;
-};
-
-const std::initializer_list<AqiCategory> aqi_categories = {
-    {
-        .tag = "good",
-        .message = "Good 😀",
-        .low_aqi = 0,
-        .high_aqi = 50,
-        .color = 0x00e400,
-        .web_color = 0x68e143,
-        .led_color = 0x00ff00,
-    },
-    {
-        .tag = "moderate",
-        .message = "Moderate 😐",
-        .low_aqi = 51,
-        .high_aqi = 100,
-        .color = 0xffff00,
-        .web_color = 0xffff55,
-        .led_color = 0xffff00,
-    },
-    {
-        .tag = "unhealthy-for-sensitive-groups",
-        .message = "Unhealthy for sensitive groups 🙁",
-        .low_aqi = 101,
-        .high_aqi = 150,
-        .color = 0xff7e00,
-        .web_color = 0xef8533,
-        .led_color = 0xff6000,
-    },
-    {
-        .tag = "unhealthy",
-        .message = "Unhealthy 😷",
-        .low_aqi = 151,
-        .high_aqi = 200,
-        .color = 0xff0000,
-        .web_color = 0xea3324,
-        .led_color = 0xff0000,
-    },
-    {
-        .tag = "very-unhealthy",
-        .message = "Very Unhealthy 🤢",
-        .low_aqi = 201,
-        .high_aqi = 300,
-        .color = 0x8f3f97,
-        .web_color = 0x8c1a4b,
-        .led_color = 0xff0020,
-    },
-    {
-        .tag = "hazardous",
-        .message = "Hazardous 😵",
-        .low_aqi = 301,
-        .high_aqi = 400,
-        .color = 0x7e0023,
-        .web_color = 0x8c1a4b,
-        .led_color = 0xff0040,
-    },
-    {
-        // Note: Officially, this is still just "hazardous".
-        .tag = "very-hazardous",
-        .message = "Very Hazardous ☠️",
-        .low_aqi = 401,
-        .high_aqi = 500,
-        .color = 0x7e0023,
-        .web_color = 0x731425,
-        .led_color = 0xff0060,
-    },
-};
-
-struct AqiLevel {
-  float low_conc;
-  float high_conc;
-};
-
-// PM1.0 aqi isn't really defined!
-const std::initializer_list<AqiLevel> aqi_pm2_5 = {
-    // good
-    {
-        .low_conc = 0.0,
-        .high_conc = 12.0,
-    },
-    // moderate
-    {
-        .low_conc = 12.1,
-        .high_conc = 35.4,
-    },
-    // unhealthy for sensitive groups
-    {
-        .low_conc = 35.5,
-        .high_conc = 55.4,
-    },
-    // unhealthy
-    {
-        .low_conc = 55.5,
-        .high_conc = 150.4,
-    },
-    // very unhealthy
-    {
-        .low_conc = 150.5,
-        .high_conc = 250.4,
-    },
-    // hazardous
-    {
-        .low_conc = 250.5,
-        .high_conc = 350.4,
-    },
-    {
-        .low_conc = 350.5,
-        .high_conc = 500.4,
-    },
-};
-const std::initializer_list<AqiLevel> aqi_pm10_0 = {
-    // good
-    {
-        .low_conc = 0,
-        .high_conc = 54,
-    },
-    // moderate
-    {
-        .low_conc = 55,
-        .high_conc = 154,
-    },
-    // unhealthy for sensitive groups
-    {
-        .low_conc = 155,
-        .high_conc = 254,
-    },
-    // unhealthy
-    {
-        .low_conc = 255,
-        .high_conc = 354,
-    },
-    // very unhealthy
-    {
-        .low_conc = 355,
-        .high_conc = 424,
-    },
-    // hazardous
-    {
-        .low_conc = 425,
-        .high_conc = 504,
-    },
-    {
-        .low_conc = 505,
-        .high_conc = 604,
-    },
-};
-
-// CO2 aqi isn't a thing, just doing this for colors.
-const std::initializer_list<AqiLevel> aqi_co2 = {
-    // good, green
-    {
-        .low_conc = 0,
-        .high_conc = 700,
-    },
-    // moderate, yellow
-    {
-        .low_conc = 701,
-        .high_conc = 1000,
-    },
-    // unhealthy for sensitive groups, orange
-    {
-        .low_conc = 1001,
-        .high_conc = 1500,
-    },
-    // unhealthy, red
-    {
-        .low_conc = 1501,
-        .high_conc = 2000,
-    },
-    // very unhealthy, purple
-    {
-        .low_conc = 2001,
-        .high_conc = 3000,
-    },
-    // hazardous, maroon
-    {
-        .low_conc = 3001,
-        .high_conc = 4000,
-    },
-    {
-        .low_conc = 4001,
-        .high_conc = 5000,
-    },
-};
-
-// TODO: truncate conc to 1 decimal place for PM2.5, integer for PM10.0
-// https://www.airnow.gov/aqi/aqi-calculator/
-// https://www.airnow.gov/sites/default/files/2020-05/aqi-technical-assistance-document-sept2018.pdf
-int Aqi(const std::initializer_list<AqiLevel>& aqi_levels,
-        int truncate_decimals, float conc) {
-  for (int i = 0; i < truncate_decimals; ++i) {
-    conc *= 10;
-  }
-  conc = int(conc);  // truncate
-  for (int i = 0; i < truncate_decimals; ++i) {
-    conc /= 10;
-  }
-
-  auto p_level = aqi_levels.begin();
-  auto cat = aqi_categories.begin();
-  while (p_level + 1 < aqi_levels.end() && cat + 1 < aqi_categories.end()) {
-    if (conc <= p_level->high_conc) {
-      break;
-    }
-    p_level++;
-    cat++;
-  }
-
-  return std::round(cat->low_aqi +
-                    float(cat->high_aqi - cat->low_aqi) /
-                        float(p_level->high_conc - p_level->low_conc) *
-                        (conc - p_level->low_conc));
-}
-
-const AqiCategory& GetAqiCategory(float aqi) {
-  const AqiCategory* c = nullptr;
-  for (const auto& cat : aqi_categories) {
-    c = &cat;
-    if (aqi <= cat.high_aqi) {
-      break;
-    }
-  }
-  return *c;
-}
-
-const char* AqiTag(float aqi) { return GetAqiCategory(aqi).tag; }
-
-const char* AqiMessage(int aqi) { return GetAqiCategory(aqi).message; }
-
-const char* Co2Tag(int co2_ppm) {
-  return GetAqiCategory(Aqi(aqi_co2, 0, co2_ppm)).tag;
-}
-
 int32_t co2Color(int co2_ppm) {
   if (co2_ppm < 700) {
     // return 0x68e143;
@@ -380,155 +139,720 @@ int32_t co2Color(int co2_ppm) {
   }
 }
 
-void DoStatusz(WiFiClient* client, const TaskData* task_data) {
-  client->print("HTTP/1.1 200 OK\r\n");
-  client->print("Content-Type:text/html charset=utf-8\r\n");
-  client->print("Connection: close\r\n");
-  client->print("\r\n");
+namespace {
 
-  // PM1.0 AQI is not a thing!
-  int pm1aqi = Aqi(aqi_pm2_5, 1, task_data->pmsx003_data->pm_1_0);
-  int pm25aqi = Aqi(aqi_pm2_5, 1, task_data->pmsx003_data->pm_2_5);
-  int pm10aqi = Aqi(aqi_pm10_0, 0, task_data->pmsx003_data->pm_10_0);
-
-  int max_aqi = pm25aqi;
-  const char* max_aqi_class = AqiTag(pm25aqi);
-  if (pm10aqi > pm25aqi) {
-    max_aqi = pm10aqi;
-    max_aqi_class = AqiTag(pm10aqi);
-  }
-
-  // int co2Rand = random(0,6000);
-
-  char buf[4 * 1024] = {0};
-  snprintf(buf, sizeof(buf), indexTemplate,
-           // Overall AQI
-           max_aqi_class, max_aqi, AqiMessage(max_aqi),
-           // PM 1.0/2.5/10.0 AQI
-           // PM1.0 AQI is not a thing!
-           AqiTag(pm1aqi), pm1aqi, task_data->pmsx003_data->pm_1_0,
-           AqiTag(pm25aqi), pm25aqi, task_data->pmsx003_data->pm_2_5,
-           AqiTag(pm10aqi), pm10aqi, task_data->pmsx003_data->pm_10_0,
-           // CO2
-           Co2Tag(task_data->dsco220_data->co2_ppm),
-           task_data->dsco220_data->co2_ppm,
-           // Temp/Humidity/Pressure
-           task_data->bme_data->temp_c,
-           dump::CToF(task_data->bme_data->temp_c),
-           task_data->bme_data->humidity_pct,
-           task_data->bme_data->pressure_pa / 100.0,
-
-           // Bottom details
-           dump::MillisHumanReadable(millis()).c_str(),
-           task_data->pmsx003_data->particles_gt_0_3,
-           task_data->pmsx003_data->particles_gt_0_5,
-           task_data->pmsx003_data->particles_gt_1_0,
-           task_data->pmsx003_data->particles_gt_2_5,
-           task_data->pmsx003_data->particles_gt_5_0,
-           task_data->pmsx003_data->particles_gt_10_0,
-           task_data->mhz19_data->co2_ppm, task_data->mhz19_data->temp_c,
-           dump::CToF(task_data->mhz19_data->temp_c),
-           task_data->dsco220_data->co2_ppm,
-           // BMEx80
-           task_data->bme_data->sensor_name, task_data->bme_data->temp_c,
-           dump::CToF(task_data->bme_data->temp_c),
-           task_data->bme_data->pressure_pa,
-           task_data->bme_data->humidity_pct);
-  client->print(buf);
-
-  client->print("\n");
-}
-
-void DoVarz(WiFiClient* client, const TaskData* task_data) {
-  client->print("HTTP/1.1 200 OK\r\n");
-  client->print("Content-Type:text/plain; version=0.0.4; charset=utf-8\r\n");
-  client->print("Connection: close\r\n");
-  client->print("\r\n");
-
-  String mac = WiFi.macAddress();
-  // mac.replace(":", "");
-  mac.toLowerCase();
-  String ip = WiFi.localIP().toString();
-  const char* host = WiFi.getHostname();
-  auto MetricLine = [&](const char* name, const char* fields, String value) {
-    String line =
-        R"({name}{mac_address="{mac}",ip_address="{ip}",hostname="{host}",{fields}} {value})";
-    line.replace("{name}", name);
-    line.replace("{mac}", mac);
-    line.replace("{ip}", ip);
-    line.replace("{host}", host);
-    line.replace("{fields}", fields);
-    line.replace("{value}", String(value));
-    line += '\n';
-    return line;
-  };
-  auto MetricLineInt = [&](const char* name, const char* fields, long value) {
-    return MetricLine(name, fields, String(value));
-  };
-  auto MetricLineUint = [&](const char* name, const char* fields,
-                            unsigned long value) {
-    return MetricLine(name, fields, String(value));
-  };
-  auto MetricLineDouble = [&](const char* name, const char* fields,
-                              double value) {
-    return MetricLine(name, fields, String(value));
-  };
-
-  client->print(MetricLineUint("uptime_ms", "", millis()));
-
-  String wifi_fields = R"(ssid="{ssid}",bssid="{bssid}",channel="{channel}")";
-  wifi_fields.replace("{ssid}", WiFi.SSID());
-  String bssid = WiFi.BSSIDstr();
-  bssid.toLowerCase();
-  wifi_fields.replace("{bssid}", bssid);
-  wifi_fields.replace("{channel}", String(WiFi.channel()));
-  client->print(MetricLineInt("wifi_rssi", wifi_fields.c_str(), WiFi.RSSI()));
-  client->print(
-      MetricLineInt("wifi_txpower", wifi_fields.c_str(), WiFi.getTxPower()));
-
-  if (millis() < 60000) {
+// Everything the status page shows: one consistent snapshot per sensor, and
+// what's worked out from them.
+struct StatuszValues {
+  pmsx003::Data pmsx003;
+  mhz19::Data mhz19;
+  dsco220::Data dsco220;
+  bme::Data bme;
+  aqi::Data aqi;
+  unsigned long uptime_ms;
+};
+
+const StatuszValues& Values(const void* values) {
+  return *reinterpret_cast<const StatuszValues*>(values);
+}
+
+void PrintInt(Print* out, int64_t value) {
+  char buf[metrics::kMaxNumberSize];
+  out->write(buf, metrics::FormatInt(value, buf));
+}
+
+void PrintFixed(Print* out, double value, int digits) {
+  char buf[metrics::kMaxNumberSize];
+  out->write(buf, metrics::FormatFixed(value, digits, buf));
+}
+
+// The placeholders in indexTemplate.
+const html_template::Field kStatuszFields[] = {
+    // Overall AQI
+    {"aqi_class",
+     [](Print* out, const void* v) {
+       out->print(Values(v).aqi.max.category().tag);
+     }},
+    {"aqi",
+     [](Print* out, const void* v) { PrintInt(out, Values(v).aqi.max.aqi); }},
+    {"aqi_message",
+     [](Print* out, const void* v) {
+       out->print(Values(v).aqi.max.category().message);
+     }},
+    // PM 1.0/2.5/10.0 AQI
+    {"pm1_0_class",
+     [](Print* out, const void* v) {
+       out->print(Values(v).aqi.pm1_0.category().tag);
+     }},
+    {"pm1_0_aqi",
+     [](Print* out, const void* v) { PrintInt(out, Values(v).aqi.pm1_0.aqi); }},
+    {"pm1_0",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).aqi.pm_1_0, 1);
+     }},
+    {"pm2_5_class",
+     [](Print* out, const void* v) {
+       out->print(Values(v).aqi.pm2_5.category().tag);
+     }},
+    {"pm2_5_aqi",
+     [](Print* out, const void* v) { PrintInt(out, Values(v).aqi.pm2_5.aqi); }},
+    {"pm2_5",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).aqi.pm_2_5, 1);
+     }},
+    {"pm10_0_class",
+     [](Print* out, const void* v) {
+       out->print(Values(v).aqi.pm10_0.category().tag);
+     }},
+    {"pm10_0_aqi",
+     [](Print* out, const void* v) {
+       PrintInt(out, Values(v).aqi.pm10_0.aqi);
+     }},
+    {"pm10_0",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).aqi.pm_10_0, 1);
+     }},
+    // CO2
+    {"co2_class",
+     [](Print* out, const void* v) {
+       out->print(Values(v).aqi.co2.category().tag);
+     }},
+    {"co2_ppm",
+     [](Print* out, const void* v) { PrintInt(out, Values(v).aqi.co2_ppm); }},
+    // Temp/Humidity/Pressure
+    {"temp_c",
+     [](Print* out, const void* v) { PrintFixed(out, Values(v).bme.temp_c, 1); }},
+    {"temp_f",
+     [](Print* out, const void* v) {
+       PrintFixed(out, dump::CToF(Values(v).bme.temp_c), 1);
+     }},
+    {"humidity_pct",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).bme.humidity_pct, 0);
+     }},
+    {"pressure_hpa",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).bme.pressure_pa / 100.0, 2);
+     }},
+    // Bottom details
+    {"uptime",
+     [](Print* out, const void* v) {
+       out->print(dump::MillisHumanReadable(Values(v).uptime_ms));
+     }},
+    {"particles_gt_0_3",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).pmsx003.particles_gt_0_3, 1);
+     }},
+    {"particles_gt_0_5",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).pmsx003.particles_gt_0_5, 1);
+     }},
+    {"particles_gt_1_0",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).pmsx003.particles_gt_1_0, 1);
+     }},
+    {"particles_gt_2_5",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).pmsx003.particles_gt_2_5, 1);
+     }},
+    {"particles_gt_5_0",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).pmsx003.particles_gt_5_0, 1);
+     }},
+    {"particles_gt_10_0",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).pmsx003.particles_gt_10_0, 1);
+     }},
+    {"mhz19_co2_ppm",
+     [](Print* out, const void* v) { PrintInt(out, Values(v).mhz19.co2_ppm); }},
+    {"mhz19_temp_c",
+     [](Print* out, const void* v) { PrintInt(out, Values(v).mhz19.temp_c); }},
+    {"mhz19_temp_f",
+     [](Print* out, const void* v) {
+       PrintFixed(out, dump::CToF(Values(v).mhz19.temp_c), 1);
+     }},
+    {"dsco220_co2_ppm",
+     [](Print* out, const void* v) {
+       PrintInt(out, Values(v).dsco220.co2_ppm);
+     }},
+    // BMEx80
+    {"bme_name",
+     [](Print* out, const void* v) {
+       const char* name = Values(v).bme.sensor_name;
+       out->print(name ? name : "BMEx80");
+     }},
+    {"bme_temp_c",
+     [](Print* out, const void* v) { PrintFixed(out, Values(v).bme.temp_c, 2); }},
+    {"bme_temp_f",
+     [](Print* out, const void* v) {
+       PrintFixed(out, dump::CToF(Values(v).bme.temp_c), 2);
+     }},
+    {"bme_pressure_pa",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).bme.pressure_pa, 2);
+     }},
+    {"bme_humidity_pct",
+     [](Print* out, const void* v) {
+       PrintFixed(out, Values(v).bme.humidity_pct, 2);
+     }},
+};
+
+const html_template::Template& StatuszTemplate() {
+  static const html_template::Template statusz_template(
+      indexTemplate, kStatuszFields,
+      sizeof(kStatuszFields) / sizeof(kStatuszFields[0]));
+  return statusz_template;
+}
+
+}  // namespace
+
+void DoStatusz(Print* client, const TaskData* task_data,
+               unsigned long uptime_ms) {
+  StatuszValues values;
+  values.pmsx003 = task_data->pmsx003->Get().value;
+  values.mhz19 = task_data->mhz19->Get().value;
+  values.dsco220 = task_data->dsco220->Get().value;
+  values.bme = task_data->bme->Get().value;
+  values.aqi = task_data->aqi->Get().value;
+  values.uptime_ms = uptime_ms;
+
+  StatuszTemplate().Render(client, &values);
+}
+
+namespace {
+metrics::LabelCache label_cache;
+// Uptime at the first /varz or /metrics request: how long after boot the
+// device could be reached. 0 until then.
+std::atomic<uint32_t> first_scrape_ms{0};
+}  // namespace
+
+void DoVarz(Print* client, const TaskData* task_data,
+            unsigned long uptime_ms) {
+  // Everything the labels are made of, gathered without allocating; the
+  // labels themselves are only re-rendered when this changes.
+  metrics::Identity identity = {};
+  WiFi.macAddress(identity.mac);
+  identity.ip = WiFi.localIP();
+  strncpy(identity.hostname, WiFi.getHostname(),
+          sizeof(identity.hostname) - 1);
+  wifi_ap_record_t ap_info;
+  const bool associated = esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK;
+  if (associated) {
+    const char* ssid = reinterpret_cast<const char*>(ap_info.ssid);
+    memcpy(identity.ssid, ssid, strnlen(ssid, sizeof(identity.ssid) - 1));
+    memcpy(identity.bssid, ap_info.bssid, sizeof(identity.bssid));
+    identity.channel = ap_info.primary;
+  }
+  metrics::Labels labels;
+  label_cache.Get(identity, &labels);
+
+  metrics::Writer out(client, labels.common);
+  out.Int("uptime_ms", "", uptime_ms);
+  out.Int("boot_to_first_scrape_ms", "", first_scrape_ms.load());
+  out.Int("wifi_rssi", labels.wifi, associated ? ap_info.rssi : 0);
+  out.Int("wifi_txpower", labels.wifi, WiFi.getTxPower());
+
+  // Per AP of the network, from the background scans and gateway probes.
+  const net_manager::RoamTable roaming = net_manager::Roaming();
+  for (int i = 0; i < roaming.size(); ++i) {
+    const net_manager::ApQuality& ap = roaming.ap(i);
+    char ap_label[64];
+    snprintf(ap_label, sizeof(ap_label),
+             R"(bssid="%02x:%02x:%02x:%02x:%02x:%02x",channel="%u")",
+             ap.bssid[0], ap.bssid[1], ap.bssid[2], ap.bssid[3], ap.bssid[4],
+             ap.bssid[5], ap.channel);
+    out.Int("wifi_ap_rssi", ap_label, ap.rssi());
+    if (ap.probe_count > 0) {
+      out.Int("wifi_ap_gateway_rtt_us", ap_label, ap.rtt_us);
+      out.Int("wifi_ap_gateway_loss_percent", ap_label, ap.loss_percent());
+    }
+  }
+  const net_manager::RoamStats& roam_stats = roaming.stats();
+  out.Int("wifi_scans", "", roam_stats.scans);
+  for (int i = 1; i < net_manager::kNumRoamReasons; ++i) {
+    char reason_label[32];
+    snprintf(reason_label, sizeof(reason_label), R"(reason="%s")",
+             net_manager::RoamReasonName(
+                 static_cast<net_manager::RoamReason>(i)));
+    out.Int("wifi_roams", reason_label, roam_stats.roams[i]);
+  }
+  // Degraded, but no better AP in range.
+  out.Int("wifi_roam_stays", "", roam_stats.roams[0]);
+
+  for (prober::Target* target : {&prober::Gateway(), &prober::Upstream()}) {
+    const prober::Stats stats = target->stats();
+    char target_label[64];
+    snprintf(target_label, sizeof(target_label), R"(target="%s")",
+             target->name());
+    out.Int("net_probes", target_label, stats.probes);
+    out.Int("net_probes_lost", target_label, stats.lost);
+    const struct {
+      const char* quantile;
+      uint32_t us;
+    } quantiles[] = {
+        {"0.5", stats.p50_us}, {"0.95", stats.p95_us}, {"0.99", stats.p99_us}};
+    for (const auto& quantile : quantiles) {
+      snprintf(target_label, sizeof(target_label),
+               R"(target="%s",quantile="%s")", target->name(),
+               quantile.quantile);
+      out.Int("net_rtt_us", target_label, quantile.us);
+    }
+  }
+
+  const net_manager::LinkStats link = net_manager::Stats();
+  out.Int("wifi_online", "", link.state == net_manager::LinkState::kOnline);
+  out.Int("wifi_connects", "", link.connects);
+  out.Int("wifi_connect_failures", "", link.failures);
+  out.Int("wifi_disconnects", "", link.disconnects);
+  out.Int("wifi_connect_ms", "", link.last_connect_ms);
+  out.Int("wifi_connect_max_ms", "", link.max_connect_ms);
+  out.Int("wifi_fast_connects", "", link.fast_connects);
+  out.Int("wifi_fast_connect_failures", "", link.fast_failures);
+  out.Int("wifi_boot_connect_ms", "", link.boot_connect_ms);
+  out.Int("wifi_reconnect_ms", "", link.last_reconnect_ms);
+  out.Int("wifi_reconnect_max_ms", "", link.max_reconnect_ms);
+  out.Int("wifi_portal_active", "", net_manager::PortalActive());
+  out.Int("wifi_portal_sessions", "", link.portal_sessions);
+  out.Int("wifi_provisions", "", link.provisions);
+  out.Int("wifi_provision_ms", "", link.last_provision_ms);
+  for (const auto& reason : link.reasons) {
+    if (reason.count > 0) {
+      char reason_label[16];
+      snprintf(reason_label, sizeof(reason_label), R"(reason="%u")",
+               reason.reason);
+      out.Int("wifi_disconnect_events", reason_label, reason.count);
+    }
+  }
+
+  const tslog::Stats log_stats = history::LogStats();
+  out.Int("flash_log_samples", "", log_stats.samples);
+  out.Int("flash_log_pages_written", "", log_stats.pages_written);
+  out.Int("flash_log_erases", "", log_stats.erases);
+  out.Int("flash_log_bad_pages", "", log_stats.bad_pages);
+  out.Int("flash_log_dropped_pages", "", log_stats.dropped_pages);
+  out.Fixed("flash_log_bytes_per_sample", "", log_stats.bytes_per_sample());
+  out.Fixed("flash_log_write_amplification", "",
+            log_stats.write_amplification());
+
+  if (uptime_ms < 60000) {
     ESP_LOGI(TAG, "Not reporting sensor varz until up for 1m");
     return;
   }
 
-  // Particulate
-  client->print(MetricLineDouble("pm_ug_m3", R"(sensor="PMSA003",size="pm1.0")",
-                                 task_data->pmsx003_data->pm_1_0));
-  client->print(MetricLineDouble("pm_ug_m3", R"(sensor="PMSA003",size="pm2.5")",
-                                 task_data->pmsx003_data->pm_2_5));
-  client->print(MetricLineDouble("pm_ug_m3",
-                                 R"(sensor="PMSA003",size="pm10.0")",
-                                 task_data->pmsx003_data->pm_10_0));
+  const auto mhz19_data = task_data->mhz19->Get().value;
+  const auto bme_data = task_data->bme->Get().value;
+  const auto aqi_data = task_data->aqi->Get().value;
+
+  // Particulate and CO2 as the AQI was worked out from them.
+  out.Fixed("pm_ug_m3", R"(sensor="PMSA003",size="pm1.0")", aqi_data.pm_1_0);
+  out.Fixed("pm_ug_m3", R"(sensor="PMSA003",size="pm2.5")", aqi_data.pm_2_5);
+  out.Fixed("pm_ug_m3", R"(sensor="PMSA003",size="pm10.0")",
+            aqi_data.pm_10_0);
 
   // PM1.0 AQI is not a thing!
-  int pm1aqi = Aqi(aqi_pm2_5, 1, task_data->pmsx003_data->pm_1_0);
-  int pm25aqi = Aqi(aqi_pm2_5, 1, task_data->pmsx003_data->pm_2_5);
-  int pm10aqi = Aqi(aqi_pm10_0, 0, task_data->pmsx003_data->pm_10_0);
-  client->print(
-      MetricLineInt("us_aqi", R"(sensor="PMSA003",size="pm1.0")", pm1aqi));
-  client->print(
-      MetricLineInt("us_aqi", R"(sensor="PMSA003",size="pm2.5")", pm25aqi));
-  client->print(
-      MetricLineInt("us_aqi", R"(sensor="PMSA003",size="pm10.0")", pm10aqi));
-
-  client->print(MetricLineInt("co2_ppm", R"(sensor="DS-CO2-20")",
-                              task_data->dsco220_data->co2_ppm));
-
-  client->print(MetricLineInt("co2_ppm", R"(sensor="MH-Z19C")",
-                              task_data->mhz19_data->co2_ppm));
-  client->print(MetricLineInt("temp_c", R"(sensor="MH-Z19C")",
-                              task_data->mhz19_data->temp_c));
-
-  std::string bme_fields =
-      std::string(R"(sensor=")") + task_data->bme_data->sensor_name + R"(")";
-  client->print(MetricLineDouble("temp_c", bme_fields.c_str(),
-                                 task_data->bme_data->temp_c));
-  client->print(MetricLineDouble("pressure_pa", bme_fields.c_str(),
-                                 task_data->bme_data->pressure_pa));
-  client->print(MetricLineDouble("humidity_percent", bme_fields.c_str(),
-                                 task_data->bme_data->humidity_pct));
+  out.Int("us_aqi", R"(sensor="PMSA003",size="pm1.0")", aqi_data.pm1_0.aqi);
+  out.Int("us_aqi", R"(sensor="PMSA003",size="pm2.5")", aqi_data.pm2_5.aqi);
+  out.Int("us_aqi", R"(sensor="PMSA003",size="pm10.0")", aqi_data.pm10_0.aqi);
+
+  out.Int("co2_ppm", R"(sensor="DS-CO2-20")", aqi_data.co2_ppm);
+
+  out.Int("co2_ppm", R"(sensor="MH-Z19C")", mhz19_data.co2_ppm);
+  out.Int("temp_c", R"(sensor="MH-Z19C")", mhz19_data.temp_c);
+
+  char bme_fields[48];
+  snprintf(bme_fields, sizeof(bme_fields), R"(sensor="%s")",
+           bme_data.sensor_name);
+  out.Fixed("temp_c", bme_fields, bme_data.temp_c);
+  out.Fixed("pressure_pa", bme_fields, bme_data.pressure_pa);
+  out.Fixed("humidity_percent", bme_fields, bme_data.humidity_pct);
+}
+
+namespace {
+
+// Every object DoReadings() adds, by its number of members.
+const size_t kReadingsCapacity =
+    JSON_OBJECT_SIZE(6) + JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(4) +
+    3 * JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(6) + 2 * JSON_OBJECT_SIZE(2) +
+    JSON_OBJECT_SIZE(4);
+
+// To the precision worth sending, which also keeps floats from coming out
+// as 21.6000003.
+double Round(double value, int digits) {
+  const double scale = pow(10, digits);
+  return round(value * scale) / scale;
+}
+
+void AddPm(JsonObject pmsx003, const char* name, float ug_m3,
+           const aqi::Level& level) {
+  JsonObject pm = pmsx003.createNestedObject(name);
+  pm["ug_m3"] = Round(ug_m3, 1);
+  pm["aqi"] = level.aqi;
+  pm["tag"] = level.category().tag;
+}
+
+}  // namespace
+
+void DoReadings(Print* out, const TaskData* task_data, unsigned long uptime_ms,
+                EventBits_t sensors) {
+  StaticJsonDocument<kReadingsCapacity> doc;
+  doc["uptime_ms"] = uptime_ms;
+
+  // The particulate and CO2 sections wait for their AQI, so levels and
+  // readings always match.
+  const aqi::Data aqi_data = task_data->aqi->Get().value;
+  if (aqi_data.pmsx003_seq && (sensors & sensor_bus::kPmsx003)) {
+    const pmsx003::Data pms = task_data->pmsx003->Get().value;
+    JsonObject aqi = doc.createNestedObject("aqi");
+    aqi["value"] = aqi_data.max.aqi;
+    aqi["tag"] = aqi_data.max.category().tag;
+    aqi["message"] = aqi_data.max.category().message;
+
+    JsonObject pmsx003 = doc.createNestedObject("pmsx003");
+    // PM1.0 AQI is not a thing! Shown anyway, on the PM2.5 scale.
+    AddPm(pmsx003, "pm1_0", aqi_data.pm_1_0, aqi_data.pm1_0);
+    AddPm(pmsx003, "pm2_5", aqi_data.pm_2_5, aqi_data.pm2_5);
+    AddPm(pmsx003, "pm10_0", aqi_data.pm_10_0, aqi_data.pm10_0);
+    JsonObject particles = pmsx003.createNestedObject("particles_per_dl");
+    particles["gt_0_3"] = Round(pms.particles_gt_0_3, 1);
+    particles["gt_0_5"] = Round(pms.particles_gt_0_5, 1);
+    particles["gt_1_0"] = Round(pms.particles_gt_1_0, 1);
+    particles["gt_2_5"] = Round(pms.particles_gt_2_5, 1);
+    particles["gt_5_0"] = Round(pms.particles_gt_5_0, 1);
+    particles["gt_10_0"] = Round(pms.particles_gt_10_0, 1);
+  }
+
+  const auto mhz19_data = task_data->mhz19->Get();
+  if (mhz19_data.seq && (sensors & sensor_bus::kMhz19)) {
+    JsonObject mhz19 = doc.createNestedObject("mhz19");
+    mhz19["co2_ppm"] = mhz19_data.value.co2_ppm;
+    mhz19["temp_c"] = mhz19_data.value.temp_c;
+  }
+
+  if (aqi_data.dsco220_seq && (sensors & sensor_bus::kDsco220)) {
+    JsonObject dsco220 = doc.createNestedObject("dsco220");
+    dsco220["co2_ppm"] = aqi_data.co2_ppm;
+    dsco220["tag"] = aqi_data.co2.category().tag;
+  }
+
+  const auto bme_data = task_data->bme->Get();
+  if (bme_data.seq && (sensors & sensor_bus::kBme)) {
+    JsonObject bme = doc.createNestedObject("bme");
+    bme["sensor"] = bme_data.value.sensor_name;
+    bme["temp_c"] = Round(bme_data.value.temp_c, 2);
+    bme["pressure_pa"] = Round(bme_data.value.pressure_pa, 2);
+    bme["humidity_pct"] = Round(bme_data.value.humidity_pct, 2);
+  }
+
+  if (doc.overflowed()) {
+    ESP_LOGE(TAG, "DoReadings(): readings don't fit in %u bytes",
+             static_cast<unsigned>(kReadingsCapacity));
+  }
+  serializeJson(doc, *out);
+}
+
+// /mhz19?cmd=<command>[&arg=<n>] queues an MH-Z19 command, e.g.
+// cmd=zero_calibrate after 20 minutes in fresh air. Only read_co2 may be a
+// GET; the rest change the sensor, so they take a POST, with the params in
+// the query or a form. span_calibrate and set_range need an arg (see
+// mhz19::ValidArg()). The result shows up in the log; the response only
+// says whether the command was queued.
+void DoMhz19Command(const http_server::Request& request,
+                    http_server::Response* response, void* task_data_arg) {
+  const TaskData* task_data = reinterpret_cast<TaskData*>(task_data_arg);
+  std::string_view name_param;
+  std::string_view arg_param;
+  if (!request.FormParam("cmd", &name_param)) {
+    request.QueryParam("cmd", &name_param);
+  }
+  const bool has_arg = request.FormParam("arg", &arg_param) ||
+                       request.QueryParam("arg", &arg_param);
+  const std::string name(name_param);
+  mhz19::Command command;
+  uint32_t arg = 0;
+  if (task_data->mhz19_control == nullptr) {
+    http_server::SendStatus(response, 503, "MH-Z19 not enabled");
+  } else if (!mhz19::ParseCommand(name.c_str(), &command)) {
+    http_server::SendStatus(response, 400, "unknown cmd");
+  } else if (request.method() != "POST" &&
+             (command != mhz19::Command::kReadCo2 ||
+              request.method() != "GET")) {
+    const bool read = command == mhz19::Command::kReadCo2;
+    response->AddHeader("Allow", read ? "GET, POST" : "POST");
+    http_server::SendStatus(response, 405, read ? "GET or POST" : "POST only");
+  } else if (mhz19::TakesArg(command) &&
+             (!has_arg || !http_server::ParseUint(arg_param, &arg) ||
+              !mhz19::ValidArg(command, arg))) {
+    http_server::SendStatus(response, 400,
+                            command == mhz19::Command::kSetRange
+                                ? "arg must be 2000 or 5000"
+                                : "arg must be 1000 to 5000 ppm");
+  } else if (!mhz19::Submit(task_data->mhz19_control, command, arg)) {
+    http_server::SendStatus(response, 503, "queue full");
+  } else {
+    http_server::SendStatus(response, 200, "queued");
+  }
+}
+
+namespace {
+
+// How stale a cached page can get while the sensors are quiet.
+const unsigned long kMaxCacheAgeMs = 10 * 1000;
+
+struct CachedPage {
+  http_server::ResponseCache* cache;
+  const TaskData* task_data;
+};
+
+// Changes whenever a sensor publishes, since every topic's seq only goes
+// up, and at least every kMaxCacheAgeMs so uptime and WiFi stats move on
+// even when the sensors don't. The 1 minute mark, when /varz starts
+// reporting the sensors, is a multiple of that.
+uint32_t ContentVersion(const TaskData* task_data, unsigned long uptime_ms) {
+  return task_data->pmsx003->seq() + task_data->mhz19->seq() +
+         task_data->dsco220->seq() + task_data->bme->seq() +
+         task_data->aqi->seq() + uptime_ms / kMaxCacheAgeMs;
+}
+
+void RenderStatusz(Print* out, void* task_data) {
+  DoStatusz(out, reinterpret_cast<TaskData*>(task_data), millis());
+}
+
+void RenderVarz(Print* out, void* task_data) {
+  DoVarz(out, reinterpret_cast<TaskData*>(task_data), millis());
+}
+
+void RenderReadings(Print* out, void* task_data) {
+  DoReadings(out, reinterpret_cast<TaskData*>(task_data), millis());
+}
+
+struct ReadingsUpdate {
+  const TaskData* task_data;
+  EventBits_t sensors;
+};
+
+void RenderReadingsUpdate(Print* out, void* update_arg) {
+  const ReadingsUpdate* update = reinterpret_cast<ReadingsUpdate*>(update_arg);
+  DoReadings(out, update->task_data, millis(), update->sensors);
+}
+
+// Each topic's seq as of the last event on /events.
+struct SentSeqs {
+  uint32_t pmsx003;
+  uint32_t mhz19;
+  uint32_t dsco220;
+  uint32_t bme;
+};
+
+void CatchUp(uint32_t latest, EventBits_t bit, uint32_t* seq,
+             EventBits_t* changed) {
+  if (latest != *seq) {
+    *seq = latest;
+    *changed |= bit;
+  }
 }
 
+template <typename T>
+void CatchUp(const sensor_bus::Topic<T>& topic, uint32_t* seq,
+             EventBits_t* changed) {
+  CatchUp(topic.seq(), topic.bit(), seq, changed);
+}
+
+// Sensors that published since seqs, which catch up. The PMSx003 and
+// DS-CO2-20 count once their AQI has been worked out, which DoReadings()
+// takes their readings from.
+EventBits_t ChangedSensors(const TaskData* task_data, SentSeqs* seqs) {
+  EventBits_t changed = 0;
+  const aqi::Data aqi_data = task_data->aqi->Get().value;
+  CatchUp(aqi_data.pmsx003_seq, sensor_bus::kPmsx003, &seqs->pmsx003,
+          &changed);
+  CatchUp(*task_data->mhz19, &seqs->mhz19, &changed);
+  CatchUp(aqi_data.dsco220_seq, sensor_bus::kDsco220, &seqs->dsco220,
+          &changed);
+  CatchUp(*task_data->bme, &seqs->bme, &changed);
+  return changed;
+}
+
+struct Events {
+  http_server::EventStream* stream;
+  TaskData* task_data;
+};
+
+// GET /events: every reading, as it comes in. The first event has them all;
+// each one after only has the sensors that changed, to be merged in.
+void SubscribeEvents(const http_server::Request& request,
+                     http_server::Response* response, void* events_arg) {
+  const Events* events = reinterpret_cast<Events*>(events_arg);
+  events->stream->Subscribe(response, "readings", RenderReadings,
+                            events->task_data);
+}
+
+void ServeCached(const http_server::Request& request,
+                 http_server::Response* response, void* page_arg) {
+  const CachedPage* page = reinterpret_cast<CachedPage*>(page_arg);
+  page->cache->Serve(request, response,
+                     ContentVersion(page->task_data, millis()));
+}
+
+void ServeVarz(const http_server::Request& request,
+               http_server::Response* response, void* page_arg) {
+  uint32_t unset = 0;
+  first_scrape_ms.compare_exchange_strong(unset, millis());
+  ServeCached(request, response, page_arg);
+}
+
+// The page shell, gzipped in flash; its script fills it in from
+// /api/v1/readings. A client that won't take gzip gets the status page
+// rendered on the device instead.
+void ServeShell(const http_server::Request& request,
+                http_server::Response* response, void* statusz_arg) {
+  response->AddHeader("Vary", "Accept-Encoding");
+  if (!request.AcceptsEncoding("gzip")) {
+    ServeCached(request, response, statusz_arg);
+    return;
+  }
+  response->set_content_type("text/html; charset=utf-8");
+  response->AddHeader("Content-Encoding", "gzip");
+  response->AddHeader("ETag", kShellHtmlEtag);
+  // Only a firmware update changes it, and the ETag catches that once a
+  // day has gone by.
+  response->AddHeader("Cache-Control", "public, max-age=86400");
+  if (request.HasEtag(kShellHtmlEtag)) {
+    response->set_status(304);
+    response->SendBody(nullptr, 0);
+  } else {
+    response->SendBody(kShellHtmlGz, kShellHtmlGzSize);
+  }
+}
+
+// Prints s with the characters HTML gives meaning to escaped, for SSIDs,
+// which can hold anything.
+void PrintHtml(Print* out, const char* s) {
+  for (; *s != '\0'; ++s) {
+    switch (*s) {
+      case '&':
+        out->print("&amp;");
+        break;
+      case '<':
+        out->print("&lt;");
+        break;
+      case '>':
+        out->print("&gt;");
+        break;
+      case '"':
+        out->print("&quot;");
+        break;
+      default:
+        out->write(static_cast<uint8_t>(*s));
+    }
+  }
+}
+
+void DoWifiPage(Print* out) {
+  out->print(
+      "<!DOCTYPE html><html><head><meta charset=\"utf-8\">"
+      "<meta name=\"viewport\" content=\"width=device-width\">"
+      "<title>pneumatic WiFi</title></head><body><h1>WiFi setup</h1><p>");
+  const net_manager::LinkStats link = net_manager::Stats();
+  if (link.state == net_manager::LinkState::kOnline) {
+    out->print("Online on ");
+    PrintHtml(out, WiFi.SSID().c_str());
+    out->print(" as ");
+    out->print(WiFi.localIP().toString());
+  } else {
+    out->print("WiFi: ");
+    out->print(net_manager::StateName(link.state));
+  }
+  out->print(
+      "</p><form method=\"post\" action=\"/wifi\">"
+      "<p><label>Network <input name=\"ssid\" list=\"networks\" "
+      "maxlength=\"32\" required></label></p><datalist id=\"networks\">");
+  net_manager::PortalNetwork networks[net_manager::kMaxPortalNetworks];
+  const int n = net_manager::PortalNetworks(networks,
+                                            net_manager::kMaxPortalNetworks);
+  for (int i = 0; i < n; ++i) {
+    out->print("<option value=\"");
+    PrintHtml(out, networks[i].ssid);
+    out->printf("\">%d dBm%s</option>", networks[i].rssi,
+                networks[i].open ? ", open" : "");
+  }
+  out->print(
+      "</datalist><p><label>Password <input name=\"password\" "
+      "type=\"password\" maxlength=\"63\"></label></p>"
+      "<p><button>Connect</button></p></form></body></html>");
+}
+
+// GET /wifi shows the setup form; posting it, which only the portal takes,
+// saves the network and connects to it. The page reloads to show how that
+// went.
+void ServeWifi(const http_server::Request& request,
+               http_server::Response* response, void* unused) {
+  response->AddHeader("Cache-Control", "no-store");
+  if (request.method() == "GET") {
+    response->set_content_type("text/html; charset=utf-8");
+    DoWifiPage(response);
+    return;
+  }
+  if (request.method() != "POST") {
+    http_server::SendStatus(response, 405, "GET or POST");
+    return;
+  }
+  // Not from the LAN, even while the portal is up: only someone on the
+  // setup network gets to change it.
+  if (!net_manager::PortalActive() ||
+      request.local_ip() != static_cast<uint32_t>(WiFi.softAPIP())) {
+    http_server::SendStatus(response, 403, "only from the setup portal");
+    return;
+  }
+  std::string_view ssid_param;
+  std::string_view password_param;
+  char ssid[33];
+  char password[64];
+  request.FormParam("password", &password_param);
+  if (!request.FormParam("ssid", &ssid_param) ||
+      !http_server::UrlDecode(ssid_param, ssid, sizeof(ssid)) ||
+      !http_server::UrlDecode(password_param, password, sizeof(password)) ||
+      !net_manager::Provision(ssid, password)) {
+    http_server::SendStatus(response, 400,
+                            "need a network of 1 to 32 characters, and a "
+                            "password of none or 8 to 63");
+    return;
+  }
+  response->set_content_type("text/html; charset=utf-8");
+  response->print(
+      "<!DOCTYPE html><html><head><meta charset=\"utf-8\">"
+      "<meta http-equiv=\"refresh\" content=\"10; url=/wifi\">"
+      "</head><body><p>Connecting to ");
+  PrintHtml(response, ssid);
+  response->print("...</p></body></html>");
+}
+
+// Every other path. While the portal is up, its DNS sends every name here,
+// so a phone's connectivity check lands on the setup page.
+void ServeCaptive(const http_server::Request& request,
+                  http_server::Response* response, void* unused) {
+  if (!net_manager::PortalActive()) {
+    http_server::SendStatus(response, 404, "not found");
+    return;
+  }
+  const String location =
+      "http://" + net_manager::PortalIp().toString() + "/wifi";
+  response->set_status(302);
+  response->AddHeader("Location", location.c_str());
+  response->AddHeader("Cache-Control", "no-store");
+  response->SendBody(nullptr, 0);
+}
+
+void LogCacheStats(const char* name, const http_server::ResponseCache& cache) {
+  const auto stats = cache.stats();
+  ESP_LOGI(TAG,
+           "  %s cache: hits: %u renders: %u not_modified: %u uncached: %u"
+           " max_size: %u",
+           name, stats.hits, stats.renders, stats.not_modified, stats.uncached,
+           stats.max_size);
+}
+
+}  // namespace
+
 #define BTN_UP 35
 #define BTN_DOWN 0
 
@@ -707,14 +1031,7 @@ void TaskDisplay(void* task_data_arg) {
       last_print_time_ms = millis();
     }
 
-    int pm25aqi = Aqi(aqi_pm2_5, 1, task_data->pmsx003_data->pm_2_5);
-    int pm10aqi = Aqi(aqi_pm10_0, 0, task_data->pmsx003_data->pm_10_0);
-
-    int max_aqi = pm25aqi;
-    if (pm10aqi > pm25aqi) {
-      max_aqi = pm10aqi;
-    }
-    const auto& aqi_cat = GetAqiCategory(max_aqi);
+    const aqi::Data aqi_data = task_data->aqi->Get().value;
 
     auto dim = [](uint16_t color565) {
       // 0 is all black, 255 is not dimmed at all.
@@ -722,25 +1039,24 @@ void TaskDisplay(void* task_data_arg) {
     };
 
     // Print AQI
-    uint16_t bgcolor = dim(tft.color24to16(aqi_cat.color));
-    uint16_t fgcolor = dim(tft.color24to16(FgColor(aqi_cat.color)));
+    uint16_t bgcolor = dim(tft.color24to16(aqi_data.max.category().color));
+    uint16_t fgcolor = dim(tft.color24to16(aqi_data.max.fg_color));
     spr.fillRect(0, 0, 240, 135, bgcolor);
     spr.setTextColor(fgcolor, bgcolor);
     spr.setTextDatum(TR_DATUM);
     spr.setFreeFont(&FreeMonoBold9pt7b);
     spr.drawString("AQI", 90, 5);
     spr.setFreeFont(&FreeMonoBold24pt7b);
-    spr.drawNumber(max_aqi, 100, 30);
+    spr.drawNumber(aqi_data.max.aqi, 100, 30);
 
     // Print CO2 ppm
-    const auto& co2_cat =
-        GetAqiCategory(Aqi(aqi_co2, 0, task_data->dsco220_data->co2_ppm));
-    spr.fillRect(120, 0, 120, 75, dim(tft.color24to16(co2_cat.color)));
-    spr.setTextColor(dim(tft.color24to16(FgColor(co2_cat.color))));
+    spr.fillRect(120, 0, 120, 75,
+                 dim(tft.color24to16(aqi_data.co2.category().color)));
+    spr.setTextColor(dim(tft.color24to16(aqi_data.co2.fg_color)));
     spr.setFreeFont(&FreeMonoBold9pt7b);
     spr.drawString("CO2", 210, 5);
     spr.setFreeFont(&FreeMonoBold24pt7b);
-    spr.drawNumber(task_data->dsco220_data->co2_ppm, 235, 30);
+    spr.drawNumber(aqi_data.co2_ppm, 235, 30);
 
     // Print status info at the bottom
     spr.setTextDatum(BL_DATUM);
@@ -792,116 +1108,77 @@ void TaskDisplay(void* task_data_arg) {
 void TaskServeWeb(void* task_data_arg) {
   Serial.println("ServeWeb: Starting task...");
   TaskData* task_data = reinterpret_cast<TaskData*>(task_data_arg);
-  WiFiServer server(/*port=*/80);
-
+  static http_server::Server server;
+  // Rendered at most once per sensor update, however many scrapers and
+  // dashboards are polling.
+  static http_server::ResponseCache statusz_cache(
+      "text/html; charset=utf-8", /*capacity=*/6144, RenderStatusz, task_data);
+  static http_server::ResponseCache varz_cache(
+      "text/plain; version=0.0.4; charset=utf-8", /*capacity=*/8192,
+      RenderVarz, task_data);
+  static http_server::ResponseCache readings_cache(
+      "application/json", /*capacity=*/1024, RenderReadings, task_data);
+  static CachedPage statusz = {&statusz_cache, task_data};
+  static CachedPage varz = {&varz_cache, task_data};
+  static CachedPage readings = {&readings_cache, task_data};
+  static http_server::EventStream event_stream;
+  static Events events = {&event_stream, task_data};
+  server.AddRoute("/", ServeShell, &statusz);
+  server.AddRoute("/api/v1/readings", ServeCached, &readings);
+  server.AddRoute("/api/v1/history", history::ServeHistory);
+  server.AddRoute("/api/v1/log", history::ServeLog);
+  server.AddRoute("/events", SubscribeEvents, &events);
+  server.AddRoute("/statusz", ServeCached, &statusz);
+  server.AddRoute("/varz", ServeVarz, &varz);
+  server.AddRoute("/metrics", ServeVarz, &varz);
+  server.AddRoute("/mhz19", DoMhz19Command, task_data);
+  server.AddRoute("/wifi", ServeWifi);
+  server.AddRoute("*", ServeCaptive);
+
+  sensor_bus::Reader readings_reader(sensor_bus::kAllSensors |
+                                     sensor_bus::kAqi);
+  SentSeqs sent_seqs = {};
   unsigned long last_print_time_ms = 0;
-  unsigned long last_client_time_ms = 0;
   for (;;) {
-    delay(10);
     if ((millis() - last_print_time_ms) > 10 * 60 * 1000 || !last_print_time_ms) {
-      ESP_LOGI(
-          TAG,
-          "TaskServeWeb(): uptime: %s core: %d stackHighWater: %d"
-          " server_running: %s since_last_http_client: %s",
-          dump::MillisHumanReadable(millis()).c_str(), xPortGetCoreID(),
-          uxTaskGetStackHighWaterMark(nullptr), (server ? "true" : "false"),
-          dump::MillisHumanReadable(millis() - last_client_time_ms).c_str());
-      if (!WiFi.isConnected()) {
-        ESP_LOGW(TAG, "TaskServeWeb: Waiting for WiFi...");
+      ESP_LOGI(TAG,
+               "TaskServeWeb(): uptime: %s core: %d stackHighWater: %d"
+               " server_running: %s",
+               dump::MillisHumanReadable(millis()).c_str(), xPortGetCoreID(),
+               uxTaskGetStackHighWaterMark(nullptr),
+               (server.running() ? "true" : "false"));
+      if (server.running()) {
+        server.LogStats();
+        LogCacheStats("statusz", statusz_cache);
+        LogCacheStats("varz", varz_cache);
+        LogCacheStats("readings", readings_cache);
+        event_stream.LogStats();
+      } else if (!net_manager::Online()) {
+        ESP_LOGW(TAG, "TaskServeWeb: Waiting for WiFi or the portal...");
       }
       last_print_time_ms = millis();
     }
-    if (!WiFi.isConnected()) {
-      continue;
-    }
 
-    // TODO: register for wifi disconnect signal to eliminate restart races.
-    if (!server) {
-      // server.end();
-      ESP_LOGI(TAG, "Starting WiFiServer");
-      // delay(5000);
-      server.begin();
-      if (!server) {
-        ESP_LOGE(TAG, "Failed to start WiFiServer");
-        // server.end();
-        delay(1000);
-        continue;
+    // The server's tasks answer requests; this one waits for WiFi or the
+    // portal, reports, and feeds /events.
+    if (!server.running()) {
+      if (net_manager::WaitOnline(1000 / portTICK_PERIOD_MS) ||
+          net_manager::PortalActive()) {
+        ESP_LOGI(TAG, "Starting http_server");
+        if (!server.Start(http_server::Config())) {
+          ESP_LOGE(TAG, "Failed to start http_server");
+          delay(1000);
+        }
       }
-      ESP_LOGI(TAG, "WiFiServer started on port 80");
-    }
-
-    // Serial.println("Waiting for HTTP connection...");
-    WiFiClient client = server.accept();
-    if (!client) {
-      // Serial.println("ServeWeb: Got no for HTTP connection...");
-      client.stop();
       continue;
     }
-
-    // long connectTime = millis();
-    std::string request;
-    Serial.println("New http client");
-    last_client_time_ms = millis();
-    ESP_LOGI(TAG, "ui::TaskServeWeb(): up: %s http request from: %s",
-             dump::MillisHumanReadable(last_client_time_ms).c_str(),
-             client.remoteIP().toString().c_str());
-    while (client.connected()) {
-      if (millis() - last_client_time_ms > 5000) {
-        ESP_LOGW(
-            TAG,
-            "TaskServeWeb: Timed out waiting for client, request so far:\n[%s]",
-            request.c_str());
-        client.stop();
-        delay(10);
-        continue;
-      }
-
-      int available = client.available();
-      if (available) {
-        int old_size = request.size();
-        request.resize(old_size + available);
-        int read_count = client.read(
-            reinterpret_cast<uint8_t*>(&request[0]) + old_size, available);
-        if (read_count > 0) {
-          request.resize(old_size + read_count);
-        } else {
-          request.resize(old_size);
-        }
-        ESP_LOGI(TAG, "TaskServeWeb: Read %d bytes, old_size: %d new_size: %d",
-                 read_count, old_size, request.size());
-      }
-      if (client.available() || request.find("\r\n\r\n") == std::string::npos) {
-        delay(10);
-        continue;
-      }
-
-      ESP_LOGI(TAG,
-               "HTTP Request -- BEGIN --\n"
-               "%s"
-               "-- END --",
-               request.c_str());
-
-      if (request.rfind("GET /favicon.ico ", 0) == 0) {
-        Serial.println("TaskServeWeb: /favicon.ico");
-        client.print("HTTP/1.1 404 Not Found\r\n");
-        client.print("Connection: close\r\n");
-        client.print("\r\n");
-      } else if (request.rfind("GET /varz ", 0) == 0 ||
-                 request.rfind("GET /metrics ", 0) == 0) {
-        Serial.println("TaskServeWeb: /varz");
-        DoVarz(&client, task_data);
-      } else {
-        Serial.println("TaskServeWeb: /statusz");
-        DoStatusz(&client, task_data);
-      }
-      client.flush();
-      client.stop();
-      ESP_LOGI(
-          TAG, "TaskServeWeb(): client finished in: %s",
-          dump::MillisHumanReadable(millis() - last_client_time_ms).c_str());
-      break;
+    // Comparing seqs finds which topics changed since the last update.
+    readings_reader.Wait(1000 / portTICK_PERIOD_MS);
+    ReadingsUpdate update = {task_data, ChangedSensors(task_data, &sent_seqs)};
+    if (update.sensors) {
+      event_stream.Publish("readings", RenderReadingsUpdate, &update);
     }
-    client.stop();
+    event_stream.KeepAlive();
   }
 
   vTaskDelete(NULL);
@@ -910,13 +1187,23 @@ void TaskServeWeb(void* task_data_arg) {
 void TaskDoPixels(void* task_data_arg) {
   TaskData* task_data = reinterpret_cast<TaskData*>(task_data_arg);
 
+  sensor_bus::Reader reader(sensor_bus::kAqi);
+  uint32_t seq = 0;
+  uint32_t dsco220_seq = 0;
   for (;;) {
-    const auto& co2_cat =
-        GetAqiCategory(Aqi(aqi_co2, 0, task_data->dsco220_data->co2_ppm));
+    if (!task_data->aqi->WaitNewer(&reader, seq, 5000 / portTICK_PERIOD_MS)) {
+      continue;
+    }
+    const auto aqi_data = task_data->aqi->Get();
+    seq = aqi_data.seq;
+    // Only redraw when the DS-CO2-20 publishes a new reading.
+    if (aqi_data.value.dsco220_seq == dsco220_seq) {
+      continue;
+    }
+    dsco220_seq = aqi_data.value.dsco220_seq;
     task_data->pixels->setBrightness(255);
-    task_data->pixels->setPixelColor(0, co2_cat.color);
+    task_data->pixels->setPixelColor(0, aqi_data.value.co2.category().color);
     task_data->pixels->show();
-    delay(1000);  // Delay for a period of time (in milliseconds).
   }
   vTaskDelete(NULL);
 }
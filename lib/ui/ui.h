@@ -2,20 +2,27 @@
 #define _UI_H_
 
 #include <Adafruit_NeoPixel.h>
+#include <Print.h>
 #include <stdint.h>
 
+#include "aqi.h"
 #include "bme.h"
 #include "dsco220.h"
 #include "mhz19.h"
 #include "pmsx003.h"
+#include "sensor_bus.h"
 
 namespace ui {
 
 struct TaskData {
-  pmsx003::TaskData* pmsx003_data;
-  mhz19::TaskData* mhz19_data;
-  dsco220::Data* dsco220_data;
-  bme::Data* bme_data;
+  const sensor_bus::Topic<pmsx003::Data>* pmsx003;
+  const sensor_bus::Topic<mhz19::Data>* mhz19;
+  const sensor_bus::Topic<dsco220::Data>* dsco220;
+  const sensor_bus::Topic<bme::Data>* bme;
+  // Everything shown in AQI colors comes from here, not the raw readings.
+  const sensor_bus::Topic<aqi::Data>* aqi;
+  // For queueing MH-Z19 commands; null if the sensor isn't enabled.
+  mhz19::TaskData* mhz19_control;
   Adafruit_NeoPixel* pixels;
 };
 
@@ -27,6 +34,15 @@ const char* aqiMessage(int aqi);
 
 const char* co2Class(int co2_ppm);
 
+// Bodies of the status page and the Prometheus metrics, as of uptime_ms. Sensor metrics are left out for the first minute.
+void DoStatusz(Print* out, const TaskData* task_data, unsigned long uptime_ms);
+void DoVarz(Print* out, const TaskData* task_data, unsigned long uptime_ms);
+// The readings as JSON, for the page shell's script: /api/v1/readings, and
+// the events on /events. Only sensors in the sensor_bus bits are included,
+// and sensors that haven't reported yet are left out.
+void DoReadings(Print* out, const TaskData* task_data, unsigned long uptime_ms,
+                EventBits_t sensors = sensor_bus::kAllSensors);
+
 void TaskButtons(void* task_data_arg);
 
 void TaskDisplay(void* task_data_arg);
@@ -7,15 +7,21 @@
 #include <esp_sntp.h>
 #include <freertos/FreeRTOS.h>
 
+#include "aqi.h"
 #include "bme.h"
 #include "constants.h"
 #include "dsco220.h"
 #include "dump.h"
+#include "history.h"
 #include "html.h"
+#include "i2c_bus.h"
 #include "mhz19.h"
 #include "net_manager.h"
 #include "ota.h"
 #include "pmsx003.h"
+#include "prober.h"
+#include "scheduler.h"
+#include "sensor_bus.h"
 #include "sensor_community.h"
 #include "ui.h"
 
@@ -41,28 +47,57 @@
 
 #define I2C_SDA_PIN 21
 #define I2C_SCL_PIN 22
-// My BME680 seems unstable at 100khz.
+// Clock for the scan at boot; after that each device runs at its own clock.
 #define I2C_FREQ 10000
+// My BME680 seems unstable at 100khz.
+#define BME_I2C_FREQ 10000
+#define DSCO220_I2C_FREQ 100000
 
 #define BME280_I2C_ADDRESS 0x76
-// TODO: acutally use ds-co2-20 address
 #define DSCO220_I2C_ADDRESS 0x08
 
+// Define for a static address instead of DHCP, e.g.
+// #define STATIC_IP 192, 168, 1, 50
+// #define STATIC_GATEWAY 192, 168, 1, 1
+// #define STATIC_SUBNET 255, 255, 255, 0
+// #define STATIC_DNS 192, 168, 1, 1
+
+// Probed past the gateway, to tell a bad uplink from a bad link.
+#define PROBE_UPSTREAM_HOST "connectivitycheck.gstatic.com"
+#define PROBE_UPSTREAM_PORT 80
+
 static const char* TAG = "main";
 
-SemaphoreHandle_t i2c_mutex = nullptr;
+i2c_bus::Bus i2c(&Wire, /*sda_pin=*/I2C_SDA_PIN, /*scl_pin=*/I2C_SCL_PIN);
+scheduler::Scheduler sensors(/*tick_ms=*/250);
+
+sensor_bus::Topic<pmsx003::Data> pmsx003_topic(sensor_bus::kPmsx003);
+sensor_bus::Topic<mhz19::Data> mhz19_topic(sensor_bus::kMhz19);
+sensor_bus::Topic<dsco220::Data> dsco220_topic(sensor_bus::kDsco220);
+sensor_bus::Topic<bme::Data> bme_topic(sensor_bus::kBme);
+sensor_bus::Topic<aqi::Data> aqi_topic(sensor_bus::kAqi);
 
-HardwareSerial pms_serial(2);
-pmsx003::TaskData pmsx003_data = {0};
+pmsx003::TaskData pmsx003_data = {};
 
-// HardwareSerial mhz19_serial(1);
+HardwareSerial mhz19_serial(1);
 mhz19::TaskData mhz19_data = {0};
 
-bme::Data bme_data = {0};
+bme::TaskData bme_data = {0};
 
-dsco220::Data dsco220_data = {0};
 dsco220::TaskData dsco220_task_data = {0};
 
+aqi::TaskData aqi_data = {};
+
+#ifdef STATIC_IP
+const net_manager::StaticIp static_ip = {
+    IPAddress(STATIC_IP), IPAddress(STATIC_GATEWAY), IPAddress(STATIC_SUBNET),
+    IPAddress(STATIC_DNS)};
+#endif
+
+history::TaskData history_data = {};
+
+prober::TaskData prober_data = {PROBE_UPSTREAM_HOST, PROBE_UPSTREAM_PORT};
+
 ui::TaskData ui_task_data = {0};
 Adafruit_NeoPixel pixels(/*num_pixels=*/1, /*pin=*/WS2812B_PIN,
                          NEO_GRB + NEO_KHZ800);
@@ -137,41 +172,64 @@ void setup() {
   // net_manager::Setup();
   // net_manager::Connect(/*timeout_ms=*/ 60000);
 
-  Serial.println("Setting up PMSx003 Serial port...");
-  pms_serial.begin(9600, SERIAL_8N1, /*rx=*/PMSX003_RX_PIN,
-                   /*tx=*/PMSX003_TX_PIN);
-  while (!pms_serial) {
+  sensor_bus::Init();
+#ifdef STATIC_IP
+  net_manager::Init(&static_ip);
+#else
+  net_manager::Init();
+#endif
+  prober::Init();
+  history::Init();
+
+  Serial.println("Setting up PMSx003 UART...");
+  // The fan and laser wear out; one averaged reading every few minutes is
+  // plenty for room air.
+  pmsx003_data.duty_cycle = {/*period_ms=*/3 * 60 * 1000,
+                             /*stabilize_ms=*/30 * 1000, /*samples=*/8};
+  while (!pmsx003::InitUart(&pmsx003_data, UART_NUM_2,
+                            /*rx_pin=*/PMSX003_RX_PIN,
+                            /*tx_pin=*/PMSX003_TX_PIN)) {
     Serial.println("    ...");
     delay(100);
   }
-  pmsx003_data.serial = &pms_serial;
-  Serial.println("PMSx003 Serial online");
-
-  // Serial.println("Setting up MH-Z19 Serial port...");
-  // mhz19_serial.begin(9600, SERIAL_8N1, /*rx=*/MHZ19_RX_PIN,
-  //                    /*tx=*/MHZ19_TX_PIN);
-  // while (!mhz19_serial) {
-  //   Serial.println("    ...");
-  //   delay(100);
-  // }
-  // Serial.println("MH-Z19 Serial online");
-  // mhz19_data.serial = &mhz19_serial;
-  // mhz19::SetAutoBackgroundCalibration(&mhz19_serial, /*abc_on=*/true);
+  Serial.println("PMSx003 UART online");
+  pmsx003_data.topic = &pmsx003_topic;
+
+  Serial.println("Setting up MH-Z19 Serial port...");
+  mhz19_serial.begin(9600, SERIAL_8N1, /*rx=*/MHZ19_RX_PIN,
+                     /*tx=*/MHZ19_TX_PIN);
+  while (!mhz19_serial) {
+    Serial.println("    ...");
+    delay(100);
+  }
+  Serial.println("MH-Z19 Serial online");
+  mhz19_data.topic = &mhz19_topic;
+  if (mhz19::Init(&mhz19_data, &mhz19_serial)) {
+    // Sent by the first poll.
+    mhz19::Submit(&mhz19_data, mhz19::Command::kAbcOn);
+  }
 
   ESP_LOGI(TAG, "Initializing I2C bus...");
-  i2c_mutex = xSemaphoreCreateMutex();
-  Wire.begin(/* sda= */ I2C_SDA_PIN,
-             /* scl= */ I2C_SCL_PIN,
-             /* frequencey= */ I2C_FREQ);
+  if (!i2c.Begin(I2C_FREQ)) {
+    ESP_LOGE(TAG, "I2C bus is stuck");
+  }
   i2cScan();
 
   ESP_LOGI(TAG, "Setting up Plantower DS CO2...");
-  dsco220_task_data.i2c_mutex = i2c_mutex;
-  dsco220_task_data.i2c = &Wire;
-  dsco220_task_data.data = &dsco220_data;
+  dsco220_task_data.i2c = &i2c;
+  dsco220_task_data.i2c_device =
+      i2c.AddDevice("DS-CO2-20", DSCO220_I2C_ADDRESS, DSCO220_I2C_FREQ);
+  dsco220_task_data.topic = &dsco220_topic;
 
   ESP_LOGI(TAG, "Setting up BMEx8x...");
-  bme_data.i2c_mutex = i2c_mutex;
+  bme_data.i2c = &i2c;
+  bme_data.i2c_device =
+      i2c.AddDevice("BME280", BME280_I2C_ADDRESS, BME_I2C_FREQ);
+  bme_data.topic = &bme_topic;
+
+  // From here on the bus task owns Wire. It runs above every task that
+  // queues transactions so they are served promptly.
+  i2c.Start(/*priority=*/20);
   bme::Init(&bme_data);
 
   ESP_LOGI(TAG, "Initializing NTP");
@@ -186,31 +244,51 @@ void setup() {
   // Apparently ESP32 FreeRTOS can't elegantly handle different tasks at the
   // same priority without the possibility of starvation.
   int next_priority = 2;
-  xTaskCreate(pmsx003::TaskPoll, "pmsx003",
-              /*stack_size=*/3 * 1024,
-              /*param=*/&pmsx003_data,
-              /*priority=*/next_priority++,
-              /*handle=*/nullptr);
-  // xTaskCreate(mhz19::TaskPoll, "PollMhz19",
-  //             /*stack_size=*/10000,
-  //             /*param=*/&mhz19_data,
-  //             /*priority=*/next_priority++,
-  //             /*handle=*/nullptr);
-  xTaskCreate(dsco220::TaskPollDsCo2, "dsco220",
-              /*stack_size=*/3 * 1024,
-              /*param=*/&dsco220_task_data,
-              /*priority=*/next_priority++,
-              /*handle=*/nullptr);
-  xTaskCreate(bme::TaskPoll, "bme",
-              /*stack_size=*/4 * 1024,
-              /*param=*/&bme_data,
-              /*priority=*/next_priority++,
-              /*handle=*/nullptr);
-
-  ui_task_data.pmsx003_data = &pmsx003_data;
-  ui_task_data.mhz19_data = &mhz19_data;
-  ui_task_data.dsco220_data = &dsco220_data;
-  ui_task_data.bme_data = &bme_data;
+  // All sensors are polled from one task. Jobs with the same period share a
+  // cycle timestamp; the phases keep the I2C sensors out of each other's way.
+  sensors.AddJob("pmsx003", pmsx003::Poll, &pmsx003_data,
+                 /*period_ms=*/1000, /*phase_ms=*/0);
+  sensors.AddJob("bme", bme::Poll, &bme_data,
+                 /*period_ms=*/bme::kPollPeriodMs, /*phase_ms=*/250);
+  sensors.AddJob("dsco220", dsco220::Poll, &dsco220_task_data,
+                 /*period_ms=*/1000, /*phase_ms=*/500);
+  if (mhz19_data.requests != nullptr) {
+    sensors.AddJob("mhz19", mhz19::Poll, &mhz19_data,
+                   /*period_ms=*/2000, /*phase_ms=*/750);
+  }
+  // Every tick, after the jobs that publish, so they see each snapshot.
+  aqi_data.pmsx003 = &pmsx003_topic;
+  aqi_data.dsco220 = &dsco220_topic;
+  aqi_data.topic = &aqi_topic;
+  sensors.AddJob("aqi", aqi::Update, &aqi_data, /*period_ms=*/250);
+  history_data.pmsx003 = &pmsx003_topic;
+  history_data.dsco220 = &dsco220_topic;
+  history_data.bme = &bme_topic;
+  sensors.AddJob("history", history::Record, &history_data,
+                 /*period_ms=*/250);
+  const uint32_t kLogStatusPeriodMs = 10 * 60 * 1000;
+  sensors.AddJob("pmsx003 status", pmsx003::LogStatus, &pmsx003_data,
+                 kLogStatusPeriodMs);
+  sensors.AddJob("bme status", bme::LogStatus, &bme_data, kLogStatusPeriodMs);
+  sensors.AddJob("dsco220 status", dsco220::LogStatus, &dsco220_task_data,
+                 kLogStatusPeriodMs);
+  if (mhz19_data.requests != nullptr) {
+    sensors.AddJob("mhz19 status", mhz19::LogStatus, &mhz19_data,
+                   kLogStatusPeriodMs);
+  }
+  sensors.AddJob("history status", history::LogStatus, &history_data,
+                 kLogStatusPeriodMs);
+  sensors.Start("sensors", /*stack_size=*/4 * 1024,
+                /*priority=*/next_priority++);
+
+  ui_task_data.pmsx003 = &pmsx003_topic;
+  ui_task_data.mhz19 = &mhz19_topic;
+  ui_task_data.dsco220 = &dsco220_topic;
+  ui_task_data.bme = &bme_topic;
+  ui_task_data.aqi = &aqi_topic;
+  if (mhz19_data.requests != nullptr) {
+    ui_task_data.mhz19_control = &mhz19_data;
+  }
   ui_task_data.pixels = &pixels;
   // xTaskCreate(ui::TaskDoPixels, "TaskDoPixels",
   //             /*stack_size=*/1024,
@@ -243,11 +321,22 @@ void setup() {
               /*param=*/nullptr,
               /*priority=*/next_priority++,
               /*handle=*/nullptr);
+  xTaskCreate(prober::DoTask, "Prober",
+              /*stack_size=*/3 * 1024,
+              /*param=*/&prober_data,
+              /*priority=*/next_priority++,
+              /*handle=*/nullptr);
   xTaskCreate(ui::TaskButtons, "TaskButtons",
               /*stack_size=*/3 * 1024,
               /*param=*/&ui_task_data,
               /*priority=*/next_priority++,
               /*handle=*/nullptr);
+  // Below everything else: nothing waits on the flash log's writes.
+  xTaskCreate(history::TaskWriteLog, "HistoryWriteLog",
+              /*stack_size=*/3 * 1024,
+              /*param=*/nullptr,
+              /*priority=*/tskIDLE_PRIORITY + 1,
+              /*handle=*/nullptr);
 
   Serial.print("setup(): core: ");
   Serial.println(xPortGetCoreID());
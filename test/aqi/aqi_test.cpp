@@ -0,0 +1,110 @@
+#include <aqi.h>
+#include <sensor_bus.h>
+#include <unity.h>
+
+void Test_Pm2_5Breakpoints() {
+  TEST_ASSERT_EQUAL(0, aqi::Pm2_5Aqi(0));
+  TEST_ASSERT_EQUAL(50, aqi::Pm2_5Aqi(12.0));
+  TEST_ASSERT_EQUAL(51, aqi::Pm2_5Aqi(12.1));
+  // Truncated to a decimal first, the way AirNow does.
+  TEST_ASSERT_EQUAL(50, aqi::Pm2_5Aqi(12.09));
+  TEST_ASSERT_EQUAL(100, aqi::Pm2_5Aqi(35.4));
+  TEST_ASSERT_EQUAL(151, aqi::Pm2_5Aqi(55.5));
+  TEST_ASSERT_EQUAL(500, aqi::Pm2_5Aqi(500.4));
+}
+
+void Test_Pm10Breakpoints() {
+  TEST_ASSERT_EQUAL(50, aqi::Pm10Aqi(54));
+  TEST_ASSERT_EQUAL(50, aqi::Pm10Aqi(54.9));
+  TEST_ASSERT_EQUAL(51, aqi::Pm10Aqi(55));
+  TEST_ASSERT_EQUAL(101, aqi::Pm10Aqi(155));
+}
+
+void Test_LevelCategoryAndColors() {
+  const aqi::Level good = aqi::GetLevel(50);
+  TEST_ASSERT_EQUAL_STRING("good", good.category().tag);
+  TEST_ASSERT_EQUAL(0x000000, good.fg_color);
+  const aqi::Level moderate = aqi::GetLevel(51);
+  TEST_ASSERT_EQUAL_STRING("moderate", moderate.category().tag);
+  const aqi::Level unhealthy = aqi::GetLevel(151);
+  TEST_ASSERT_EQUAL_STRING("unhealthy", unhealthy.category().tag);
+  TEST_ASSERT_EQUAL(0xffffff, unhealthy.fg_color);
+  // Off the scale stays in the last category.
+  TEST_ASSERT_EQUAL_STRING("very-hazardous",
+                           aqi::GetLevel(900).category().tag);
+
+  // Before any snapshot: good, in black.
+  const aqi::Level zero = {};
+  TEST_ASSERT_EQUAL_STRING("good", zero.category().tag);
+  TEST_ASSERT_EQUAL(aqi::FgColor(zero.category().color), zero.fg_color);
+}
+
+void Test_DeriveTakesTheWorsePm() {
+  pmsx003::Data pms = {};
+  pms.pm_1_0 = 5.2;
+  pms.pm_2_5 = 12.4;
+  pms.pm_10_0 = 160;
+  dsco220::Data dsco220 = {};
+  dsco220.co2_ppm = 1200;
+  const aqi::Data data = aqi::Derive(pms, dsco220);
+  TEST_ASSERT_EQUAL(aqi::Pm2_5Aqi(5.2), data.pm1_0.aqi);
+  TEST_ASSERT_EQUAL(52, data.pm2_5.aqi);
+  TEST_ASSERT_EQUAL(103, data.pm10_0.aqi);
+  TEST_ASSERT_EQUAL(103, data.max.aqi);
+  TEST_ASSERT_EQUAL_STRING("unhealthy-for-sensitive-groups",
+                           data.max.category().tag);
+  TEST_ASSERT_EQUAL(1200, data.co2_ppm);
+  TEST_ASSERT_EQUAL_STRING("unhealthy-for-sensitive-groups",
+                           data.co2.category().tag);
+}
+
+void Test_UpdatePublishesOncePerSnapshot() {
+  sensor_bus::Topic<pmsx003::Data> pmsx003(sensor_bus::kPmsx003);
+  sensor_bus::Topic<dsco220::Data> dsco220(sensor_bus::kDsco220);
+  sensor_bus::Topic<aqi::Data> topic(sensor_bus::kAqi);
+  aqi::TaskData task_data = {&pmsx003, &dsco220, &topic};
+
+  // Nothing to work from yet.
+  aqi::Update(&task_data, 0);
+  TEST_ASSERT_EQUAL(0, topic.seq());
+
+  pmsx003::Data pms = {};
+  pms.pm_2_5 = 40;
+  pmsx003.Publish(pms, 1000);
+  aqi::Update(&task_data, 1000);
+  aqi::Update(&task_data, 1250);
+  TEST_ASSERT_EQUAL(1, topic.seq());
+  auto snapshot = topic.Get();
+  TEST_ASSERT_EQUAL(1000, snapshot.timestamp_ms);
+  TEST_ASSERT_EQUAL(1, snapshot.value.pmsx003_seq);
+  TEST_ASSERT_EQUAL(0, snapshot.value.dsco220_seq);
+  TEST_ASSERT_EQUAL(aqi::Pm2_5Aqi(40), snapshot.value.max.aqi);
+
+  dsco220.Publish({/*co2_ppm=*/800, 0, 0}, 1500);
+  aqi::Update(&task_data, 1500);
+  TEST_ASSERT_EQUAL(2, topic.seq());
+  snapshot = topic.Get();
+  TEST_ASSERT_EQUAL(1500, snapshot.timestamp_ms);
+  TEST_ASSERT_EQUAL(1, snapshot.value.dsco220_seq);
+  TEST_ASSERT_EQUAL(800, snapshot.value.co2_ppm);
+  // The particulates carry over.
+  TEST_ASSERT_EQUAL(aqi::Pm2_5Aqi(40), snapshot.value.max.aqi);
+}
+
+int RunTests() {
+  UNITY_BEGIN();
+  RUN_TEST(Test_Pm2_5Breakpoints);
+  RUN_TEST(Test_Pm10Breakpoints);
+  RUN_TEST(Test_LevelCategoryAndColors);
+  RUN_TEST(Test_DeriveTakesTheWorsePm);
+  RUN_TEST(Test_UpdatePublishesOncePerSnapshot);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
+void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
@@ -0,0 +1,110 @@
+#include <bme280.h>
+#include <unity.h>
+
+// Trimming values from the BMP280 datasheet's worked example (section 3.12),
+// plus humidity values from a real BME280.
+const uint8_t kCalib00[bme280::kCalib00Size] = {
+    0x70, 0x6b,  // T1 = 27504
+    0x43, 0x67,  // T2 = 26435
+    0x18, 0xfc,  // T3 = -1000
+    0x7d, 0x8e,  // P1 = 36477
+    0x43, 0xd6,  // P2 = -10685
+    0xd0, 0x0b,  // P3 = 3024
+    0x27, 0x0b,  // P4 = 2855
+    0x8c, 0x00,  // P5 = 140
+    0xf9, 0xff,  // P6 = -7
+    0x8c, 0x3c,  // P7 = 15500
+    0xf8, 0xc6,  // P8 = -14600
+    0x70, 0x17,  // P9 = 6000
+    0x00,        // unused
+    0x4b,        // H1 = 75
+};
+const uint8_t kCalib26[bme280::kCalib26Size] = {
+    0x6a, 0x01,  // H2 = 362
+    0x00,        // H3 = 0
+    0x13, 0x29,  // H4 = 313, H5 = 50 (0x29 holds both low nibbles)
+    0x03,        //
+    0x1e,        // H6 = 30
+};
+// adc_P = 415148, adc_T = 519888, adc_H = 30000
+const uint8_t kData[bme280::kDataSize] = {0x65, 0x5a, 0xc0, 0x7e,
+                                          0xed, 0x00, 0x75, 0x30};
+
+void Test_ParseCalibration() {
+  auto c = bme280::ParseCalibration(kCalib00, kCalib26);
+  TEST_ASSERT_EQUAL(27504, c.t1);
+  TEST_ASSERT_EQUAL(26435, c.t2);
+  TEST_ASSERT_EQUAL(-1000, c.t3);
+  TEST_ASSERT_EQUAL(36477, c.p1);
+  TEST_ASSERT_EQUAL(-10685, c.p2);
+  TEST_ASSERT_EQUAL(-7, c.p6);
+  TEST_ASSERT_EQUAL(6000, c.p9);
+  TEST_ASSERT_EQUAL(75, c.h1);
+  TEST_ASSERT_EQUAL(362, c.h2);
+  TEST_ASSERT_EQUAL(0, c.h3);
+  TEST_ASSERT_EQUAL(313, c.h4);
+  TEST_ASSERT_EQUAL(50, c.h5);
+  TEST_ASSERT_EQUAL(30, c.h6);
+}
+
+void Test_ParseCalibrationNegativeH4H5() {
+  const uint8_t calib26[bme280::kCalib26Size] = {0, 0, 0, 0xff, 0xfe, 0xff, 0};
+  auto c = bme280::ParseCalibration(kCalib00, calib26);
+  TEST_ASSERT_EQUAL(-2, c.h4);
+  TEST_ASSERT_EQUAL(-1, c.h5);
+}
+
+void Test_ParseData() {
+  auto raw = bme280::ParseData(kData);
+  TEST_ASSERT_EQUAL(415148, raw.adc_p);
+  TEST_ASSERT_EQUAL(519888, raw.adc_t);
+  TEST_ASSERT_EQUAL(30000, raw.adc_h);
+  TEST_ASSERT_TRUE(bme280::IsValid(raw));
+
+  raw.adc_h = 0x8000;
+  TEST_ASSERT_FALSE(bme280::IsValid(raw));
+}
+
+void Test_Compensate() {
+  auto c = bme280::ParseCalibration(kCalib00, kCalib26);
+  bme280::Reading reading;
+  TEST_ASSERT_TRUE(bme280::Compensate(c, bme280::ParseData(kData), &reading));
+  // Datasheet: 25.08 °C and 100653.27 Pa (floating point reference).
+  TEST_ASSERT_EQUAL(2508, reading.temp_centi_c);
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 100653.27, reading.pressure_pa());
+  // Floating point reference formula gives 55.0007 %RH.
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 55.0007, reading.humidity_pct());
+}
+
+void Test_CompensateRejectsZeroP1() {
+  auto c = bme280::ParseCalibration(kCalib00, kCalib26);
+  c.p1 = 0;
+  bme280::Reading reading;
+  TEST_ASSERT_FALSE(bme280::Compensate(c, bme280::ParseData(kData), &reading));
+}
+
+void Test_CtrlMeas() {
+  TEST_ASSERT_EQUAL_HEX8(0x25,
+                         bme280::CtrlMeas(bme280::kOversample1x,
+                                          bme280::kOversample1x,
+                                          bme280::kModeForced));
+}
+
+int RunTests() {
+  UNITY_BEGIN();
+  RUN_TEST(Test_ParseCalibration);
+  RUN_TEST(Test_ParseCalibrationNegativeH4H5);
+  RUN_TEST(Test_ParseData);
+  RUN_TEST(Test_Compensate);
+  RUN_TEST(Test_CompensateRejectsZeroP1);
+  RUN_TEST(Test_CtrlMeas);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
+void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
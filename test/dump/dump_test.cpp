@@ -85,12 +85,18 @@ void Test_CToF() {
   TEST_ASSERT_FLOAT_WITHIN(0.0001, -190.22206, CToF(-123.4567));
 }
 
-void setup() {
+int RunTests() {
   UNITY_BEGIN();
   RUN_TEST(Test_SecondsHumanReadable);
   RUN_TEST(Test_MillisHumanReadable);
   RUN_TEST(Test_CToF);
-  UNITY_END();
+  return UNITY_END();
 }
 
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
 void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
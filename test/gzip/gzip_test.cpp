@@ -0,0 +1,158 @@
+#include <gzip.h>
+#include <string.h>
+#include <unity.h>
+
+#include <string>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using gzip::GzipPrint;
+
+// Collects everything written to it.
+class StringPrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    text += static_cast<char>(c);
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t size) override {
+    text.append(reinterpret_cast<const char*>(data), size);
+    return size;
+  }
+
+  std::string text;
+};
+
+// Big: keep it off the stack.
+GzipPrint gz;
+
+// Compresses input, written chunk bytes at a time.
+std::string Compress(const std::string& input, size_t chunk) {
+  StringPrint out;
+  gz.Begin(&out);
+  for (size_t i = 0; i < input.size(); i += chunk) {
+    const size_t n = std::min(chunk, input.size() - i);
+    TEST_ASSERT_EQUAL(
+        n, gz.write(reinterpret_cast<const uint8_t*>(input.data() + i), n));
+  }
+  gz.Finish();
+  TEST_ASSERT_EQUAL(input.size(), gz.in_size());
+  TEST_ASSERT_EQUAL(out.text.size(), gz.out_size());
+  return out.text;
+}
+
+uint32_t Le32(const std::string& data, size_t at) {
+  uint32_t value = 0;
+  for (int i = 3; i >= 0; --i) {
+    value = value << 8 | static_cast<uint8_t>(data[at + i]);
+  }
+  return value;
+}
+
+void Test_Crc32() {
+  const char kCheck[] = "123456789";
+  TEST_ASSERT_EQUAL_HEX32(
+      0xcbf43926,
+      gzip::Crc32(reinterpret_cast<const uint8_t*>(kCheck), 9));
+  // In pieces.
+  const uint32_t crc =
+      gzip::Crc32(reinterpret_cast<const uint8_t*>(kCheck), 4);
+  TEST_ASSERT_EQUAL_HEX32(
+      0xcbf43926,
+      gzip::Crc32(reinterpret_cast<const uint8_t*>(kCheck) + 4, 5, crc));
+}
+
+void Test_HeaderAndTrailer() {
+  const std::string input = "t,min,max,mean,count\n";
+  const std::string out = Compress(input, input.size());
+  TEST_ASSERT_EQUAL_HEX8(0x1f, static_cast<uint8_t>(out[0]));
+  TEST_ASSERT_EQUAL_HEX8(0x8b, static_cast<uint8_t>(out[1]));
+  TEST_ASSERT_EQUAL(8, out[2]);
+  TEST_ASSERT_EQUAL_HEX32(
+      gzip::Crc32(reinterpret_cast<const uint8_t*>(input.data()),
+                  input.size()),
+      Le32(out, out.size() - 8));
+  TEST_ASSERT_EQUAL(input.size(), Le32(out, out.size() - 4));
+}
+
+#ifdef HAVE_ZLIB
+std::string Inflate(const std::string& compressed) {
+  z_stream stream = {};
+  TEST_ASSERT_EQUAL(Z_OK, inflateInit2(&stream, 16 + MAX_WBITS));
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  stream.avail_in = compressed.size();
+  std::string out;
+  char buffer[4096];
+  int result;
+  do {
+    stream.next_out = reinterpret_cast<Bytef*>(buffer);
+    stream.avail_out = sizeof(buffer);
+    result = inflate(&stream, Z_NO_FLUSH);
+    out.append(buffer, sizeof(buffer) - stream.avail_out);
+  } while (result == Z_OK);
+  TEST_ASSERT_EQUAL(Z_STREAM_END, result);
+  // Nothing after the trailer.
+  TEST_ASSERT_EQUAL(0, stream.avail_in);
+  inflateEnd(&stream);
+  return out;
+}
+
+void RoundTrip(const std::string& input) {
+  for (size_t chunk : {size_t{1}, size_t{7}, size_t{1000}, input.size() + 1}) {
+    const std::string inflated = Inflate(Compress(input, chunk));
+    TEST_ASSERT_EQUAL(input.size(), inflated.size());
+    TEST_ASSERT_TRUE(input == inflated);
+  }
+}
+
+void Test_RoundTripsEmpty() { RoundTrip(""); }
+
+void Test_RoundTripsCsv() {
+  std::string csv = "t,min,max,mean,count\n";
+  for (int i = 0; i < 720; ++i) {
+    csv += std::to_string(1697000000 + 120 * i) + "," +
+           std::to_string(10 + i % 7) + ".3," + std::to_string(20 + i % 13) +
+           ".1," + std::to_string(15 + i % 5) + ".8,120\n";
+  }
+  RoundTrip(csv);
+  // Mostly matches, even with fixed codes: about a third the size, where
+  // zlib gets a fifth.
+  TEST_ASSERT_TRUE(Compress(csv, csv.size()).size() < csv.size() / 2);
+}
+
+void Test_RoundTripsLongRunsAndNoise() {
+  // Matches up to the longest length, overlapping themselves, across
+  // blocks.
+  std::string input(5000, 'a');
+  uint32_t x = 1;
+  for (int i = 0; i < 5000; ++i) {
+    x = x * 1103515245 + 12345;
+    input += static_cast<char>(x >> 24);
+  }
+  input += input.substr(0, 3000);
+  RoundTrip(input);
+}
+#endif  // HAVE_ZLIB
+
+int RunTests() {
+  UNITY_BEGIN();
+  RUN_TEST(Test_Crc32);
+  RUN_TEST(Test_HeaderAndTrailer);
+#ifdef HAVE_ZLIB
+  RUN_TEST(Test_RoundTripsEmpty);
+  RUN_TEST(Test_RoundTripsCsv);
+  RUN_TEST(Test_RoundTripsLongRunsAndNoise);
+#endif
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
+void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
@@ -0,0 +1,119 @@
+#include <html_template.h>
+#include <string.h>
+#include <unity.h>
+
+#include <string>
+
+using html_template::Field;
+using html_template::Template;
+
+// Collects everything written to it.
+class StringPrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    text += static_cast<char>(c);
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t size) override {
+    text.append(reinterpret_cast<const char*>(data), size);
+    return size;
+  }
+
+  std::string text;
+};
+
+struct Values {
+  const char* name;
+  int count;
+};
+
+const Values& V(const void* values) {
+  return *reinterpret_cast<const Values*>(values);
+}
+
+const Field kFields[] = {
+    {"name", [](Print* out, const void* v) { out->print(V(v).name); }},
+    {"count", [](Print* out, const void* v) { out->print(V(v).count); }},
+};
+const size_t kNumFields = sizeof(kFields) / sizeof(kFields[0]);
+
+std::string Render(const Template& page, const Values& values) {
+  StringPrint out;
+  page.Render(&out, &values);
+  return out.text;
+}
+
+void Test_FillsInPlaceholders() {
+  const Template page("Hello {{name}}, you have {{count}} new {{name}}s.",
+                      kFields, kNumFields);
+  TEST_ASSERT_TRUE(page.ok());
+  // Four literal runs and three fields.
+  TEST_ASSERT_EQUAL(7, page.segments());
+  TEST_ASSERT_EQUAL_STRING("Hello x, you have 3 new xs.",
+                           Render(page, {"x", 3}).c_str());
+  TEST_ASSERT_EQUAL_STRING("Hello yy, you have -1 new yys.",
+                           Render(page, {"yy", -1}).c_str());
+}
+
+void Test_PlaceholdersOnly() {
+  const Template page("{{count}}{{name}}", kFields, kNumFields);
+  TEST_ASSERT_TRUE(page.ok());
+  TEST_ASSERT_EQUAL(2, page.segments());
+  TEST_ASSERT_EQUAL_STRING("42z", Render(page, {"z", 42}).c_str());
+
+  const Template empty("", kFields, kNumFields);
+  TEST_ASSERT_TRUE(empty.ok());
+  TEST_ASSERT_EQUAL_STRING("", Render(empty, {"z", 42}).c_str());
+}
+
+void Test_LeavesOtherBracesAlone() {
+  // CSS, percent signs and unterminated placeholders are just text.
+  const Template page("a { width: 100%; } {{count}} {{name", kFields,
+                      kNumFields);
+  TEST_ASSERT_TRUE(page.ok());
+  TEST_ASSERT_EQUAL_STRING("a { width: 100%; } 7 {{name",
+                           Render(page, {"z", 7}).c_str());
+}
+
+void Test_UnknownPlaceholderShows() {
+  const Template page("{{name}} {{nmae}} {{count}}", kFields, kNumFields);
+  TEST_ASSERT_FALSE(page.ok());
+  TEST_ASSERT_EQUAL_STRING("z {{nmae}} 1", Render(page, {"z", 1}).c_str());
+
+  // A prefix of a field's name isn't that field.
+  const Template prefix("{{nam}}", kFields, kNumFields);
+  TEST_ASSERT_FALSE(prefix.ok());
+}
+
+void Test_TooManySegments() {
+  std::string text;
+  for (int i = 0; i < Template::kMaxSegments; ++i) {
+    text += "-{{count}}";
+  }
+  const Template page(text.c_str(), kFields, kNumFields);
+  TEST_ASSERT_FALSE(page.ok());
+  TEST_ASSERT_TRUE(page.segments() <= Template::kMaxSegments);
+  // Everything is still there, filled in or not.
+  const std::string rendered = Render(page, {"z", 5});
+  TEST_ASSERT_EQUAL_STRING("-5-5", rendered.substr(0, 4).c_str());
+  TEST_ASSERT_EQUAL_STRING("-{{count}}",
+                           rendered.substr(rendered.size() - 10).c_str());
+}
+
+int RunTests() {
+  UNITY_BEGIN();
+  RUN_TEST(Test_FillsInPlaceholders);
+  RUN_TEST(Test_PlaceholdersOnly);
+  RUN_TEST(Test_LeavesOtherBracesAlone);
+  RUN_TEST(Test_UnknownPlaceholderShows);
+  RUN_TEST(Test_TooManySegments);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
+void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
@@ -0,0 +1,460 @@
+#include <Arduino.h>
+#include <event_stream.h>
+#include <http_server.h>
+#include <lwip/sockets.h>
+#include <response_cache.h>
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#ifndef ARDUINO
+#include <host.h>
+#endif
+
+namespace {
+
+http_server::Server server;
+
+// Echoes the body back.
+void Echo(const http_server::Request& request, http_server::Response* response,
+          void* unused) {
+  response->set_content_type("text/plain");
+  response->write(reinterpret_cast<const uint8_t*>(request.body().data()),
+                  request.body().size());
+}
+
+uint16_t ServerPort() {
+#ifdef ARDUINO
+  return 80;
+#else
+  return host::BoundHttpPort();
+#endif
+}
+
+// Says whether the request accepts gzip.
+void AcceptsGzip(const http_server::Request& request,
+                 http_server::Response* response, void* unused) {
+  response->set_content_type("text/plain");
+  response->print(request.AcceptsEncoding("gzip") ? "[yes]" : "[no]");
+}
+
+// What the cached route renders: body_size bytes of the version's digit.
+struct Cached {
+  size_t body_size = 16;
+  uint32_t version = 1;
+  int renders = 0;
+};
+Cached cached;
+
+void RenderCached(Print* out, void* unused) {
+  ++cached.renders;
+  for (size_t i = 0; i < cached.body_size; ++i) {
+    out->write('0' + cached.version % 10);
+  }
+}
+
+http_server::ResponseCache cache("text/plain", /*capacity=*/64, RenderCached,
+                                 nullptr);
+
+void ServeCached(const http_server::Request& request,
+                 http_server::Response* response, void* unused) {
+  cache.Serve(request, response, cached.version);
+}
+
+// Where the soft AP would be, in network order.
+uint32_t portal_ip = 0;
+
+// Takes a POST only from the soft AP's side, as the setup page does.
+void Setup(const http_server::Request& request,
+           http_server::Response* response, void* unused) {
+  if (request.local_ip() != portal_ip) {
+    http_server::SendStatus(response, 403, "only from the setup portal");
+    return;
+  }
+  response->set_content_type("text/plain");
+  response->print("[set up]");
+}
+
+http_server::EventStream events;
+// What each event's data is: data_size bytes of 'e'.
+size_t data_size = 8;
+
+void RenderEvent(Print* out, void* unused) {
+  for (size_t i = 0; i < data_size; ++i) {
+    out->write('e');
+  }
+}
+
+void Subscribe(const http_server::Request& request,
+               http_server::Response* response, void* unused) {
+  events.Subscribe(response, "hello", RenderEvent, nullptr);
+}
+
+// Sends data on a new connection and returns everything that comes back
+// until the server closes it or goes quiet.
+std::string Exchange(const std::string& data) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(ServerPort());
+  TEST_ASSERT_EQUAL(0, connect(fd, reinterpret_cast<sockaddr*>(&addr),
+                               sizeof(addr)));
+  struct timeval timeout = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  TEST_ASSERT_EQUAL(data.size(), send(fd, data.data(), data.size(), 0));
+  std::string received;
+  char buffer[512];
+  for (;;) {
+    const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+      break;
+    }
+    received.append(buffer, n);
+  }
+  close(fd);
+  return received;
+}
+
+bool StartsWith(const std::string& s, const char* prefix) {
+  return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+size_t Count(const std::string& s, const char* needle) {
+  size_t count = 0;
+  for (size_t pos = s.find(needle); pos != std::string::npos;
+       pos = s.find(needle, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+// The value of header name in response, or empty.
+std::string Header(const std::string& response, const char* name) {
+  const std::string prefix = std::string("\r\n") + name + ": ";
+  const size_t start = response.find(prefix);
+  if (start == std::string::npos) {
+    return "";
+  }
+  const size_t value = start + prefix.size();
+  return response.substr(value, response.find("\r\n", value) - value);
+}
+
+// A connection to /events, or whatever url. receive_buffer, if set, is
+// the client's socket buffer, so the server has less room to send into.
+int OpenStream(const char* url = "/events", int receive_buffer = 0) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (receive_buffer > 0) {
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer,
+               sizeof(receive_buffer));
+  }
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(ServerPort());
+  TEST_ASSERT_EQUAL(0, connect(fd, reinterpret_cast<sockaddr*>(&addr),
+                               sizeof(addr)));
+  struct timeval timeout = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  const std::string request =
+      std::string("GET ") + url + " HTTP/1.1\r\n\r\n";
+  TEST_ASSERT_EQUAL(request.size(),
+                    send(fd, request.data(), request.size(), 0));
+  return fd;
+}
+
+// Reads from fd until what came in ends with end, or it goes quiet.
+std::string ReadUntil(int fd, const std::string& end) {
+  std::string received;
+  char c;
+  while (received.size() < end.size() ||
+         received.compare(received.size() - end.size(), end.size(), end) !=
+             0) {
+    if (recv(fd, &c, 1, 0) != 1) {
+      break;
+    }
+    received += c;
+  }
+  return received;
+}
+
+// Closes the clients' ends and publishes until the stream noticed.
+void CloseStreams(const std::vector<int>& fds) {
+  const int remaining = events.subscribers() - fds.size();
+  for (int fd : fds) {
+    close(fd);
+  }
+  for (int i = 0; i < 100 && events.subscribers() > remaining; ++i) {
+    events.Publish("bye", RenderEvent, nullptr);
+    delay(10);
+  }
+  TEST_ASSERT_EQUAL(remaining, events.subscribers());
+}
+
+std::string GetCached(const std::string& etag = "") {
+  std::string request = "GET /cached HTTP/1.1\r\nConnection: close\r\n";
+  if (!etag.empty()) {
+    request += "If-None-Match: " + etag + "\r\n";
+  }
+  return Exchange(request + "\r\n");
+}
+
+}  // namespace
+
+void Test_NegativeContentLengthIsBadRequest() {
+  const std::string response = Exchange(
+      "POST /echo HTTP/1.1\r\nContent-Length: -1\r\n\r\nx"
+      "GET /echo HTTP/1.1\r\n\r\n");
+  TEST_ASSERT_TRUE(StartsWith(response, "HTTP/1.1 400"));
+  // Nothing more once it gave up on the connection.
+  TEST_ASSERT_EQUAL(1, Count(response, "HTTP/1.1"));
+}
+
+void Test_HugeContentLengthIsTooLarge() {
+  for (const char* length : {"4294967295", "18446744073709551615",
+                             "99999999999999999999999"}) {
+    const std::string response =
+        Exchange(std::string("POST /echo HTTP/1.1\r\nContent-Length: ") +
+                 length + "\r\n\r\nx");
+    TEST_ASSERT_TRUE(StartsWith(response, "HTTP/1.1 413"));
+  }
+}
+
+void Test_PipelinedBodiesStayApart() {
+  const std::string response = Exchange(
+      "POST /echo HTTP/1.1\r\nContent-Length: 5\r\n\r\nfirst"
+      "POST /echo HTTP/1.1\r\nContent-Length: 6\r\nConnection: close\r\n\r\n"
+      "second");
+  TEST_ASSERT_EQUAL(2, Count(response, "HTTP/1.1 200"));
+  TEST_ASSERT_TRUE(response.find("first") != std::string::npos);
+  TEST_ASSERT_TRUE(response.find("second") != std::string::npos);
+}
+
+void Test_AcceptsEncoding() {
+  struct {
+    const char* accept_encoding;
+    bool gzip;
+  } cases[] = {
+      {nullptr, false},
+      {"gzip", true},
+      {"deflate, GZIP, br", true},
+      {"gzip;q=0.5", true},
+      {"gzip ; q=1.0", true},
+      {"gzip;q=0", false},
+      {"br, gzip;q=0.000", false},
+      {"x-gzip", false},
+      {"*", true},
+      {"*;q=0", false},
+      {"*, gzip;q=0", false},
+      {"gzip;q=0, *", false},
+      {"br;q=0, *;q=0.1", true},
+  };
+  for (const auto& c : cases) {
+    std::string request = "GET /gzip HTTP/1.1\r\nConnection: close\r\n";
+    if (c.accept_encoding != nullptr) {
+      request += std::string("Accept-Encoding: ") + c.accept_encoding + "\r\n";
+    }
+    const std::string response = Exchange(request + "\r\n");
+    // With the header in both, so a failure says which case it was.
+    const std::string name = c.accept_encoding ? c.accept_encoding : "none";
+    const std::string body = response.substr(response.rfind('['));
+    TEST_ASSERT_EQUAL_STRING((name + (c.gzip ? " [yes]" : " [no]")).c_str(),
+                             (name + " " + body).c_str());
+  }
+}
+
+void Test_CacheHitAndNotModified() {
+  cached = Cached();
+  const http_server::ResponseCache::Stats before = cache.stats();
+  const std::string first = GetCached();
+  const std::string second = GetCached();
+  TEST_ASSERT_TRUE(StartsWith(second, "HTTP/1.1 200"));
+  TEST_ASSERT_TRUE(second.find(std::string(16, '1')) != std::string::npos);
+  TEST_ASSERT_EQUAL(1, cached.renders);
+  TEST_ASSERT_EQUAL(before.hits + 1, cache.stats().hits);
+
+  const std::string etag = Header(first, "ETag");
+  TEST_ASSERT_FALSE(etag.empty());
+  TEST_ASSERT_EQUAL_STRING(etag.c_str(), Header(second, "ETag").c_str());
+  const std::string not_modified = GetCached(etag);
+  TEST_ASSERT_TRUE(StartsWith(not_modified, "HTTP/1.1 304"));
+  TEST_ASSERT_TRUE(not_modified.find(std::string(16, '1')) ==
+                   std::string::npos);
+  TEST_ASSERT_EQUAL(before.not_modified + 1, cache.stats().not_modified);
+  TEST_ASSERT_EQUAL(1, cached.renders);
+}
+
+void Test_CacheNewVersionRendersAgain() {
+  cached = Cached();
+  const std::string old_etag = Header(GetCached(), "ETag");
+  const int renders = cached.renders;
+
+  cached.version = 2;
+  const std::string response = GetCached(old_etag);
+  TEST_ASSERT_TRUE(StartsWith(response, "HTTP/1.1 200"));
+  TEST_ASSERT_TRUE(response.find(std::string(16, '2')) != std::string::npos);
+  TEST_ASSERT_EQUAL(renders + 1, cached.renders);
+  TEST_ASSERT_TRUE(Header(response, "ETag") != old_etag);
+}
+
+void Test_CacheOverflowRendersOnlyOncePerVersion() {
+  cached = Cached();
+  cached.body_size = 100;
+  cached.version = 3;
+  const http_server::ResponseCache::Stats before = cache.stats();
+  for (int i = 0; i < 3; ++i) {
+    const std::string response = GetCached();
+    TEST_ASSERT_TRUE(StartsWith(response, "HTTP/1.1 200"));
+    TEST_ASSERT_TRUE(response.find(std::string(100, '3')) !=
+                     std::string::npos);
+    TEST_ASSERT_EQUAL_STRING("", Header(response, "ETag").c_str());
+  }
+  // One try at caching it, then straight into each response.
+  TEST_ASSERT_EQUAL(4, cached.renders);
+  TEST_ASSERT_EQUAL(before.renders + 1, cache.stats().renders);
+  TEST_ASSERT_EQUAL(before.uncached + 3, cache.stats().uncached);
+
+  // A new version gets another try, and caches again once it fits.
+  cached.version = 4;
+  cached.body_size = 16;
+  GetCached();
+  GetCached();
+  TEST_ASSERT_EQUAL(5, cached.renders);
+}
+
+void Test_EventsFramedForEverySubscriber() {
+  data_size = 8;
+  std::vector<int> fds = {OpenStream(), OpenStream()};
+  for (int fd : fds) {
+    const std::string head = ReadUntil(fd, "event: hello\ndata: eeeeeeee\n\n");
+    TEST_ASSERT_TRUE(StartsWith(head, "HTTP/1.1 200"));
+    TEST_ASSERT_TRUE(head.find("Content-Type: text/event-stream") !=
+                     std::string::npos);
+    TEST_ASSERT_TRUE(head.find("event: hello\ndata: eeeeeeee\n\n") !=
+                     std::string::npos);
+  }
+  TEST_ASSERT_EQUAL(2, events.subscribers());
+
+  data_size = 3;
+  events.Publish("reading", RenderEvent, nullptr);
+  for (int fd : fds) {
+    TEST_ASSERT_EQUAL_STRING("event: reading\ndata: eee\n\n",
+                             ReadUntil(fd, "\n\n").c_str());
+  }
+  CloseStreams(fds);
+}
+
+void Test_EventsTurnAwayTheFifthSubscriber() {
+  data_size = 8;
+  const http_server::EventStream::Stats before = events.stats();
+  std::vector<int> fds;
+  for (int i = 0; i < http_server::EventStream::kMaxSubscribers; ++i) {
+    fds.push_back(OpenStream());
+    ReadUntil(fds.back(), "data: eeeeeeee\n\n");
+  }
+  TEST_ASSERT_EQUAL(http_server::EventStream::kMaxSubscribers,
+                    events.subscribers());
+
+  const int extra = OpenStream();
+  TEST_ASSERT_TRUE(StartsWith(ReadUntil(extra, "\r\n"), "HTTP/1.1 503"));
+  close(extra);
+  TEST_ASSERT_EQUAL(before.rejected + 1, events.stats().rejected);
+  TEST_ASSERT_EQUAL(http_server::EventStream::kMaxSubscribers,
+                    events.subscribers());
+
+  // Room again once one goes.
+  CloseStreams({fds.back()});
+  fds.pop_back();
+  const int another = OpenStream();
+  TEST_ASSERT_TRUE(StartsWith(ReadUntil(another, "data: eeeeeeee\n\n"),
+                              "HTTP/1.1 200"));
+  fds.push_back(another);
+  CloseStreams(fds);
+}
+
+void Test_EventsDropASubscriberThatStopsReading() {
+  const http_server::EventStream::Stats before = events.stats();
+  // Reads nothing, into as little buffer as the kernel allows.
+  const int stalled = OpenStream("/events", 1);
+  const int reading = OpenStream();
+  ReadUntil(reading, "data: eeeeeeee\n\n");
+  TEST_ASSERT_EQUAL(2, events.subscribers());
+
+  data_size = 900;
+  const std::string event =
+      "event: reading\ndata: " + std::string(data_size, 'e') + "\n\n";
+  for (int i = 0; i < 100000 && events.subscribers() == 2; ++i) {
+    events.Publish("reading", RenderEvent, nullptr);
+    // The other one keeps up, and keeps getting whole events.
+    TEST_ASSERT_EQUAL_STRING(event.c_str(),
+                             ReadUntil(reading, "\n\n").c_str());
+  }
+  TEST_ASSERT_EQUAL(1, events.subscribers());
+  TEST_ASSERT_EQUAL(before.dropped + 1, events.stats().dropped);
+
+  events.Publish("reading", RenderEvent, nullptr);
+  TEST_ASSERT_EQUAL_STRING(event.c_str(), ReadUntil(reading, "\n\n").c_str());
+  close(stalled);
+  CloseStreams({reading});
+}
+
+void Test_EventsForgetAClosedSubscriber() {
+  data_size = 8;
+  const http_server::EventStream::Stats before = events.stats();
+  const int fd = OpenStream();
+  ReadUntil(fd, "data: eeeeeeee\n\n");
+  TEST_ASSERT_EQUAL(1, events.subscribers());
+  CloseStreams({fd});
+  TEST_ASSERT_EQUAL(before.closed + 1, events.stats().closed);
+  TEST_ASSERT_EQUAL(before.dropped, events.stats().dropped);
+}
+
+void Test_SetupRefusedFromTheLan() {
+  const std::string kPost =
+      "POST /setup HTTP/1.1\r\nContent-Length: 0\r\n"
+      "Connection: close\r\n\r\n";
+  // The request comes in on localhost, and the AP is elsewhere.
+  portal_ip = htonl(INADDR_LOOPBACK + 1);
+  const std::string lan = Exchange(kPost);
+  TEST_ASSERT_TRUE(StartsWith(lan, "HTTP/1.1 403 "));
+  TEST_ASSERT_EQUAL(0, Count(lan, "[set up]"));
+  portal_ip = htonl(INADDR_LOOPBACK);
+  const std::string portal = Exchange(kPost);
+  TEST_ASSERT_TRUE(StartsWith(portal, "HTTP/1.1 200 "));
+  TEST_ASSERT_EQUAL(1, Count(portal, "[set up]"));
+}
+
+int RunTests() {
+#ifndef ARDUINO
+  host::SetHttpPort(0);
+#endif
+  server.AddRoute("/echo", Echo);
+  server.AddRoute("/cached", ServeCached);
+  server.AddRoute("/gzip", AcceptsGzip);
+  server.AddRoute("/events", Subscribe);
+  server.AddRoute("/setup", Setup);
+  TEST_ASSERT_TRUE(server.Start(http_server::Config()));
+  UNITY_BEGIN();
+  RUN_TEST(Test_NegativeContentLengthIsBadRequest);
+  RUN_TEST(Test_HugeContentLengthIsTooLarge);
+  RUN_TEST(Test_PipelinedBodiesStayApart);
+  RUN_TEST(Test_AcceptsEncoding);
+  RUN_TEST(Test_CacheHitAndNotModified);
+  RUN_TEST(Test_CacheNewVersionRendersAgain);
+  RUN_TEST(Test_CacheOverflowRendersOnlyOncePerVersion);
+  RUN_TEST(Test_EventsFramedForEverySubscriber);
+  RUN_TEST(Test_EventsTurnAwayTheFifthSubscriber);
+  RUN_TEST(Test_EventsDropASubscriberThatStopsReading);
+  RUN_TEST(Test_EventsForgetAClosedSubscriber);
+  RUN_TEST(Test_SetupRefusedFromTheLan);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
+void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
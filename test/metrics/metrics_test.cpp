@@ -0,0 +1,200 @@
+#include <metrics.h>
+#include <string.h>
+#include <unity.h>
+
+#include <string>
+
+using metrics::FormatFixed;
+using metrics::FormatInt;
+
+// Collects everything written to it.
+class StringPrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    text += static_cast<char>(c);
+    ++writes;
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t size) override {
+    text.append(reinterpret_cast<const char*>(data), size);
+    ++writes;
+    return size;
+  }
+
+  std::string text;
+  int writes = 0;
+};
+
+std::string Int(int64_t value) {
+  char buf[metrics::kMaxNumberSize];
+  size_t n = FormatInt(value, buf);
+  TEST_ASSERT_EQUAL(strlen(buf), n);
+  return buf;
+}
+
+std::string Fixed(double value, int digits = 2) {
+  char buf[metrics::kMaxNumberSize];
+  size_t n = FormatFixed(value, digits, buf);
+  TEST_ASSERT_EQUAL(strlen(buf), n);
+  return buf;
+}
+
+metrics::Identity MakeIdentity() {
+  metrics::Identity identity = {};
+  const uint8_t mac[6] = {0x24, 0x0a, 0xc4, 0x00, 0x51, 0x3e};
+  memcpy(identity.mac, mac, sizeof(mac));
+  // 192.168.1.23, first octet in the low byte.
+  identity.ip = 192 | 168 << 8 | 1 << 16 | 23u << 24;
+  strcpy(identity.hostname, "pneumatic");
+  strcpy(identity.ssid, "home");
+  const uint8_t bssid[6] = {0xAA, 0xBB, 0xCC, 0x01, 0x02, 0x03};
+  memcpy(identity.bssid, bssid, sizeof(bssid));
+  identity.channel = 11;
+  return identity;
+}
+
+void Test_FormatInt() {
+  TEST_ASSERT_EQUAL_STRING("0", Int(0).c_str());
+  TEST_ASSERT_EQUAL_STRING("7", Int(7).c_str());
+  TEST_ASSERT_EQUAL_STRING("-55", Int(-55).c_str());
+  TEST_ASSERT_EQUAL_STRING("4294967295", Int(4294967295u).c_str());
+  TEST_ASSERT_EQUAL_STRING("9223372036854775807",
+                           Int(INT64_MAX).c_str());
+  TEST_ASSERT_EQUAL_STRING("-9223372036854775808",
+                           Int(INT64_MIN).c_str());
+}
+
+void Test_FormatFixed() {
+  TEST_ASSERT_EQUAL_STRING("0.00", Fixed(0).c_str());
+  TEST_ASSERT_EQUAL_STRING("7.00", Fixed(7).c_str());
+  TEST_ASSERT_EQUAL_STRING("12.50", Fixed(12.5).c_str());
+  TEST_ASSERT_EQUAL_STRING("101325.75", Fixed(101325.75).c_str());
+  TEST_ASSERT_EQUAL_STRING("0.01", Fixed(0.005).c_str());
+  TEST_ASSERT_EQUAL_STRING("-3.20", Fixed(-3.2).c_str());
+  // Rounds to zero without a sign.
+  TEST_ASSERT_EQUAL_STRING("0.00", Fixed(-0.001).c_str());
+  TEST_ASSERT_EQUAL_STRING("21", Fixed(21.4, 0).c_str());
+  TEST_ASSERT_EQUAL_STRING("1.000001", Fixed(1.000001, 6).c_str());
+  TEST_ASSERT_EQUAL_STRING("NaN", Fixed(NAN).c_str());
+  TEST_ASSERT_EQUAL_STRING("+Inf", Fixed(INFINITY).c_str());
+  TEST_ASSERT_EQUAL_STRING("-Inf", Fixed(-INFINITY).c_str());
+}
+
+void Test_RenderLabels() {
+  metrics::Labels labels;
+  metrics::RenderLabels(MakeIdentity(), &labels);
+  TEST_ASSERT_EQUAL_STRING(
+      R"(mac_address="24:0a:c4:00:51:3e",ip_address="192.168.1.23",)"
+      R"(hostname="pneumatic",)",
+      labels.common);
+  TEST_ASSERT_EQUAL_STRING(
+      R"(ssid="home",bssid="aa:bb:cc:01:02:03",channel="11")", labels.wifi);
+}
+
+void Test_RenderLabelsEscapesAndDisconnected() {
+  metrics::Identity identity = MakeIdentity();
+  strcpy(identity.ssid, R"(Bob's "5G" \o/)");
+  metrics::Labels labels;
+  metrics::RenderLabels(identity, &labels);
+  TEST_ASSERT_EQUAL_STRING(
+      R"(ssid="Bob's \"5G\" \\o/",bssid="aa:bb:cc:01:02:03",channel="11")",
+      labels.wifi);
+
+  memset(identity.ssid, 0, sizeof(identity.ssid));
+  memset(identity.bssid, 0, sizeof(identity.bssid));
+  identity.channel = 0;
+  metrics::RenderLabels(identity, &labels);
+  TEST_ASSERT_EQUAL_STRING(R"(ssid="",bssid="",channel="0")", labels.wifi);
+}
+
+void Test_RenderLabelsLongestEscaped() {
+  metrics::Identity identity = MakeIdentity();
+  memset(identity.hostname, '"', sizeof(identity.hostname) - 1);
+  memset(identity.ssid, '\\', sizeof(identity.ssid) - 1);
+  metrics::Labels labels;
+  metrics::RenderLabels(identity, &labels);
+
+  std::string hostname;
+  for (int i = 0; i < 63; ++i) {
+    hostname += R"(\")";
+  }
+  TEST_ASSERT_EQUAL_STRING(
+      (R"(mac_address="24:0a:c4:00:51:3e",ip_address="192.168.1.23",)"
+       R"(hostname=")" + hostname + R"(",)")
+          .c_str(),
+      labels.common);
+  TEST_ASSERT_EQUAL_STRING(
+      (R"(ssid=")" + std::string(2 * 32, '\\') +
+       R"(",bssid="aa:bb:cc:01:02:03",channel="11")")
+          .c_str(),
+      labels.wifi);
+}
+
+void Test_LabelCacheRendersOnChange() {
+  metrics::LabelCache cache;
+  metrics::Identity identity = MakeIdentity();
+  metrics::Labels labels;
+  cache.Get(identity, &labels);
+  cache.Get(identity, &labels);
+  TEST_ASSERT_EQUAL(1, cache.renders());
+
+  identity.ip = 192 | 168 << 8 | 1 << 16 | 24u << 24;
+  cache.Get(identity, &labels);
+  TEST_ASSERT_EQUAL(2, cache.renders());
+  TEST_ASSERT_NOT_NULL(strstr(labels.common, R"(ip_address="192.168.1.24")"));
+}
+
+void Test_WriterLines() {
+  StringPrint out;
+  {
+    metrics::Writer writer(&out, R"(host="a",)");
+    writer.Int("uptime_ms", "", 60000);
+    writer.Fixed("pm_ug_m3", R"(size="pm2.5")", 12);
+    // Nothing goes out until the buffer fills or the writer is done.
+    TEST_ASSERT_EQUAL(0, out.writes);
+  }
+  TEST_ASSERT_EQUAL_STRING(
+      "uptime_ms{host=\"a\",} 60000\n"
+      "pm_ug_m3{host=\"a\",size=\"pm2.5\"} 12.00\n",
+      out.text.c_str());
+  TEST_ASSERT_EQUAL(1, out.writes);
+}
+
+void Test_WriterFlushesWholeBuffers() {
+  StringPrint out;
+  std::string expected;
+  {
+    metrics::Writer writer(&out, "");
+    for (int i = 0; i < 200; ++i) {
+      writer.Int("counter", R"(n="x")", i);
+      expected += "counter{n=\"x\"} " + std::to_string(i) + "\n";
+    }
+  }
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), out.text.c_str());
+  // Full buffers, then the rest.
+  TEST_ASSERT_EQUAL(
+      (expected.size() + metrics::Writer::kBufferSize - 1) /
+          metrics::Writer::kBufferSize,
+      out.writes);
+}
+
+int RunTests() {
+  UNITY_BEGIN();
+  RUN_TEST(Test_FormatInt);
+  RUN_TEST(Test_FormatFixed);
+  RUN_TEST(Test_RenderLabels);
+  RUN_TEST(Test_RenderLabelsEscapesAndDisconnected);
+  RUN_TEST(Test_RenderLabelsLongestEscaped);
+  RUN_TEST(Test_LabelCacheRendersOnChange);
+  RUN_TEST(Test_WriterLines);
+  RUN_TEST(Test_WriterFlushesWholeBuffers);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
+void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
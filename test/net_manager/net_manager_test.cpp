@@ -0,0 +1,468 @@
+#include <link.h>
+#include <roam.h>
+#include <unity.h>
+
+using net_manager::Action;
+using net_manager::ApQuality;
+using net_manager::Link;
+using net_manager::LinkEvent;
+using net_manager::LinkState;
+using net_manager::RoamReason;
+using net_manager::RoamTable;
+
+// WIFI_REASON_NO_AP_FOUND, WIFI_REASON_AUTH_FAIL, WIFI_REASON_BEACON_TIMEOUT
+const uint8_t kNoApFound = 201;
+const uint8_t kAuthFail = 202;
+const uint8_t kBeaconTimeout = 200;
+const uint8_t kAssocLeave = net_manager::kReasonAssocLeave;
+
+void Test_ConnectsAndTimesIt() {
+  Link link;
+  link.Init();
+  link.Start(1000, /*have_network=*/true);
+  TEST_ASSERT_FALSE(link.online());
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(1000));
+  TEST_ASSERT_EQUAL(LinkState::kConnecting, link.state());
+  // Only once.
+  TEST_ASSERT_EQUAL(Action::kNone, link.Poll(1010));
+
+  link.Handle(LinkEvent::kAssociated, 1800);
+  TEST_ASSERT_EQUAL(LinkState::kAssociated, link.state());
+  TEST_ASSERT_FALSE(link.online());
+  link.Handle(LinkEvent::kGotIp, 3500);
+  TEST_ASSERT_TRUE(link.online());
+  TEST_ASSERT_TRUE(link.WaitOnline(0));
+  const auto stats = link.stats();
+  TEST_ASSERT_EQUAL(1, stats.connects);
+  TEST_ASSERT_EQUAL(2500, stats.last_connect_ms);
+  TEST_ASSERT_EQUAL(0, stats.failures);
+}
+
+void Test_ReconnectsAfterDrop() {
+  Link link;
+  link.Init();
+  link.Start(0, true);
+  link.Poll(0);
+  link.Handle(LinkEvent::kAssociated, 100);
+  link.Handle(LinkEvent::kGotIp, 200);
+
+  link.Handle(LinkEvent::kDisconnected, 60000, kBeaconTimeout);
+  TEST_ASSERT_FALSE(link.online());
+  TEST_ASSERT_FALSE(link.WaitOnline(0));
+  TEST_ASSERT_EQUAL(LinkState::kBackoff, link.state());
+  // Straight away the first time.
+  TEST_ASSERT_EQUAL(0, link.NextPollMs(60000));
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(60000));
+  link.Handle(LinkEvent::kAssociated, 60100);
+  link.Handle(LinkEvent::kGotIp, 60300);
+
+  const auto stats = link.stats();
+  TEST_ASSERT_EQUAL(2, stats.connects);
+  TEST_ASSERT_EQUAL(1, stats.disconnects);
+  TEST_ASSERT_EQUAL(300, stats.last_connect_ms);
+  TEST_ASSERT_EQUAL(kBeaconTimeout, stats.last_reason);
+  TEST_ASSERT_EQUAL(kBeaconTimeout, stats.reasons[0].reason);
+  TEST_ASSERT_EQUAL(1, stats.reasons[0].count);
+}
+
+void Test_BacksOffThenOpensPortal() {
+  Link link;
+  link.Init();
+  unsigned long now_ms = 0;
+  link.Start(now_ms, true);
+  unsigned long backoff_ms = Link::kMinBackoffMs;
+  for (int i = 1; i < Link::kPortalAfterFailures; ++i) {
+    TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(now_ms));
+    link.Handle(LinkEvent::kDisconnected, now_ms + 50, kAuthFail);
+    now_ms += 50;
+    TEST_ASSERT_EQUAL(LinkState::kBackoff, link.state());
+    TEST_ASSERT_EQUAL(backoff_ms, link.NextPollMs(now_ms));
+    // Nothing to do before the retry is due.
+    TEST_ASSERT_EQUAL(Action::kNone, link.Poll(now_ms + backoff_ms - 1));
+    now_ms += backoff_ms;
+    backoff_ms *= 2;
+  }
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(now_ms));
+  link.Handle(LinkEvent::kDisconnected, now_ms, kAuthFail);
+  TEST_ASSERT_EQUAL(LinkState::kPortal, link.state());
+  TEST_ASSERT_EQUAL(Action::kStartPortal, link.Poll(now_ms));
+  TEST_ASSERT_EQUAL(Action::kNone, link.Poll(now_ms));
+  TEST_ASSERT_EQUAL(Link::kPortalAfterFailures, link.stats().failures);
+  TEST_ASSERT_EQUAL(Link::kPortalAfterFailures, link.stats().reasons[0].count);
+
+  // A network was set up.
+  link.Start(now_ms, true);
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(now_ms));
+}
+
+void Test_TimesOutWithoutIp() {
+  Link link;
+  link.Init();
+  link.Start(0, true);
+  link.Poll(0);
+  link.Handle(LinkEvent::kAssociated, 500);
+  TEST_ASSERT_EQUAL(Link::kConnectTimeoutMs - 1000, link.NextPollMs(1000));
+  TEST_ASSERT_EQUAL(Action::kNone, link.Poll(Link::kConnectTimeoutMs - 1));
+  // Called off, so the driver doesn't carry on with it.
+  TEST_ASSERT_EQUAL(Action::kDisconnect, link.Poll(Link::kConnectTimeoutMs));
+  TEST_ASSERT_EQUAL(LinkState::kBackoff, link.state());
+  TEST_ASSERT_EQUAL(1, link.stats().failures);
+
+  // The disconnect's event comes once the next attempt is under way, and
+  // isn't it failing.
+  const unsigned long retry_ms = Link::kConnectTimeoutMs + Link::kMinBackoffMs;
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(retry_ms));
+  link.Handle(LinkEvent::kDisconnected, retry_ms + 10, kAssocLeave);
+  TEST_ASSERT_EQUAL(LinkState::kConnecting, link.state());
+  TEST_ASSERT_EQUAL(1, link.stats().failures);
+  TEST_ASSERT_EQUAL(0, link.stats().reasons[0].count);
+  // Only that one.
+  link.Handle(LinkEvent::kDisconnected, retry_ms + 20, kAssocLeave);
+  TEST_ASSERT_EQUAL(LinkState::kBackoff, link.state());
+  TEST_ASSERT_EQUAL(2, link.stats().failures);
+}
+
+void Test_DisconnectWithoutEventIsForgotten() {
+  Link link;
+  link.Init();
+  link.Start(0, true);
+  link.Poll(0);
+  TEST_ASSERT_EQUAL(Action::kDisconnect, link.Poll(Link::kConnectTimeoutMs));
+  // The driver had given up already, so nothing came of the disconnect; a
+  // later one, as for roaming, still takes it down.
+  const unsigned long retry_ms = Link::kConnectTimeoutMs + Link::kMinBackoffMs;
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(retry_ms));
+  link.Handle(LinkEvent::kAssociated, retry_ms + 100);
+  link.Handle(LinkEvent::kGotIp, retry_ms + 200);
+  link.Handle(LinkEvent::kDisconnected, retry_ms + 5000, kAssocLeave);
+  TEST_ASSERT_EQUAL(LinkState::kBackoff, link.state());
+  TEST_ASSERT_EQUAL(1, link.stats().disconnects);
+}
+
+void Test_NoNetworkGoesToPortal() {
+  Link link;
+  link.Init();
+  link.Start(0, /*have_network=*/false);
+  TEST_ASSERT_EQUAL(LinkState::kPortal, link.state());
+  TEST_ASSERT_EQUAL(Action::kStartPortal, link.Poll(0));
+  // Set up from the portal.
+  link.Provision(5000);
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(5000));
+  link.Handle(LinkEvent::kAssociated, 5010);
+  link.Handle(LinkEvent::kGotIp, 5020);
+  TEST_ASSERT_TRUE(link.online());
+  TEST_ASSERT_EQUAL(1, link.stats().provisions);
+  TEST_ASSERT_EQUAL(5020, link.stats().last_provision_ms);
+}
+
+void Test_PortalRetryIsntAProvision() {
+  Link link;
+  link.Init();
+  link.Start(0, /*have_network=*/true);
+  unsigned long now_ms = 0;
+  for (int i = 0; i < Link::kPortalAfterFailures; ++i) {
+    TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(now_ms));
+    link.Handle(LinkEvent::kDisconnected, now_ms, kNoApFound);
+    now_ms += Link::kMaxBackoffMs;
+  }
+  TEST_ASSERT_EQUAL(LinkState::kPortal, link.state());
+  // The saved network came back on the portal's retry.
+  link.Start(now_ms, true);
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(now_ms));
+  link.Handle(LinkEvent::kGotIp, now_ms + 100);
+  TEST_ASSERT_TRUE(link.online());
+  const auto stats = link.stats();
+  TEST_ASSERT_EQUAL(1, stats.portal_sessions);
+  TEST_ASSERT_EQUAL(0, stats.provisions);
+}
+
+void Test_ProvisionIgnoresItsDisconnect() {
+  Link link;
+  link.Init();
+  link.Start(0, /*have_network=*/false);
+  link.Poll(0);
+  // Provisioned while the portal's retry was connecting: the disconnect
+  // calling that off arrives once the new attempt has begun.
+  link.Start(1000, true);
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(1000));
+  link.Provision(2000);
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(2000));
+  link.Handle(LinkEvent::kDisconnected, 2010, kAssocLeave);
+  TEST_ASSERT_EQUAL(LinkState::kConnecting, link.state());
+  TEST_ASSERT_EQUAL(0, link.stats().failures);
+  link.Handle(LinkEvent::kAssociated, 2500);
+  link.Handle(LinkEvent::kGotIp, 3000);
+  TEST_ASSERT_TRUE(link.online());
+  TEST_ASSERT_EQUAL(1, link.stats().provisions);
+}
+
+void Test_ProvisionFromPortal() {
+  Link link;
+  link.Init();
+  link.Start(1000, /*have_network=*/false);
+  TEST_ASSERT_EQUAL(Action::kStartPortal, link.Poll(1000));
+
+  // Wrong password: every retry fails, and it's back in the portal.
+  link.Provision(60000);
+  unsigned long now_ms = 60000;
+  for (int i = 0; i < Link::kPortalAfterFailures; ++i) {
+    TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(now_ms));
+    link.Handle(LinkEvent::kDisconnected, now_ms, kAuthFail);
+    now_ms += Link::kMaxBackoffMs;
+  }
+  TEST_ASSERT_EQUAL(LinkState::kPortal, link.state());
+  TEST_ASSERT_EQUAL(Action::kStartPortal, link.Poll(now_ms));
+
+  // Then the right one.
+  link.Provision(now_ms);
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(now_ms));
+  link.Handle(LinkEvent::kAssociated, now_ms + 500);
+  link.Handle(LinkEvent::kGotIp, now_ms + 1000);
+  TEST_ASSERT_TRUE(link.online());
+  auto stats = link.stats();
+  TEST_ASSERT_EQUAL(1, stats.portal_sessions);
+  TEST_ASSERT_EQUAL(1, stats.provisions);
+  // From entering the portal at 1000.
+  TEST_ASSERT_EQUAL(now_ms, stats.last_provision_ms);
+
+  // Dropping and coming back isn't provisioning.
+  link.Handle(LinkEvent::kDisconnected, now_ms + 5000, kBeaconTimeout);
+  link.Poll(now_ms + 5000);
+  link.Handle(LinkEvent::kGotIp, now_ms + 5100);
+  stats = link.stats();
+  TEST_ASSERT_EQUAL(1, stats.provisions);
+  TEST_ASSERT_EQUAL(1, stats.portal_sessions);
+}
+
+void Test_LostIpThenDropped() {
+  Link link;
+  link.Init();
+  link.Start(0, true);
+  link.Poll(0);
+  link.Handle(LinkEvent::kGotIp, 100);
+  link.Handle(LinkEvent::kLostIp, 5000);
+  TEST_ASSERT_EQUAL(LinkState::kAssociated, link.state());
+  TEST_ASSERT_FALSE(link.online());
+  link.Handle(LinkEvent::kGotIp, 5400);
+  TEST_ASSERT_EQUAL(400, link.stats().last_connect_ms);
+
+  // Down. Only the Link's own attempts count: a stray association, from
+  // before, leaves it waiting for the retry.
+  link.Handle(LinkEvent::kDisconnected, 9000, kBeaconTimeout);
+  link.Handle(LinkEvent::kDisconnected, 9000, kBeaconTimeout);
+  link.Handle(LinkEvent::kAssociated, 9010);
+  TEST_ASSERT_EQUAL(LinkState::kBackoff, link.state());
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(9020));
+  link.Handle(LinkEvent::kAssociated, 9100);
+  TEST_ASSERT_EQUAL(LinkState::kAssociated, link.state());
+  link.Handle(LinkEvent::kGotIp, 9150);
+  TEST_ASSERT_TRUE(link.online());
+  const auto stats = link.stats();
+  TEST_ASSERT_EQUAL(3, stats.connects);
+  TEST_ASSERT_EQUAL(2, stats.disconnects);
+  TEST_ASSERT_EQUAL(130, stats.last_connect_ms);
+  TEST_ASSERT_EQUAL(400, stats.max_connect_ms);
+  TEST_ASSERT_EQUAL(2, stats.reasons[0].count);
+}
+
+void Test_CountsOtherReasonsTogether() {
+  Link link;
+  link.Init();
+  for (int reason = 1; reason <= 10; ++reason) {
+    link.Handle(LinkEvent::kDisconnected, 0, reason);
+  }
+  link.Handle(LinkEvent::kDisconnected, 0, kNoApFound);
+  const auto stats = link.stats();
+  const int kOther = net_manager::LinkStats::kMaxReasons - 1;
+  for (int i = 0; i < kOther; ++i) {
+    TEST_ASSERT_EQUAL(i + 1, stats.reasons[i].reason);
+    TEST_ASSERT_EQUAL(1, stats.reasons[i].count);
+  }
+  TEST_ASSERT_EQUAL(0, stats.reasons[kOther].reason);
+  TEST_ASSERT_EQUAL(4, stats.reasons[kOther].count);
+}
+
+void Test_FastConnectThenScan() {
+  Link link;
+  link.Init();
+  link.SetFastConnect(true);
+  link.Start(0, true);
+  TEST_ASSERT_EQUAL(Action::kFastConnect, link.Poll(0));
+  TEST_ASSERT_EQUAL(Link::kFastConnectTimeoutMs, link.NextPollMs(0));
+  link.Handle(LinkEvent::kAssociated, 80);
+  link.Handle(LinkEvent::kGotIp, 150);
+  auto stats = link.stats();
+  TEST_ASSERT_EQUAL(1, stats.fast_connects);
+  TEST_ASSERT_EQUAL(150, stats.boot_connect_ms);
+
+  // The AP moved: the fast attempt times out, and a scan follows at once
+  // with no backoff.
+  link.Handle(LinkEvent::kDisconnected, 10000, kBeaconTimeout);
+  TEST_ASSERT_EQUAL(Action::kFastConnect, link.Poll(10000));
+  TEST_ASSERT_EQUAL(Action::kNone,
+                    link.Poll(10000 + Link::kFastConnectTimeoutMs - 1));
+  TEST_ASSERT_EQUAL(Action::kDisconnect,
+                    link.Poll(10000 + Link::kFastConnectTimeoutMs));
+  TEST_ASSERT_EQUAL(0, link.NextPollMs(10000 + Link::kFastConnectTimeoutMs));
+  TEST_ASSERT_EQUAL(Action::kConnect,
+                    link.Poll(10000 + Link::kFastConnectTimeoutMs));
+  // Scans from now on, until it is online.
+  link.Handle(LinkEvent::kDisconnected, 16000, kNoApFound);
+  TEST_ASSERT_EQUAL(LinkState::kBackoff, link.state());
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(16000 + Link::kMinBackoffMs));
+  link.Handle(LinkEvent::kAssociated, 19000);
+  link.Handle(LinkEvent::kGotIp, 19500);
+
+  stats = link.stats();
+  TEST_ASSERT_EQUAL(2, stats.connects);
+  TEST_ASSERT_EQUAL(1, stats.fast_connects);
+  TEST_ASSERT_EQUAL(1, stats.fast_failures);
+  TEST_ASSERT_EQUAL(2, stats.failures);
+  TEST_ASSERT_EQUAL(9500, stats.last_reconnect_ms);
+  TEST_ASSERT_EQUAL(150, stats.boot_connect_ms);
+
+  // Online again, so the next drop tries the cache first again.
+  link.Handle(LinkEvent::kDisconnected, 30000, kBeaconTimeout);
+  TEST_ASSERT_EQUAL(Action::kFastConnect, link.Poll(30000));
+  link.Handle(LinkEvent::kAssociated, 30050);
+  link.Handle(LinkEvent::kGotIp, 30100);
+  stats = link.stats();
+  TEST_ASSERT_EQUAL(2, stats.fast_connects);
+  TEST_ASSERT_EQUAL(100, stats.last_reconnect_ms);
+  TEST_ASSERT_EQUAL(9500, stats.max_reconnect_ms);
+}
+
+void Test_FastFailuresDontOpenPortal() {
+  Link link;
+  link.Init();
+  link.SetFastConnect(true);
+  link.Start(0, true);
+  TEST_ASSERT_EQUAL(Action::kFastConnect, link.Poll(0));
+  link.Handle(LinkEvent::kDisconnected, 10, kNoApFound);
+  unsigned long now_ms = 10;
+  for (int i = 1; i < Link::kPortalAfterFailures; ++i) {
+    now_ms += Link::kMaxBackoffMs;
+    TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(now_ms));
+    link.Handle(LinkEvent::kDisconnected, now_ms, kNoApFound);
+  }
+  TEST_ASSERT_EQUAL(LinkState::kBackoff, link.state());
+  now_ms += Link::kMaxBackoffMs;
+  TEST_ASSERT_EQUAL(Action::kConnect, link.Poll(now_ms));
+  link.Handle(LinkEvent::kDisconnected, now_ms, kNoApFound);
+  TEST_ASSERT_EQUAL(LinkState::kPortal, link.state());
+}
+
+const uint8_t kApA[6] = {0x02, 0, 0, 0, 0, 0xa};
+const uint8_t kApB[6] = {0x02, 0, 0, 0, 0, 0xb};
+
+void Test_RoamsAwayFromWeakAp() {
+  RoamTable table;
+  table.SetCurrent(kApA, 1, 0);
+  table.AddRssi(kApA, 1, -70, 0);
+  table.AddRssi(kApB, 6, -60, 0);
+  RoamReason reason;
+  // Good enough: stay, however much better B is.
+  TEST_ASSERT_NULL(table.Decide(0, &reason));
+  TEST_ASSERT_EQUAL(RoamReason::kNone, reason);
+
+  // A weakens, and B isn't kHysteresisDb better.
+  for (int i = 0; i < ApQuality::kRssiHistory; ++i) {
+    table.AddRssi(kApA, 1, -75, 1000);
+  }
+  table.AddRssi(kApB, 6, -72, 1000);
+  table.AddRssi(kApB, 6, -72, 1000);
+  TEST_ASSERT_EQUAL(-75, table.current()->rssi());
+  TEST_ASSERT_EQUAL(-68, table.ap(1).rssi());
+  TEST_ASSERT_NULL(table.Decide(1000, &reason));
+  TEST_ASSERT_EQUAL(RoamReason::kWeakSignal, reason);
+  TEST_ASSERT_EQUAL(1, table.stats().roams[0]);
+
+  table.AddRssi(kApB, 6, -60, 2000);
+  const ApQuality* target = table.Decide(2000, &reason);
+  TEST_ASSERT_NOT_NULL(target);
+  TEST_ASSERT_EQUAL_MEMORY(kApB, target->bssid, 6);
+  TEST_ASSERT_EQUAL(6, target->channel);
+  TEST_ASSERT_EQUAL(1, table.stats().roams[int(RoamReason::kWeakSignal)]);
+
+  // Roaming back straight away would flap.
+  table.SetCurrent(kApB, 6, 3000);
+  for (int i = 0; i < ApQuality::kRssiHistory; ++i) {
+    table.AddRssi(kApB, 6, -80, 3000);
+    table.AddRssi(kApA, 1, -60, 3000);
+  }
+  TEST_ASSERT_NULL(table.Decide(3000, &reason));
+  TEST_ASSERT_NOT_NULL(
+      table.Decide(2000 + RoamTable::kMinRoamIntervalMs, &reason));
+}
+
+void Test_RoamsAwayFromLossyAp() {
+  RoamTable table;
+  table.SetCurrent(kApA, 1, 0);
+  table.AddRssi(kApA, 1, -55, 0);
+  table.AddRssi(kApB, 11, -62, 0);
+  for (int i = 0; i < RoamTable::kMinProbes; ++i) {
+    table.AddProbe(/*ok=*/i % 2 == 0, 2000);
+  }
+  const ApQuality& a = *table.current();
+  TEST_ASSERT_EQUAL(50, a.loss_percent());
+  TEST_ASSERT_EQUAL(2000, a.rtt_us);
+  TEST_ASSERT_EQUAL(RoamReason::kLoss, table.Degraded());
+  RoamReason reason;
+  // Weaker, but well clear of weak.
+  const ApQuality* target = table.Decide(0, &reason);
+  TEST_ASSERT_NOT_NULL(target);
+  TEST_ASSERT_EQUAL(RoamReason::kLoss, reason);
+  TEST_ASSERT_EQUAL_MEMORY(kApB, target->bssid, 6);
+
+  // Old losses age out of the window.
+  for (int i = 0; i < ApQuality::kProbeWindow; ++i) {
+    table.AddProbe(true, 200 * 1000);
+  }
+  TEST_ASSERT_EQUAL(0, table.current()->loss_percent());
+  TEST_ASSERT_EQUAL(RoamReason::kLatency, table.Degraded());
+}
+
+void Test_RoamTableIsBounded() {
+  RoamTable table;
+  uint8_t bssid[6] = {0x02, 0, 0, 0, 0, 0};
+  table.SetCurrent(bssid, 1, 0);
+  for (int i = 1; i <= RoamTable::kMaxAps; ++i) {
+    bssid[5] = i;
+    table.AddRssi(bssid, 1, -60, i * 1000);
+  }
+  TEST_ASSERT_EQUAL(RoamTable::kMaxAps, table.size());
+  // The current AP is the stalest but stays; the next stalest went.
+  TEST_ASSERT_EQUAL(0, table.current()->bssid[5]);
+  for (int i = 0; i < table.size(); ++i) {
+    TEST_ASSERT_NOT_EQUAL(1, table.ap(i).bssid[5]);
+  }
+}
+
+int RunTests() {
+  UNITY_BEGIN();
+  RUN_TEST(Test_ConnectsAndTimesIt);
+  RUN_TEST(Test_ReconnectsAfterDrop);
+  RUN_TEST(Test_BacksOffThenOpensPortal);
+  RUN_TEST(Test_TimesOutWithoutIp);
+  RUN_TEST(Test_DisconnectWithoutEventIsForgotten);
+  RUN_TEST(Test_NoNetworkGoesToPortal);
+  RUN_TEST(Test_ProvisionFromPortal);
+  RUN_TEST(Test_PortalRetryIsntAProvision);
+  RUN_TEST(Test_ProvisionIgnoresItsDisconnect);
+  RUN_TEST(Test_LostIpThenDropped);
+  RUN_TEST(Test_CountsOtherReasonsTogether);
+  RUN_TEST(Test_FastConnectThenScan);
+  RUN_TEST(Test_FastFailuresDontOpenPortal);
+  RUN_TEST(Test_RoamsAwayFromWeakAp);
+  RUN_TEST(Test_RoamsAwayFromLossyAp);
+  RUN_TEST(Test_RoamTableIsBounded);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
+void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
@@ -0,0 +1,285 @@
+#include <plantower.h>
+#include <string.h>
+#include <unity.h>
+
+#include <vector>
+
+using plantower::FrameParser;
+using plantower::FrameStatus;
+
+// Builds a frame around big-endian 16-bit payload words.
+std::vector<uint8_t> MakeFrame(const std::vector<uint16_t>& words) {
+  std::vector<uint8_t> frame = {0x42, 0x4d, 0x00,
+                                static_cast<uint8_t>(words.size() * 2 + 2)};
+  for (uint16_t word : words) {
+    frame.push_back(word >> 8);
+    frame.push_back(word & 0xff);
+  }
+  uint16_t checksum = 0;
+  for (uint8_t c : frame) {
+    checksum += c;
+  }
+  frame.push_back(checksum >> 8);
+  frame.push_back(checksum & 0xff);
+  return frame;
+}
+
+std::vector<uint8_t> PmsFrame(uint16_t pm2_5) {
+  return MakeFrame({1, pm2_5, 3, 4, pm2_5, 6, 7, 8, 9, 10, 11, 12, 0x9700});
+}
+
+// Stand-in for an Arduino Stream that hands out at most chunk bytes per
+// available() call, like a UART trickling in data.
+class FakeStream {
+ public:
+  FakeStream(const std::vector<uint8_t>& bytes, int chunk)
+      : bytes_(bytes), chunk_(chunk) {}
+
+  int available() {
+    int remaining = bytes_.size() - pos_;
+    return remaining < chunk_ ? remaining : chunk_;
+  }
+
+  size_t readBytes(uint8_t* buffer, size_t length) {
+    size_t n = std::min(length, bytes_.size() - pos_);
+    memcpy(buffer, &bytes_[pos_], n);
+    pos_ += n;
+    return n;
+  }
+
+ private:
+  std::vector<uint8_t> bytes_;
+  size_t pos_ = 0;
+  int chunk_;
+};
+
+void Test_ByteAtATime() {
+  FrameParser parser;
+  auto frame = PmsFrame(25);
+  for (size_t i = 0; i < frame.size(); ++i) {
+    TEST_ASSERT_FALSE(parser.ready());
+    TEST_ASSERT_EQUAL(1, parser.Feed(&frame[i], 1));
+  }
+  TEST_ASSERT_TRUE(parser.ready());
+  TEST_ASSERT_EQUAL(32, parser.frame_size());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(&frame[0], parser.frame(), frame.size());
+  TEST_ASSERT_EQUAL(1, parser.stats().frames);
+  TEST_ASSERT_EQUAL(0, parser.stats().skipped_bytes);
+}
+
+void Test_StopsAfterEachFrame() {
+  FrameParser parser;
+  auto first = PmsFrame(10);
+  auto second = PmsFrame(20);
+  std::vector<uint8_t> bytes = first;
+  bytes.insert(bytes.end(), second.begin(), second.end());
+
+  size_t consumed = parser.Feed(&bytes[0], bytes.size());
+  TEST_ASSERT_EQUAL(32, consumed);
+  TEST_ASSERT_TRUE(parser.ready());
+  TEST_ASSERT_EQUAL(10, parser.frame()[7]);
+
+  consumed += parser.Feed(&bytes[consumed], bytes.size() - consumed);
+  TEST_ASSERT_EQUAL(64, consumed);
+  TEST_ASSERT_TRUE(parser.ready());
+  TEST_ASSERT_EQUAL(20, parser.frame()[7]);
+  TEST_ASSERT_EQUAL(2, parser.stats().frames);
+}
+
+void Test_ResyncsOnGarbage() {
+  FrameParser parser;
+  auto frame = PmsFrame(42);
+  std::vector<uint8_t> bytes = {0x00, 0x42, 0x11, 0x42, 0x42};
+  bytes.insert(bytes.end(), frame.begin() + 1, frame.end());
+
+  TEST_ASSERT_EQUAL(bytes.size(), parser.Feed(&bytes[0], bytes.size()));
+  TEST_ASSERT_TRUE(parser.ready());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(&frame[0], parser.frame(), frame.size());
+  TEST_ASSERT_EQUAL(4, parser.stats().skipped_bytes);
+}
+
+void Test_BadChecksum() {
+  FrameParser parser;
+  auto bad = PmsFrame(1);
+  bad[10] ^= 0xff;
+  auto good = PmsFrame(2);
+  std::vector<uint8_t> bytes = bad;
+  bytes.insert(bytes.end(), good.begin(), good.end());
+
+  TEST_ASSERT_EQUAL(bytes.size(), parser.Feed(&bytes[0], bytes.size()));
+  TEST_ASSERT_TRUE(parser.ready());
+  TEST_ASSERT_EQUAL(2, parser.frame()[7]);
+  TEST_ASSERT_EQUAL(1, parser.stats().bad_checksum);
+  TEST_ASSERT_EQUAL(1, parser.stats().frames);
+}
+
+void Test_BadLength() {
+  FrameParser parser;
+  uint8_t bytes[] = {0x42, 0x4d, 0x01, 0x00};
+  parser.Feed(bytes, sizeof(bytes));
+  TEST_ASSERT_FALSE(parser.ready());
+  TEST_ASSERT_EQUAL(1, parser.stats().bad_length);
+
+  auto good = PmsFrame(3);
+  parser.Feed(&good[0], good.size());
+  TEST_ASSERT_TRUE(parser.ready());
+}
+
+void Test_OverrunDropsPartialFrame() {
+  FrameParser parser;
+  auto first = PmsFrame(5);
+  auto second = PmsFrame(6);
+  parser.Feed(&first[0], 20);
+  parser.Overrun();
+  // The tail of the lost frame is skipped while looking for a header.
+  parser.Feed(&first[20], first.size() - 20);
+  TEST_ASSERT_FALSE(parser.ready());
+  parser.Feed(&second[0], second.size());
+  TEST_ASSERT_TRUE(parser.ready());
+  TEST_ASSERT_EQUAL(6, parser.frame()[7]);
+  TEST_ASSERT_EQUAL(1, parser.stats().overruns);
+}
+
+void Test_ZeroCopyReserve() {
+  FrameParser parser;
+  auto frame = PmsFrame(7);
+  size_t pos = 0;
+  int commits = 0;
+  while (!parser.ready()) {
+    size_t want = 0;
+    uint8_t* dst = parser.Reserve(&want);
+    memcpy(dst, &frame[pos], want);
+    parser.Commit(want);
+    pos += want;
+    ++commits;
+  }
+  TEST_ASSERT_EQUAL(frame.size(), pos);
+  // Four header bytes, then the rest of the frame in one piece.
+  TEST_ASSERT_EQUAL(5, commits);
+}
+
+void Test_DsCo2Frame() {
+  FrameParser parser;
+  auto frame = MakeFrame({800, 0x1234, 0x5678});
+  TEST_ASSERT_EQUAL(12, frame.size());
+  parser.Feed(&frame[0], frame.size());
+  TEST_ASSERT_TRUE(parser.ready());
+  TEST_ASSERT_EQUAL(12, parser.frame_size());
+}
+
+void Test_ReadFromStream() {
+  FrameParser parser;
+  auto first = PmsFrame(8);
+  auto second = PmsFrame(9);
+  std::vector<uint8_t> bytes = first;
+  bytes.insert(bytes.end(), second.begin(), second.end());
+  FakeStream stream(bytes, /*chunk=*/5);
+
+  TEST_ASSERT_TRUE(parser.ReadFrom(&stream));
+  TEST_ASSERT_EQUAL(8, parser.frame()[7]);
+  TEST_ASSERT_TRUE(parser.ReadFrom(&stream));
+  TEST_ASSERT_EQUAL(9, parser.frame()[7]);
+  TEST_ASSERT_FALSE(parser.ReadFrom(&stream));
+}
+
+struct TestData {
+  uint16_t raw;
+  float value;
+  float smoothed;
+  float temp_c;
+};
+
+constexpr plantower::Field<TestData> kTestFields[] = {
+    plantower::RawField("raw", 4, &TestData::raw, /*min_value=*/0,
+                        /*max_value=*/1000),
+    plantower::ValueField("value", 6, &TestData::value),
+    plantower::ValueField("smoothed", 8, &TestData::smoothed,
+                          /*ewma_periods=*/3),
+    plantower::ValueField("temp_c", 10, &TestData::temp_c, /*ewma_periods=*/0,
+                          /*scale=*/0.1, /*is_signed=*/true),
+};
+static_assert(plantower::FitsInFrame(kTestFields, 16), "fits");
+static_assert(!plantower::FitsInFrame(kTestFields, 12), "overlaps checksum");
+
+float TestEwma(float new_value, float prev_ewma, int periods) {
+  return prev_ewma + (new_value - prev_ewma) * 2 / float(periods + 1);
+}
+
+void Test_VerifyFrame() {
+  auto frame = PmsFrame(12);
+  TEST_ASSERT_TRUE(FrameStatus::kOk ==
+                   plantower::VerifyFrame(&frame[0], frame.size()));
+  TEST_ASSERT_TRUE(FrameStatus::kBadLength ==
+                   plantower::VerifyFrame(&frame[0], frame.size() - 2));
+  frame[5] ^= 1;
+  TEST_ASSERT_TRUE(FrameStatus::kBadChecksum ==
+                   plantower::VerifyFrame(&frame[0], frame.size()));
+  frame[0] = 0;
+  TEST_ASSERT_TRUE(FrameStatus::kBadMagic ==
+                   plantower::VerifyFrame(&frame[0], frame.size()));
+}
+
+void Test_DecodeLayout() {
+  TestData data = {};
+  data.smoothed = 10;
+  auto frame = MakeFrame({500, 42, 20, static_cast<uint16_t>(-55), 0});
+  TEST_ASSERT_TRUE(FrameStatus::kOk ==
+                   plantower::Decode<16>(kTestFields, &frame[0], frame.size(),
+                                         &data, TestEwma));
+  TEST_ASSERT_EQUAL(500, data.raw);
+  TEST_ASSERT_EQUAL_FLOAT(42, data.value);
+  TEST_ASSERT_EQUAL_FLOAT(15, data.smoothed);
+  TEST_ASSERT_EQUAL_FLOAT(-5.5, data.temp_c);
+}
+
+void Test_DecodeRejectsOutliers() {
+  TestData data = {};
+  auto frame = MakeFrame({1001, 42, 20, 0, 0});
+  TEST_ASSERT_TRUE(FrameStatus::kOutOfRange ==
+                   plantower::Decode<16>(kTestFields, &frame[0], frame.size(),
+                                         &data, TestEwma));
+  TEST_ASSERT_EQUAL(0, data.raw);
+  TEST_ASSERT_EQUAL_FLOAT(0, data.value);
+
+  TEST_ASSERT_TRUE(FrameStatus::kBadSize ==
+                   plantower::Decode<16>(kTestFields, &frame[0], 12, &data,
+                                         TestEwma));
+}
+
+void Test_BuildCommand() {
+  uint8_t command[plantower::kCommandSize];
+  // DS-CO2-20 read request, as documented.
+  plantower::BuildCommand(0xe3, 0, command);
+  const uint8_t ds_co2_read[] = {0x42, 0x4d, 0xe3, 0x00, 0x00, 0x01, 0x72};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(ds_co2_read, command, sizeof(command));
+  // PMSx003 wake up.
+  plantower::BuildCommand(0xe4, 1, command);
+  const uint8_t pms_wake[] = {0x42, 0x4d, 0xe4, 0x00, 0x01, 0x01, 0x74};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(pms_wake, command, sizeof(command));
+}
+
+int RunTests() {
+  UNITY_BEGIN();
+  RUN_TEST(Test_ByteAtATime);
+  RUN_TEST(Test_StopsAfterEachFrame);
+  RUN_TEST(Test_ResyncsOnGarbage);
+  RUN_TEST(Test_BadChecksum);
+  RUN_TEST(Test_BadLength);
+  RUN_TEST(Test_OverrunDropsPartialFrame);
+  RUN_TEST(Test_ZeroCopyReserve);
+  RUN_TEST(Test_DsCo2Frame);
+  RUN_TEST(Test_ReadFromStream);
+  RUN_TEST(Test_VerifyFrame);
+  RUN_TEST(Test_DecodeLayout);
+  RUN_TEST(Test_DecodeRejectsOutliers);
+  RUN_TEST(Test_BuildCommand);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
+void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
@@ -0,0 +1,116 @@
+#include <lwip/sockets.h>
+#include <prober.h>
+#include <unity.h>
+
+using prober::Histogram;
+
+void Test_BucketsAreLogLinear() {
+  TEST_ASSERT_EQUAL(0, Histogram::Bucket(0));
+  TEST_ASSERT_EQUAL(0, Histogram::Bucket(Histogram::kMinUs - 1));
+  TEST_ASSERT_EQUAL(1, Histogram::Bucket(Histogram::kMinUs));
+  TEST_ASSERT_EQUAL(Histogram::kNumBuckets - 1,
+                    Histogram::Bucket(60 * 1000 * 1000));
+  int last_bucket = 0;
+  for (uint32_t us = Histogram::kMinUs; us < 16 * 1000 * 1000;
+       us += us / 7 + 1) {
+    const int bucket = Histogram::Bucket(us);
+    TEST_ASSERT_TRUE(bucket >= last_bucket);
+    last_bucket = bucket;
+    const uint32_t midpoint = Histogram::Midpoint(bucket);
+    const uint32_t error = midpoint > us ? midpoint - us : us - midpoint;
+    TEST_ASSERT_TRUE(error <= us / 16 + 1);
+  }
+}
+
+void Test_Quantiles() {
+  Histogram histogram;
+  TEST_ASSERT_EQUAL(0, histogram.Quantile(0.5));
+  for (int i = 0; i < 90; ++i) {
+    histogram.Add(1000);
+  }
+  Histogram slow;
+  for (int i = 0; i < 9; ++i) {
+    slow.Add(10 * 1000);
+  }
+  slow.Add(100 * 1000);
+  TEST_ASSERT_INT_WITHIN(1000 / 16, 1000, histogram.Quantile(0.50, &slow));
+  TEST_ASSERT_INT_WITHIN(10000 / 16, 10000, histogram.Quantile(0.95, &slow));
+  TEST_ASSERT_INT_WITHIN(10000 / 16, 10000, histogram.Quantile(0.99, &slow));
+  TEST_ASSERT_INT_WITHIN(100000 / 16, 100000, histogram.Quantile(1, &slow));
+  TEST_ASSERT_INT_WITHIN(1000 / 16, 1000, histogram.Quantile(0.99));
+
+  histogram.Clear();
+  TEST_ASSERT_EQUAL(0, histogram.count());
+  TEST_ASSERT_EQUAL(0, histogram.Quantile(0.5));
+}
+
+void Test_TargetForgetsOldWindows() {
+  prober::Target target("test");
+  TEST_ASSERT_EQUAL(0, target.stats().probes);
+  target.Init();
+  const unsigned long kWindowMs = prober::Target::kWindowMs;
+  for (int i = 0; i < 10; ++i) {
+    target.Add(true, 50 * 1000, i * 1000);
+  }
+  target.Add(false, 0, 11000);
+  prober::Stats stats = target.stats();
+  TEST_ASSERT_EQUAL(11, stats.probes);
+  TEST_ASSERT_EQUAL(1, stats.lost);
+  TEST_ASSERT_EQUAL(50 * 1000, stats.last_rtt_us);
+  TEST_ASSERT_INT_WITHIN(50000 / 16, 50000, stats.p50_us);
+
+  // The previous window still counts...
+  target.Add(true, 1000, kWindowMs);
+  stats = target.stats();
+  TEST_ASSERT_INT_WITHIN(50000 / 16, 50000, stats.p50_us);
+  TEST_ASSERT_EQUAL(1000, stats.last_rtt_us);
+  // ...the one before doesn't.
+  target.Add(true, 1000, 2 * kWindowMs);
+  stats = target.stats();
+  TEST_ASSERT_INT_WITHIN(1000 / 16, 1000, stats.p99_us);
+  // Nor after a long gap.
+  target.Add(true, 2000, 10 * kWindowMs);
+  TEST_ASSERT_INT_WITHIN(2000 / 16, 2000, target.stats().p50_us);
+  TEST_ASSERT_EQUAL(14, target.stats().probes);
+}
+
+// A stand-in for the gateway or upstream host: a listener on localhost.
+void Test_ConnectRttToLocalEndpoint() {
+  const int listener = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  TEST_ASSERT_EQUAL(0, bind(listener, reinterpret_cast<sockaddr*>(&addr),
+                            sizeof(addr)));
+  TEST_ASSERT_EQUAL(0, listen(listener, 4));
+  socklen_t len = sizeof(addr);
+  getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+  const uint16_t port = ntohs(addr.sin_port);
+
+  uint32_t rtt_us = 0;
+  TEST_ASSERT_TRUE(prober::ConnectRtt(addr.sin_addr.s_addr, port,
+                                      /*timeout_ms=*/1000, &rtt_us));
+  TEST_ASSERT_TRUE(
+      prober::ConnectRtt("127.0.0.1", port, /*timeout_ms=*/1000, &rtt_us));
+  close(listener);
+  // Refused answers too.
+  TEST_ASSERT_TRUE(prober::ConnectRtt(addr.sin_addr.s_addr, port,
+                                      /*timeout_ms=*/1000, &rtt_us));
+}
+
+int RunTests() {
+  UNITY_BEGIN();
+  RUN_TEST(Test_BucketsAreLogLinear);
+  RUN_TEST(Test_Quantiles);
+  RUN_TEST(Test_TargetForgetsOldWindows);
+  RUN_TEST(Test_ConnectRttToLocalEndpoint);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
+void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
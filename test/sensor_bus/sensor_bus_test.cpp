@@ -0,0 +1,90 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <sensor_bus.h>
+#include <unity.h>
+
+namespace {
+struct Value {
+  int n;
+};
+
+const TickType_t kLongTicks = 5000 / portTICK_PERIOD_MS;
+
+// Publishes after a while, from another task.
+void TaskPublishLater(void* topic_arg) {
+  auto topic = reinterpret_cast<sensor_bus::Topic<Value>*>(topic_arg);
+  vTaskDelay(50 / portTICK_PERIOD_MS);
+  topic->Publish({2}, 0);
+  vTaskDelete(nullptr);
+}
+}  // namespace
+
+void Test_PublishBetweenCheckAndWaitIsNotLost() {
+  sensor_bus::Topic<Value> topic(sensor_bus::kBme);
+  sensor_bus::Reader reader(sensor_bus::kBme);
+  const uint32_t seq = topic.seq();
+  // The writer gets in after the reader checked the seq but before it
+  // waits.
+  topic.Publish({1}, 0);
+  const TickType_t start = xTaskGetTickCount();
+  TEST_ASSERT_EQUAL(sensor_bus::kBme, reader.Wait(kLongTicks));
+  TEST_ASSERT_TRUE(xTaskGetTickCount() - start < kLongTicks / 2);
+  TEST_ASSERT_NOT_EQUAL(seq, topic.seq());
+  // Read, so the next wait times out.
+  TEST_ASSERT_EQUAL(0, reader.Wait(10 / portTICK_PERIOD_MS));
+}
+
+void Test_ReadersOnlyWakeForTheirTopics() {
+  sensor_bus::Topic<Value> bme(sensor_bus::kBme);
+  sensor_bus::Topic<Value> mhz19(sensor_bus::kMhz19);
+  sensor_bus::Reader bme_reader(sensor_bus::kBme);
+  sensor_bus::Reader both(sensor_bus::kBme | sensor_bus::kMhz19);
+  mhz19.Publish({1}, 0);
+  TEST_ASSERT_EQUAL(0, bme_reader.Wait(10 / portTICK_PERIOD_MS));
+  bme.Publish({1}, 0);
+  TEST_ASSERT_EQUAL(sensor_bus::kBme, bme_reader.Wait(kLongTicks));
+  TEST_ASSERT_EQUAL(sensor_bus::kBme | sensor_bus::kMhz19,
+                    both.Wait(kLongTicks));
+}
+
+void Test_WaitNewer() {
+  sensor_bus::Topic<Value> topic(sensor_bus::kAqi);
+  sensor_bus::Reader reader(sensor_bus::kAqi);
+  TEST_ASSERT_FALSE(topic.WaitNewer(&reader, 0, 10 / portTICK_PERIOD_MS));
+  topic.Publish({1}, 0);
+  TEST_ASSERT_TRUE(topic.WaitNewer(&reader, 0, kLongTicks));
+
+  // The bit from the first publish is still latched; the wait goes on
+  // until one newer than seq 1.
+  xTaskCreate(TaskPublishLater, "publish", 4096, &topic, 1, nullptr);
+  TEST_ASSERT_TRUE(topic.WaitNewer(&reader, 1, kLongTicks));
+  TEST_ASSERT_EQUAL(2, topic.Get().value.n);
+}
+
+void Test_ReadersGiveTheirSlotsBack() {
+  sensor_bus::Topic<Value> topic(sensor_bus::kDsco220);
+  // Many more than fit at once, as from one reader per request.
+  for (int i = 0; i < 4 * sensor_bus::Reader::kMaxReaders; ++i) {
+    sensor_bus::Reader reader(sensor_bus::kDsco220);
+    topic.Publish({i}, 0);
+    TEST_ASSERT_EQUAL(sensor_bus::kDsco220, reader.Wait(kLongTicks));
+  }
+}
+
+int RunTests() {
+  sensor_bus::Init();
+  UNITY_BEGIN();
+  RUN_TEST(Test_PublishBetweenCheckAndWaitIsNotLost);
+  RUN_TEST(Test_ReadersOnlyWakeForTheirTopics);
+  RUN_TEST(Test_WaitNewer);
+  RUN_TEST(Test_ReadersGiveTheirSlotsBack);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
+void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
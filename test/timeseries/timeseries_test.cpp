@@ -0,0 +1,169 @@
+#include <math.h>
+#include <timeseries.h>
+#include <unity.h>
+
+using timeseries::Bucket;
+using timeseries::kTiers;
+using timeseries::Point;
+using timeseries::Series;
+
+const unsigned long kSecond = 1000;
+
+// Big: keep them off the stack. Each test starts by clearing series.
+Series series(/*resolution=*/0.1);
+Point points[1024];
+Bucket buckets[1024];
+uint32_t starts_s[1024];
+
+void Test_RollsUpMinMaxMean() {
+  series.Clear();
+  series.Add(1.0, 0);
+  series.Add(3.0, 2 * kSecond);
+  series.Add(2.5, 9 * kSecond);
+  // The next 10 s bucket.
+  series.Add(7.0, 10 * kSecond);
+
+  TEST_ASSERT_EQUAL(2, series.Read(0, 0, points, 1024));
+  TEST_ASSERT_EQUAL(0, points[0].start_s);
+  TEST_ASSERT_EQUAL(3, points[0].count);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 1.0, points[0].min);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 3.0, points[0].max);
+  TEST_ASSERT_FLOAT_WITHIN(0.06, 6.5 / 3, points[0].mean);
+  // Still filling.
+  TEST_ASSERT_EQUAL(10, points[1].start_s);
+  TEST_ASSERT_EQUAL(1, points[1].count);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 7.0, points[1].mean);
+
+  // Every tier sees every sample.
+  TEST_ASSERT_EQUAL(1, series.Read(1, 0, points, 1024));
+  TEST_ASSERT_EQUAL(4, points[0].count);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 1.0, points[0].min);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 7.0, points[0].max);
+  TEST_ASSERT_FLOAT_WITHIN(0.06, 13.5 / 4, points[0].mean);
+  TEST_ASSERT_EQUAL(1, series.Read(2, 0, points, 1024));
+  TEST_ASSERT_EQUAL(4, series.samples());
+}
+
+void Test_SkipsGaps() {
+  series.Clear();
+  series.Add(1.0, 5 * kSecond);
+  series.Add(2.0, 45 * kSecond);
+  TEST_ASSERT_EQUAL(2, series.Read(0, 0, points, 1024));
+  TEST_ASSERT_EQUAL(0, points[0].start_s);
+  TEST_ASSERT_EQUAL(40, points[1].start_s);
+}
+
+void Test_RingKeepsNewest() {
+  series.Clear();
+  const uint32_t bucket_s = kTiers[0].bucket_s;
+  const int buckets = kTiers[0].buckets;
+  // Twice around the ring, a sample a bucket.
+  for (int i = 0; i < 2 * buckets; ++i) {
+    series.Add(i, i * bucket_s * kSecond);
+  }
+  TEST_ASSERT_EQUAL(buckets, series.Read(0, 0, points, 1024));
+  TEST_ASSERT_EQUAL(buckets * bucket_s, points[0].start_s);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, buckets, points[0].mean);
+  TEST_ASSERT_EQUAL((2 * buckets - 1) * bucket_s,
+                    points[buckets - 1].start_s);
+
+  // Gone quiet for longer than the ring: only the new sample is left.
+  series.Add(-1, 10 * buckets * bucket_s * kSecond);
+  TEST_ASSERT_EQUAL(1, series.Read(0, 0, points, 1024));
+  TEST_ASSERT_FLOAT_WITHIN(0.01, -1, points[0].mean);
+}
+
+void Test_ReadSinceAndMaxPoints() {
+  series.Clear();
+  for (int i = 0; i < 10; ++i) {
+    series.Add(i, i * 10 * kSecond);
+  }
+  // Buckets starting at or after since_s.
+  TEST_ASSERT_EQUAL(5, series.Read(0, 45, points, 1024));
+  TEST_ASSERT_EQUAL(50, points[0].start_s);
+  // The newest max_points.
+  TEST_ASSERT_EQUAL(3, series.Read(0, 0, points, 3));
+  TEST_ASSERT_EQUAL(70, points[0].start_s);
+  TEST_ASSERT_EQUAL(90, points[2].start_s);
+}
+
+void Test_ReadsRangeAsStored() {
+  series.Clear();
+  for (int i = 0; i < 10; ++i) {
+    series.Add(i, i * 10 * kSecond);
+  }
+  // Buckets starting from 20 s through 55 s.
+  TEST_ASSERT_EQUAL(4, series.Read(0, 20, 55, buckets, starts_s, 1024));
+  TEST_ASSERT_EQUAL(20, starts_s[0]);
+  TEST_ASSERT_EQUAL(50, starts_s[3]);
+  TEST_ASSERT_EQUAL(20, buckets[0].mean);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 2.0, series.Value(buckets[0].mean));
+  // Through the open bucket, newest kept.
+  TEST_ASSERT_EQUAL(2, series.Read(0, 0, UINT32_MAX, buckets, starts_s, 2));
+  TEST_ASSERT_EQUAL(90, starts_s[1]);
+  TEST_ASSERT_EQUAL(0, series.Read(0, 95, UINT32_MAX, buckets, starts_s, 2));
+}
+
+void Test_DownsampleKeepsShape() {
+  // A flat line with one spike.
+  for (int i = 0; i < 100; ++i) {
+    buckets[i] = {0, 0, static_cast<int16_t>(i == 42 ? 500 : 10), 1};
+    starts_s[i] = 1000 + i * 10;
+  }
+  TEST_ASSERT_EQUAL(10, timeseries::Downsample(buckets, starts_s, 100, 10));
+  TEST_ASSERT_EQUAL(1000, starts_s[0]);
+  TEST_ASSERT_EQUAL(1990, starts_s[9]);
+  bool spike = false;
+  for (int i = 0; i < 10; ++i) {
+    spike |= buckets[i].mean == 500 && starts_s[i] == 1420;
+    if (i > 0) {
+      TEST_ASSERT_TRUE(starts_s[i] > starts_s[i - 1]);
+    }
+  }
+  TEST_ASSERT_TRUE(spike);
+
+  // Nothing to do.
+  TEST_ASSERT_EQUAL(10, timeseries::Downsample(buckets, starts_s, 10, 20));
+}
+
+void Test_QuantizesAndClamps() {
+  static Series pressure(/*resolution=*/1, /*offset=*/100000);
+  pressure.Add(101325.4, 0);
+  pressure.Add(200000, 1 * kSecond);
+  pressure.Add(NAN, 2 * kSecond);
+  TEST_ASSERT_EQUAL(2, pressure.samples());
+  TEST_ASSERT_EQUAL(1, pressure.Read(0, 0, points, 1024));
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 101325, points[0].min);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 132767, points[0].max);
+}
+
+void Test_StartsOverWhenTimeGoesBack() {
+  series.Clear();
+  series.Add(1.0, 1000 * kSecond);
+  series.Add(2.0, 3 * kSecond);
+  TEST_ASSERT_EQUAL(1, series.samples());
+  TEST_ASSERT_EQUAL(1, series.Read(2, 0, points, 1024));
+  TEST_ASSERT_EQUAL(0, points[0].start_s);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 2.0, points[0].mean);
+}
+
+int RunTests() {
+  UNITY_BEGIN();
+  RUN_TEST(Test_RollsUpMinMaxMean);
+  RUN_TEST(Test_SkipsGaps);
+  RUN_TEST(Test_RingKeepsNewest);
+  RUN_TEST(Test_ReadSinceAndMaxPoints);
+  RUN_TEST(Test_ReadsRangeAsStored);
+  RUN_TEST(Test_DownsampleKeepsShape);
+  RUN_TEST(Test_QuantizesAndClamps);
+  RUN_TEST(Test_StartsOverWhenTimeGoesBack);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
+void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
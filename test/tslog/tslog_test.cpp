@@ -0,0 +1,426 @@
+#include <string.h>
+#include <tslog.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <vector>
+
+using tslog::kPageSize;
+using tslog::kSectorSize;
+using tslog::Log;
+using tslog::Sample;
+
+// Flash in RAM, which can lose power part way through a write.
+class RamFlash : public tslog::Flash {
+ public:
+  explicit RamFlash(size_t sectors)
+      : data(sectors * kSectorSize, 0xff), erases(sectors) {}
+
+  size_t size() const override { return data.size(); }
+  bool Read(size_t offset, void* out, size_t size) override {
+    memcpy(out, data.data() + offset, size);
+    return true;
+  }
+  bool Write(size_t offset, const void* in, size_t size) override {
+    for (size_t i = 0; i < size; ++i) {
+      if (write_budget == 0) {
+        return false;
+      }
+      if (write_budget > 0) {
+        --write_budget;
+      }
+      data[offset + i] &= static_cast<const uint8_t*>(in)[i];
+    }
+    return true;
+  }
+  bool Erase(size_t offset, size_t size) override {
+    ++erases[offset / kSectorSize];
+    memset(data.data() + offset, 0xff, size);
+    return true;
+  }
+
+  std::vector<uint8_t> data;
+  std::vector<int> erases;
+  // Bytes programmed before the power goes; -1 for never.
+  long write_budget = -1;
+};
+
+bool Collect(const Sample& sample, void* samples) {
+  reinterpret_cast<std::vector<Sample>*>(samples)->push_back(sample);
+  return true;
+}
+
+std::vector<Sample> ScanAll(Log* log, int stream) {
+  std::vector<Sample> samples;
+  log->Scan(stream, 0, UINT32_MAX, Collect, &samples);
+  return samples;
+}
+
+void AssertSamples(const std::vector<Sample>& expected,
+                   const std::vector<Sample>& actual) {
+  TEST_ASSERT_EQUAL(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    TEST_ASSERT_EQUAL(expected[i].time_s, actual[i].time_s);
+    TEST_ASSERT_EQUAL(expected[i].value, actual[i].value);
+  }
+}
+
+const uint32_t kStart = 1700000000;
+
+// Appends, and writes out any page that filled, as the task writing the log
+// out would get to it before the next.
+bool Append(Log* log, int stream, uint32_t time_s, int16_t value) {
+  const bool ok = log->Append(stream, time_s, value);
+  log->WriteOut();
+  return ok;
+}
+
+void Test_RoundTripsEveryCode() {
+  RamFlash flash(8);
+  Log log(&flash);
+  TEST_ASSERT_TRUE(log.Mount());
+  std::vector<Sample> samples;
+  uint32_t t = kStart;
+  int16_t value = 0;
+  uint32_t x = 1;
+  for (int i = 0; i < 3000; ++i) {
+    x = x * 1103515245 + 12345;
+    // Mostly a second apart and barely moving, with jumps of every size.
+    const int jump = x >> 28;
+    t += jump == 0 ? 100000 : jump == 1 ? 3000 : jump == 2 ? 200 : 1;
+    if (jump == 3) {
+      value = value > 0 ? -30000 : 30000;
+    } else if (jump == 4) {
+      value += value > 0 ? -400 : 400;
+    } else if (jump == 5) {
+      value += value > 0 ? -20 : 20;
+    }
+    samples.push_back({t, value});
+    TEST_ASSERT_TRUE(Append(&log, 2, t, value));
+  }
+  // Those still in RAM included.
+  AssertSamples(samples, ScanAll(&log, 2));
+  log.Flush();
+  AssertSamples(samples, ScanAll(&log, 2));
+  TEST_ASSERT_EQUAL(0, ScanAll(&log, 0).size());
+  TEST_ASSERT_EQUAL(3000, log.stats().samples_written);
+}
+
+void Test_PacksSteadyReadings() {
+  RamFlash flash(16);
+  Log log(&flash);
+  TEST_ASSERT_TRUE(log.Mount());
+  // Once a second, wandering by a step or two.
+  int16_t value = 2150;
+  for (uint32_t i = 0; i < 5000; ++i) {
+    value += (i * 7919) % 5 - 2;
+    Append(&log, 0, kStart + i, value);
+  }
+  const tslog::Stats stats = log.stats();
+  TEST_ASSERT_EQUAL(5000, stats.samples);
+  TEST_ASSERT_TRUE(stats.pages_written > 0);
+  // Seven bits each, and the page headers.
+  TEST_ASSERT_TRUE(stats.bytes_per_sample() < 1.0);
+  TEST_ASSERT_TRUE(stats.write_amplification() < 1.15);
+}
+
+void Test_ScansRangeOfInterleavedStreams() {
+  RamFlash flash(8);
+  Log log(&flash);
+  TEST_ASSERT_TRUE(log.Mount());
+  for (uint32_t i = 0; i < 4000; ++i) {
+    Append(&log, 0, kStart + i, i % 100);
+    // A slow stream, whose pages cover far more time.
+    if (i % 30 == 0) {
+      Append(&log, 1, kStart + i, -static_cast<int16_t>(i / 30));
+    }
+  }
+  log.Flush();
+  std::vector<Sample> samples;
+  TEST_ASSERT_EQUAL(
+      101, log.Scan(0, kStart + 1000, kStart + 1100, Collect, &samples));
+  TEST_ASSERT_EQUAL(kStart + 1000, samples.front().time_s);
+  TEST_ASSERT_EQUAL(kStart + 1100, samples.back().time_s);
+  TEST_ASSERT_EQUAL(0, samples.front().value);
+
+  samples.clear();
+  TEST_ASSERT_EQUAL(
+      3, log.Scan(1, kStart + 1000, kStart + 1100, Collect, &samples));
+  TEST_ASSERT_EQUAL(kStart + 1020, samples.front().time_s);
+  TEST_ASSERT_EQUAL(-34, samples.front().value);
+
+  TEST_ASSERT_EQUAL(
+      0, log.Scan(0, kStart + 5000, UINT32_MAX, Collect, &samples));
+  // Stops when the callback says so.
+  TEST_ASSERT_EQUAL(0, log.Scan(
+                           0, kStart, UINT32_MAX,
+                           [](const Sample&, void*) { return false; },
+                           nullptr));
+}
+
+void Test_RemountPicksUpWhereItLeftOff() {
+  RamFlash flash(8);
+  std::vector<Sample> samples;
+  {
+    Log log(&flash);
+    TEST_ASSERT_TRUE(log.Mount());
+    for (uint32_t i = 0; i < 1000; ++i) {
+      samples.push_back({kStart + i, static_cast<int16_t>(i)});
+      Append(&log, 0, kStart + i, i);
+    }
+    log.Flush();
+  }
+  Log log(&flash);
+  TEST_ASSERT_TRUE(log.Mount());
+  AssertSamples(samples, ScanAll(&log, 0));
+  for (uint32_t i = 1000; i < 2000; ++i) {
+    samples.push_back({kStart + i, static_cast<int16_t>(i)});
+    Append(&log, 0, kStart + i, i);
+  }
+  log.Flush();
+  AssertSamples(samples, ScanAll(&log, 0));
+}
+
+// Part-full pages only live in RAM until Flush(), as before a restart.
+void Test_FlushKeepsPartFullPages() {
+  RamFlash flash(8);
+  std::vector<Sample> pm;
+  std::vector<Sample> co2;
+  {
+    Log log(&flash);
+    TEST_ASSERT_TRUE(log.Mount());
+    for (uint32_t i = 0; i < 20; ++i) {
+      Append(&log, 0, kStart + i * 180, 10);
+    }
+  }
+  {
+    // Restarted without a flush: gone.
+    Log log(&flash);
+    TEST_ASSERT_TRUE(log.Mount());
+    TEST_ASSERT_EQUAL(0, ScanAll(&log, 0).size());
+    for (uint32_t i = 0; i < 20; ++i) {
+      pm.push_back({kStart + i * 180, static_cast<int16_t>(10 + i % 3)});
+      Append(&log, 0, pm.back().time_s, pm.back().value);
+      co2.push_back({kStart + i * 180, static_cast<int16_t>(800 + i)});
+      Append(&log, 1, co2.back().time_s, co2.back().value);
+    }
+    log.Flush();
+  }
+  Log log(&flash);
+  TEST_ASSERT_TRUE(log.Mount());
+  AssertSamples(pm, ScanAll(&log, 0));
+  AssertSamples(co2, ScanAll(&log, 1));
+}
+
+void Test_WrapsOldestFirstAndWearsEvenly() {
+  const size_t kSectors = 4;
+  RamFlash flash(kSectors);
+  Log log(&flash);
+  TEST_ASSERT_TRUE(log.Mount());
+  // Big steps, so pages fill quickly: some 80 pages, five times around.
+  uint32_t i = 0;
+  while (log.stats().pages_written < 5 * log.pages()) {
+    Append(&log, 0, kStart + i * 1000, (i % 2) * 20000);
+    ++i;
+  }
+  for (size_t sector = 0; sector < kSectors; ++sector) {
+    TEST_ASSERT_INT_WITHIN(1, 5, flash.erases[sector]);
+  }
+  const std::vector<Sample> samples = ScanAll(&log, 0);
+  // Three full sectors and some of the one being filled, in order and up
+  // to the last sample appended.
+  TEST_ASSERT_TRUE(samples.size() > 0);
+  for (size_t j = 1; j < samples.size(); ++j) {
+    TEST_ASSERT_EQUAL(samples[j - 1].time_s + 1000, samples[j].time_s);
+  }
+  TEST_ASSERT_EQUAL(i, (samples.back().time_s - kStart) / 1000 + 1);
+
+  // The oldest pages left are still found by time.
+  std::vector<Sample> range;
+  log.Scan(0, samples[10].time_s, samples[20].time_s, Collect, &range);
+  TEST_ASSERT_EQUAL(11, range.size());
+}
+
+void Test_SurvivesPowerLossMidWrite() {
+  RamFlash flash(8);
+  std::vector<Sample> samples;
+  {
+    Log log(&flash);
+    TEST_ASSERT_TRUE(log.Mount());
+    for (uint32_t i = 0; i < 2000; ++i) {
+      samples.push_back({kStart + i, static_cast<int16_t>(i)});
+      Append(&log, 0, kStart + i, i);
+    }
+    log.Flush();
+    // The next page only gets part way.
+    for (uint32_t i = 2000; i < 2100; ++i) {
+      Append(&log, 0, kStart + i, i);
+    }
+    flash.write_budget = kPageSize / 4;
+    log.Flush();
+    flash.write_budget = -1;
+  }
+  Log log(&flash);
+  TEST_ASSERT_TRUE(log.Mount());
+  TEST_ASSERT_EQUAL(1, log.stats().bad_pages);
+  AssertSamples(samples, ScanAll(&log, 0));
+  // New pages go after the torn one.
+  for (uint32_t i = 3000; i < 3100; ++i) {
+    samples.push_back({kStart + i, static_cast<int16_t>(i)});
+    Append(&log, 0, kStart + i, i);
+  }
+  log.Flush();
+  AssertSamples(samples, ScanAll(&log, 0));
+}
+
+// Appends big steps to stream 0 until pages are on flash; returns them.
+std::vector<Sample> FillPages(Log* log, size_t pages, uint32_t* i) {
+  std::vector<Sample> samples;
+  while (log->stats().pages_written < pages) {
+    samples.push_back({kStart + *i * 1000,
+                       static_cast<int16_t>((*i % 2) * 20000)});
+    Append(log, 0, samples.back().time_s, samples.back().value);
+    ++*i;
+  }
+  // The last one started the page still in RAM.
+  samples.pop_back();
+  return samples;
+}
+
+// The samples of the page at offset, and it corrupted.
+std::vector<Sample> Corrupt(RamFlash* flash, size_t offset) {
+  std::vector<Sample> samples;
+  tslog::PageInfo info;
+  TEST_ASSERT_TRUE(tslog::ParsePage(&flash->data[offset], &info));
+  tslog::DecodePage(&flash->data[offset], Collect, &samples);
+  flash->data[offset + tslog::kHeaderSize] ^= 0x55;
+  return samples;
+}
+
+std::vector<Sample> Without(const std::vector<Sample>& samples,
+                            const std::vector<Sample>& dropped) {
+  std::vector<Sample> kept;
+  for (const Sample& sample : samples) {
+    bool drop = false;
+    for (const Sample& d : dropped) {
+      drop = drop || d.time_s == sample.time_s;
+    }
+    if (!drop) {
+      kept.push_back(sample);
+    }
+  }
+  return kept;
+}
+
+void Test_MountFindsNewestSectorPastABadFirstPage() {
+  RamFlash flash(8);
+  std::vector<Sample> samples;
+  {
+    Log log(&flash);
+    TEST_ASSERT_TRUE(log.Mount());
+    uint32_t i = 0;
+    samples = FillPages(&log, tslog::kPagesPerSector + 3, &i);
+  }
+  // Sector 1 is the newest, and its first page no longer reads.
+  samples = Without(samples, Corrupt(&flash, kSectorSize));
+  const int erases = flash.erases[1];
+
+  Log log(&flash);
+  TEST_ASSERT_TRUE(log.Mount());
+  // Still going after sector 1's pages, not starting it over.
+  TEST_ASSERT_EQUAL(1, log.stats().bad_pages);
+  AssertSamples(samples, ScanAll(&log, 0));
+  const uint32_t next_s = samples.back().time_s + 1000;
+  samples.push_back({next_s, 7});
+  Append(&log, 0, next_s, 7);
+  log.Flush();
+  TEST_ASSERT_EQUAL(erases, flash.erases[1]);
+  AssertSamples(samples, ScanAll(&log, 0));
+}
+
+void Test_ScanSearchesPastSectorsItCantDate() {
+  RamFlash flash(8);
+  Log log(&flash);
+  TEST_ASSERT_TRUE(log.Mount());
+  uint32_t i = 0;
+  std::vector<Sample> samples = FillPages(&log, 6 * tslog::kPagesPerSector, &i);
+  // Torn first pages in sectors 1 to 5, and nothing whole left in 4.
+  for (size_t sector = 1; sector < 6; ++sector) {
+    samples = Without(samples, Corrupt(&flash, sector * kSectorSize));
+  }
+  for (size_t page = 1; page < tslog::kPagesPerSector; ++page) {
+    samples = Without(samples, Corrupt(&flash, 4 * kSectorSize +
+                                                   page * kPageSize));
+  }
+
+  // Ranges starting in every sector, and the gap where 4 was.
+  for (size_t from = 0; from < samples.size(); from += samples.size() / 13) {
+    const size_t to = std::min(from + 30, samples.size() - 1);
+    std::vector<Sample> range;
+    log.Scan(0, samples[from].time_s, samples[to].time_s, Collect, &range);
+    AssertSamples(std::vector<Sample>(samples.begin() + from,
+                                      samples.begin() + to + 1),
+                  range);
+  }
+}
+
+void Test_AppendLeavesTheFlashToWriteOut() {
+  RamFlash flash(8);
+  Log log(&flash);
+  TEST_ASSERT_TRUE(log.Mount());
+  const std::vector<uint8_t> blank = flash.data;
+  // Big steps, so pages fill quickly, until one doesn't fit on the queue.
+  std::vector<Sample> samples;
+  for (uint32_t i = 0; log.stats().dropped_pages == 0; ++i) {
+    samples.push_back({kStart + i * 1000,
+                       static_cast<int16_t>((i % 2) * 20000)});
+    log.Append(0, samples.back().time_s, samples.back().value);
+  }
+  TEST_ASSERT_TRUE(flash.data == blank);
+  TEST_ASSERT_EQUAL(0, flash.erases[0]);
+  TEST_ASSERT_EQUAL(0, log.stats().pages_written);
+
+  // The queued pages are found, then the sample that started a new page.
+  const std::vector<Sample> found = ScanAll(&log, 0);
+  TEST_ASSERT_TRUE(found.size() < samples.size());
+  AssertSamples(std::vector<Sample>(samples.begin(),
+                                    samples.begin() + found.size() - 1),
+                std::vector<Sample>(found.begin(), found.end() - 1));
+  TEST_ASSERT_EQUAL(samples.back().time_s, found.back().time_s);
+
+  TEST_ASSERT_TRUE(log.WriteOut());
+  TEST_ASSERT_EQUAL(Log::kMaxQueuedPages, log.stats().pages_written);
+  TEST_ASSERT_EQUAL(1, flash.erases[0]);
+  AssertSamples(found, ScanAll(&log, 0));
+}
+
+void Test_RejectsTooLittleFlash() {
+  RamFlash flash(1);
+  Log log(&flash);
+  TEST_ASSERT_FALSE(log.Mount());
+  TEST_ASSERT_FALSE(log.Append(0, kStart, 1));
+}
+
+int RunTests() {
+  UNITY_BEGIN();
+  RUN_TEST(Test_RoundTripsEveryCode);
+  RUN_TEST(Test_PacksSteadyReadings);
+  RUN_TEST(Test_ScansRangeOfInterleavedStreams);
+  RUN_TEST(Test_RemountPicksUpWhereItLeftOff);
+  RUN_TEST(Test_FlushKeepsPartFullPages);
+  RUN_TEST(Test_WrapsOldestFirstAndWearsEvenly);
+  RUN_TEST(Test_SurvivesPowerLossMidWrite);
+  RUN_TEST(Test_MountFindsNewestSectorPastABadFirstPage);
+  RUN_TEST(Test_ScanSearchesPastSectorsItCantDate);
+  RUN_TEST(Test_AppendLeavesTheFlashToWriteOut);
+  RUN_TEST(Test_RejectsTooLittleFlash);
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() { RunTests(); }
+
+void loop() {}
+#else
+int main() { return RunTests(); }
+#endif
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Embeds a file in a C++ header, gzipped, to be served straight from flash.
+
+  tools/embed_gzip.py lib/ui/shell.html lib/ui/shell_html_gz.h kShellHtml
+
+writes kShellHtmlGz[] and its size, plus kShellHtmlEtag, a quoted ETag made
+from a hash of the uncompressed file. With --check, nothing is written; the
+exit status says whether the header is up to date with the file.
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+
+def etag(data):
+    return '"%s"' % hashlib.sha256(data).hexdigest()[:16]
+
+
+def render(source_name, header_name, name, data):
+    compressed = gzip.compress(data, compresslevel=9, mtime=0)
+    guard = '_%s_' % re.sub(r'\W', '_', header_name).upper()
+    lines = [
+        '// Generated by tools/embed_gzip.py from %s; do not edit.' %
+        source_name,
+        '',
+        '#ifndef %s' % guard,
+        '#define %s' % guard,
+        '',
+        '#include <stddef.h>',
+        '#include <stdint.h>',
+        '',
+        '// %d bytes, %d gzipped.' % (len(data), len(compressed)),
+        'const char %sEtag[] = R"(%s)";' % (name, etag(data)),
+        'const size_t %sGzSize = %d;' % (name, len(compressed)),
+        'const uint8_t %sGz[] = {' % name,
+    ]
+    for i in range(0, len(compressed), 12):
+        lines.append('    ' + ' '.join(
+            '0x%02x,' % b for b in compressed[i:i + 12]))
+    lines += ['};', '', '#endif  // %s' % guard, '']
+    return '\n'.join(lines)
+
+
+parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+parser.add_argument('source')
+parser.add_argument('header')
+parser.add_argument('name', help='prefix of the generated names')
+parser.add_argument('--check', action='store_true',
+                    help='fail if the header is stale instead of writing it')
+args = parser.parse_args()
+
+with open(args.source, 'rb') as f:
+    data = f.read()
+
+if args.check:
+    # Compare the ETag rather than the bytes, which vary with zlib versions.
+    try:
+        with open(args.header) as f:
+            header = f.read()
+    except FileNotFoundError:
+        header = ''
+    if ('%sEtag[] = R"(%s)"' % (args.name, etag(data))) not in header:
+        sys.exit('%s is stale; run tools/embed_gzip.py %s %s %s' %
+                 (args.header, args.source, args.header, args.name))
+    sys.exit(0)
+
+with open(args.header, 'w') as f:
+    f.write(render(os.path.basename(args.source),
+                   os.path.basename(args.header), args.name, data))